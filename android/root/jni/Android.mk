@@ -11,6 +11,7 @@ LOCAL_SRC_FILES = \
 config/oor_config_confuse.c    \
 		  config/oor_config_functions.c  \
    		  control/oor_control.c          \
+		  control/ctrl_pacer.c           \
 		  control/oor_ctrl_device.c      \
 		  control/oor_local_db.c         \
 		  control/oor_map_cache.c        \
@@ -22,6 +23,7 @@ config/oor_config_confuse.c    \
 		  data-plane/encapsulations/vxlan-gpe.c              \
 		  data-plane/tun/tun.c           \
 		  data-plane/tun/tun_input.c     \
+		  data-plane/tun/tun_offload.c   \
 		  data-plane/tun/tun_output.c    \
 		  elibs/mbedtls/md.c             \
 		  elibs/mbedtls/sha1.c           \
@@ -31,6 +33,7 @@ config/oor_config_confuse.c    \
 		  fwd_policies/fwd_policy.c	     \
 		  fwd_policies/flow_balancing/fb_addr_func.c         \
 		  fwd_policies/flow_balancing/flow_balancing.c       \
+		  fwd_policies/maglev/maglev.c   \
 		  liblisp/liblisp.c              \
 		  liblisp/lisp_address.c         \
 		  liblisp/lisp_data.c            \
@@ -40,6 +43,7 @@ config/oor_config_confuse.c    \
 		  liblisp/lisp_mapping.c         \
 		  liblisp/lisp_messages.c        \
 		  liblisp/lisp_message_fields.c  \
+		  lib/addr_key.c                 \
 		  lib/cksum.c                    \
 		  lib/generic_list.c             \
 		  lib/hmac.c                     \
@@ -47,15 +51,24 @@ config/oor_config_confuse.c    \
 		  lib/int_table.c                \
 		  lib/lbuf.c                     \
 		  lib/lisp_site.c                \
+		  lib/loct_set.c                 \
+		  lib/lpm_trie.c                 \
+		  lib/lru_list.c                 \
 		  lib/oor_log.c                  \
 		  lib/mapping_db.c               \
 		  lib/map_cache_entry.c          \
 		  lib/map_local_entry.c		     \
+          lib/mcast_table.c              \
           lib/mem_util.c	    	     \
           lib/nonces_table.c             \
           lib/packets.c                  \
+          lib/pmtu_table.c               \
+          lib/rloc_probe_table.c         \
+          lib/rloc_reach_table.c         \
+          lib/peer_activity.c           \
           lib/pointers_table.c           \
 		  lib/prefixes.c                 \
+		  lib/reencap_table.c            \
 		  lib/routing_tables_lib.c       \
 		  lib/sockets.c                  \
 		  lib/sockets-util.c             \
@@ -107,6 +107,25 @@ oor_api_result_msg_new(uint8_t **buf,oor_api_msg_device_e  dev,
     return (sizeof(oor_api_msg_hdr_t)+sizeof(oor_api_msg_result_e));
 }
 
+int
+oor_api_result_msg_new_with_data(uint8_t **buf,oor_api_msg_device_e  dev,
+        oor_api_msg_target_e trgt, oor_api_msg_opr_e opr,
+        oor_api_msg_result_e res, uint8_t *data, int dlen)
+{
+    oor_api_msg_hdr_t hdr;
+    uint8_t *ptr;
+    int len;
+
+    len = sizeof(oor_api_msg_result_e) + dlen;
+    oor_api_fill_hdr(&hdr,dev,trgt,opr,OOR_API_TYPE_RESULT,len);
+    *buf = xzalloc(sizeof(oor_api_msg_hdr_t)+len);
+    ptr = oor_api_hdr_push(*buf,&hdr);
+    memcpy(ptr, &res,sizeof(oor_api_msg_result_e));
+    memcpy(CO(ptr,sizeof(oor_api_msg_result_e)), data, dlen);
+
+    return (sizeof(oor_api_msg_hdr_t)+len);
+}
+
 
 int
 oor_api_recv(oor_api_connection_t *conn, void *buffer, int flags)
@@ -56,7 +56,8 @@ typedef enum oor_api_msg_target_e_ {
     OOR_API_TRGT_MSLIST,
     OOR_API_TRGT_PETRLIST,
     OOR_API_TRGT_MAPCACHE,
-    OOR_API_TRGT_MAPDB
+    OOR_API_TRGT_MAPDB,
+    OOR_API_TRGT_RLOCPROBES
 
 } oor_api_msg_target_e; //Target of the operation
 
@@ -136,6 +137,11 @@ int oor_api_result_msg_new(uint8_t **buf,oor_api_msg_device_e  dev,
         oor_api_msg_target_e trgt, oor_api_msg_opr_e opr,
         oor_api_msg_result_e res);
 
+/* Result message followed by 'dlen' bytes of 'data' */
+int oor_api_result_msg_new_with_data(uint8_t **buf,oor_api_msg_device_e  dev,
+        oor_api_msg_target_e trgt, oor_api_msg_opr_e opr,
+        oor_api_msg_result_e res, uint8_t *data, int dlen);
+
 int oor_api_apply_config(oor_api_connection_t *conn, int dev, int trgt, int opr,
         uint8_t *data, int dlen);
 
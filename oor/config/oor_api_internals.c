@@ -933,7 +933,7 @@ oor_api_xtr_petrs_create(oor_api_connection_t *conn, oor_api_msg_hdr_t *hdr,
     doc = NULL;
 
     //Everything fine. We replace the old list with the new one
-    glist_remove_all(mapping_locators_lists(mcache_entry_mapping(xtr->petrs)));
+    mapping_remove_locators(mcache_entry_mapping(xtr->petrs));
     glist_for_each_entry(addr_it,str_addr_list){
         str_addr = (char *)glist_entry_data(addr_it);
         add_proxy_etr_entry(xtr->petrs,str_addr,1,100);
@@ -975,7 +975,7 @@ oor_api_xtr_petrs_delete(oor_api_connection_t *conn, oor_api_msg_hdr_t *hdr,
 
     xtr = CONTAINER_OF(ctrl_dev, lisp_xtr_t, super);
 
-    glist_remove_all(mapping_locators_lists(mcache_entry_mapping(xtr->petrs)));
+    mapping_remove_locators(mcache_entry_mapping(xtr->petrs));
 
     result_msg_len = oor_api_result_msg_new(&result_msg,hdr->device,hdr->target,hdr->operation,OOR_API_RES_OK);
     oor_api_send(conn,result_msg,result_msg_len,OOR_API_NOFLAGS);
@@ -983,6 +983,81 @@ oor_api_xtr_petrs_delete(oor_api_connection_t *conn, oor_api_msg_hdr_t *hdr,
     return (GOOD);
 }
 
+static xmlNodePtr
+lxml_new_uint_child(xmlNodePtr parent, char *name, uint32_t value)
+{
+    char str[16];
+
+    snprintf(str, sizeof(str), "%u", value);
+    return (xmlNewChild(parent, NULL, BAD_CAST name, BAD_CAST str));
+}
+
+/* Reply with the state and the RTT measured for each RLOC probed:
+ * <rloc-probes><rloc-probe><rloc-address/><state/><rtt/><rtt-var/><samples/>
+ * </rloc-probe>...</rloc-probes>. RTT in microseconds. The RLOCs that don't
+ * fit in an API message are not included */
+int
+oor_api_xtr_rloc_probes_read(oor_api_connection_t *conn, oor_api_msg_hdr_t *hdr,
+        uint8_t *data)
+{
+    lisp_xtr_t *xtr;
+    rloc_probe_t *probe;
+    uint8_t *result_msg;
+    int result_msg_len;
+    xmlDocPtr doc;
+    xmlNodePtr root, node;
+    xmlChar *xml = NULL;
+    int xml_len = 0;
+    int max_len;
+    int count = 0;
+
+    OOR_LOG(LDBG_2, "OOR_API: Reading RTT of the RLOCs probed");
+
+    xtr = CONTAINER_OF(ctrl_dev, lisp_xtr_t, super);
+    max_len = MAX_API_PKT_LEN - sizeof(oor_api_msg_hdr_t) - sizeof(oor_api_msg_result_e);
+
+    doc = xmlNewDoc(BAD_CAST "1.0");
+    root = xmlNewNode(NULL, BAD_CAST "rloc-probes");
+    xmlDocSetRootElement(doc, root);
+
+    rloc_probe_table_foreach(&xtr->rloc_probes, probe) {
+        node = xmlNewChild(root, NULL, BAD_CAST "rloc-probe", NULL);
+        xmlNewChild(node, NULL, BAD_CAST "rloc-address",
+                BAD_CAST lisp_addr_to_char(probe->rloc));
+        xmlNewChild(node, NULL, BAD_CAST "state", BAD_CAST (!probe->probed ?
+                "unknown" : (probe->state == UP ? "up" : "down")));
+        lxml_new_uint_child(node, "rtt", probe->srtt);
+        lxml_new_uint_child(node, "rtt-var", probe->rttvar);
+        lxml_new_uint_child(node, "samples", probe->samples);
+
+        xmlFree(xml);
+        xmlDocDumpMemory(doc, &xml, &xml_len);
+        if (xml_len > max_len) {
+            OOR_LOG(LDBG_1, "OOR_API: Only %d RLOCs of %d fit in the reply",
+                    count, rloc_probe_table_size(&xtr->rloc_probes));
+            xmlUnlinkNode(node);
+            xmlFreeNode(node);
+            xmlFree(xml);
+            xmlDocDumpMemory(doc, &xml, &xml_len);
+            break;
+        }
+        count++;
+    } rloc_probe_table_foreach_end;
+
+    if (xml == NULL) {
+        xmlDocDumpMemory(doc, &xml, &xml_len);
+    }
+    xmlFreeDoc(doc);
+
+    result_msg_len = oor_api_result_msg_new_with_data(&result_msg,hdr->device,
+            hdr->target,hdr->operation,OOR_API_RES_OK,(uint8_t *)xml,xml_len);
+    oor_api_send(conn,result_msg,result_msg_len,OOR_API_NOFLAGS);
+    free(result_msg);
+    xmlFree(xml);
+
+    return (GOOD);
+}
+
 
 int
 (*oor_api_get_proc_func(oor_api_msg_hdr_t* hdr))(oor_api_connection_t *,
@@ -1063,6 +1138,17 @@ int
                 break;
             }
             break;
+        case OOR_API_TRGT_RLOCPROBES:
+            switch (operation){
+            case OOR_API_OPR_READ:
+                OOR_LOG(LDBG_2, "OOR_API call = (Device: xTR | Target: RLOC probes | Operation: Read)");
+                process_func = oor_api_xtr_rloc_probes_read;
+                break;
+            default:
+                OOR_LOG(LWRN, "OOR_API call = (Device: xTR | Target: RLOC probes | Operation: Unsupported)");
+                break;
+            }
+            break;
         default:
         	OOR_LOG(LWRN, "OOR_API call = (Device: xTR | Target: Unsupported)");
             break;
@@ -346,10 +346,18 @@ configure_tunnel_router(cfg_t *cfg, lisp_xtr_t *xtr, shash_t *lcaf_ht)
     int i,n,ret;
     char *map_resolver;
     char *encap;
+    char *fwd_policy;
     mapping_t *mapping;
 
     /* FWD POLICY STRUCTURES */
-    xtr->fwd_policy = fwd_policy_class_find("flow_balancing");
+    if ((fwd_policy = cfg_getstr(cfg, "fwd-policy")) == NULL) {
+        fwd_policy = "flow_balancing";
+    }
+    OOR_LOG(LDBG_1, "Forward policy: %s", fwd_policy);
+    xtr->fwd_policy = fwd_policy_class_find(fwd_policy);
+    if (xtr->fwd_policy == NULL) {
+        return (BAD);
+    }
     xtr->fwd_policy_dev_parm = xtr->fwd_policy->new_dev_policy_inf(ctrl_dev,NULL);
 
     if ((encap = cfg_getstr(cfg, "encapsulation")) != NULL) {
@@ -367,6 +375,19 @@ configure_tunnel_router(cfg_t *cfg, lisp_xtr_t *xtr, shash_t *lcaf_ht)
     ret = cfg_getint(cfg, "map-request-retries");
     xtr->map_request_retries = (ret != 0) ? ret : DEFAULT_MAP_REQUEST_RETRIES;
 
+    /* CONTROL PACING */
+    ctrl_pacer_set_rates(&lctrl->pacer, cfg_getint(cfg, "control-pacing-rate"),
+            cfg_getint(cfg, "control-pacing-global-rate"));
+
+    /* MAP-CACHE REFRESH */
+    ret = cfg_getint(cfg, "map-cache-refresh");
+    if (ret < 0 || ret > 99){
+        OOR_LOG(LWRN, "map-cache-refresh should be a percentage of the TTL "
+                "between 0 and 99. Disabling it");
+        ret = 0;
+    }
+    xtr->mcache_refresh = ret;
+
 
     /* RLOC PROBING CONFIG */
     cfg_t *dm = cfg_getnsec(cfg, "rloc-probing", 0);
@@ -542,6 +563,17 @@ configure_xtr(cfg_t *cfg)
         default_rloc_afi = AF_INET;
         OOR_LOG(LDBG_1, "NAT support enabled. Set defaul RLOC to IPv4 family");
     }
+    xtr->glean_mappings = cfg_getbool(cfg, "glean-mappings") ? TRUE:FALSE;
+    xtr->map_versioning = cfg_getbool(cfg, "map-versioning") ? TRUE:FALSE;
+    xtr->smr_active_peers = cfg_getbool(cfg, "smr-active-peers") ? TRUE:FALSE;
+    xtr->pubsub = cfg_getbool(cfg, "pubsub") ? TRUE:FALSE;
+    /* The Map-Server identifies the subscriptions by the xTR-ID */
+    if (xtr->pubsub && !xtr->nat_aware){
+        if (nat_set_xTR_ID(xtr) != GOOD){
+            return (BAD);
+        }
+        nat_set_site_ID(xtr, 0);
+    }
 
     if (configure_tunnel_router(cfg, xtr, lcaf_ht)!=GOOD){
         return (BAD);
@@ -594,6 +626,17 @@ configure_mn(cfg_t *cfg)
         default_rloc_afi = AF_INET;
         OOR_LOG(LDBG_1, "NAT support enabled. Set defaul RLOC to IPv4 family");
     }
+    xtr->glean_mappings = cfg_getbool(cfg, "glean-mappings") ? TRUE:FALSE;
+    xtr->map_versioning = cfg_getbool(cfg, "map-versioning") ? TRUE:FALSE;
+    xtr->smr_active_peers = cfg_getbool(cfg, "smr-active-peers") ? TRUE:FALSE;
+    xtr->pubsub = cfg_getbool(cfg, "pubsub") ? TRUE:FALSE;
+    /* The Map-Server identifies the subscriptions by the xTR-ID */
+    if (xtr->pubsub && !xtr->nat_aware){
+        if (nat_set_xTR_ID(xtr) != GOOD){
+            return (BAD);
+        }
+        nat_set_site_ID(xtr, 0);
+    }
 
     if (configure_tunnel_router(cfg, xtr, lcaf_ht)!=GOOD){
         return (BAD);
@@ -859,8 +902,12 @@ handle_config_file()
             CFG_SEC("rtr-ifaces",           rtr_ifaces_opts,        CFGF_MULTI),
             CFG_SEC("proxy-etr",            petr_mapping_opts,      CFGF_MULTI),
             CFG_STR("encapsulation",        0,                      CFGF_NONE),
+            CFG_STR("fwd-policy",           0,                      CFGF_NONE),
             CFG_SEC("rloc-probing",         rloc_probing_opts,      CFGF_MULTI),
             CFG_INT("map-request-retries",  0, CFGF_NONE),
+            CFG_INT("map-cache-refresh",    0, CFGF_NONE),
+            CFG_INT("control-pacing-rate",  0, CFGF_NONE),
+            CFG_INT("control-pacing-global-rate", 0, CFGF_NONE),
             CFG_INT("control-port",         0, CFGF_NONE),
             CFG_INT("debug",                0, CFGF_NONE),
             CFG_STR("log-file",             0, CFGF_NONE),
@@ -874,6 +921,10 @@ handle_config_file()
 #endif
             CFG_STR("operating-mode",       0, CFGF_NONE),
             CFG_BOOL("nat_traversal_support", cfg_false, CFGF_NONE),
+            CFG_BOOL("glean-mappings",      cfg_false, CFGF_NONE),
+            CFG_BOOL("map-versioning",      cfg_false, CFGF_NONE),
+            CFG_BOOL("smr-active-peers",    cfg_false, CFGF_NONE),
+            CFG_BOOL("pubsub",              cfg_false, CFGF_NONE),
             CFG_STR("control-iface",        0, CFGF_NONE),
             CFG_STR("rtr-data-iface",        0, CFGF_NONE),
             CFG_SEC("lisp-site",            lisp_site_opts,         CFGF_MULTI),
@@ -87,6 +87,16 @@ parse_elp_node(
         struct uci_section      *section,
         shash_t                *ht);
 
+static fwd_policy_class *
+parse_fwd_policy(
+        struct uci_context      *ctx,
+        struct uci_package      *pck);
+
+static void
+parse_ctrl_pacing(
+        struct uci_context      *ctx,
+        struct uci_package      *pck);
+
 /********************************** FUNCTIONS ********************************/
 
 int
@@ -191,6 +201,11 @@ configure_xtr(struct uci_context *ctx, struct uci_package *pck)
     int uci_retries;
     char *uci_address;
     char *uci_nat_aware;
+    char *uci_glean;
+    char *uci_map_versioning;
+    char *uci_smr_peers;
+    char *uci_pubsub;
+    int uci_refresh;
     int uci_key_type;
     char *uci_key;
     int uci_proxy_reply;
@@ -212,8 +227,14 @@ configure_xtr(struct uci_context *ctx, struct uci_package *pck)
 
     xtr = CONTAINER_OF(ctrl_dev, lisp_xtr_t, super);
 
+    /* CONTROL PACING */
+    parse_ctrl_pacing(ctx, pck);
+
     /* FWD POLICY STRUCTURES */
-    xtr->fwd_policy = fwd_policy_class_find("flow_balancing");
+    xtr->fwd_policy = parse_fwd_policy(ctx, pck);
+    if (xtr->fwd_policy == NULL){
+        return (BAD);
+    }
     xtr->fwd_policy_dev_parm = xtr->fwd_policy->new_dev_policy_inf(ctrl_dev,NULL);
 
     /* CREATE LCAFS HTABLE */
@@ -236,7 +257,9 @@ configure_xtr(struct uci_context *ctx, struct uci_package *pck)
             uci_nat_aware = uci_lookup_option_string(ctx, sect, "nat_traversal_support");
             if (uci_nat_aware && strcmp(uci_nat_aware, "on") == 0){
                 xtr->nat_aware  = TRUE;
-                nat_set_xTR_ID(xtr);
+                if (nat_set_xTR_ID(xtr) != GOOD){
+                    return (BAD);
+                }
                 nat_set_site_ID(xtr, 0);
                 default_rloc_afi = AF_INET;
                 OOR_LOG(LDBG_1, "NAT support enabled. Set defaul RLOC to IPv4 family");
@@ -252,6 +275,39 @@ configure_xtr(struct uci_context *ctx, struct uci_package *pck)
             sect = uci_to_section(element);
             if (strcmp(sect->type, "daemon") == 0){
 
+                /* GLEANING */
+                uci_glean = (char *)uci_lookup_option_string(ctx, sect, "glean_mappings");
+                xtr->glean_mappings = (uci_glean && strcmp(uci_glean, "on") == 0) ? TRUE : FALSE;
+
+                /* MAP-VERSIONING */
+                uci_map_versioning = (char *)uci_lookup_option_string(ctx, sect, "map_versioning");
+                xtr->map_versioning = (uci_map_versioning && strcmp(uci_map_versioning, "on") == 0) ? TRUE : FALSE;
+
+                /* SMRs ONLY TO ACTIVE PEERS */
+                uci_smr_peers = (char *)uci_lookup_option_string(ctx, sect, "smr_active_peers");
+                xtr->smr_active_peers = (uci_smr_peers && strcmp(uci_smr_peers, "on") == 0) ? TRUE : FALSE;
+
+                /* PUBLISH/SUBSCRIBE */
+                uci_pubsub = (char *)uci_lookup_option_string(ctx, sect, "pubsub");
+                xtr->pubsub = (uci_pubsub && strcmp(uci_pubsub, "on") == 0) ? TRUE : FALSE;
+                if (xtr->pubsub && !xtr->nat_aware){
+                    if (nat_set_xTR_ID(xtr) != GOOD){
+                        return (BAD);
+                    }
+                    nat_set_site_ID(xtr, 0);
+                }
+
+                /* MAP-CACHE REFRESH */
+                if (uci_lookup_option_string(ctx, sect, "map_cache_refresh") != NULL){
+                    uci_refresh = strtol(uci_lookup_option_string(ctx, sect, "map_cache_refresh"),NULL,10);
+                    if (uci_refresh >= 0 && uci_refresh <= 99){
+                        xtr->mcache_refresh = uci_refresh;
+                    }else{
+                        OOR_LOG(LWRN, "Map-cache refresh should be a percentage of the TTL "
+                                "between 0 and 99. Disabling it");
+                    }
+                }
+
                 /* RETRIES */
                 if (uci_lookup_option_string(ctx, sect, "map_request_retries") != NULL){
                     uci_retries = strtol(uci_lookup_option_string(ctx, sect, "map_request_retries"),NULL,10);
@@ -474,6 +530,11 @@ configure_mn(struct uci_context *ctx, struct uci_package *pck)
     int uci_key_type;
     char *uci_key;
     char *uci_nat_aware;
+    char *uci_glean;
+    char *uci_map_versioning;
+    char *uci_smr_peers;
+    char *uci_pubsub;
+    int uci_refresh;
     int uci_proxy_reply;
     int uci_priority;
     int uci_weigth;
@@ -494,8 +555,14 @@ configure_mn(struct uci_context *ctx, struct uci_package *pck)
 
     xtr = CONTAINER_OF(ctrl_dev, lisp_xtr_t, super);
 
+    /* CONTROL PACING */
+    parse_ctrl_pacing(ctx, pck);
+
     /* FWD POLICY STRUCTURES */
-    xtr->fwd_policy = fwd_policy_class_find("flow_balancing");
+    xtr->fwd_policy = parse_fwd_policy(ctx, pck);
+    if (xtr->fwd_policy == NULL){
+        return (BAD);
+    }
     xtr->fwd_policy_dev_parm = xtr->fwd_policy->new_dev_policy_inf(ctrl_dev,NULL);
 
     /* CREATE LCAFS HTABLE */
@@ -518,7 +585,9 @@ configure_mn(struct uci_context *ctx, struct uci_package *pck)
             uci_nat_aware = uci_lookup_option_string(ctx, sect, "nat_traversal_support");
             if (uci_nat_aware && strcmp(uci_nat_aware, "on") == 0){
                 xtr->nat_aware  = TRUE;
-                nat_set_xTR_ID(xtr);
+                if (nat_set_xTR_ID(xtr) != GOOD){
+                    return (BAD);
+                }
                 nat_set_site_ID(xtr, 0);
                 default_rloc_afi = AF_INET;
                 OOR_LOG(LDBG_1, "NAT support enabled. Set defaul RLOC to IPv4 family");
@@ -534,6 +603,39 @@ configure_mn(struct uci_context *ctx, struct uci_package *pck)
         sect = uci_to_section(element);
         if (strcmp(sect->type, "daemon") == 0){
 
+            /* GLEANING */
+            uci_glean = (char *)uci_lookup_option_string(ctx, sect, "glean_mappings");
+            xtr->glean_mappings = (uci_glean && strcmp(uci_glean, "on") == 0) ? TRUE : FALSE;
+
+            /* MAP-VERSIONING */
+            uci_map_versioning = (char *)uci_lookup_option_string(ctx, sect, "map_versioning");
+            xtr->map_versioning = (uci_map_versioning && strcmp(uci_map_versioning, "on") == 0) ? TRUE : FALSE;
+
+            /* SMRs ONLY TO ACTIVE PEERS */
+            uci_smr_peers = (char *)uci_lookup_option_string(ctx, sect, "smr_active_peers");
+            xtr->smr_active_peers = (uci_smr_peers && strcmp(uci_smr_peers, "on") == 0) ? TRUE : FALSE;
+
+            /* PUBLISH/SUBSCRIBE */
+            uci_pubsub = (char *)uci_lookup_option_string(ctx, sect, "pubsub");
+            xtr->pubsub = (uci_pubsub && strcmp(uci_pubsub, "on") == 0) ? TRUE : FALSE;
+            if (xtr->pubsub && !xtr->nat_aware){
+                if (nat_set_xTR_ID(xtr) != GOOD){
+                    return (BAD);
+                }
+                nat_set_site_ID(xtr, 0);
+            }
+
+            /* MAP-CACHE REFRESH */
+            if (uci_lookup_option_string(ctx, sect, "map_cache_refresh") != NULL){
+                uci_refresh = strtol(uci_lookup_option_string(ctx, sect, "map_cache_refresh"),NULL,10);
+                if (uci_refresh >= 0 && uci_refresh <= 99){
+                    xtr->mcache_refresh = uci_refresh;
+                }else{
+                    OOR_LOG(LWRN, "Map-cache refresh should be a percentage of the TTL "
+                            "between 0 and 99. Disabling it");
+                }
+            }
+
             /* RETRIES */
             if (uci_lookup_option_string(ctx, sect, "map_request_retries") != NULL){
                 uci_retries = strtol(uci_lookup_option_string(ctx, sect, "map_request_retries"),NULL,10);
@@ -777,8 +879,14 @@ configure_rtr(struct uci_context *ctx, struct uci_package *pck)
 
     xtr = CONTAINER_OF(ctrl_dev, lisp_xtr_t, super);
 
+    /* CONTROL PACING */
+    parse_ctrl_pacing(ctx, pck);
+
     /* FWD POLICY STRUCTURES */
-    xtr->fwd_policy = fwd_policy_class_find("flow_balancing");
+    xtr->fwd_policy = parse_fwd_policy(ctx, pck);
+    if (xtr->fwd_policy == NULL){
+        return (BAD);
+    }
     xtr->fwd_policy_dev_parm = xtr->fwd_policy->new_dev_policy_inf(ctrl_dev,NULL);
 
     /* CREATE LCAFS HTABLE */
@@ -1469,6 +1577,54 @@ parse_lcafs(struct uci_context *ctx, struct uci_package *pck)
     return(lcaf_ht);
 }
 
+/* Forward policy selected in the daemon section. By default flow_balancing */
+static fwd_policy_class *
+parse_fwd_policy(struct uci_context *ctx, struct uci_package *pck)
+{
+    struct uci_section *section;
+    struct uci_element *element;
+    char *uci_fwd_policy = NULL;
+
+    uci_foreach_element(&pck->sections, element) {
+        section = uci_to_section(element);
+
+        if (strcmp(section->type, "daemon") == 0){
+            uci_fwd_policy = (char *)uci_lookup_option_string(ctx, section, "fwd_policy");
+            break;
+        }
+    }
+
+    if (uci_fwd_policy == NULL){
+        uci_fwd_policy = "flow_balancing";
+    }
+    OOR_LOG(LDBG_1, "Forward policy: %s", uci_fwd_policy);
+    return (fwd_policy_class_find(uci_fwd_policy));
+}
+
+/* Rates of the control messages paced, from the daemon section. By default
+ * the ones of the pacer */
+static void
+parse_ctrl_pacing(struct uci_context *ctx, struct uci_package *pck)
+{
+    struct uci_section *section;
+    struct uci_element *element;
+    const char *uci_rate, *uci_global_rate;
+
+    uci_foreach_element(&pck->sections, element) {
+        section = uci_to_section(element);
+
+        if (strcmp(section->type, "daemon") == 0){
+            uci_rate = uci_lookup_option_string(ctx, section, "control_pacing_rate");
+            uci_global_rate = uci_lookup_option_string(ctx, section,
+                    "control_pacing_global_rate");
+            ctrl_pacer_set_rates(&lctrl->pacer,
+                    uci_rate ? strtol(uci_rate, NULL, 10) : 0,
+                    uci_global_rate ? strtol(uci_global_rate, NULL, 10) : 0);
+            break;
+        }
+    }
+}
+
 static int
 parse_elp_node(struct uci_context *ctx, struct uci_section *section, shash_t *ht)
 {
@@ -145,6 +145,7 @@ vpnapi_control_dp_recv_msg(sock_t *sl)
     if (lbuf_size(b) < 4){
         OOR_LOG(LDBG_3, "Received a non LISP message in the "
                 "control port! Discarding packet!");
+        lbuf_del(b);
         return (BAD);
     }
 
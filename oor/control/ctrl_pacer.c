@@ -0,0 +1,318 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <inttypes.h>
+
+#include "ctrl_pacer.h"
+#include "oor_control.h"
+#include "../lib/mem_util.h"
+#include "../lib/oor_log.h"
+#include "../lib/util.h"
+
+typedef struct pacer_msg {
+    struct ovs_list     list;
+    lbuf_t              *b;
+    uconn_t             uc;
+    struct timespec     ts;     /* time when it was queued */
+} pacer_msg_t;
+
+/* Add the tokens earned since the last refill, up to the burst size */
+static void
+bucket_refill(double *tokens, struct timespec *last, struct timespec *now,
+        int rate, int burst)
+{
+    double elapsed = time_diff(now, last);
+
+    if (elapsed > 0) {
+        *tokens += elapsed * rate;
+        if (*tokens > burst) {
+            *tokens = burst;
+        }
+    }
+    *last = *now;
+}
+
+static int
+pacer_msg_send(ctrl_pacer_t *pacer, lbuf_t *b, uconn_t *uc)
+{
+    return (pacer->ctrl->control_data_plane->control_dp_send_msg(pacer->ctrl,
+            b, uc));
+}
+
+static void
+pacer_msg_del(pacer_msg_t *msg)
+{
+    lbuf_del(msg->b);
+    free(msg);
+}
+
+static void
+pacer_dst_del(pacer_dst_t *dst)
+{
+    pacer_msg_t *msg, *next;
+
+    LIST_FOR_EACH_SAFE(msg, next, list, &dst->queue) {
+        list_remove(&msg->list);
+        pacer_msg_del(msg);
+    }
+    free(dst);
+}
+
+/* Return the destination 'addr' or NULL if it can not be tracked */
+static pacer_dst_t *
+pacer_dst_get(ctrl_pacer_t *pacer, addr_key_t *addr, struct timespec *now)
+{
+    pacer_dst_t *dst;
+    khiter_t k;
+    int ret;
+
+    k = kh_get(pacer, pacer->dsts, addr);
+    if (k != kh_end(pacer->dsts)) {
+        return (kh_value(pacer->dsts, k));
+    }
+
+    if (kh_size(pacer->dsts) >= CTRL_PACER_MAX_DSTS) {
+        return (NULL);
+    }
+
+    dst = xzalloc(sizeof(pacer_dst_t));
+    dst->addr = *addr;
+    dst->tokens = pacer->burst;
+    dst->last = *now;
+    list_init(&dst->queue);
+    list_init(&dst->backlog);
+
+    k = kh_put(pacer, pacer->dsts, &dst->addr, &ret);
+    kh_value(pacer->dsts, k) = dst;
+
+    return (dst);
+}
+
+/* Forget the destinations without queued messages that have been idle for
+ * CTRL_PACER_IDLE_TIMEOUT seconds. Their buckets would be full anyway */
+static void
+pacer_sweep(ctrl_pacer_t *pacer, struct timespec *now)
+{
+    pacer_dst_t *dst;
+    khiter_t k;
+
+    for (k = kh_begin(pacer->dsts); k != kh_end(pacer->dsts); ++k) {
+        if (!kh_exist(pacer->dsts, k)) {
+            continue;
+        }
+        dst = kh_value(pacer->dsts, k);
+        if (list_is_empty(&dst->queue)
+                && time_diff(now, &dst->last) > CTRL_PACER_IDLE_TIMEOUT) {
+            kh_del(pacer, pacer->dsts, k);
+            pacer_dst_del(dst);
+        }
+    }
+    pacer->last_sweep = *now;
+}
+
+void
+ctrl_pacer_init(ctrl_pacer_t *pacer, struct oor_ctrl *ctrl)
+{
+    memset(pacer, 0, sizeof(ctrl_pacer_t));
+    pacer->ctrl = ctrl;
+    pacer->dsts = kh_init(pacer);
+    list_init(&pacer->backlog);
+    pacer->rate = CTRL_PACER_RATE;
+    pacer->burst = CTRL_PACER_BURST;
+    pacer->global_rate = CTRL_PACER_GLOBAL_RATE;
+    pacer->global_burst = CTRL_PACER_GLOBAL_BURST;
+    pacer->tokens = pacer->global_burst;
+    clock_gettime(CLOCK_MONOTONIC, &pacer->last);
+    pacer->last_sweep = pacer->last;
+}
+
+/* The queued messages are discarded */
+void
+ctrl_pacer_uninit(ctrl_pacer_t *pacer)
+{
+    khiter_t k;
+
+    if (!pacer->dsts) {
+        return;
+    }
+    for (k = kh_begin(pacer->dsts); k != kh_end(pacer->dsts); ++k) {
+        if (kh_exist(pacer->dsts, k)) {
+            pacer_dst_del(kh_value(pacer->dsts, k));
+        }
+    }
+    kh_destroy(pacer, pacer->dsts);
+    pacer->dsts = NULL;
+    pacer->queued = 0;
+    list_init(&pacer->backlog);
+}
+
+/* Burst of a bucket of 'rate' messages per second, in the proportion of the
+ * default ones */
+static int
+pacer_burst(int rate, int def_rate, int def_burst)
+{
+    int burst = (int)((int64_t)rate * def_burst / def_rate);
+
+    return (burst > 0 ? burst : 1);
+}
+
+void
+ctrl_pacer_set_rates(ctrl_pacer_t *pacer, int rate, int global_rate)
+{
+    if (rate > 0) {
+        pacer->rate = rate;
+        pacer->burst = pacer_burst(rate, CTRL_PACER_RATE, CTRL_PACER_BURST);
+    }
+    if (global_rate > 0) {
+        pacer->global_rate = global_rate;
+        pacer->global_burst = pacer_burst(global_rate, CTRL_PACER_GLOBAL_RATE,
+                CTRL_PACER_GLOBAL_BURST);
+        pacer->tokens = pacer->global_burst;
+    }
+    OOR_LOG(LDBG_1, "Control pacer: %d messages/s per destination, %d "
+            "messages/s in total", pacer->rate, pacer->global_rate);
+}
+
+int
+ctrl_pacer_send(ctrl_pacer_t *pacer, lbuf_t *b, uconn_t *uc)
+{
+    pacer_dst_t *dst;
+    pacer_msg_t *msg;
+    struct timespec now;
+    addr_key_t addr;
+
+    if (!pacer->dsts || lisp_addr_lafi(&uc->ra) != LM_AFI_IP) {
+        return (pacer_msg_send(pacer, b, uc));
+    }
+    addr_key_from_ip(&addr, lisp_addr_ip(&uc->ra), 0);
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    dst = pacer_dst_get(pacer, &addr, &now);
+    if (!dst) {
+        return (pacer_msg_send(pacer, b, uc));
+    }
+
+    bucket_refill(&pacer->tokens, &pacer->last, &now, pacer->global_rate,
+            pacer->global_burst);
+    bucket_refill(&dst->tokens, &dst->last, &now, pacer->rate, pacer->burst);
+
+    /* Messages are not sent ahead of the ones already queued */
+    if (list_is_empty(&dst->queue) && dst->tokens >= 1 && pacer->tokens >= 1) {
+        dst->tokens--;
+        pacer->tokens--;
+        pacer->sent++;
+        return (pacer_msg_send(pacer, b, uc));
+    }
+
+    if (pacer->queued >= CTRL_PACER_MAX_QUEUED) {
+        OOR_LOG(LDBG_1, "ctrl_pacer_send: Queue full. Dropping control "
+                "message to %s", lisp_addr_to_char(&uc->ra));
+        pacer->dropped++;
+        return (BAD);
+    }
+
+    msg = xzalloc(sizeof(pacer_msg_t));
+    msg->b = lbuf_clone(b);
+    /* Only IP addresses, so no memory is shared with 'uc' */
+    msg->uc = *uc;
+    msg->ts = now;
+    if (list_is_empty(&dst->queue)) {
+        list_push_back(&pacer->backlog, &dst->backlog);
+    }
+    list_push_back(&dst->queue, &msg->list);
+
+    if (++pacer->queued > pacer->max_queued) {
+        pacer->max_queued = pacer->queued;
+    }
+    OOR_LOG(LDBG_3, "ctrl_pacer_send: Control message to %s queued (%u "
+            "messages queued)", lisp_addr_to_char(&uc->ra), pacer->queued);
+    return (GOOD);
+}
+
+void
+ctrl_pacer_process(ctrl_pacer_t *pacer)
+{
+    pacer_dst_t *dst, *next;
+    pacer_msg_t *msg;
+    struct timespec now;
+    double delay;
+    int progress;
+
+    if (!pacer->dsts || kh_size(pacer->dsts) == 0) {
+        return;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    if (pacer->queued > 0) {
+        bucket_refill(&pacer->tokens, &pacer->last, &now,
+                pacer->global_rate, pacer->global_burst);
+
+        /* One message of each destination per round */
+        do {
+            progress = FALSE;
+            LIST_FOR_EACH_SAFE(dst, next, backlog, &pacer->backlog) {
+                if (pacer->tokens < 1) {
+                    break;
+                }
+                bucket_refill(&dst->tokens, &dst->last, &now, pacer->rate,
+                        pacer->burst);
+                if (dst->tokens < 1) {
+                    continue;
+                }
+                msg = CONTAINER_OF(list_pop_front(&dst->queue), pacer_msg_t, list);
+                if (list_is_empty(&dst->queue)) {
+                    list_remove(&dst->backlog);
+                }
+                dst->tokens--;
+                pacer->tokens--;
+                pacer->queued--;
+                pacer->paced++;
+
+                delay = time_diff(&now, &msg->ts);
+                pacer->delay_sum += delay;
+                if (delay > pacer->delay_max) {
+                    pacer->delay_max = delay;
+                }
+                pacer_msg_send(pacer, msg->b, &msg->uc);
+                pacer_msg_del(msg);
+                progress = TRUE;
+            }
+        } while (progress && pacer->tokens >= 1 && pacer->queued > 0);
+    }
+
+    if (time_diff(&now, &pacer->last_sweep) > CTRL_PACER_IDLE_TIMEOUT) {
+        pacer_sweep(pacer, &now);
+    }
+}
+
+void
+ctrl_pacer_stats_dump(ctrl_pacer_t *pacer, int log_level)
+{
+    if (is_loggable(log_level) == FALSE || !pacer->dsts) {
+        return;
+    }
+
+    OOR_LOG(log_level, "Control pacer: %u destinations, %u messages queued "
+            "(max %u)", kh_size(pacer->dsts), pacer->queued, pacer->max_queued);
+    OOR_LOG(log_level, "  Sent %"PRIu64", paced %"PRIu64", dropped %"PRIu64,
+            pacer->sent, pacer->paced, pacer->dropped);
+    OOR_LOG(log_level, "  Pacing delay avg %.1f ms, max %.1f ms",
+            pacer->paced ? 1000 * pacer->delay_sum / pacer->paced : 0.0,
+            1000 * pacer->delay_max);
+}
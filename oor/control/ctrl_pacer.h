@@ -0,0 +1,101 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef CTRL_PACER_H_
+#define CTRL_PACER_H_
+
+#include <time.h>
+#include "../elibs/khash/khash.h"
+#include "../elibs/ovs/list.h"
+#include "../lib/addr_key.h"
+#include "../lib/lbuf.h"
+#include "../lib/sockets.h"
+
+/*
+ * Pacing of the control messages originated by the tunnel routers. Each
+ * destination has a token bucket, and all of them share a global one.
+ * Messages that find the buckets empty are copied to the queue of their
+ * destination, which is drained from the event loop in round robin among
+ * destinations. This way the Map-Registers, Map-Requests and SMRs programmed
+ * at the same time don't leave in a single burst that overflows the socket
+ * buffers or the peer. Replies and RLOC probes are not paced (see
+ * send_msg).
+ */
+
+/* Default messages per second and burst size of each destination. The
+ * burst scales with the rate configured */
+#define CTRL_PACER_RATE             50
+#define CTRL_PACER_BURST            20
+/* Default messages per second and burst size of all the destinations */
+#define CTRL_PACER_GLOBAL_RATE      500
+#define CTRL_PACER_GLOBAL_BURST     100
+/* Messages queued in the pacer. Further messages are dropped */
+#define CTRL_PACER_MAX_QUEUED       4096
+/* Maximum number of destinations tracked. Messages to others are not paced */
+#define CTRL_PACER_MAX_DSTS         10000
+/* Seconds without messages after which a destination is forgotten */
+#define CTRL_PACER_IDLE_TIMEOUT     60
+
+struct oor_ctrl;
+
+typedef struct pacer_dst {
+    addr_key_t          addr;
+    double              tokens;
+    struct timespec     last;       /* last refill of the bucket */
+    struct ovs_list     queue;      /* messages waiting for tokens */
+    struct ovs_list     backlog;    /* node in the list of the pacer */
+} pacer_dst_t;
+
+KHASH_INIT(pacer, addr_key_t *, pacer_dst_t *, 1, addr_key_hash, addr_key_equal)
+
+typedef struct ctrl_pacer {
+    struct oor_ctrl     *ctrl;
+    khash_t(pacer)      *dsts;
+    struct ovs_list     backlog;    /* destinations with queued messages */
+    int                 rate;
+    int                 burst;
+    int                 global_rate;
+    int                 global_burst;
+    double              tokens;
+    struct timespec     last;
+    struct timespec     last_sweep;
+    /* stats */
+    uint32_t            queued;
+    uint32_t            max_queued;
+    uint64_t            sent;       /* sent without delay */
+    uint64_t            paced;      /* sent from the queue */
+    uint64_t            dropped;
+    double              delay_sum;
+    double              delay_max;
+} ctrl_pacer_t;
+
+void ctrl_pacer_init(ctrl_pacer_t *pacer, struct oor_ctrl *ctrl);
+void ctrl_pacer_uninit(ctrl_pacer_t *pacer);
+/* Messages per second to each destination and to all of them. 0 keeps the
+ * default rate */
+void ctrl_pacer_set_rates(ctrl_pacer_t *pacer, int rate, int global_rate);
+/* Send 'b' or queue a copy of it when the buckets are empty. The caller
+ * keeps the ownership of 'b' */
+int ctrl_pacer_send(ctrl_pacer_t *pacer, lbuf_t *b, uconn_t *uc);
+/* Send the queued messages allowed by the buckets. Called from the event
+ * loop */
+void ctrl_pacer_process(ctrl_pacer_t *pacer);
+void ctrl_pacer_stats_dump(ctrl_pacer_t *pacer, int log_level);
+
+#endif /* CTRL_PACER_H_ */
@@ -23,6 +23,7 @@
 #include "../lib/oor_log.h"
 #include "../lib/pointers_table.h"
 #include "../lib/prefixes.h"
+#include "../lib/util.h"
 
 
 static int ms_recv_map_request(lisp_ms_t *, lbuf_t *, uconn_t *);
@@ -126,6 +127,39 @@ forward_mreq(lisp_ms_t *ms, lbuf_t *b, mapping_t *m)
 }
 
 
+/* Remove the expired subscriptions to the prefix. The list is removed from
+ * the db once empty. Returns the remaining subscribers or NULL if none */
+static glist_t *
+ms_pubsub_prune(lisp_ms_t *ms, lisp_addr_t *eid)
+{
+    glist_t *subs;
+    glist_entry_t *it, *aux_it;
+    lisp_subscriber_t *sub;
+    time_t now;
+
+    subs = mdb_lookup_entry_exact(ms->pubsub_db, eid);
+    if (!subs){
+        return (NULL);
+    }
+
+    now = time(NULL);
+    glist_for_each_entry_safe(it, aux_it, subs){
+        sub = (lisp_subscriber_t *)glist_entry_data(it);
+        if (sub->expires < now){
+            OOR_LOG(LDBG_2, "Subscription of ITR %s to %s expired",
+                    lisp_addr_to_char(sub->itr_rloc), lisp_addr_to_char(eid));
+            glist_remove(it, subs);
+        }
+    }
+
+    if (glist_size(subs) == 0){
+        mdb_remove_entry(ms->pubsub_db, eid);
+        glist_destroy(subs);
+        return (NULL);
+    }
+    return (subs);
+}
+
 /* Called when the timer associated with a registered lisp site expires. */
 static int
 lsite_entry_expiration_timer_cb(oor_timer_t *t)
@@ -139,6 +173,8 @@ lsite_entry_expiration_timer_cb(oor_timer_t *t)
     OOR_LOG(LDBG_1,"Registration of site with EID %s timed out",
             lisp_addr_to_char(addr));
 
+    /* Subscriptions still alive are kept in case the site comes back */
+    ms_pubsub_prune(ms, addr);
     mdb_remove_entry(ms->reg_sites_db, addr);
     lisp_reg_site_del(rsite);
     ms_dump_registered_sites(ms, LDBG_3);
@@ -182,6 +218,9 @@ lsite_entry_update_expiration_timer(lisp_ms_t *ms, lisp_reg_site_t *rsite)
     timer = (oor_timer_t *)glist_first_data(timer_lst);
     glist_destroy(timer_lst);
 
+    /* Each refresh of the registration purges the expired subscriptions */
+    ms_pubsub_prune(ms, mapping_eid(rsite->site_map));
+
     /* Give a 2s margin before purging the registered site */
     oor_timer_start(timer, MS_SITE_EXPIRATION + 2);
 
@@ -190,6 +229,112 @@ lsite_entry_update_expiration_timer(lisp_ms_t *ms, lisp_reg_site_t *rsite)
             MS_SITE_EXPIRATION);
 }
 
+static lisp_subscriber_t *
+ms_subscribers_lookup(glist_t *subs, lisp_xtr_id *xtr_id, lisp_site_id site_id)
+{
+    glist_entry_t *it;
+    lisp_subscriber_t *sub;
+
+    glist_for_each_entry(it, subs){
+        sub = (lisp_subscriber_t *)glist_entry_data(it);
+        if (sub->site_id == site_id
+                && memcmp(&sub->xtr_id, xtr_id, sizeof(lisp_xtr_id)) == 0){
+            return (sub);
+        }
+    }
+    return (NULL);
+}
+
+/* Subscribe the ITR that sent the Map-Request to the changes of the mapping
+ * of the registered site. The Map-Notify messages of the publications are
+ * signed with the key of the site of the ITR */
+static void
+ms_add_subscription(lisp_ms_t *ms, lisp_reg_site_t *rsite, lisp_addr_t *seid,
+        lisp_addr_t *itr_rloc, lisp_xtr_id *xtr_id, lisp_site_id site_id,
+        uint64_t nonce)
+{
+    lisp_site_prefix_t *itr_site;
+    lisp_subscriber_t *sub;
+    lisp_addr_t *eid = mapping_eid(rsite->site_map);
+    glist_t *subs;
+
+    itr_site = mdb_lookup_entry(ms->lisp_sites_db, seid);
+    if (!itr_site){
+        OOR_LOG(LDBG_1, "Subscription of %s to %s rejected: The source EID "
+                "doesn't belong to a configured site", lisp_addr_to_char(seid),
+                lisp_addr_to_char(eid));
+        return;
+    }
+
+    subs = ms_pubsub_prune(ms, eid);
+    if (!subs){
+        subs = glist_new_managed((glist_del_fct)lisp_subscriber_del);
+        if (!mdb_add_entry(ms->pubsub_db, eid, subs)){
+            glist_destroy(subs);
+            return;
+        }
+    }
+
+    sub = ms_subscribers_lookup(subs, xtr_id, site_id);
+    if (sub){
+        /* Refresh of the subscription. The ITR may have changed its RLOCs */
+        lisp_addr_copy(sub->itr_rloc, itr_rloc);
+        sub->nonce = nonce;
+    }else{
+        if (glist_size(subs) >= MS_PUBSUB_MAX_SUBSCRIBERS){
+            OOR_LOG(LDBG_1, "Subscription of ITR %s (xTR-ID: %s) to %s "
+                    "rejected: Reached the maximum of %d subscribers",
+                    lisp_addr_to_char(itr_rloc), get_char_from_xTR_ID(xtr_id),
+                    lisp_addr_to_char(eid), MS_PUBSUB_MAX_SUBSCRIBERS);
+            return;
+        }
+        sub = lisp_subscriber_new_init(itr_rloc, xtr_id, site_id,
+                itr_site->key, nonce);
+        glist_add(sub, subs);
+        OOR_LOG(LDBG_1, "ITR %s (xTR-ID: %s) subscribed to %s",
+                lisp_addr_to_char(itr_rloc), get_char_from_xTR_ID(xtr_id),
+                lisp_addr_to_char(eid));
+    }
+    /* The subscription lasts the TTL of the mapping */
+    sub->expires = time(NULL) + mapping_ttl(rsite->site_map) * 60;
+}
+
+/* Push the new mapping of a registered site to its subscribers */
+static void
+ms_publish_mapping(lisp_ms_t *ms, mapping_t *map)
+{
+    glist_t *subs;
+    glist_entry_t *it;
+    lisp_subscriber_t *sub;
+    lbuf_t *mntf;
+    void *mntf_hdr;
+    uconn_t uc;
+    lisp_key_type_e keyid = HMAC_SHA_1_96;
+
+    subs = ms_pubsub_prune(ms, mapping_eid(map));
+    if (!subs){
+        return;
+    }
+
+    glist_for_each_entry(it, subs){
+        sub = (lisp_subscriber_t *)glist_entry_data(it);
+        mntf = lisp_msg_create(LISP_MAP_NOTIFY);
+        lisp_msg_put_empty_auth_record(mntf, keyid);
+        lisp_msg_put_mapping(mntf, map, NULL);
+        mntf_hdr = lisp_msg_hdr(mntf);
+        MNTF_NONCE(mntf_hdr) = ++sub->nonce;
+        lisp_msg_fill_auth_data(mntf, keyid, sub->key);
+
+        uconn_init(&uc, LISP_CONTROL_PORT, LISP_CONTROL_PORT, NULL,
+                sub->itr_rloc);
+        OOR_LOG(LDBG_1, "%s, EID: %s, publication to ITR %s",
+                lisp_msg_hdr_to_char(mntf), lisp_addr_to_char(mapping_eid(map)),
+                lisp_addr_to_char(sub->itr_rloc));
+        send_msg(&ms->super, mntf, &uc);
+        lisp_msg_destroy(mntf);
+    }
+}
+
 static int
 ms_recv_map_request(lisp_ms_t *ms, lbuf_t *buf, uconn_t *uc)
 {
@@ -207,11 +352,18 @@ ms_recv_map_request(lisp_ms_t *ms, lbuf_t *buf, uconn_t *uc)
     lisp_site_prefix_t *    site            = NULL;
     lisp_reg_site_t *       rsite           = NULL;
     uint8_t act_flag;
+    mem_arena_t *   arena       = ctrl_dev_msg_arena(&ms->super);
+    eid_record_hdr_t *      eid_rec         = NULL;
+    lisp_xtr_id     xtr_id;
+    lisp_site_id    site_id     = 0;
+    lisp_addr_t     itr_rloc;
+    int             subscribe   = FALSE;
 
     /* local copy of the buf that can be modified */
     b = *buf;
 
-    seid = lisp_addr_new();
+    /* Addresses of the request are released with the arena */
+    seid = lisp_addr_new_arena(arena);
 
 
     mreq_hdr = lisp_msg_pull_hdr(&b);
@@ -232,13 +384,21 @@ ms_recv_map_request(lisp_ms_t *ms, lbuf_t *buf, uconn_t *uc)
     }
 
     /* PROCESS ITR RLOCs */
-    itr_rlocs = laddr_list_new();
-    lisp_msg_parse_itr_rlocs(&b, itr_rlocs);
+    itr_rlocs = glist_new();
+    lisp_msg_parse_itr_rlocs(&b, itr_rlocs, arena);
+
+    /* The xTR-ID identifies the subscriptions of the ITR (LISP Pub/Sub) */
+    if (MREQ_XTR_ID_PRESENT(mreq_hdr)) {
+        subscribe = lisp_msg_parse_xtr_id_site_id(buf, &xtr_id, &site_id) == GOOD
+                && laddr_list_get_addr(itr_rlocs, lisp_addr_ip_afi(&uc->la),
+                        &itr_rloc) == GOOD;
+    }
 
     for (i = 0; i < MREQ_REC_COUNT(mreq_hdr); i++) {
-        deid = lisp_addr_new();
+        deid = lisp_addr_new_arena(arena);
 
         /* PROCESS EID REC */
+        eid_rec = lbuf_data(&b);
         if (lisp_msg_parse_eid_rec(&b, deid) != GOOD) {
             goto err;
         }
@@ -263,7 +423,6 @@ ms_recv_map_request(lisp_ms_t *ms, lbuf_t *buf, uconn_t *uc)
                     lisp_addr_to_char(deid));
             send_msg(&ms->super, mrep, uc);
             lisp_msg_destroy(mrep);
-            lisp_addr_del(deid);
 
             continue;
         }
@@ -279,19 +438,22 @@ ms_recv_map_request(lisp_ms_t *ms, lbuf_t *buf, uconn_t *uc)
                     lisp_addr_to_char(deid));
             send_msg(&ms->super, mrep, uc);
             lisp_msg_destroy(mrep);
-            lisp_addr_del(deid);
             continue;
         }
 
         map = rsite->site_map;
         /* If site is null, the request is for a static entry */
 
+        if (subscribe && EID_REC_NOTIFY(eid_rec)) {
+            ms_add_subscription(ms, rsite, seid, &itr_rloc, &xtr_id, site_id,
+                    MREQ_NONCE(mreq_hdr));
+        }
+
         /* IF *NOT* PROXY REPLY: forward the message to an xTR */
         if (site != NULL && site->proxy_reply == FALSE) {
             /* FIXME: once locs become one object, send that instead of mapping */
             forward_mreq(ms, buf, map);
             lisp_msg_destroy(mrep);
-            lisp_addr_del(deid);
             continue;
         }
 
@@ -314,18 +476,14 @@ ms_recv_map_request(lisp_ms_t *ms, lbuf_t *buf, uconn_t *uc)
             OOR_LOG(LDBG_1, "Couldn't send Map-Reply!");
         }
         lisp_msg_destroy(mrep);
-        lisp_addr_del(deid);
     }
 
     glist_destroy(itr_rlocs);
-    lisp_addr_del(seid);
 
     return(GOOD);
 err:
     glist_destroy(itr_rlocs);
     lisp_msg_destroy(mrep);
-    lisp_addr_del(deid);
-    lisp_addr_del(seid);
     return(BAD);
 
 }
@@ -336,15 +494,16 @@ ms_recv_map_register(lisp_ms_t *ms, lbuf_t *buf, uconn_t *uc)
     lisp_reg_site_t *rsite = NULL, *new_rsite = NULL;
     lisp_site_prefix_t *reg_pref = NULL;
     char *key = NULL;
-    lisp_addr_t *eid;
+    lisp_addr_t eid;
+    lisp_rec_view_t rv;
     lbuf_t b;
     void *hdr = NULL, *mntf_hdr = NULL;
     int i = 0;
     mapping_t *m = NULL;
-    locator_t *probed = NULL;
     lbuf_t *mntf = NULL;
     lisp_key_type_e keyid = HMAC_SHA_1_96; /* TODO configurable */
     int valid_records = FALSE;
+    int publish = FALSE;
 
 
     b = *buf;
@@ -357,29 +516,31 @@ ms_recv_map_register(lisp_ms_t *ms, lbuf_t *buf, uconn_t *uc)
 
     lisp_msg_pull_auth_field(&b);
 
+    memset(&eid, 0, sizeof(lisp_addr_t));
 
     for (i = 0; i < MREG_REC_COUNT(hdr); i++) {
-        m = mapping_new();
-        if (lisp_msg_parse_mapping_record(&b, m, &probed) != GOOD) {
+        /* The record is only materialized in a mapping when it is stored */
+        lisp_addr_dealloc(&eid);
+        memset(&eid, 0, sizeof(lisp_addr_t));
+        if (lisp_msg_pull_rec_view(&b, &rv) != GOOD
+                || lisp_rec_view_eid(&rv, &eid) != GOOD) {
             goto err;
         }
 
-        if (mapping_auth(m) == 0){
+        if (MAP_REC_AUTH(rv.hdr) == 0){
             OOR_LOG(LWRN,"ms_recv_map_register: Received a none authoritative record in a Map Register: %s",
-                    lisp_addr_to_char(mapping_eid(m)));
+                    lisp_addr_to_char(&eid));
         }
 
         /* To be sure that we store the network address and not a IP-> 10.0.0.0/24 instead of 10.0.0.1/24 */
-        eid = mapping_eid(m);
-        pref_conv_to_netw_pref(eid);
+        pref_conv_to_netw_pref(&eid);
 
         /* find configured prefix */
-        reg_pref = mdb_lookup_entry(ms->lisp_sites_db, eid);
+        reg_pref = mdb_lookup_entry(ms->lisp_sites_db, &eid);
 
         if (!reg_pref) {
             OOR_LOG(LDBG_1, "EID %s not in configured lisp-sites DB "
-                    "Discarding mapping", lisp_addr_to_char(eid));
-            mapping_del(m);
+                    "Discarding mapping", lisp_addr_to_char(&eid));
             continue;
         }
 
@@ -389,16 +550,16 @@ ms_recv_map_register(lisp_ms_t *ms, lbuf_t *buf, uconn_t *uc)
         if (!key) {
             if (lisp_msg_check_auth_field(buf, reg_pref->key) != GOOD) {
                 OOR_LOG(LDBG_1, "Message validation failed for EID %s with key "
-                        "%s. Stopping processing!", lisp_addr_to_char(eid),
+                        "%s. Stopping processing!", lisp_addr_to_char(&eid),
                         reg_pref->key);
-                goto bad;
+                goto err;
             }
             OOR_LOG(LDBG_2, "Message validated with key associated to EID %s",
-                    lisp_addr_to_char(eid));
+                    lisp_addr_to_char(&eid));
             key = reg_pref->key;
         } else if (strncmp(key, reg_pref->key, strlen(key)) !=0 ) {
             OOR_LOG(LDBG_1, "EID %s part of multi EID Map-Register has different "
-                    "key! Discarding!", lisp_addr_to_char(eid));
+                    "key! Discarding!", lisp_addr_to_char(&eid));
             continue;
         }
 
@@ -407,62 +568,80 @@ ms_recv_map_register(lisp_ms_t *ms, lbuf_t *buf, uconn_t *uc)
         if (reg_pref->accept_more_specifics == TRUE){
             if (!pref_is_prefix_b_part_of_a(
                     lisp_addr_get_ip_pref_addr(reg_pref->eid_prefix),
-                    lisp_addr_get_ip_pref_addr(mapping_eid(m)))){
+                    lisp_addr_get_ip_pref_addr(&eid))){
                 OOR_LOG(LDBG_1, "EID %s not in configured lisp-sites DB! "
-                        "Discarding mapping!", lisp_addr_to_char(eid));
-                mapping_del(m);
+                        "Discarding mapping!", lisp_addr_to_char(&eid));
                 continue;
             }
-        }else if(lisp_addr_cmp(reg_pref->eid_prefix, eid) !=0) {
+        }else if(lisp_addr_cmp(reg_pref->eid_prefix, &eid) !=0) {
             OOR_LOG(LDBG_1, "EID %s is a more specific of %s. However more "
                     "specifics not configured! Discarding",
-                    lisp_addr_to_char(eid),
+                    lisp_addr_to_char(&eid),
                     lisp_addr_to_char(reg_pref->eid_prefix));
-            lisp_addr_del(eid);
             continue;
         }
 
 
-        rsite = mdb_lookup_entry_exact(ms->reg_sites_db, eid);
+        rsite = mdb_lookup_entry_exact(ms->reg_sites_db, &eid);
+        publish = FALSE;
         if (rsite) {
-            if (mapping_cmp(rsite->site_map, m) != 0) {
+            /* Periodic refreshes don't change the locators and are only
+             * compared against the registered mapping */
+            if (lisp_rec_view_cmp_locators(&rv, rsite->site_map) != 0) {
                 if (!reg_pref->merge) {
                     OOR_LOG(LDBG_3, "Prefix %s already registered, updating "
-                            "locators", lisp_addr_to_char(eid));
+                            "locators", lisp_addr_to_char(&eid));
+                    m = mapping_new();
+                    if (lisp_rec_view_to_mapping(&rv, m, NULL) != GOOD) {
+                        goto err;
+                    }
                     mapping_update_locators(rsite->site_map,mapping_locators_lists(m));
+                    mapping_del(m);
+                    m = NULL;
+                    publish = TRUE;
                 } else {
                     /* TREAT MERGE SEMANTICS */
                     OOR_LOG(LWRN, "Prefix %s has merge semantics",
-                            lisp_addr_to_char(eid));
+                            lisp_addr_to_char(&eid));
                 }
                 reg_pref->proxy_reply = MREG_PROXY_REPLY(hdr);
                 ms_dump_registered_sites(ms, LDBG_3);
             }
+            /* The Map-Version may change without changing the locators */
+            mapping_set_version(rsite->site_map, MAP_REC_VERSION(rv.hdr));
+            if (publish) {
+                ms_publish_mapping(ms, rsite->site_map);
+            }
 
             /* update registration timer */
             lsite_entry_update_expiration_timer(ms, rsite);
         } else {
+            m = mapping_new();
+            if (lisp_rec_view_to_mapping(&rv, m, NULL) != GOOD) {
+                goto err;
+            }
+            pref_conv_to_netw_pref(mapping_eid(m));
+
             /* save prefix to the registered sites db */
             new_rsite = xzalloc(sizeof(lisp_reg_site_t));
             new_rsite->site_map = m;
-            mdb_add_entry(ms->reg_sites_db, mapping_eid(m), new_rsite);
+            m = NULL;
+            mdb_add_entry(ms->reg_sites_db, mapping_eid(new_rsite->site_map),
+                    new_rsite);
             lsite_entry_start_expiration_timer(ms, new_rsite);
 
             reg_pref->proxy_reply = MREG_PROXY_REPLY(hdr);
             ms_dump_registered_sites(ms, LDBG_3);
+            /* The site may come back after its registration timed out */
+            ms_publish_mapping(ms, new_rsite->site_map);
         }
 
         if (MREG_WANT_MAP_NOTIFY(hdr)) {
-            lisp_msg_put_mapping(mntf, m, NULL);
+            lisp_msg_put_rec_view(mntf, &rv);
             valid_records = TRUE;
         }
-
-        /* if site previously registered, just remove the parsed mapping */
-        if (rsite) {
-            mapping_del(m);
-        }
-
     }
+    lisp_addr_dealloc(&eid);
 
     /* check if key is initialized, otherwise registration failed */
     if (mntf && key && valid_records) {
@@ -477,11 +656,8 @@ ms_recv_map_register(lisp_ms_t *ms, lbuf_t *buf, uconn_t *uc)
     lisp_msg_destroy(mntf);
 
     return(GOOD);
-err:
-    return(BAD);
-    mapping_del(m);
-    lisp_msg_destroy(mntf);
-bad: /* could return different error */
+err: /* could return different error */
+    lisp_addr_dealloc(&eid);
     mapping_del(m);
     lisp_msg_destroy(mntf);
     return(BAD);
@@ -647,8 +823,9 @@ ms_ctrl_construct(oor_ctrl_dev_t *dev)
 
     ms->reg_sites_db = mdb_new();
     ms->lisp_sites_db = mdb_new();
+    ms->pubsub_db = mdb_new();
 
-    if (!ms->reg_sites_db || !ms->lisp_sites_db) {
+    if (!ms->reg_sites_db || !ms->lisp_sites_db || !ms->pubsub_db) {
         return(BAD);
     }
 
@@ -663,6 +840,7 @@ ms_ctrl_destruct(oor_ctrl_dev_t *dev)
     lisp_ms_t *ms = lisp_ms_cast(dev);
     mdb_del(ms->lisp_sites_db, (mdb_del_fct)lisp_site_prefix_del);
     mdb_del(ms->reg_sites_db, (mdb_del_fct)lisp_reg_site_del);
+    mdb_del(ms->pubsub_db, (mdb_del_fct)glist_destroy);
 }
 
 void
@@ -696,5 +874,6 @@ ctrl_dev_class_t ms_ctrl_class = {
         .if_link_update = ms_if_link_update,
         .if_addr_update = ms_if_addr_update,
         .route_update = ms_route_update,
-        .get_fwd_entry = ms_get_fwd_entry
+        .get_fwd_entry = ms_get_fwd_entry,
+        .get_mcast_fwd_entry = ms_get_fwd_entry
 };
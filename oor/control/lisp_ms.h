@@ -23,6 +23,9 @@
 #include "oor_ctrl_device.h"
 #include "../lib/lisp_site.h"
 
+/* Maximum number of ITRs subscribed to the same prefix. Map-Requests are not
+ * authenticated, so new subscriptions beyond it are rejected */
+#define MS_PUBSUB_MAX_SUBSCRIBERS   64
 
 typedef struct _lisp_ms {
     oor_ctrl_dev_t super;    /* base "class" */
@@ -30,6 +33,9 @@ typedef struct _lisp_ms {
     /* ms members */
     mdb_t *lisp_sites_db;
     mdb_t *reg_sites_db;
+    /* ITRs subscribed to the registered prefixes. glist of lisp_subscriber_t
+     * indexed by the EID prefix of the registered site */
+    mdb_t *pubsub_db;
 } lisp_ms_t;
 
 /* ms interface */
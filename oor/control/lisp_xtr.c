@@ -20,6 +20,7 @@
 #include <unistd.h>
 
 #include "../lib/iface_locators.h"
+#include "../lib/loct_set.h"
 #include "../lib/sockets.h"
 #include "../lib/mem_util.h"
 #include "../lib/oor_log.h"
@@ -29,12 +30,14 @@
 
 static int mc_entry_expiration_timer_cb(oor_timer_t *t);
 static void mc_entry_start_expiration_timer(lisp_xtr_t *, mcache_entry_t *);
-static int handle_locator_probe_reply(lisp_xtr_t *, mcache_entry_t *, lisp_addr_t *);
+static void handle_rloc_probe_reply(lisp_xtr_t *, oor_timer_t *, uint64_t);
 static int update_mcache_entry(lisp_xtr_t *, mapping_t *);
 static int tr_recv_map_reply(lisp_xtr_t *, lbuf_t *, uconn_t *);
 static int tr_reply_to_smr(lisp_xtr_t *xtr, lisp_addr_t *src_eid, lisp_addr_t *req_eid);
 static int tr_recv_map_request(lisp_xtr_t *, lbuf_t *, uconn_t *);
 static int tr_recv_map_notify(lisp_xtr_t *, lbuf_t *);
+static int tr_recv_publication(lisp_xtr_t *, lbuf_t *);
+static void tr_pubsub_set_nonce(lisp_xtr_t *, lisp_addr_t *, uint64_t);
 static int tr_recv_info_nat(lisp_xtr_t *xtr, lbuf_t *buf, uconn_t *uc);
 int tr_update_nat_info(lisp_xtr_t *xtr, map_local_entry_t *mle, locator_t *loct,
         glist_t *rtr_list);
@@ -55,14 +58,18 @@ static int program_smr(lisp_xtr_t *, int time);
 static int send_map_request_retry_cb(oor_timer_t *timer);
 static int build_and_send_encap_map_request(lisp_xtr_t *xtr, lisp_addr_t *src_eid,
         mcache_entry_t *mce, uint64_t nonce);
-static int build_and_send_map_reg(lisp_xtr_t *, mapping_t *, map_server_elt *,
-        uint64_t);
+static int build_and_send_map_regs(lisp_xtr_t *, map_server_elt *, glist_t *,
+        nonces_list_t *);
+static oor_timer_t *map_server_reg_timer(lisp_xtr_t *xtr, map_server_elt *ms);
+static void program_next_map_register(oor_timer_t *timer);
+static void map_reg_confirm_eid(timer_map_reg_argument *timer_arg,
+        lisp_addr_t *eid);
 int program_map_register_for_mapping(lisp_xtr_t *xtr, map_local_entry_t *mle);
 static int encap_map_register_cb(oor_timer_t *timer);
 int program_encap_map_reg_of_loct_for_map(lisp_xtr_t *xtr, map_local_entry_t *mle,
         locator_t *src_loct);
-static int rloc_probing(lisp_xtr_t *, mapping_t *, locator_t *loc, uint64_t nonce);
-static void program_rloc_probing(lisp_xtr_t *, mcache_entry_t *, locator_t *, int);
+static int rloc_probing(lisp_xtr_t *, rloc_probe_t *, uint64_t nonce);
+static void rloc_probe_set_state(lisp_xtr_t *, rloc_probe_t *, uint8_t, uint8_t);
 static void program_mce_rloc_probing(lisp_xtr_t *, mcache_entry_t *);
 static inline lisp_xtr_t *lisp_xtr_cast(oor_ctrl_dev_t *);
 int map_reply_fill_uconn(lisp_xtr_t *xtr, glist_t *itr_rlocs, uconn_t *uc);
@@ -71,6 +78,15 @@ static void proxy_etrs_dump(lisp_xtr_t *, int log_level);
 
 static fwd_info_t *tr_get_forwarding_entry(oor_ctrl_dev_t *,
         packet_tuple_t *);
+static fwd_info_t *tr_get_mcast_forwarding_entry(oor_ctrl_dev_t *,
+        packet_tuple_t *);
+static void tr_rloc_reach_update(oor_ctrl_dev_t *, lisp_addr_t *, uint8_t);
+static void tr_lsb_update(oor_ctrl_dev_t *, lisp_addr_t *, lisp_addr_t *,
+        uint32_t, int);
+static void tr_glean_mapping(oor_ctrl_dev_t *, packet_tuple_t *, lisp_addr_t *);
+static void tr_peer_activity(oor_ctrl_dev_t *, packet_tuple_t *, lisp_addr_t *);
+static void tr_map_versions_update(oor_ctrl_dev_t *, packet_tuple_t *,
+        lisp_addr_t *, uint16_t, uint16_t);
 
 glist_t *get_local_locators_with_address(local_map_db_t *local_db, lisp_addr_t *addr);
 map_local_entry_t *get_map_loc_ent_containing_loct_ptr(local_map_db_t *local_db,
@@ -78,10 +94,7 @@ map_local_entry_t *get_map_loc_ent_containing_loct_ptr(local_map_db_t *local_db,
 glist_t *get_map_local_entry_to_smr(lisp_xtr_t *xtr);
 static lisp_addr_t * get_map_resolver(lisp_xtr_t *xtr);
 
-static int mapping_has_elp_with_l_bit(mapping_t *map);
-/* Funtions related to timer_rloc_probe_argument */
-timer_rloc_probe_argument *timer_rloc_probe_argument_new_init(mcache_entry_t *mce,
-        locator_t *locator);
+static int rec_view_has_elp_with_l_bit(lisp_rec_view_t *rv);
 int xtr_if_link_update(oor_ctrl_dev_t *dev, char *iface_name, uint8_t status);
 int xtr_if_addr_update(oor_ctrl_dev_t *dev, char *iface_name,
         lisp_addr_t *old_addr, lisp_addr_t *new_addr, uint8_t status);
@@ -89,14 +102,12 @@ int xtr_route_update(oor_ctrl_dev_t *dev, int command, char *iface_name ,
         lisp_addr_t *src_pref, lisp_addr_t *dst_pref, lisp_addr_t *gateway);
 int xtr_iface_event_signaling(lisp_xtr_t * xtr, iface_locators * if_loct);
 
-void timer_rloc_probe_argument_free(timer_rloc_probe_argument *timer_arg);
 /* Funtions related to timer_map_req_argument */
 timer_map_req_argument *timer_map_req_arg_new_init(mcache_entry_t *mce,
         lisp_addr_t *src_eid);
 void timer_map_req_arg_free(timer_map_req_argument * timer_arg);
 /* Funtions related to timer_map_reg_argument */
-timer_map_reg_argument * timer_map_reg_argument_new_init(map_local_entry_t *mle,
-        map_server_elt *ms);
+timer_map_reg_argument * timer_map_reg_argument_new_init(map_server_elt *ms);
 void timer_map_reg_arg_free(timer_map_reg_argument * timer_arg);
 timer_encap_map_reg_argument *timer_encap_map_reg_argument_new_init(map_local_entry_t *mle,
         map_server_elt *ms, locator_t *src_loct, lisp_addr_t *rtr_addr);
@@ -127,63 +138,129 @@ mc_entry_expiration_timer_cb(oor_timer_t *timer)
     return(GOOD);
 }
 
-static void
-mc_entry_start_expiration_timer(lisp_xtr_t *xtr, mcache_entry_t *mce)
+/* Returns the timer of type 'type' of the map cache entry or NULL */
+static oor_timer_t *
+mc_entry_timer(mcache_entry_t *mce, timer_type type)
 {
-    /* Expiration cache timer */
-    oor_timer_t *timer;
+    oor_timer_t *timer = NULL;
+    glist_t *timer_lst;
 
-    timer = oor_timer_create(EXPIRE_MAP_CACHE_TIMER);
-    oor_timer_init(timer,xtr,mc_entry_expiration_timer_cb,mce,NULL,NULL);
-    htable_ptrs_timers_add(ptrs_to_timers_ht, mce, timer);
-
-    oor_timer_start(timer, mapping_ttl(mcache_entry_mapping(mce))*60);
+    timer_lst = htable_ptrs_timers_get_timers_of_type_from_obj(ptrs_to_timers_ht,
+            mce, type);
+    if (glist_size(timer_lst) > 0){
+        timer = (oor_timer_t *)glist_first_data(timer_lst);
+    }
+    glist_destroy(timer_lst);
 
-    OOR_LOG(LDBG_1,"The map cache entry of EID %s will expire in %d minutes.",
-            lisp_addr_to_char(mapping_eid(mcache_entry_mapping(mce))),
-            mapping_ttl(mcache_entry_mapping(mce)));
+    return (timer);
 }
 
-/* Process a record from map-reply probe message */
+/* Called before the expiration of an entry to request again its mapping if
+ * it has been used since the last refresh. The current mapping is used
+ * until the Map-Reply arrives. An entry not in use is checked again halfway
+ * to its expiration, as traffic may still come before it expires */
 static int
-handle_locator_probe_reply(lisp_xtr_t *xtr, mcache_entry_t *mce,
-        lisp_addr_t *probed_addr)
+mc_entry_refresh_timer_cb(oor_timer_t *timer)
 {
-    locator_t * loct = NULL;
-    mapping_t * map = NULL;
-
-    map = mcache_entry_mapping(mce);
-    loct = mapping_get_loct_with_addr(map, probed_addr);
+    mcache_entry_t *mce = oor_timer_cb_argument(timer);
+    lisp_xtr_t *xtr = oor_timer_owner(timer);
+    lisp_addr_t *eid = mapping_eid(mcache_entry_mapping(mce));
+    lisp_addr_t *src_eid;
+    oor_timer_t *mr_timer;
+    timer_map_req_argument *timer_arg;
+    int remaining;
+
+    if (!mce->active_witin_period){
+        remaining = (int)(mce->expires - time(NULL));
+        if (remaining / 2 >= MCACHE_REFRESH_MIN_LEAD){
+            OOR_LOG(LDBG_2,"The map cache entry of EID %s is not in use. "
+                    "Checking it again in %d seconds", lisp_addr_to_char(eid),
+                    remaining / 2);
+            oor_timer_start(timer, remaining / 2);
+        }else{
+            OOR_LOG(LDBG_2,"The map cache entry of EID %s is not in use. It "
+                    "will not be refreshed", lisp_addr_to_char(eid));
+        }
+        return (GOOD);
+    }
 
+    /* The entry is already being requested (SMR) */
+    if (mc_entry_timer(mce, MAP_REQUEST_RETRY_TIMER)
+            || mc_entry_timer(mce, SMR_INV_RETRY_TIMER)){
+        return (GOOD);
+    }
 
-    if (!loct){
-        OOR_LOG(LDBG_2,"Probed locator %s not part of the the mapping %s",
-                lisp_addr_to_char(probed_addr),
-                lisp_addr_to_char(mapping_eid(map)));
-        return (ERR_NO_EXIST);
+    src_eid = local_map_db_get_main_eid(xtr->local_mdb, lisp_addr_ip_afi(eid));
+    if (!src_eid){
+        OOR_LOG(LDBG_2,"No local EID to refresh the map cache entry of EID %s",
+                lisp_addr_to_char(eid));
+        return (BAD);
     }
 
+    OOR_LOG(LDBG_1,"Refreshing the map cache entry of EID %s before it expires",
+            lisp_addr_to_char(eid));
+    timer_arg = timer_map_req_arg_new_init(mce, src_eid);
+    mr_timer = oor_timer_with_nonce_new(MAP_REQUEST_RETRY_TIMER, xtr,
+            send_map_request_retry_cb, timer_arg,
+            (oor_timer_del_cb_arg_fn)timer_map_req_arg_free);
+    htable_ptrs_timers_add(ptrs_to_timers_ht, mce, mr_timer);
 
-    OOR_LOG(LDBG_1," Successfully probed RLOC %s of cache entry with EID %s",
-                lisp_addr_to_char(locator_addr(loct)),
-                lisp_addr_to_char(mapping_eid(map)));
+    return (send_map_request_retry_cb(mr_timer));
+}
 
+static void
+mc_entry_start_expiration_timer(lisp_xtr_t *xtr, mcache_entry_t *mce)
+{
+    /* Expiration cache timer */
+    oor_timer_t *timer;
+    int ttl = mapping_ttl(mcache_entry_mapping(mce))*60;
+
+    /* Updates of the entry restart its timers */
+    timer = mc_entry_timer(mce, EXPIRE_MAP_CACHE_TIMER);
+    if (!timer){
+        timer = oor_timer_create(EXPIRE_MAP_CACHE_TIMER);
+        oor_timer_init(timer,xtr,mc_entry_expiration_timer_cb,mce,NULL,NULL);
+        htable_ptrs_timers_add(ptrs_to_timers_ht, mce, timer);
+    }
 
-    if (loct->state == DOWN) {
-        loct->state = UP;
+    oor_timer_start(timer, ttl);
+    mce->expires = time(NULL) + ttl;
 
-        OOR_LOG(LDBG_1," Locator %s state changed to UP",
-                lisp_addr_to_char(locator_addr(loct)));
+    OOR_LOG(LDBG_1,"The map cache entry of EID %s will expire in %d minutes.",
+            lisp_addr_to_char(mapping_eid(mcache_entry_mapping(mce))),
+            mapping_ttl(mcache_entry_mapping(mce)));
 
-        /* [re]Calculate forwarding info if status changed*/
-        xtr->fwd_policy->updated_map_cache_inf(xtr->fwd_policy_dev_parm,mce);
+    /* Refresh-ahead of the entries in use */
+    if (xtr->mcache_refresh == 0 || mce->how_learned != MCE_DYNAMIC || ttl == 0){
+        return;
+    }
+    timer = mc_entry_timer(mce, REFRESH_MAP_CACHE_TIMER);
+    if (!timer){
+        timer = oor_timer_create(REFRESH_MAP_CACHE_TIMER);
+        oor_timer_init(timer,xtr,mc_entry_refresh_timer_cb,mce,NULL,NULL);
+        htable_ptrs_timers_add(ptrs_to_timers_ht, mce, timer);
     }
+    mce->active_witin_period = FALSE;
+    oor_timer_start(timer, ttl * xtr->mcache_refresh / 100);
+}
 
-    /* Reprogramming timers of rloc probing */
-    program_rloc_probing(xtr, mce, loct, xtr->probe_interval);
+/* Process the reply to the probe of an RLOC. The probe is identified by the
+ * nonce of the reply, also used to measure the RTT */
+static void
+handle_rloc_probe_reply(lisp_xtr_t *xtr, oor_timer_t *timer, uint64_t nonce)
+{
+    rloc_probe_t *probe = oor_timer_cb_argument(timer);
+    int rtt_changed;
 
-    return (GOOD);
+    rtt_changed = rloc_probe_rtt_sample(probe, nonce);
+    OOR_LOG(LDBG_1," Successfully probed RLOC %s (RTT %u us)",
+            lisp_addr_to_char(probe->rloc), probe->srtt);
+
+    rloc_probe_set_state(xtr, probe, UP, rtt_changed);
 
+    /* Reprogramming timers of rloc probing */
+    htable_nonces_reset_nonces_lst(nonces_ht, oor_timer_nonces(timer));
+    oor_timer_start_jitter(timer, xtr->probe_interval);
 }
 
 static int
@@ -210,6 +287,8 @@ update_mcache_entry(lisp_xtr_t *xtr, mapping_t *recv_map)
 
     /* DISCARD all locator state */
     mapping_update_locators(map, mapping_locators_lists(recv_map));
+    loct_set_intern(map);
+    mapping_set_version(map, mapping_version(recv_map));
 
     /* Update forwarding info */
     xtr->fwd_policy->updated_map_cache_inf(xtr->fwd_policy_dev_parm,mce);
@@ -227,9 +306,8 @@ static int
 tr_recv_map_reply(lisp_xtr_t *xtr, lbuf_t *buf, uconn_t *udp_con)
 {
     void *mrep_hdr;
-    locator_t *probed;
-    lisp_addr_t *probed_addr;
-    mapping_t *m, *aux_m;
+    lisp_rec_view_t rv;
+    mapping_t *m = NULL;
     lbuf_t b;
     mcache_entry_t *mce;
     nonces_list_t *nonces_lst;
@@ -272,68 +350,44 @@ tr_recv_map_reply(lisp_xtr_t *xtr, lbuf_t *buf, uconn_t *udp_con)
         }
 
         for (i = 0; i < records; i++) {
-            m = mapping_new();
-            if (lisp_msg_parse_mapping_record(&b, m, &probed) != GOOD) {
+            if (lisp_msg_pull_rec_view(&b, &rv) != GOOD) {
                 goto err;
             }
-            if (mapping_has_elp_with_l_bit(m)){
+            if (rec_view_has_elp_with_l_bit(&rv)){
                 OOR_LOG(LDBG_1,"Received a Map Reply with an ELP with the L bit set. "
                         "Not supported -> Discrding map reply");
                 goto err;
             }
+            m = mapping_new();
+            if (lisp_rec_view_to_mapping(&rv, m, NULL) != GOOD) {
+                goto err;
+            }
 
             /* Mapping is NOT ACTIVE */
             if (!active_entry) {
                 /* DO NOT free mapping in this case */
                 tr_mcache_add_mapping(xtr, m);
+                tr_pubsub_set_nonce(xtr, mapping_eid(m), MREP_NONCE(mrep_hdr));
                 /* Mapping is ACTIVE */
             } else {
                 /* the reply might be for an active mapping (SMR)*/
                 update_mcache_entry(xtr, m);
+                tr_pubsub_set_nonce(xtr, mapping_eid(m), MREP_NONCE(mrep_hdr));
                 mapping_del(m);
             }
+            m = NULL;
 
             mcache_dump_db(xtr->map_cache, LDBG_3);
         }
     }else{
-        if (MREP_REC_COUNT(mrep_hdr) >1){
-            OOR_LOG(LDBG_1,"Received Map Reply Probe with multiple records. Only first one will be processed");
-        }
-        records = 1;
-        for (i = 0; i < records; i++) {
-            m = mapping_new();
-            if (lisp_msg_parse_mapping_record(&b, m, &probed) != GOOD) {
-                goto err;
-            }
-            if (mapping_has_elp_with_l_bit(m)){
-                OOR_LOG(LDBG_1,"Received a Map Reply with an ELP with the L bit set. "
-                        "Not supported -> Discrding map reply");
-                goto err;
-            }
-
-            if (probed != NULL){
-                probed_addr = locator_addr(probed);
-            }else{
-                probed_addr = &(udp_con->ra);
-            }
-
-            mce = mcache_lookup_exact(xtr->map_cache, mapping_eid(m));
-            if (!mce){
-                /* Check if the map reply probe is from a proxy */
-                mce = xtr->petrs;
-                aux_m = mcache_entry_mapping(mce);
-                if (lisp_addr_cmp(mapping_eid(m),mapping_eid(aux_m)) != 0){
-                    OOR_LOG(LDBG_2,"Received a non requested Map Reply probe");
-                    return (BAD);
-                }
-            }
-
-            handle_locator_probe_reply(xtr, mce, probed_addr);
-
-            /* No need to free 'probed' since it's a pointer to a locator in
-             * of m's */
-            mapping_del(m);
+        /* The RLOC probed is the one of the timer of the nonce. The records
+         * of the reply are not needed */
+        if (oor_timer_type(timer) != RLOC_PROBING_TIMER){
+            OOR_LOG(LDBG_2,"Received a non requested Map Reply probe");
+            return (BAD);
         }
+        handle_rloc_probe_reply(xtr, timer, MREP_NONCE(mrep_hdr));
+        return (GOOD);
     }
     if (timer != NULL){
         /* Remove nonces_lst and associated timer*/
@@ -342,7 +396,6 @@ tr_recv_map_reply(lisp_xtr_t *xtr, lbuf_t *buf, uconn_t *udp_con)
 
     return(GOOD);
 err:
-    locator_del(probed);
     mapping_del(m);
     return(BAD);
 }
@@ -387,12 +440,14 @@ tr_recv_map_request(lisp_xtr_t *xtr, lbuf_t *buf, uconn_t *uc)
     int i = 0;
     lbuf_t *mrep = NULL;
     lbuf_t  b;
+    mem_arena_t *arena = ctrl_dev_msg_arena(&xtr->super);
 
     /* local copy of the buf that can be modified */
     b = *buf;
 
-    seid = lisp_addr_new();
-    deid = lisp_addr_new();
+    /* Addresses of the request are released with the arena */
+    seid = lisp_addr_new_arena(arena);
+    deid = lisp_addr_new_arena(arena);
 
     mreq_hdr = lisp_msg_pull_hdr(&b);
 
@@ -412,8 +467,8 @@ tr_recv_map_request(lisp_xtr_t *xtr, lbuf_t *buf, uconn_t *uc)
     }
 
     /* Process additional ITR RLOCs */
-    itr_rlocs = laddr_list_new();
-    lisp_msg_parse_itr_rlocs(&b, itr_rlocs);
+    itr_rlocs = glist_new();
+    lisp_msg_parse_itr_rlocs(&b, itr_rlocs, arena);
 
     /* Process records and build Map-Reply */
     mrep = lisp_msg_create(LISP_MAP_REPLY);
@@ -469,14 +524,10 @@ tr_recv_map_request(lisp_xtr_t *xtr, lbuf_t *buf, uconn_t *uc)
 done:
     glist_destroy(itr_rlocs);
     lisp_msg_destroy(mrep);
-    lisp_addr_del(seid);
-    lisp_addr_del(deid);
     return(GOOD);
 err:
     glist_destroy(itr_rlocs);
     lisp_msg_destroy(mrep);
-    lisp_addr_del(seid);
-    lisp_addr_del(deid);
     return(BAD);
 }
 
@@ -711,6 +762,7 @@ handle_merge_semantics(lisp_xtr_t *xtr, mapping_t *rec_map)
         OOR_LOG(LDBG_3, "Prefix %s already registered, updating locators",
                 lisp_addr_to_char(eid));
         mapping_update_locators(map,mapping_locators_lists(rec_map));
+        loct_set_intern(map);
 
         /* Update forward info*/
         xtr->fwd_policy->updated_map_cache_inf(xtr->fwd_policy_dev_parm,mce);
@@ -718,21 +770,22 @@ handle_merge_semantics(lisp_xtr_t *xtr, mapping_t *rec_map)
         program_mce_rloc_probing(xtr, mce);
 
     }
+    mapping_del(rec_map);
     return(GOOD);
 }
 
 static int
 tr_recv_map_notify(lisp_xtr_t *xtr, lbuf_t *buf)
 {
-    lisp_addr_t *eid;
+    lisp_addr_t eid;
+    lisp_rec_view_t rv;
     map_local_entry_t *map_loc_e;
     mapping_t *m, *local_map;
     void *hdr;
-    locator_t *probed ;
     map_server_elt *ms;
     nonces_list_t *nonces_lst;
     oor_timer_t *timer;
-    timer_map_reg_argument *timer_arg_mn;
+    timer_map_reg_argument *timer_arg_mn = NULL;
     timer_encap_map_reg_argument *timer_arg_emn;
     int i, res = BAD;
     lbuf_t b;
@@ -744,6 +797,10 @@ tr_recv_map_notify(lisp_xtr_t *xtr, lbuf_t *buf)
     /* Check NONCE */
     nonces_lst = htable_nonces_lookup(nonces_ht, MNTF_NONCE(hdr));
     if (!nonces_lst){
+        /* The nonces of the publications are chosen by the Map-Server */
+        if (xtr->pubsub){
+            return(tr_recv_publication(xtr, buf));
+        }
         OOR_LOG(LDBG_1, "No Map Register sent with nonce: %"PRIx64
                 " Discarding message!", MNTF_NONCE(hdr));
         return(BAD);
@@ -761,6 +818,11 @@ tr_recv_map_notify(lisp_xtr_t *xtr, lbuf_t *buf)
             lbuf_set_size(buf, lbuf_size(buf) - sizeof(auth_record_hdr_t));
         }
     }else{
+        if (oor_timer_type(timer) != MAP_REGISTER_TIMER){
+            OOR_LOG(LDBG_1, "Nonce of Map-Notify doesn't belong to a Map-Register."
+                    " Discarding message!");
+            return(BAD);
+        }
         timer_arg_mn = (timer_map_reg_argument *)oor_timer_cb_argument(timer);
         ms = timer_arg_mn->ms;
     }
@@ -777,39 +839,172 @@ tr_recv_map_notify(lisp_xtr_t *xtr, lbuf_t *buf)
     lisp_msg_pull_auth_field(&b);
 
     for (i = 0; i < MNTF_REC_COUNT(hdr); i++) {
-        m = mapping_new();
-        if (lisp_msg_parse_mapping_record(&b, m, &probed) != GOOD) {
-            mapping_del(m);
+        if (lisp_msg_pull_rec_view(&b, &rv) != GOOD
+                || lisp_rec_view_eid(&rv, &eid) != GOOD) {
             return(BAD);
         }
 
-        eid = mapping_eid(m);
-        map_loc_e = local_map_db_lookup_eid_exact(xtr->local_mdb, eid);
+        map_loc_e = local_map_db_lookup_eid_exact(xtr->local_mdb, &eid);
         if (!map_loc_e) {
             OOR_LOG(LDBG_1, "Map-Notify confirms registration of UNKNOWN EID %s."
-                    " Dropping!", lisp_addr_to_char(eid));
+                    " Dropping!", lisp_addr_to_char(&eid));
+            lisp_addr_dealloc(&eid);
             continue;
         }
         local_map = map_local_entry_mapping(map_loc_e);
 
-        OOR_LOG(LDBG_1, "Map-Notify message confirms correct registration of %s."
-                "Programing next Map-Register in %d seconds",lisp_addr_to_char(eid),
-                MAP_REGISTER_INTERVAL);
+        OOR_LOG(LDBG_1, "Map-Notify message confirms correct registration of %s",
+                lisp_addr_to_char(&eid));
 
         /* MULTICAST MERGE SEMANTICS */
-        if (lisp_addr_is_mc(eid) && mapping_cmp(local_map, m) != 0) {
-            handle_merge_semantics(xtr, m);
+        if (lisp_addr_is_mc(&eid) && lisp_rec_view_cmp_locators(&rv, local_map) != 0) {
+            m = mapping_new();
+            if (lisp_rec_view_to_mapping(&rv, m, NULL) == GOOD) {
+                /* The mapping is stored or released by the function */
+                handle_merge_semantics(xtr, m);
+            } else {
+                mapping_del(m);
+            }
+        }
+
+        if (timer_arg_mn){
+            map_reg_confirm_eid(timer_arg_mn, &eid);
+        }else{
+            htable_nonces_reset_nonces_lst(nonces_ht,nonces_lst);
+            oor_timer_start_jitter(timer, MAP_REGISTER_INTERVAL);
+        }
+        lisp_addr_dealloc(&eid);
+    }
+
+    /* Once all the records sent to the Map-Server are confirmed */
+    if (timer_arg_mn && glist_size(timer_arg_mn->pending_eids) == 0){
+        program_next_map_register(timer);
+        OOR_LOG(LDBG_1, "Programing next Map-Register to %s in %d seconds",
+                lisp_addr_to_char(ms->address), MAP_REGISTER_INTERVAL
+                - (int)(time(NULL) - timer_arg_mn->last_reg));
+    }
+
+    return(GOOD);
+}
+
+/* The Map-Server subscribed the ITR with the Map-Request answered by the
+ * Map-Reply with 'nonce', and numbers the publications from it */
+static void
+tr_pubsub_set_nonce(lisp_xtr_t *xtr, lisp_addr_t *eid, uint64_t nonce)
+{
+    mcache_entry_t *mce;
+
+    if (!xtr->pubsub){
+        return;
+    }
+    mce = mcache_lookup_exact(xtr->map_cache, eid);
+    if (mce){
+        mce->pubsub_nonce = nonce;
+    }
+}
+
+/* Map-Notify pushed by a Map-Server with the new mapping of an EID the ITR
+ * is subscribed to (LISP Pub/Sub). Publications not newer than the last one
+ * accepted for the entry are replays and discarded */
+static int
+tr_recv_publication(lisp_xtr_t *xtr, lbuf_t *buf)
+{
+    glist_entry_t *it;
+    map_server_elt *ms = NULL;
+    mcache_entry_t *mce;
+    mapping_t *m;
+    lisp_rec_view_t rv;
+    lisp_addr_t eid;
+    void *hdr;
+    lbuf_t b;
+    uint64_t nonce, diff;
+    int i;
+
+    /* local copy */
+    b = *buf;
+    hdr = lisp_msg_pull_hdr(&b);
+    nonce = MNTF_NONCE(hdr);
+
+    /* The Map-Server signs it with the key of the site of the ITR */
+    glist_for_each_entry(it, xtr->map_servers){
+        if (lisp_msg_check_auth_field(buf,
+                ((map_server_elt *)glist_entry_data(it))->key) == GOOD){
+            ms = (map_server_elt *)glist_entry_data(it);
+            break;
+        }
+    }
+    if (!ms){
+        OOR_LOG(LDBG_1, "Map-Notify with nonce %"PRIx64" is neither an answer to "
+                "a Map-Register nor a valid publication. Discarding message!",
+                MNTF_NONCE(hdr));
+        return(BAD);
+    }
+
+    lisp_msg_pull_auth_field(&b);
+
+    for (i = 0; i < MNTF_REC_COUNT(hdr); i++) {
+        if (lisp_msg_pull_rec_view(&b, &rv) != GOOD
+                || lisp_rec_view_eid(&rv, &eid) != GOOD) {
+            return(BAD);
+        }
+
+        /* Not active entries are updated by the Map-Reply on its way */
+        mce = mcache_lookup_exact(xtr->map_cache, &eid);
+        if (!mce || !mcache_entry_active(mce)){
+            OOR_LOG(LDBG_2, "Publication of %s from Map-Server %s not in the "
+                    "map-cache. Ignoring it", lisp_addr_to_char(&eid),
+                    lisp_addr_to_char(ms->address));
+            lisp_addr_dealloc(&eid);
+            continue;
         }
 
+        diff = nonce - mce->pubsub_nonce;
+        if (mce->pubsub_nonce == 0 || diff == 0 || diff > PUBSUB_NONCE_WINDOW){
+            OOR_LOG(LDBG_1, "Publication of %s from Map-Server %s with old or "
+                    "unexpected nonce %"PRIx64". Discarding it",
+                    lisp_addr_to_char(&eid), lisp_addr_to_char(ms->address),
+                    nonce);
+            lisp_addr_dealloc(&eid);
+            continue;
+        }
+        mce->pubsub_nonce = nonce;
+        lisp_addr_dealloc(&eid);
 
+        if (lisp_rec_view_cmp_locators(&rv, mcache_entry_mapping(mce)) == 0
+                && MAP_REC_VERSION(rv.hdr)
+                == mapping_version(mcache_entry_mapping(mce))){
+            continue;
+        }
+
+        m = mapping_new();
+        if (lisp_rec_view_to_mapping(&rv, m, NULL) != GOOD) {
+            mapping_del(m);
+            return(BAD);
+        }
+        OOR_LOG(LDBG_1, "Map-Server %s published a new mapping for %s",
+                lisp_addr_to_char(ms->address), lisp_addr_to_char(mapping_eid(m)));
+        update_mcache_entry(xtr, m);
         mapping_del(m);
-        htable_nonces_reset_nonces_lst(nonces_ht,nonces_lst);
-        oor_timer_start(timer,MAP_REGISTER_INTERVAL);
     }
+    mcache_dump_db(xtr->map_cache, LDBG_3);
 
     return(GOOD);
 }
 
+/* Remove the EID confirmed by a Map-Notify from the pending ones */
+static void
+map_reg_confirm_eid(timer_map_reg_argument *timer_arg, lisp_addr_t *eid)
+{
+    glist_entry_t *it;
+
+    glist_for_each_entry(it, timer_arg->pending_eids){
+        if (lisp_addr_cmp(eid, (lisp_addr_t *)glist_entry_data(it)) == 0){
+            glist_remove(it, timer_arg->pending_eids);
+            return;
+        }
+    }
+}
+
 
 int
 handle_map_cache_miss(lisp_xtr_t *xtr, lisp_addr_t *requested_eid,
@@ -846,6 +1041,78 @@ handle_map_cache_miss(lisp_xtr_t *xtr, lisp_addr_t *requested_eid,
     return(send_map_request_retry_cb(timer));
 }
 
+/*
+ * Install in the map-cache the RLOC 'rloc' from which a packet of the remote
+ * EID of 'tuple' (source) has been received, so the traffic towards it
+ * doesn't wait for a Map-Reply. The gleaned entry is NOT active: it is used
+ * to forward but a Map-Request is sent to verify it, and the Map-Reply
+ * replaces it as with any other map-cache miss.
+ */
+static void
+tr_glean_mapping(oor_ctrl_dev_t *dev, packet_tuple_t *tuple, lisp_addr_t *rloc)
+{
+    lisp_xtr_t *xtr = lisp_xtr_cast(dev);
+    lisp_addr_t *src_eid, *dst_eid;
+    mcache_entry_t *mce;
+    mapping_t *m;
+    locator_t *loct;
+    oor_timer_t *timer;
+    timer_map_req_argument *timer_arg;
+    int iidmlen;
+
+    /* Without Map-Resolver the gleaned mapping couldn't be verified */
+    if (!xtr->glean_mappings || xtr->nat_aware
+            || glist_size(xtr->map_resolvers) == 0){
+        return;
+    }
+
+    if (tuple->iid > 0){
+        iidmlen = (lisp_addr_ip_afi(&tuple->src_addr) == AF_INET) ? 32: 128;
+        src_eid = lisp_addr_new_init_iid(tuple->iid, &tuple->src_addr, iidmlen);
+    }else{
+        src_eid = lisp_addr_clone(&tuple->src_addr);
+    }
+    if (mcache_lookup(xtr->map_cache, src_eid)
+            || local_map_db_lookup_eid(xtr->local_mdb, src_eid, FALSE)){
+        lisp_addr_del(src_eid);
+        return;
+    }
+    if (tuple->iid > 0){
+        dst_eid = lisp_addr_new_init_iid(tuple->iid, &tuple->dst_addr, iidmlen);
+    }else{
+        dst_eid = lisp_addr_clone(&tuple->dst_addr);
+    }
+
+    OOR_LOG(LDBG_1, "Gleaned mapping %s -> %s from the data traffic. Sending "
+            "Map-Request to verify it", lisp_addr_to_char(src_eid),
+            lisp_addr_to_char(rloc));
+
+    m = mapping_new_init(src_eid);
+    loct = locator_new_init(rloc, UP, 0, 1, 1, 100, 255, 0);
+    mapping_add_locator(m, loct);
+    mce = mcache_entry_new();
+    mcache_entry_init_gleaned(mce, m);
+    if (xtr->fwd_policy->init_map_cache_policy_inf(xtr->fwd_policy_dev_parm,mce,
+            xtr->fwd_policy->del_map_cache_policy_inf) != GOOD
+            || mcache_add_entry(xtr->map_cache, src_eid, mce) != GOOD){
+        OOR_LOG(LDBG_1, "tr_glean_mapping: Couldn't install the gleaned mapping "
+                "of %s", lisp_addr_to_char(src_eid));
+        mcache_entry_del(mce);
+        goto done;
+    }
+
+    /* The source of the Map-Request is the local EID of the packet */
+    timer_arg = timer_map_req_arg_new_init(mce, dst_eid);
+    timer = oor_timer_with_nonce_new(MAP_REQUEST_RETRY_TIMER,xtr,send_map_request_retry_cb,
+            timer_arg,(oor_timer_del_cb_arg_fn)timer_map_req_arg_free);
+    htable_ptrs_timers_add(ptrs_to_timers_ht,mce,timer);
+    send_map_request_retry_cb(timer);
+
+done:
+    lisp_addr_del(src_eid);
+    lisp_addr_del(dst_eid);
+}
+
 static glist_t *
 build_rloc_list(mapping_t *mapping)
 {
@@ -929,6 +1196,97 @@ build_and_send_smr_mreq_to_map(lisp_xtr_t  *xtr, mapping_t *src_map,
     return(GOOD);
 }
 
+/* Solicit SMRs for 'map' only to the peer ITRs that sent us traffic in the
+ * last minute (RFC 6830, section 6.6.2): the RLOCs of the active map cache
+ * entries of the same IID and AFI from which the data plane decapsulated
+ * packets of the EIDs of the entries. One SMR is sent per RLOC and entry.
+ * Peers whose EID has no active entry still cache our mapping: one SMR is
+ * sent to each of their RLOCs asking for the EID of some of the traffic */
+static void
+send_smr_to_active_peers(lisp_xtr_t *xtr, mapping_t *map)
+{
+    khash_t(peers) *sent;
+    peer_key_t *key, skey;
+    addr_key_t lkey;
+    mcache_entry_t *mce;
+    mapping_t *mcache_map;
+    locator_t *loct;
+    lisp_addr_t *peer_eid, rloc;
+    int ret, n_sent = 0, n_peers = 0, n_no_mce = 0;
+
+    if (addr_key_from_lisp_addr(&lkey, mapping_eid(map)) != GOOD){
+        return;
+    }
+
+    sent = kh_init(peers);
+    peer_activity_expire(&xtr->peer_activity);
+    peer_activity_foreach(&xtr->peer_activity, key){
+        n_peers++;
+        if (key->eid.afi != lkey.afi || key->eid.iid != lkey.iid){
+            continue;
+        }
+        peer_key_rloc(key, &rloc);
+        peer_eid = peer_key_eid(key);
+        mce = mcache_lookup(xtr->map_cache, peer_eid);
+        if (!mce || !mce->active){
+            /* The ITR refreshes our mapping whatever EID is asked, so one SMR
+             * per RLOC is enough. The zero EID key doesn't match any entry */
+            skey.rloc = key->rloc;
+            memset(&skey.eid, 0, sizeof(skey.eid));
+            kh_put(peers, sent, skey, &ret);
+            if (ret != 0){
+                build_and_send_smr_mreq(xtr, map, peer_eid, &rloc);
+                n_no_mce++;
+            }
+            lisp_addr_del(peer_eid);
+            continue;
+        }
+        lisp_addr_del(peer_eid);
+        mcache_map = mcache_entry_mapping(mce);
+        /* Peers with versioned mappings detect the new version in our
+         * traffic and are solicited when they send theirs */
+        if (xtr->map_versioning && mapping_version(mcache_map) != MAP_VERSION_NULL){
+            continue;
+        }
+        loct = mapping_get_loct_with_addr(mcache_map, &rloc);
+        if (!loct || loct->state != UP){
+            continue;
+        }
+        skey.rloc = key->rloc;
+        if (addr_key_from_lisp_addr(&skey.eid, mapping_eid(mcache_map)) != GOOD){
+            continue;
+        }
+        kh_put(peers, sent, skey, &ret);
+        if (ret == 0){
+            continue;
+        }
+        build_and_send_smr_mreq(xtr, map, mapping_eid(mcache_map), &rloc);
+        n_sent++;
+    } peer_activity_foreach_end;
+    kh_destroy(peers, sent);
+
+    xtr->smr_rounds++;
+    xtr->smr_sent += n_sent + n_no_mce;
+    xtr->smr_no_mcache += n_no_mce;
+    OOR_LOG(LDBG_1, "Sent %d SMRs for local EID %s to active peers, %d of "
+            "them without map cache entry (%d RLOC-EID pairs with traffic)",
+            n_sent + n_no_mce, lisp_addr_to_char(mapping_eid(map)), n_no_mce,
+            n_peers);
+}
+
+/* Record that a packet of the source EID of 'tuple' was received from 'rloc',
+ * to send the SMRs only to the peers with traffic */
+static void
+tr_peer_activity(oor_ctrl_dev_t *dev, packet_tuple_t *tuple, lisp_addr_t *rloc)
+{
+    lisp_xtr_t *xtr = lisp_xtr_cast(dev);
+
+    if (!xtr->smr_active_peers){
+        return;
+    }
+    peer_activity_add(&xtr->peer_activity, rloc, &tuple->src_addr, tuple->iid);
+}
+
 static int
 send_all_smr_cb(oor_timer_t *timer)
 {
@@ -979,17 +1337,30 @@ send_smr_and_mreg_for_locl_mapping(lisp_xtr_t *xtr, map_local_entry_t *map_loc_e
     map = map_local_entry_mapping(map_loc_e);
     eid = mapping_eid(map);
 
+    if (xtr->map_versioning){
+        mapping_set_version(map, map_version_next(mapping_version(map)));
+        OOR_LOG(LDBG_1, "New Map-Version of local EID %s: %d",
+                lisp_addr_to_char(eid), mapping_version(map));
+    }
+
     program_map_register_for_mapping(xtr, map_loc_e);
 
     OOR_LOG(LDBG_1, "Start SMR for local EID %s", lisp_addr_to_char(eid));
 
-    /* TODO: spec says SMRs should be sent only to peer ITRs that sent us
-     * traffic in the last minute. Should change this in the future*/
-    /* XXX: works ONLY with IP */
-    mcache_foreach_active_entry_in_ip_eid_db(xtr->map_cache, eid, mce) {
-        mcache_map = mcache_entry_mapping(mce);
-        build_and_send_smr_mreq_to_map(xtr, map, mcache_map);
-    } mcache_foreach_active_entry_in_ip_eid_db_end;
+    if (xtr->smr_active_peers){
+        send_smr_to_active_peers(xtr, map);
+    }else{
+        /* XXX: works ONLY with IP */
+        mcache_foreach_active_entry_in_ip_eid_db(xtr->map_cache, eid, mce) {
+            mcache_map = mcache_entry_mapping(mce);
+            /* Peers with versioned mappings detect the new version in our
+             * traffic and are solicited when they send theirs */
+            if (xtr->map_versioning && mapping_version(mcache_map) != MAP_VERSION_NULL){
+                continue;
+            }
+            build_and_send_smr_mreq_to_map(xtr, map, mcache_map);
+        } mcache_foreach_active_entry_in_ip_eid_db_end;
+    }
 
     /* SMR proxy-itr */
     OOR_LOG(LDBG_1, "Sending SMRs to PITRs");
@@ -1140,6 +1511,12 @@ send_map_request_retry_cb(oor_timer_t *timer)
         htable_nonces_insert(nonces_ht, nonce, nonces_list);
         oor_timer_start(timer, OOR_INITIAL_MRQ_TIMEOUT);
         return (GOOD);
+    } else if (mcache_entry_active(timer_arg->mce)) {
+        /* Refresh of an entry in use. The mapping is kept until it expires */
+        OOR_LOG(LDBG_1, "No Map-Reply for EID %s after %d retries. Keeping "
+                "the current mapping", lisp_addr_to_char(deid), retries -1 );
+        stop_timer_from_obj(timer_arg->mce, timer, ptrs_to_timers_ht, nonces_ht);
+        return (BAD);
     } else {
         OOR_LOG(LDBG_1, "No Map-Reply for EID %s after %d retries. Aborting!",
                 lisp_addr_to_char(deid), retries -1 );
@@ -1177,7 +1554,12 @@ build_and_send_encap_map_request(lisp_xtr_t *xtr, lisp_addr_t *seid,
     // Rlocs to be used as ITR of the map req.
     rlocs = ctrl_default_rlocs(xtr->super.ctrl);
     OOR_LOG(LDBG_1, "locators for req: %s", laddr_list_to_char(rlocs));
-    b = lisp_msg_mreq_create(seid, rlocs, deid);
+    if (xtr->pubsub){
+        b = lisp_msg_pubsub_mreq_create(seid, rlocs, deid, &xtr->xtr_id,
+                xtr->site_id);
+    }else{
+        b = lisp_msg_mreq_create(seid, rlocs, deid);
+    }
     if (b == NULL) {
         OOR_LOG(LDBG_1, "build_and_send_encap_map_request: Couldn't create map request message");
         glist_destroy(rlocs);
@@ -1249,39 +1631,75 @@ build_and_send_info_req(lisp_xtr_t * xtr, mapping_t * m, locator_t *loct,
 }
 
 
-/* build and send generic map-register with one record
- * for each map server */
+/* Authenticate and send the Map-Register 'b' to the Map-Server. The nonce
+ * of the message is added to 'nonces_lst' */
 static int
-build_and_send_map_reg(lisp_xtr_t * xtr, mapping_t * m, map_server_elt *ms,
-        uint64_t nonce)
+send_map_reg(lisp_xtr_t *xtr, map_server_elt *ms, lbuf_t *b,
+        nonces_list_t *nonces_lst)
 {
-    lbuf_t * b = NULL;
-    void * hdr = NULL;
-    lisp_addr_t * drloc = NULL;
+    void *hdr = lisp_msg_hdr(b);
+    uint64_t nonce = nonce_new();
     uconn_t uc;
 
-    b = lisp_msg_mreg_create(m, ms->key_type);
-
-    if (!b) {
-        return(BAD);
-    }
-
-    hdr = lisp_msg_hdr(b);
     MREG_PROXY_REPLY(hdr) = ms->proxy_reply;
     MREG_NONCE(hdr) = nonce;
 
-    if (lisp_msg_fill_auth_data(b, ms->key_type,
-            ms->key) != GOOD) {
+    if (lisp_msg_fill_auth_data(b, ms->key_type, ms->key) != GOOD) {
+        lisp_msg_destroy(b);
         return(BAD);
     }
-    drloc =  ms->address;
-    OOR_LOG(LDBG_1, "%s, EID: %s, MS: %s", lisp_msg_hdr_to_char(b),
-            lisp_addr_to_char(mapping_eid(m)), lisp_addr_to_char(drloc));
+    OOR_LOG(LDBG_1, "%s, records: %d, MS: %s", lisp_msg_hdr_to_char(b),
+            MREG_REC_COUNT(hdr), lisp_addr_to_char(ms->address));
 
-    uconn_init(&uc, LISP_CONTROL_PORT, LISP_CONTROL_PORT, NULL, drloc);
+    uconn_init(&uc, LISP_CONTROL_PORT, LISP_CONTROL_PORT, NULL, ms->address);
     send_msg(&xtr->super, b, &uc);
+    htable_nonces_insert(nonces_ht, nonce, nonces_lst);
 
     lisp_msg_destroy(b);
+    return(GOOD);
+}
+
+/* Send the mappings of the list of 'eids' to the Map-Server, packing as many
+ * records as fit in each Map-Register. The nonces of the messages are added
+ * to 'nonces_lst'. EIDs no longer in the local database are removed from the
+ * list */
+static int
+build_and_send_map_regs(lisp_xtr_t *xtr, map_server_elt *ms, glist_t *eids,
+        nonces_list_t *nonces_lst)
+{
+    glist_entry_t *it, *it_aux;
+    map_local_entry_t *mle;
+    lisp_addr_t *eid;
+    mapping_t *m;
+    lbuf_t *b = NULL;
+
+    glist_for_each_entry_safe(it, it_aux, eids){
+        eid = (lisp_addr_t *)glist_entry_data(it);
+        mle = local_map_db_lookup_eid_exact(xtr->local_mdb, eid);
+        if (!mle){
+            glist_remove(it, eids);
+            continue;
+        }
+        m = map_local_entry_mapping(mle);
+
+        if (b != NULL && lisp_msg_mreg_put_mapping(b, m, MAX_LISP_MREG_LEN) == GOOD){
+            continue;
+        }
+        /* The record doesn't fit in the current message */
+        if (b != NULL && send_map_reg(xtr, ms, b, nonces_lst) != GOOD){
+            return(BAD);
+        }
+        b = lisp_msg_create(LISP_MAP_REGISTER);
+        if (!lisp_msg_put_empty_auth_record(b, ms->key_type)
+                || lisp_msg_mreg_put_mapping(b, m, MAX_LISP_MREG_LEN) != GOOD) {
+            lisp_msg_destroy(b);
+            return(BAD);
+        }
+    }
+
+    if (b != NULL){
+        return(send_map_reg(xtr, ms, b, nonces_lst));
+    }
 
     return(GOOD);
 }
@@ -1340,47 +1758,87 @@ map_register_cb(oor_timer_t *timer)
     timer_map_reg_argument *timer_arg = oor_timer_cb_argument(timer);
     nonces_list_t *nonces_lst = oor_timer_nonces(timer);
     lisp_xtr_t *xtr = oor_timer_owner(timer);
-    mapping_t *map = map_local_entry_mapping(timer_arg->mle);
     map_server_elt *ms = timer_arg->ms;
-    uint64_t nonce;
+    map_local_entry_t *mle;
+    void *map_local_entry_it;
 
-    if ((nonces_list_size(nonces_lst) -1) < xtr->probe_retries){
-        nonce = nonce_new();
-        if (build_and_send_map_reg(xtr, map, ms, nonce) != GOOD){
-            return (BAD);
-        }
-        if (nonces_list_size(nonces_lst) > 0) {
-            OOR_LOG(LDBG_1,"Sent Retry Map-Register for mapping %s to %s "
-                    "(%d retries)", lisp_addr_to_char(mapping_eid(map)),
-                    lisp_addr_to_char(ms->address), nonces_list_size(nonces_lst));
-        } else {
-            OOR_LOG(LDBG_1,"Sent Map-Register for mapping %s to %s "
-                    , lisp_addr_to_char(mapping_eid(map)),
-                    lisp_addr_to_char(ms->address));
-        }
-        htable_nonces_insert(nonces_ht, nonce,nonces_lst);
-        oor_timer_start(timer, OOR_INITIAL_MREG_TIMEOUT);
-        return (GOOD);
+    if (glist_size(timer_arg->pending_eids) == 0){
+        /* Register all the mappings */
+        htable_nonces_reset_nonces_lst(nonces_ht, nonces_lst);
+        local_map_db_foreach_entry(xtr->local_mdb, map_local_entry_it) {
+            mle = (map_local_entry_t *)map_local_entry_it;
+            glist_add_tail(lisp_addr_clone(map_local_entry_eid(mle)),
+                    timer_arg->pending_eids);
+        } local_map_db_foreach_end;
+        timer_arg->retries = 0;
+        timer_arg->last_reg = time(NULL);
+        OOR_LOG(LDBG_1,"Sent Map-Register for %d mappings to %s",
+                glist_size(timer_arg->pending_eids), lisp_addr_to_char(ms->address));
+    }else if (timer_arg->retries < xtr->probe_retries){
+        /* Only the mappings not confirmed by a Map-Notify */
+        timer_arg->retries++;
+        OOR_LOG(LDBG_1,"Sent Retry Map-Register for %d mappings to %s "
+                "(%d retries)", glist_size(timer_arg->pending_eids),
+                lisp_addr_to_char(ms->address), timer_arg->retries);
     }else{
-        /* If we have reached maximum number of retransmissions, change remote
-         *  locator status */
+        /* If we have reached maximum number of retransmissions, wait for the
+         * next Map Register interval */
+        OOR_LOG(LWRN,"Map Register of %d mappings to %s not received reply. "
+                "Retry in %d seconds", glist_size(timer_arg->pending_eids),
+                lisp_addr_to_char(ms->address), MAP_REGISTER_INTERVAL);
+        glist_remove_all(timer_arg->pending_eids);
+        program_next_map_register(timer);
+        return (BAD);
+    }
 
-        /* Reprogram time for next Map Register interval */
-        htable_nonces_reset_nonces_lst(nonces_ht,nonces_lst);
-        oor_timer_start(timer, MAP_REGISTER_INTERVAL);
-        OOR_LOG(LWRN,"Map Register of %s to %s not received reply. Retry in %d seconds",
-                lisp_addr_to_char(mapping_eid(map)), lisp_addr_to_char(ms->address),
-                MAP_REGISTER_INTERVAL);
+    if (build_and_send_map_regs(xtr, ms, timer_arg->pending_eids, nonces_lst) != GOOD){
+        OOR_LOG(LDBG_1,"map_register_cb: Couldn't build Map-Register to %s",
+                lisp_addr_to_char(ms->address));
+    }
+    if (glist_size(timer_arg->pending_eids) == 0){
+        program_next_map_register(timer);
+        return (GOOD);
+    }
+    oor_timer_start(timer, OOR_INITIAL_MREG_TIMEOUT);
+    return (GOOD);
+}
 
-        return (BAD);
+/* Program the registration of all the mappings MAP_REGISTER_INTERVAL seconds
+ * (with jitter) after the previous one. Registrations of single mappings in
+ * between don't delay it */
+static void
+program_next_map_register(oor_timer_t *timer)
+{
+    timer_map_reg_argument *timer_arg = oor_timer_cb_argument(timer);
+    int elapsed = time(NULL) - timer_arg->last_reg;
+
+    htable_nonces_reset_nonces_lst(nonces_ht, oor_timer_nonces(timer));
+    if (elapsed < 0 || elapsed >= MAP_REGISTER_INTERVAL){
+        elapsed = MAP_REGISTER_INTERVAL - 1;
     }
+    oor_timer_start_jitter(timer, MAP_REGISTER_INTERVAL - elapsed);
+}
+
+/* Returns the Map-Register timer of the Map-Server or NULL if it is not
+ * programmed */
+static oor_timer_t *
+map_server_reg_timer(lisp_xtr_t *xtr, map_server_elt *ms)
+{
+    oor_timer_t *timer = NULL;
+    glist_t *timers_lst;
+
+    timers_lst = htable_ptrs_timers_get_timers_of_type_from_obj(ptrs_to_timers_ht,
+            ms, MAP_REGISTER_TIMER);
+    if (glist_size(timers_lst) > 0){
+        timer = (oor_timer_t *)glist_first_data(timers_lst);
+    }
+    glist_destroy(timers_lst);
+    return (timer);
 }
 
 int
 program_map_register(lisp_xtr_t *xtr)
 {
-    void *map_local_entry_it;
-    map_local_entry_t *mle;
     oor_timer_t *timer;
     timer_map_reg_argument *timer_arg;
     map_server_elt *ms;
@@ -1390,24 +1848,23 @@ program_map_register(lisp_xtr_t *xtr)
         return (BAD);
     }
 
-    local_map_db_foreach_entry(xtr->local_mdb, map_local_entry_it) {
-        mle = (map_local_entry_t *)map_local_entry_it;
-        /* Cancel timers associated to the map register of the local map entry */
-        stop_timers_of_type_from_obj(mle,MAP_REGISTER_TIMER,ptrs_to_timers_ht, nonces_ht);
-        /* Configure map register for each map server */
-        glist_for_each_entry(ms_it,xtr->map_servers){
-            ms = (map_server_elt *)glist_entry_data(ms_it);
-            timer_arg = timer_map_reg_argument_new_init(mle,ms);
-            timer = oor_timer_with_nonce_new(MAP_REGISTER_TIMER, xtr, map_register_cb,
-                    timer_arg,(oor_timer_del_cb_arg_fn)timer_map_reg_arg_free);
-            htable_ptrs_timers_add(ptrs_to_timers_ht, mle, timer);
-            map_register_cb(timer);
-        }
-    } local_map_db_foreach_end;
+    /* Configure a map register timer for each map server */
+    glist_for_each_entry(ms_it,xtr->map_servers){
+        ms = (map_server_elt *)glist_entry_data(ms_it);
+        /* Cancel timers associated to the map register of the map server */
+        stop_timers_of_type_from_obj(ms,MAP_REGISTER_TIMER,ptrs_to_timers_ht, nonces_ht);
+        timer_arg = timer_map_reg_argument_new_init(ms);
+        timer = oor_timer_with_nonce_new(MAP_REGISTER_TIMER, xtr, map_register_cb,
+                timer_arg,(oor_timer_del_cb_arg_fn)timer_map_reg_arg_free);
+        htable_ptrs_timers_add(ptrs_to_timers_ht, ms, timer);
+        map_register_cb(timer);
+    }
 
     return(GOOD);
 }
 
+/* Register the mapping of 'mle' now, without waiting for the next
+ * registration of all the mappings */
 int
 program_map_register_for_mapping(lisp_xtr_t *xtr, map_local_entry_t *mle)
 {
@@ -1415,21 +1872,34 @@ program_map_register_for_mapping(lisp_xtr_t *xtr, map_local_entry_t *mle)
     timer_map_reg_argument *timer_arg;
     map_server_elt *ms;
     glist_entry_t *ms_it;
+    lisp_addr_t *eid = map_local_entry_eid(mle);
+    glist_t *eids;
 
     if (glist_size(xtr->map_servers) == 0){
         return (BAD);
     }
 
-    /* Cancel timers associated to the map register of the local map entry */
-    stop_timers_of_type_from_obj(mle,MAP_REGISTER_TIMER,ptrs_to_timers_ht, nonces_ht);
-    /* Configure map register for each map server */
     glist_for_each_entry(ms_it,xtr->map_servers){
         ms = (map_server_elt *)glist_entry_data(ms_it);
-        timer_arg = timer_map_reg_argument_new_init(mle,ms);
-        timer = oor_timer_with_nonce_new(MAP_REGISTER_TIMER, xtr, map_register_cb,
-                timer_arg,(oor_timer_del_cb_arg_fn)timer_map_reg_arg_free);
-        htable_ptrs_timers_add(ptrs_to_timers_ht, mle, timer);
-        map_register_cb(timer);
+        timer = map_server_reg_timer(xtr, ms);
+        if (!timer){
+            program_map_register(xtr);
+            return (GOOD);
+        }
+        timer_arg = oor_timer_cb_argument(timer);
+        if (!glist_contain_using_cmp_fct(eid, timer_arg->pending_eids,
+                (glist_cmp_fct)lisp_addr_cmp)){
+            glist_add_tail(lisp_addr_clone(eid), timer_arg->pending_eids);
+        }
+        timer_arg->retries = 0;
+
+        eids = glist_new();
+        glist_add(eid, eids);
+        OOR_LOG(LDBG_1,"Sent Map-Register for mapping %s to %s",
+                lisp_addr_to_char(eid), lisp_addr_to_char(ms->address));
+        build_and_send_map_regs(xtr, ms, eids, oor_timer_nonces(timer));
+        glist_destroy(eids);
+        oor_timer_start(timer, OOR_INITIAL_MREG_TIMEOUT);
     }
 
     return(GOOD);
@@ -1470,7 +1940,7 @@ encap_map_register_cb(oor_timer_t *timer)
 
         /* Reprogram time for next Map Register interval */
         htable_nonces_reset_nonces_lst(nonces_ht,nonces_lst);
-        oor_timer_start(timer, MAP_REGISTER_INTERVAL);
+        oor_timer_start_jitter(timer, MAP_REGISTER_INTERVAL);
         OOR_LOG(LDBG_1,"Encap Map-Register for mapping %s to MS %s from RLOC %s through RTR %s not received reply."
                 " Retry in %d seconds", lisp_addr_to_char(mapping_eid(map)),lisp_addr_to_char(ms->address),
                 lisp_addr_to_char(etr_addr),lisp_addr_to_char(rtr_addr), MAP_REGISTER_INTERVAL);
@@ -1637,148 +2107,266 @@ program_initial_info_request_process(lisp_xtr_t *xtr)
 static int
 rloc_probing_cb(oor_timer_t *timer)
 {
-    timer_rloc_probe_argument *rparg = oor_timer_cb_argument(timer);
+    rloc_probe_t *probe = oor_timer_cb_argument(timer);
     nonces_list_t *nonces_lst = oor_timer_nonces(timer);
     lisp_xtr_t *xtr = oor_timer_owner(timer);
-    mapping_t *map = mcache_entry_mapping(rparg->mce);
-    locator_t *loct = rparg->locator;
-    lisp_addr_t * drloc;
     uint64_t nonce;
-    mcache_entry_t * mce;
-
-    // XXX alopez -> What we have to do with ELP and probe bit
-    drloc = xtr->fwd_policy->get_fwd_ip_addr(locator_addr(loct), ctrl_rlocs(xtr->super.ctrl));
 
     if ((nonces_list_size(nonces_lst) -1) < xtr->probe_retries){
         nonce = nonce_new();
-        if (rloc_probing(xtr, map,loct,nonce) != GOOD){
-                   return (BAD);
+        if (rloc_probing(xtr, probe, nonce) != GOOD){
+            return (BAD);
         }
+        rloc_probe_sent(probe, nonce);
         if (nonces_list_size(nonces_lst) > 0) {
-            OOR_LOG(LDBG_1,"Retry Map-Request Probe for locator %s and "
-                    "EID: %s (%d retries)", lisp_addr_to_char(drloc),
-                    lisp_addr_to_char(mapping_eid(map)), nonces_list_size(nonces_lst));
+            OOR_LOG(LDBG_1,"Retry Map-Request Probe for RLOC %s (%d retries)",
+                    lisp_addr_to_char(probe->rloc), nonces_list_size(nonces_lst));
         } else {
-            OOR_LOG(LDBG_1,"Map-Request Probe for locator %s and "
-                    "EID: %s", lisp_addr_to_char(drloc),
-                    lisp_addr_to_char(mapping_eid(map)));
+            OOR_LOG(LDBG_1,"Map-Request Probe for RLOC %s",
+                    lisp_addr_to_char(probe->rloc));
         }
         htable_nonces_insert(nonces_ht, nonce,nonces_lst);
         oor_timer_start(timer, xtr->probe_retries_interval);
         return (GOOD);
     }else{
-        /* If we have reached maximum number of retransmissions, change remote
-         *  locator status */
-        if (locator_state(loct) == UP) {
-            locator_set_state(loct, DOWN);
-            OOR_LOG(LDBG_1,"rloc_probing: No Map-Reply Probe received for locator"
-                    " %s and EID: %s -> Locator state changes to DOWN",
-                    lisp_addr_to_char(drloc), lisp_addr_to_char(mapping_eid(map)));
-
-            /* [re]Calculate forwarding info  if it has been a change
-             * of status*/
-            mce = mcache_lookup_exact(xtr->map_cache,mapping_eid(map));
-            if (mce == NULL){
-                /* It is a PeTR RLOC */
-                if ( mcache_entry_mapping(xtr->petrs) != map ){
-                    OOR_LOG(LERR,"rloc_probing: No map cache entry for EID %s. It should never happened",
-                            lisp_addr_to_char(mapping_eid(map)));
-                    return (BAD);
-                }
-                mce = xtr->petrs;
-            }
-
-            xtr->fwd_policy->updated_map_cache_inf(xtr->fwd_policy_dev_parm,mce);
+        /* If we have reached maximum number of retransmissions, change the
+         * status of the locators with the RLOC */
+        if (!probe->probed || probe->state == UP) {
+            OOR_LOG(LDBG_1,"rloc_probing: No Map-Reply Probe received for RLOC"
+                    " %s -> Locators state changes to DOWN",
+                    lisp_addr_to_char(probe->rloc));
         }
+        rloc_probe_set_state(xtr, probe, DOWN, FALSE);
 
         /* Reprogram time for next probe interval */
         htable_nonces_reset_nonces_lst(nonces_ht,nonces_lst);
-        oor_timer_start(timer, xtr->probe_interval);
-        OOR_LOG(LDBG_2,"Reprogramed RLOC probing of the locator %s of the EID %s "
-                "in %d seconds", lisp_addr_to_char(drloc),
-                lisp_addr_to_char(mapping_eid(map)), xtr->probe_interval);
+        oor_timer_start_jitter(timer, xtr->probe_interval);
+        OOR_LOG(LDBG_2,"Reprogramed RLOC probing of %s in %d seconds",
+                lisp_addr_to_char(probe->rloc), xtr->probe_interval);
 
         return (BAD);
     }
 }
 
-/* Send a Map-Request probe to check status of 'loc'. If the number of
- * retries without answer is higher than rloc_probe_retries. Change the status
- * of the 'loc' to down */
+/* Send a Map-Request probe to the RLOC of 'probe' asking for the EID of one of
+ * the mappings with it */
+static int
+rloc_probing(lisp_xtr_t *xtr, rloc_probe_t *probe, uint64_t nonce)
+{
+    uconn_t uc;
+    lisp_addr_t empty;
+    lbuf_t * b = NULL;
+    glist_t * rlocs = NULL;
+    void * hdr = NULL;
+    int ret;
+
+    lisp_addr_set_lafi(&empty, LM_AFI_NO_ADDR);
+
+    rlocs = ctrl_default_rlocs(xtr->super.ctrl);
+    b = lisp_msg_mreq_create(&empty, rlocs, probe->eid);
+    glist_destroy(rlocs);
+    if (b == NULL){
+        return (BAD);
+    }
+
+    hdr = lisp_msg_hdr(b);
+    MREQ_NONCE(hdr) = nonce;
+    MREQ_RLOC_PROBE(hdr) = 1;
+
+    uconn_init(&uc, LISP_CONTROL_PORT, LISP_CONTROL_PORT, NULL, probe->rloc);
+    ret = send_msg(&xtr->super, b, &uc);
+    lisp_msg_destroy(b);
+
+    return (ret);
+}
+
+/* Address where the probes of 'loct' are sent */
+static inline lisp_addr_t *
+rloc_probe_addr(lisp_xtr_t *xtr, locator_t *loct)
+{
+    // XXX alopez -> What we have to do with ELP and probe bit
+    return (xtr->fwd_policy->get_fwd_ip_addr(locator_addr(loct),
+            ctrl_rlocs(xtr->super.ctrl)));
+}
+
+/* Set the state and RTT of the locators of 'mce' with the RLOC of 'probe'.
+ * The forwarding information of a locator set shared by several entries is
+ * calculated once: 'lsets' has the sets already updated */
+static void
+rloc_probe_update_mce(lisp_xtr_t *xtr, mcache_entry_t *mce,
+        rloc_probe_t *probe, htable_ptrs_t *lsets)
+{
+    mapping_t *map = mcache_entry_mapping(mce);
+    loct_set_t *lset = mapping_loct_set(map);
+    locator_t *loct;
+    lisp_addr_t *drloc;
+    int changed = FALSE;
+
+    mapping_foreach_active_locator(map, loct){
+        drloc = rloc_probe_addr(xtr, loct);
+        if (!drloc || lisp_addr_cmp(drloc, probe->rloc) != 0){
+            continue;
+        }
+        if (locator_state(loct) != probe->state){
+            locator_set_state(loct, probe->state);
+            changed = TRUE;
+        }
+        if (locator_rtt(loct) != probe->pub_rtt){
+            locator_set_rtt(loct, probe->pub_rtt);
+            changed = TRUE;
+        }
+    }mapping_foreach_active_locator_end;
+
+    if (!changed || (lset && htable_ptrs_lookup(lsets, lset))){
+        return;
+    }
+    if (lset){
+        htable_ptrs_insert(lsets, lset, lset);
+    }
+    OOR_LOG(LDBG_2," Locator %s of EID %s changed to %s (RTT %u us)",
+            lisp_addr_to_char(probe->rloc), lisp_addr_to_char(mapping_eid(map)),
+            probe->state == UP ? "UP" : "DOWN", probe->pub_rtt);
+    /* [re]Calculate forwarding info if status changed*/
+    xtr->fwd_policy->updated_map_cache_inf(xtr->fwd_policy_dev_parm, mce);
+}
+
+/* Record the result of the probe of an RLOC and apply it to the locators of
+ * all the map-cache entries and Proxy-ETRs with the RLOC. 'rtt_changed' is
+ * TRUE when the RTT to apply to the locators has changed */
+static void
+rloc_probe_set_state(lisp_xtr_t *xtr, rloc_probe_t *probe, uint8_t state,
+        uint8_t rtt_changed)
+{
+    htable_ptrs_t *lsets;
+    void *it;
+
+    if (probe->probed && probe->state == state && !rtt_changed){
+        return;
+    }
+    probe->probed = TRUE;
+    probe->state = state;
+
+    lsets = htable_ptrs_new();
+    mcache_foreach_active_entry(xtr->map_cache, it){
+        rloc_probe_update_mce(xtr, (mcache_entry_t *)it, probe, lsets);
+    } mcache_foreach_end;
+    rloc_probe_update_mce(xtr, xtr->petrs, probe, lsets);
+    htable_ptrs_destroy(lsets);
+}
+
+/* Walk the map-cache to forget the RLOCs no longer used by any locator and
+ * to update the EID asked in the probes */
 static int
-rloc_probing(lisp_xtr_t *xtr, mapping_t *map, locator_t *loc, uint64_t nonce)
+rloc_probe_sweep_cb(oor_timer_t *timer)
 {
-    uconn_t uc;
-    lisp_addr_t * deid = NULL;
-    lisp_addr_t * drloc = NULL;
-    lisp_addr_t empty;
-    lbuf_t * b = NULL;
-    glist_t * rlocs = NULL;
-    void * hdr = NULL;
-    int ret;
-
-    deid = mapping_eid(map);
-
-    // XXX alopez -> What we have to do with ELP and probe bit
-    drloc = xtr->fwd_policy->get_fwd_ip_addr(locator_addr(loc), ctrl_rlocs(xtr->super.ctrl));
-    lisp_addr_set_lafi(&empty, LM_AFI_NO_ADDR);
+    lisp_xtr_t *xtr = oor_timer_owner(timer);
+    rloc_probe_t *probe;
+    void *it;
 
-    rlocs = ctrl_default_rlocs(xtr->super.ctrl);
-    b = lisp_msg_mreq_create(&empty, rlocs, deid);
-    glist_destroy(rlocs);
-    if (b == NULL){
-        return (BAD);
-    }
+    rloc_probe_table_foreach(&xtr->rloc_probes, probe) {
+        probe->in_use = FALSE;
+    } rloc_probe_table_foreach_end;
 
-    hdr = lisp_msg_hdr(b);
-    MREQ_NONCE(hdr) = nonce;
-    MREQ_RLOC_PROBE(hdr) = 1;
+    mcache_foreach_active_entry(xtr->map_cache, it){
+        program_mce_rloc_probing(xtr, (mcache_entry_t *)it);
+    } mcache_foreach_end;
+    program_mce_rloc_probing(xtr, xtr->petrs);
 
-    uconn_init(&uc, LISP_CONTROL_PORT, LISP_CONTROL_PORT, NULL, drloc);
-    ret = send_msg(&xtr->super, b, &uc);
-    lisp_msg_destroy(b);
+    rloc_probe_table_foreach(&xtr->rloc_probes, probe) {
+        if (!probe->in_use) {
+            OOR_LOG(LDBG_2,"RLOC %s not used anymore. Stop probing it",
+                    lisp_addr_to_char(probe->rloc));
+            rloc_probe_table_remove(&xtr->rloc_probes, probe);
+        }
+    } rloc_probe_table_foreach_end;
 
-    return (ret);
+    oor_timer_start(timer, xtr->probe_interval);
+    return (GOOD);
 }
 
-static void
-program_rloc_probing(lisp_xtr_t *xtr, mcache_entry_t *mce, locator_t *loc, int time)
+/* Return the probing of the RLOC of 'loct', programming it if it is the first
+ * locator with the RLOC */
+static rloc_probe_t *
+rloc_probe_get(lisp_xtr_t *xtr, mcache_entry_t *mce, locator_t *loct)
 {
+    rloc_probe_t *probe;
     oor_timer_t *timer;
-    timer_rloc_probe_argument *arg;
+    lisp_addr_t *drloc;
 
+    drloc = rloc_probe_addr(xtr, loct);
+    if (!drloc){
+        return (NULL);
+    }
+    probe = rloc_probe_table_lookup(&xtr->rloc_probes, drloc);
+    if (probe){
+        return (probe);
+    }
+    probe = rloc_probe_table_add(&xtr->rloc_probes, drloc,
+            mapping_eid(mcache_entry_mapping(mce)));
+    if (!probe){
+        return (NULL);
+    }
 
-    arg = timer_rloc_probe_argument_new_init(mce,loc);
-    timer = oor_timer_with_nonce_new(RLOC_PROBING_TIMER,xtr,rloc_probing_cb,
-            arg,(oor_timer_del_cb_arg_fn)timer_rloc_probe_argument_free);
-    htable_ptrs_timers_add(ptrs_to_timers_ht, mce, timer);
-
-    oor_timer_start(timer, time);
-    OOR_LOG(LDBG_2,"Programming probing of EID's %s locator %s (%d seconds)",
-            lisp_addr_to_char(mapping_eid(mcache_entry_mapping(mce))),
-            lisp_addr_to_char(locator_addr(loc)), time);
+    timer = oor_timer_with_nonce_new(RLOC_PROBING_TIMER, xtr, rloc_probing_cb,
+            probe, NULL);
+    htable_ptrs_timers_add(ptrs_to_timers_ht, probe, timer);
+    oor_timer_start_jitter(timer, xtr->probe_interval);
+    OOR_LOG(LDBG_2,"Programming probing of RLOC %s (%d seconds)",
+            lisp_addr_to_char(drloc), xtr->probe_interval);
+
+    if (!xtr->rloc_probe_sweep_timer){
+        xtr->rloc_probe_sweep_timer = oor_timer_create(RLOC_PROBING_TIMER);
+        oor_timer_init(xtr->rloc_probe_sweep_timer, xtr, rloc_probe_sweep_cb,
+                NULL, NULL, NULL);
+        oor_timer_start(xtr->rloc_probe_sweep_timer, xtr->probe_interval);
+    }
 
+    return (probe);
 }
 
-/* Program RLOC probing for each locator of the mapping */
+/* Program RLOC probing for each locator of the mapping. RLOCs already probed
+ * for other mappings are not probed again: their last result is applied to
+ * the locators of the mapping */
 static void
 program_mce_rloc_probing(lisp_xtr_t *xtr, mcache_entry_t *mce)
 {
-	mapping_t *map;
+    mapping_t *map;
     locator_t *locator;
+    rloc_probe_t *probe;
+    int changed = FALSE;
 
     if (xtr->probe_interval == 0) {
         return;
     }
-    /* Cancel previous RLOCs Probing associated to this mce */
-    stop_timers_of_type_from_obj(mce,RLOC_PROBING_TIMER,ptrs_to_timers_ht, nonces_ht);
 
     map = mcache_entry_mapping(mce);
-    /* Start rloc probing for each locator of the mapping */
     mapping_foreach_active_locator(map,locator){
-    		// XXX alopez: Check if RLOB probing available for all LCAF. ELP RLOC Probing bit
-    		program_rloc_probing(xtr, mce, locator, xtr->probe_interval);
+        // XXX alopez: Check if RLOB probing available for all LCAF. ELP RLOC Probing bit
+        probe = rloc_probe_get(xtr, mce, locator);
+        if (!probe){
+            continue;
+        }
+        /* The EID of the probes is the one of the first mapping using the RLOC */
+        if (!probe->in_use){
+            probe->in_use = TRUE;
+            if (lisp_addr_cmp(probe->eid, mapping_eid(map)) != 0){
+                lisp_addr_del(probe->eid);
+                probe->eid = lisp_addr_clone(mapping_eid(map));
+            }
+        }
+        if (probe->probed && locator_state(locator) != probe->state){
+            locator_set_state(locator, probe->state);
+            changed = TRUE;
+        }
+        if (locator_rtt(locator) != probe->pub_rtt){
+            locator_set_rtt(locator, probe->pub_rtt);
+            changed = TRUE;
+        }
     }mapping_foreach_active_locator_end;
+
+    if (changed){
+        xtr->fwd_policy->updated_map_cache_inf(xtr->fwd_policy_dev_parm, mce);
+    }
 }
 
 
@@ -1792,6 +2380,8 @@ tr_mcache_add_mapping(lisp_xtr_t *xtr, mapping_t *m)
         return (BAD);
     }
 
+    /* Entries with the same locators share them */
+    loct_set_intern(m);
     mcache_entry_init(mce, m);
 
     /* Precalculate routing information */
@@ -1946,7 +2536,6 @@ xtr_if_addr_update(oor_ctrl_dev_t *dev, char *iface_name, lisp_addr_t *old_addr,
 {
     lisp_xtr_t * xtr = lisp_xtr_cast(dev);
     iface_locators * if_loct = NULL;
-    glist_t * loct_list = NULL;
     glist_t * locators = NULL;
     locator_t * locator = NULL;
     map_local_entry_t * map_loc_e = NULL;
@@ -1998,9 +2587,9 @@ xtr_if_addr_update(oor_ctrl_dev_t *dev, char *iface_name, lisp_addr_t *old_addr,
             mapping = map_local_entry_mapping(map_loc_e);
             if (mapping_get_loct_with_addr(mapping,new_addr) != NULL){
                 OOR_LOG(LDBG_2, "xtr_if_addr_change: A non active locator is duplicated. Removing it");
-                loct_list = mapping_get_loct_lst_with_afi(mapping,LM_AFI_NO_ADDR,0);
                 iface_locators_unattach_locator(xtr->iface_locators_table,locator);
-                glist_remove_obj_with_ptr(locator,loct_list);
+                mapping_remove_locator(mapping,locator);
+                locator_del(locator);
                 continue;
             }
             /* Activate locator */
@@ -2010,6 +2599,10 @@ xtr_if_addr_update(oor_ctrl_dev_t *dev, char *iface_name, lisp_addr_t *old_addr,
 
         }else{
             locator_clone_addr(locator,new_addr);
+            glist_for_each_entry(it_m, if_loct->map_loc_entries){
+                map_loc_e = (map_local_entry_t *)glist_entry_data(it_m);
+                mapping_locators_changed(map_local_entry_mapping(map_loc_e));
+            }
         }
 
     }
@@ -2180,6 +2773,7 @@ map_server_elt_del (map_server_elt *map_server)
     if (map_server == NULL){
         return;
     }
+    stop_timers_from_obj(map_server, ptrs_to_timers_ht, nonces_ht);
     lisp_addr_del (map_server->address);
     free(map_server->key);
     free(map_server);
@@ -2220,6 +2814,9 @@ xtr_ctrl_construct(oor_ctrl_dev_t *dev)
     xtr->petrs = mcache_entry_new();
     xtr->rtrs = mcache_entry_new();
     xtr->iface_locators_table = shash_new_managed((free_value_fn_t)iface_locators_del);
+    rloc_probe_table_init(&xtr->rloc_probes);
+    peer_activity_init(&xtr->peer_activity);
+    xtr->mver_smr = kh_init(mver_smr);
 
     if (!xtr->local_mdb || !xtr->map_cache || !xtr->map_servers ||
             !xtr->map_resolvers || !xtr->pitrs || !xtr->petrs ||
@@ -2255,6 +2852,20 @@ xtr_ctrl_destruct(oor_ctrl_dev_t *dev)
     }
 
     shash_destroy(xtr->iface_locators_table);
+    oor_timer_stop(xtr->rloc_probe_sweep_timer);
+    rloc_probe_table_uninit(&xtr->rloc_probes);
+    if (xtr->smr_active_peers){
+        OOR_LOG(LDBG_1, "SMR to active peers: %"PRIu64" SMRs sent in %"PRIu64
+                " rounds (%"PRIu64" to peers without map cache entry), %d "
+                "peers tracked, %"PRIu64" not tracked (table full)",
+                xtr->smr_sent, xtr->smr_rounds, xtr->smr_no_mcache,
+                peer_activity_size(&xtr->peer_activity),
+                xtr->peer_activity.dropped);
+    }
+    peer_activity_uninit(&xtr->peer_activity);
+    kh_destroy(mver_smr, xtr->mver_smr);
+    stop_timers_of_type_from_obj(xtr, RLOC_REACH_HOLD_TIMER, ptrs_to_timers_ht,
+            nonces_ht);
     mcache_del(xtr->map_cache);
     mcache_entry_del(xtr->petrs);
     mcache_entry_del(xtr->rtrs);
@@ -2385,6 +2996,10 @@ xtr_run(lisp_xtr_t *xtr)
         /* Register EID prefix to control */
         map_loc_e = (map_local_entry_t *)it;
         ctrl_register_eid_prefix(&(xtr->super),map_local_entry_eid(map_loc_e));
+        if (xtr->map_versioning && mapping_version(
+                map_local_entry_mapping(map_loc_e)) == MAP_VERSION_NULL){
+            mapping_set_version(map_local_entry_mapping(map_loc_e), 1);
+        }
         /* Update forwarding info of the local mappings. When it is created during conf file process,
          * the local rlocs are not set. For this reason should be calculated again. It can not be removed
          * from the conf file process -> In future could appear fwd_map_info parameters*/
@@ -2459,7 +3074,13 @@ ctrl_dev_class_t xtr_ctrl_class = {
         .if_link_update = xtr_if_link_update,
         .if_addr_update = xtr_if_addr_update,
         .route_update = xtr_route_update,
-        .get_fwd_entry = tr_get_forwarding_entry
+        .get_fwd_entry = tr_get_forwarding_entry,
+        .get_mcast_fwd_entry = tr_get_mcast_forwarding_entry,
+        .rloc_reach_update = tr_rloc_reach_update,
+        .lsb_update = tr_lsb_update,
+        .glean_mapping = tr_glean_mapping,
+        .map_versions_update = tr_map_versions_update,
+        .peer_activity = tr_peer_activity
 };
 
 
@@ -2545,6 +3166,37 @@ map_servers_dump(lisp_xtr_t *xtr, int log_level)
 //    }
 //
 
+/* Locator-Status-Bits announced in the packets encapsulated with 'fe': one
+ * bit per locator of the local mapping 'map', in the order of the records */
+static void
+tr_fwd_entry_set_lsb(fwd_entry_t *fe, mapping_t *map)
+{
+    loct_vec_t *vec;
+    int i, max;
+
+    vec = mapping_loct_vec(map);
+    if (!vec){
+        return;
+    }
+    max = fe->iid ? 8 : 32;
+    fe->lsb = 0;
+    for (i = 0; i < vec->count && i < max; i++){
+        if (locator_state(vec->elts[i].loct) == UP){
+            fe->lsb |= 1U << i;
+        }
+    }
+    fe->lsb_set = TRUE;
+}
+
+/* Map-Versions announced in the packets encapsulated with 'fe' */
+static void
+tr_fwd_entry_set_map_versions(fwd_entry_t *fe, mapping_t *src_map,
+        mapping_t *dst_map)
+{
+    fe->src_map_version = mapping_version(src_map);
+    fe->dst_map_version = mapping_version(dst_map);
+}
+
 static fwd_info_t *
 tr_get_fwd_entry(lisp_xtr_t *xtr, packet_tuple_t *tuple)
 {
@@ -2617,6 +3269,9 @@ tr_get_fwd_entry(lisp_xtr_t *xtr, packet_tuple_t *tuple)
             fwd_info->neg_map_reply_act = ACT_NO_ACTION;
             return (fwd_info);
         }
+    } else if (mce->active == NOT_ACTIVE && mce->how_learned == MCE_GLEANED) {
+        /* Forward with the gleaned RLOC until the mapping is verified */
+        fwd_info->temporal = TRUE;
     } else if (mce->active == NOT_ACTIVE) {
         fwd_info->temporal = TRUE;
         OOR_LOG(LDBG_2, "Already sent Map-Request for %s. Waiting for reply!",
@@ -2640,6 +3295,9 @@ tr_get_fwd_entry(lisp_xtr_t *xtr, packet_tuple_t *tuple)
         }
     }
 
+    /* The entries in use are refreshed before they expire */
+    mce->active_witin_period = TRUE;
+
     dmap = mcache_entry_mapping(mce);
     if (mapping_locator_count(dmap) == 0) {
         OOR_LOG(LDBG_3, "Destination %s has a NEGATIVE mapping!",
@@ -2713,6 +3371,16 @@ tr_get_fwd_entry(lisp_xtr_t *xtr, packet_tuple_t *tuple)
             fwd_info->neg_map_reply_act = ACT_NATIVE_FWD;
         }
     }
+    if ((xtr->super.mode == xTR_MODE || xtr->super.mode == MN_MODE)
+            && fwd_info->fwd_info){
+        tr_fwd_entry_set_lsb(fwd_info->fwd_info,
+                map_local_entry_mapping(map_loc_e));
+        if (xtr->map_versioning){
+            tr_fwd_entry_set_map_versions(fwd_info->fwd_info,
+                    map_local_entry_mapping(map_loc_e),
+                    mcache_entry_mapping(mce));
+        }
+    }
     /* Assign encapsulated that should be used */
     fwd_info->encap = xtr->encap_type;
     lisp_addr_del(src_eid);
@@ -2731,6 +3399,414 @@ tr_get_forwarding_entry(oor_ctrl_dev_t *dev, packet_tuple_t *tuple)
     return(tr_get_fwd_entry(xtr, tuple));
 }
 
+/* Apply to the locators with 'rloc' a state learned from the data plane. The
+ * RLOC may not be probed: its state is only applied to the map-cache */
+static void
+tr_set_rloc_state(lisp_xtr_t *xtr, lisp_addr_t *rloc, uint8_t state)
+{
+    rloc_probe_t *probe, aux;
+
+    probe = rloc_probe_table_lookup(&xtr->rloc_probes, rloc);
+    if (!probe){
+        memset(&aux, 0, sizeof(rloc_probe_t));
+        aux.rloc = rloc;
+        probe = &aux;
+    }
+    rloc_probe_set_state(xtr, probe, state, FALSE);
+}
+
+/* Returns the timer restoring the locators with 'rloc' or NULL */
+static oor_timer_t *
+rloc_reach_hold_timer(lisp_xtr_t *xtr, lisp_addr_t *rloc)
+{
+    oor_timer_t *timer = NULL;
+    glist_t *timer_lst;
+    glist_entry_t *it;
+
+    timer_lst = htable_ptrs_timers_get_timers_of_type_from_obj(ptrs_to_timers_ht,
+            xtr, RLOC_REACH_HOLD_TIMER);
+    glist_for_each_entry(it, timer_lst){
+        if (lisp_addr_cmp(oor_timer_cb_argument(glist_entry_data(it)), rloc) == 0){
+            timer = (oor_timer_t *)glist_entry_data(it);
+            break;
+        }
+    }
+    glist_destroy(timer_lst);
+
+    return (timer);
+}
+
+/* Nothing is sent to a locator down, so without probing the data plane can't
+ * see it recover: it is restored after RLOC_REACH_DOWN_HOLD seconds and the
+ * echo-nonce algorithm verifies it again with the traffic */
+static int
+rloc_reach_hold_cb(oor_timer_t *timer)
+{
+    lisp_xtr_t *xtr = oor_timer_owner(timer);
+    lisp_addr_t *rloc = oor_timer_cb_argument(timer);
+
+    if (!rloc_probe_table_lookup(&xtr->rloc_probes, rloc)){
+        OOR_LOG(LDBG_1, "Echo-nonce: RLOC %s down for %d seconds. Using it "
+                "again to verify it", lisp_addr_to_char(rloc),
+                RLOC_REACH_DOWN_HOLD);
+        tr_set_rloc_state(xtr, rloc, UP);
+    }
+    stop_timer_from_obj(xtr, timer, ptrs_to_timers_ht, nonces_ht);
+    return (GOOD);
+}
+
+/* Reachability of 'rloc' detected with the echo-nonce algorithm */
+static void
+tr_rloc_reach_update(oor_ctrl_dev_t *dev, lisp_addr_t *rloc, uint8_t state)
+{
+    lisp_xtr_t *xtr = lisp_xtr_cast(dev);
+    oor_timer_t *timer;
+
+    if (xtr->super.mode != xTR_MODE && xtr->super.mode != MN_MODE){
+        return;
+    }
+    OOR_LOG(LDBG_1, "Echo-nonce: RLOC %s is %s", lisp_addr_to_char(rloc),
+            state == UP ? "up" : "down");
+    tr_set_rloc_state(xtr, rloc, state);
+
+    timer = rloc_reach_hold_timer(xtr, rloc);
+    if (state == UP || rloc_probe_table_lookup(&xtr->rloc_probes, rloc)){
+        if (timer){
+            stop_timer_from_obj(xtr, timer, ptrs_to_timers_ht, nonces_ht);
+        }
+        return;
+    }
+    if (!timer){
+        timer = oor_timer_create(RLOC_REACH_HOLD_TIMER);
+        oor_timer_init(timer, xtr, rloc_reach_hold_cb, lisp_addr_clone(rloc),
+                (oor_timer_del_cb_arg_fn)lisp_addr_del, NULL);
+        htable_ptrs_timers_add(ptrs_to_timers_ht, xtr, timer);
+    }
+    oor_timer_start(timer, RLOC_REACH_DOWN_HOLD);
+}
+
+/* Locator-Status-Bits received from 'rloc' in the packets of 'eid'. The bits
+ * are ignored when they don't match the locators of the map-cache entry
+ * (the Map-Reply omits the locators down, so the positions may differ).
+ * A locator marked up is only restored when it is not probed: probing
+ * decides the state of the RLOCs it monitors */
+static void
+tr_lsb_update(oor_ctrl_dev_t *dev, lisp_addr_t *eid, lisp_addr_t *rloc,
+        uint32_t lsb, int lsb_count)
+{
+    lisp_xtr_t *xtr = lisp_xtr_cast(dev);
+    mcache_entry_t *mce;
+    loct_vec_t *vec;
+    locator_t *loct;
+    lisp_addr_t *drloc;
+    int i, count, src_idx = -1;
+
+    if (xtr->super.mode != xTR_MODE && xtr->super.mode != MN_MODE){
+        return;
+    }
+    mce = mcache_lookup(xtr->map_cache, eid);
+    if (!mce || !mcache_entry_active(mce)){
+        return;
+    }
+    vec = mapping_loct_vec(mcache_entry_mapping(mce));
+    if (!vec || vec->count == 0){
+        return;
+    }
+    count = vec->count < lsb_count ? vec->count : lsb_count;
+    if (count < lsb_count && (lsb >> count) != 0){
+        OOR_LOG(LDBG_2, "Locator-Status-Bits %#x of %s don't match its %d "
+                "locators. Ignoring them", lsb, lisp_addr_to_char(eid),
+                vec->count);
+        return;
+    }
+    for (i = 0; i < count; i++){
+        drloc = rloc_probe_addr(xtr, vec->elts[i].loct);
+        if (drloc && lisp_addr_cmp(drloc, rloc) == 0){
+            src_idx = i;
+            break;
+        }
+    }
+    if (src_idx < 0 || !(lsb & (1U << src_idx))){
+        OOR_LOG(LDBG_2, "Locator-Status-Bits %#x of %s don't mark as up the "
+                "RLOC %s sending them. Ignoring them", lsb,
+                lisp_addr_to_char(eid), lisp_addr_to_char(rloc));
+        return;
+    }
+
+    for (i = 0; i < count; i++){
+        loct = vec->elts[i].loct;
+        drloc = rloc_probe_addr(xtr, loct);
+        if (!drloc){
+            continue;
+        }
+        if (!(lsb & (1U << i)) && locator_state(loct) != DOWN){
+            OOR_LOG(LDBG_1, "Locator-Status-Bits: locator %s of %s is down",
+                    lisp_addr_to_char(drloc), lisp_addr_to_char(eid));
+            tr_set_rloc_state(xtr, drloc, DOWN);
+        }else if ((lsb & (1U << i)) && locator_state(loct) == DOWN
+                && !rloc_probe_table_lookup(&xtr->rloc_probes, drloc)){
+            OOR_LOG(LDBG_1, "Locator-Status-Bits: locator %s of %s is up",
+                    lisp_addr_to_char(drloc), lisp_addr_to_char(eid));
+            tr_set_rloc_state(xtr, drloc, UP);
+        }
+    }
+}
+
+/* Returns TRUE if no SMR has been sent to 'rloc' for the local mapping
+ * 'lmap' in the last MVER_SMR_INTERVAL seconds, and records the new one */
+static int
+mver_smr_allowed(lisp_xtr_t *xtr, lisp_addr_t *rloc, mapping_t *lmap)
+{
+    addr_pair_key_t key;
+    khiter_t k;
+    time_t now;
+    int ret;
+
+    memset(&key, 0, sizeof(key));
+    addr_key_from_ip(&key.src, lisp_addr_ip(rloc), 0);
+    if (addr_key_from_lisp_addr(&key.dst, mapping_eid(lmap)) != GOOD){
+        return (TRUE);
+    }
+
+    now = time(NULL);
+    k = kh_get(mver_smr, xtr->mver_smr, key);
+    if (k != kh_end(xtr->mver_smr)){
+        if (now - kh_value(xtr->mver_smr, k) < MVER_SMR_INTERVAL){
+            return (FALSE);
+        }
+        kh_value(xtr->mver_smr, k) = now;
+        return (TRUE);
+    }
+
+    /* Forget the SMRs old enough not to limit the next ones */
+    if (kh_size(xtr->mver_smr) >= MVER_SMR_MAX_SIZE){
+        for (k = kh_begin(xtr->mver_smr); k != kh_end(xtr->mver_smr); ++k){
+            if (kh_exist(xtr->mver_smr, k)
+                    && now - kh_value(xtr->mver_smr, k) >= MVER_SMR_INTERVAL){
+                kh_del(mver_smr, xtr->mver_smr, k);
+            }
+        }
+        if (kh_size(xtr->mver_smr) >= MVER_SMR_MAX_SIZE){
+            return (FALSE);
+        }
+    }
+    k = kh_put(mver_smr, xtr->mver_smr, key, &ret);
+    kh_value(xtr->mver_smr, k) = now;
+    return (TRUE);
+}
+
+/*
+ * Map-Versions received from 'rloc' in a packet with the EIDs of 'tuple'
+ * (RFC 6834). A Dest Map-Version that is not the one of the local mapping
+ * means the remote ITR uses an old mapping: it is solicited to refresh it.
+ * A Source Map-Version that is not the one of the map-cache entry means the
+ * entry is old: it is requested again. Any difference is considered, not
+ * only older versions, as the versions start again when OOR restarts.
+ * The data plane only filters repeated versions, so the SMRs to an RLOC are
+ * limited to one per local mapping every MVER_SMR_INTERVAL seconds.
+ */
+static void
+tr_map_versions_update(oor_ctrl_dev_t *dev, packet_tuple_t *tuple,
+        lisp_addr_t *rloc, uint16_t src_ver, uint16_t dst_ver)
+{
+    lisp_xtr_t *xtr = lisp_xtr_cast(dev);
+    map_local_entry_t *map_loc_e;
+    mcache_entry_t *mce;
+    mapping_t *lmap, *rmap;
+    lisp_addr_t *src_eid, *dst_eid;
+    glist_t *timers;
+    int iidmlen;
+
+    if (!xtr->map_versioning
+            || (xtr->super.mode != xTR_MODE && xtr->super.mode != MN_MODE)){
+        return;
+    }
+    if (tuple->iid > 0){
+        iidmlen = (lisp_addr_ip_afi(&tuple->src_addr) == AF_INET) ? 32: 128;
+        src_eid = lisp_addr_new_init_iid(tuple->iid, &tuple->src_addr, iidmlen);
+        dst_eid = lisp_addr_new_init_iid(tuple->iid, &tuple->dst_addr, iidmlen);
+    }else{
+        src_eid = lisp_addr_clone(&tuple->src_addr);
+        dst_eid = lisp_addr_clone(&tuple->dst_addr);
+    }
+
+    map_loc_e = local_map_db_lookup_eid(xtr->local_mdb, dst_eid, FALSE);
+    if (map_loc_e && dst_ver != MAP_VERSION_NULL){
+        lmap = map_local_entry_mapping(map_loc_e);
+        if (mapping_version(lmap) != dst_ver
+                && mver_smr_allowed(xtr, rloc, lmap)){
+            OOR_LOG(LDBG_1, "Map-Versioning: RLOC %s uses version %d of the "
+                    "mapping of %s instead of %d. Sending SMR",
+                    lisp_addr_to_char(rloc), dst_ver,
+                    lisp_addr_to_char(mapping_eid(lmap)), mapping_version(lmap));
+            build_and_send_smr_mreq(xtr, lmap, src_eid, rloc);
+        }
+    }
+
+    /* Entries learnt without version are refreshed as before */
+    mce = mcache_lookup(xtr->map_cache, src_eid);
+    if (map_loc_e && mce && mcache_entry_active(mce)
+            && src_ver != MAP_VERSION_NULL){
+        rmap = mcache_entry_mapping(mce);
+        if (mapping_version(rmap) != MAP_VERSION_NULL
+                && mapping_version(rmap) != src_ver){
+            timers = htable_ptrs_timers_get_timers_of_type_from_obj(
+                    ptrs_to_timers_ht, mce, SMR_INV_RETRY_TIMER);
+            if (glist_size(timers) == 0){
+                OOR_LOG(LDBG_1, "Map-Versioning: version %d of the mapping of "
+                        "%s received instead of %d. Requesting it",
+                        src_ver, lisp_addr_to_char(mapping_eid(rmap)),
+                        mapping_version(rmap));
+                tr_reply_to_smr(xtr, dst_eid, mapping_eid(rmap));
+            }
+            glist_destroy(timers);
+        }
+    }
+
+    lisp_addr_del(src_eid);
+    lisp_addr_del(dst_eid);
+}
+
+/*
+ * Add to 'dst_rlocs' the nodes of the RLE 'rle' to which this xTR has to
+ * replicate the packets. An ITR replicates to the nodes with the lowest
+ * level. When the xTR is itself a node of the RLE, it replicates to the
+ * nodes of the next level.
+ */
+static void
+rle_get_replication_nodes(lcaf_addr_t *rle, glist_t *dst_rlocs)
+{
+    glist_entry_t *it;
+    rle_node_t *rnode;
+    int own_level = -1, next_level = 256;
+
+    glist_for_each_entry(it, lcaf_rle_node_list(rle)) {
+        rnode = (rle_node_t *)glist_entry_data(it);
+        if (rnode->level > own_level
+                && get_interface_with_address(rnode->addr) != NULL) {
+            own_level = rnode->level;
+        }
+    }
+    glist_for_each_entry(it, lcaf_rle_node_list(rle)) {
+        rnode = (rle_node_t *)glist_entry_data(it);
+        if (rnode->level > own_level && rnode->level < next_level) {
+            next_level = rnode->level;
+        }
+    }
+    glist_for_each_entry(it, lcaf_rle_node_list(rle)) {
+        rnode = (rle_node_t *)glist_entry_data(it);
+        if (rnode->level == next_level) {
+            glist_add_tail(rnode->addr, dst_rlocs);
+        }
+    }
+}
+
+/*
+ * Obtain the replication list of the (S,G) channel of the tuple. The
+ * fwd_info of the returned structure is a list of fwd_entry_t, one for each
+ * destination RLOC. An empty list means that the packet should be dropped.
+ */
+static fwd_info_t *
+tr_get_mcast_fwd_entry(lisp_xtr_t *xtr, packet_tuple_t *tuple)
+{
+    fwd_info_t *fwd_info;
+    mcache_entry_t *mce;
+    map_local_entry_t *map_loc_e;
+    mapping_t *dmap;
+    locator_t *loct;
+    lisp_addr_t *mc_eid, *eid, *laddr, *srloc, *drloc;
+    glist_t *dst_rlocs, *rep_list;
+    glist_entry_t *it;
+    fwd_entry_t *fwd_entry;
+
+    fwd_info = fwd_info_new();
+    if(fwd_info == NULL){
+        OOR_LOG(LWRN, "tr_get_mcast_fwd_entry: Couldn't allocate memory for fwd_info_t");
+        return (NULL);
+    }
+    rep_list = glist_new_managed((glist_del_fct)fwd_entry_del);
+    fwd_info->fwd_info = rep_list;
+    fwd_info->neg_map_reply_act = ACT_NO_ACTION;
+    fwd_info->encap = xtr->encap_type;
+
+    if (xtr->super.mode == xTR_MODE || xtr->super.mode == MN_MODE) {
+        map_loc_e = local_map_db_lookup_eid(xtr->local_mdb, &tuple->src_addr, FALSE);
+        if (map_loc_e != NULL){
+            eid = map_local_entry_eid(map_loc_e);
+            if (lisp_addr_is_iid(eid)){
+                tuple->iid = lcaf_iid_get_iid(lisp_addr_get_lcaf(eid));
+            }
+        }
+    }
+
+    mc_eid = lisp_addr_build_mc(&tuple->src_addr, &tuple->dst_addr);
+    mc_type_set_iid(lcaf_addr_get_mc(lisp_addr_get_lcaf(mc_eid)), tuple->iid);
+
+    mce = mcache_lookup(xtr->map_cache, mc_eid);
+    if (!mce) {
+        fwd_info->temporal = TRUE;
+        OOR_LOG(LDBG_1, "No map cache for multicast EID %s. Sending Map-Request!",
+                lisp_addr_to_char(mc_eid));
+        handle_map_cache_miss(xtr, mc_eid, &tuple->src_addr);
+        lisp_addr_del(mc_eid);
+        return (fwd_info);
+    } else if (mce->active == NOT_ACTIVE) {
+        fwd_info->temporal = TRUE;
+        OOR_LOG(LDBG_2, "Already sent Map-Request for %s. Waiting for reply!",
+                lisp_addr_to_char(mc_eid));
+        lisp_addr_del(mc_eid);
+        return (fwd_info);
+    }
+
+    dst_rlocs = glist_new();
+    dmap = mcache_entry_mapping(mce);
+    mapping_foreach_active_locator(dmap, loct){
+        if (locator_state(loct) != UP){
+            continue;
+        }
+        laddr = locator_addr(loct);
+        if (lisp_addr_is_lcaf(laddr)
+                && lisp_addr_lcaf_type(laddr) == LCAF_RLE){
+            rle_get_replication_nodes(lisp_addr_get_lcaf(laddr), dst_rlocs);
+        } else if (lisp_addr_lafi(laddr) == LM_AFI_IP){
+            glist_add_tail(laddr, dst_rlocs);
+        }
+    }mapping_foreach_active_locator_end;
+
+    glist_for_each_entry(it, dst_rlocs){
+        drloc = (lisp_addr_t *)glist_entry_data(it);
+        /* Don't replicate to ourselves */
+        if (get_interface_with_address(drloc) != NULL){
+            continue;
+        }
+        srloc = ctrl_default_rloc(xtr->super.ctrl, lisp_addr_ip_afi(drloc));
+        if (srloc == NULL){
+            OOR_LOG(LDBG_3, "tr_get_mcast_fwd_entry: No local RLOC compatible with %s",
+                    lisp_addr_to_char(drloc));
+            continue;
+        }
+        fwd_entry = fwd_entry_new_init(srloc, drloc, tuple->iid, NULL);
+        glist_add_tail(fwd_entry, rep_list);
+    }
+
+    OOR_LOG(LDBG_3, "tr_get_mcast_fwd_entry: Multicast EID %s replicated to %d RLOCs",
+            lisp_addr_to_char(mc_eid), glist_size(rep_list));
+
+    glist_destroy(dst_rlocs);
+    lisp_addr_del(mc_eid);
+    return (fwd_info);
+}
+
+static fwd_info_t *
+tr_get_mcast_forwarding_entry(oor_ctrl_dev_t *dev, packet_tuple_t *tuple)
+{
+    lisp_xtr_t *xtr;
+
+    xtr = lisp_xtr_cast(dev);
+
+    return(tr_get_mcast_fwd_entry(xtr, tuple));
+}
+
 /*
  * Return the list of locators from the local mappings containing addr
  * @param local_db Database where to search locators
@@ -2880,53 +3956,48 @@ get_map_resolver(lisp_xtr_t *xtr)
 
 // XXX This function is only used while we don't have support of L bit of ELPs
 static int
-mapping_has_elp_with_l_bit(mapping_t *map)
+rec_view_has_elp_with_l_bit(lisp_rec_view_t *rv)
 {
-    glist_t *loct_list;
-    locator_t *loct;
-    lisp_addr_t *addr;
+    lisp_loc_view_t lv;
+    lisp_addr_t addr;
     elp_t * elp;
     elp_node_t *elp_node;
-    glist_entry_t *loct_it;
     glist_entry_t *elp_n_it;
+    int has_l_bit = FALSE;
 
-    loct_list = mapping_get_loct_lst_with_afi(map,LM_AFI_LCAF,LCAF_EXPL_LOC_PATH);
-    if (loct_list == NULL){
-        return (FALSE);
-    }
-    glist_for_each_entry(loct_it,loct_list){
-        loct = (locator_t *)glist_entry_data(loct_it);
-        addr = locator_addr(loct);
-        elp = (elp_t *)lisp_addr_lcaf_addr(addr);
+    lisp_rec_view_foreach_loc(rv, &lv) {
+        if (lisp_loc_view_afi(&lv) != LISP_AFI_LCAF
+                || LCAF_CAST(lv.addr)->type != LCAF_EXPL_LOC_PATH) {
+            continue;
+        }
+        if (lisp_loc_view_addr(&lv, &addr) != GOOD) {
+            continue;
+        }
+        elp = (elp_t *)lisp_addr_lcaf_addr(&addr);
         glist_for_each_entry(elp_n_it,elp->nodes){
             elp_node = (elp_node_t *)glist_entry_data(elp_n_it);
             if (elp_node->L == true){
-                return (TRUE);
+                has_l_bit = TRUE;
+                break;
             }
         }
+        lisp_addr_dealloc(&addr);
+        if (has_l_bit) {
+            return (TRUE);
+        }
     }
 
     return (FALSE);
 }
 
-timer_rloc_probe_argument *
-timer_rloc_probe_argument_new_init(mcache_entry_t *mce,locator_t *locator)
-{
-    timer_rloc_probe_argument *timer_arg = xmalloc(sizeof(timer_rloc_probe_argument));
-    timer_arg->mce = mce;
-    timer_arg->locator = locator;
-    return (timer_arg);
-}
-
-void
-timer_rloc_probe_argument_free(timer_rloc_probe_argument *timer_arg){
-    free (timer_arg);
-}
+/* Arguments of the timers programmed for each map-cache entry */
+static mem_slab_t timer_map_req_arg_slab = MEM_SLAB_INITIALIZER(
+        "map_req_arg", timer_map_req_argument);
 
 timer_map_req_argument *
 timer_map_req_arg_new_init(mcache_entry_t *mce,lisp_addr_t *src_eid)
 {
-    timer_map_req_argument *timer_arg = xmalloc(sizeof(timer_map_req_argument));
+    timer_map_req_argument *timer_arg = mem_slab_alloc(&timer_map_req_arg_slab);
     timer_arg->mce = mce;
     timer_arg->src_eid = lisp_addr_clone(src_eid);
 
@@ -2937,16 +4008,15 @@ void
 timer_map_req_arg_free(timer_map_req_argument * timer_arg)
 {
     lisp_addr_del(timer_arg->src_eid);
-    free(timer_arg);
+    mem_slab_free(&timer_map_req_arg_slab, timer_arg);
 }
 
 timer_map_reg_argument *
-timer_map_reg_argument_new_init(map_local_entry_t *mle,
-        map_server_elt *ms)
+timer_map_reg_argument_new_init(map_server_elt *ms)
 {
-    timer_map_reg_argument *timer_arg = xmalloc(sizeof(timer_map_reg_argument));
-    timer_arg->mle = mle;
+    timer_map_reg_argument *timer_arg = xzalloc(sizeof(timer_map_reg_argument));
     timer_arg->ms = ms;
+    timer_arg->pending_eids = glist_new_managed((glist_del_fct)lisp_addr_del);
 
     return(timer_arg);
 }
@@ -2954,6 +4024,7 @@ timer_map_reg_argument_new_init(map_local_entry_t *mle,
 void
 timer_map_reg_arg_free(timer_map_reg_argument * timer_arg)
 {
+    glist_destroy(timer_arg->pending_eids);
     free(timer_arg);
 }
 
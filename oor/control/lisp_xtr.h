@@ -24,6 +24,8 @@
 #include "oor_ctrl_device.h"
 #include "../defs.h"
 #include "../fwd_policies/fwd_policy.h"
+#include "../lib/peer_activity.h"
+#include "../lib/rloc_probe_table.h"
 #include "../lib/shash.h"
 
 
@@ -39,6 +41,26 @@ typedef enum {
     AFTER_DRAFT_VER_4
 }nat_version;
 
+/* Seconds before the expiration of a map-cache entry under which an entry
+ * not in use at its refresh point is not checked again */
+#define MCACHE_REFRESH_MIN_LEAD 10
+
+/* LISP Pub/Sub: the Map-Server numbers the publications of a subscription
+ * from the nonce of the Map-Request. Publications with a nonce not newer than
+ * the last one accepted, or newer by more than this, are discarded */
+#define PUBSUB_NONCE_WINDOW     0xFFFFFFFFULL
+
+/* Seconds between the SMRs sent to an RLOC that uses an old Map-Version of
+ * the same local mapping. Each packet with the old version would trigger
+ * one otherwise */
+#define MVER_SMR_INTERVAL       5
+#define MVER_SMR_MAX_SIZE       10000
+
+/* Key: RLOC and EID prefix of the local mapping. Value: time of the SMR */
+#define mver_smr_hash(_k)           addr_pair_key_hash(&(_k))
+#define mver_smr_equal(_k1, _k2)    addr_pair_key_equal(&(_k1), &(_k2))
+KHASH_INIT(mver_smr, addr_pair_key_t, time_t, 1, mver_smr_hash, mver_smr_equal)
+
 typedef struct lisp_xtr {
     oor_ctrl_dev_t super; /* base "class" */
 
@@ -51,6 +73,19 @@ typedef struct lisp_xtr {
     int (*add_mapping_to_local_map_db)(mapping_t *mapping);
 
     int map_request_retries;
+    /* Install the mappings of the sources of the traffic received */
+    int glean_mappings;
+    /* Version the local mappings and check the versions of the data
+     * traffic instead of sending SMRs to every peer (RFC 6834) */
+    int map_versioning;
+    /* Send SMRs only to the peers with traffic in the last minute */
+    int smr_active_peers;
+    /* Subscribe to the mappings requested to be notified of their changes
+     * by the Map-Servers (LISP Pub/Sub) */
+    int pubsub;
+    /* Percentage of the TTL after which the map cache entries used since
+     * their last update are requested again. 0 disables it */
+    int mcache_refresh;
     int probe_interval;
     int probe_retries;
     int probe_retries_interval;
@@ -82,6 +117,18 @@ typedef struct lisp_xtr {
     /* TIMERS */
     oor_timer_t *smr_timer;
 
+    /* PEERS WITH TRAFFIC, TARGETS OF THE SMRs */
+    peer_activity_t peer_activity;
+    uint64_t smr_rounds;
+    uint64_t smr_sent;
+    uint64_t smr_no_mcache;
+    /* Last SMR sent because of an old Map-Version */
+    khash_t(mver_smr) *mver_smr;
+
+    /* RLOC PROBING */
+    rloc_probe_table_t rloc_probes;
+    oor_timer_t *rloc_probe_sweep_timer;
+
     /* MAPPING IFACE TO LOCATORS */
     shash_t *iface_locators_table; /* Key: Iface name, Value: iface_locators */
 
@@ -99,19 +146,20 @@ typedef struct map_server_elt_t {
     uint8_t         proxy_reply;
 } map_server_elt;
 
-typedef struct _timer_rloc_prob_argument {
-    mcache_entry_t *mce;
-    locator_t      *locator;
-} timer_rloc_probe_argument;
-
 typedef struct _timer_map_req_argument {
     mcache_entry_t  *mce;
     lisp_addr_t     *src_eid;
 } timer_map_req_argument;
 
+/* A single Map-Register timer per Map-Server registers all the local
+ * mappings, packed in as few messages as possible */
 typedef struct _timer_map_reg_argument {
-    map_local_entry_t  *mle;
     map_server_elt     *ms;
+    /* EIDs sent and not confirmed yet by a Map-Notify */
+    glist_t            *pending_eids; // <lisp_addr_t *>
+    int                retries;
+    /* Time of the last registration of all the mappings */
+    time_t             last_reg;
 } timer_map_reg_argument;
 
 typedef struct _timer_encap_map_reg_argument {
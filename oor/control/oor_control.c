@@ -74,6 +74,7 @@ ctrl_create()
     ctrl->ipv4_rlocs = glist_new();
     ctrl->ipv6_rlocs = glist_new();
     ctrl->control_data_plane = control_dp_select();
+    ctrl_pacer_init(&ctrl->pacer, ctrl);
 
     OOR_LOG(LINF, "Control created!");
 
@@ -86,6 +87,9 @@ ctrl_destroy(oor_ctrl_t *ctrl)
     if (ctrl == NULL){
         return;
     }
+    ctrl_pacer_stats_dump(&ctrl->pacer, LDBG_1);
+    /* Queued messages are not sent anymore */
+    ctrl_pacer_uninit(&ctrl->pacer);
     glist_destroy(ctrl->devices);
     glist_destroy(ctrl->rlocs);
     glist_destroy(ctrl->ipv4_rlocs);
@@ -245,6 +249,55 @@ ctrl_get_forwarding_info(packet_tuple_t *tuple)
     return (ctrl_dev_get_fwd_entry(dev, tuple));
 }
 
+fwd_info_t *
+ctrl_get_mcast_forwarding_info(packet_tuple_t *tuple)
+{
+    oor_ctrl_dev_t *dev;
+    dev = glist_first_data(lctrl->devices);
+    return (ctrl_dev_get_mcast_fwd_entry(dev, tuple));
+}
+
+void
+ctrl_rloc_reach_update(lisp_addr_t *rloc, uint8_t state)
+{
+    oor_ctrl_dev_t *dev;
+    dev = glist_first_data(lctrl->devices);
+    ctrl_dev_rloc_reach_update(dev, rloc, state);
+}
+
+void
+ctrl_lsb_update(lisp_addr_t *eid, lisp_addr_t *rloc, uint32_t lsb, int lsb_count)
+{
+    oor_ctrl_dev_t *dev;
+    dev = glist_first_data(lctrl->devices);
+    ctrl_dev_lsb_update(dev, eid, rloc, lsb, lsb_count);
+}
+
+void
+ctrl_glean_mapping(packet_tuple_t *tuple, lisp_addr_t *rloc)
+{
+    oor_ctrl_dev_t *dev;
+    dev = glist_first_data(lctrl->devices);
+    ctrl_dev_glean_mapping(dev, tuple, rloc);
+}
+
+void
+ctrl_map_versions_update(packet_tuple_t *tuple, lisp_addr_t *rloc,
+        uint16_t src_ver, uint16_t dst_ver)
+{
+    oor_ctrl_dev_t *dev;
+    dev = glist_first_data(lctrl->devices);
+    ctrl_dev_map_versions_update(dev, tuple, rloc, src_ver, dst_ver);
+}
+
+void
+ctrl_peer_activity(packet_tuple_t *tuple, lisp_addr_t *rloc)
+{
+    oor_ctrl_dev_t *dev;
+    dev = glist_first_data(lctrl->devices);
+    ctrl_dev_peer_activity(dev, tuple, rloc);
+}
+
 int
 ctrl_register_device(oor_ctrl_t *ctrl, oor_ctrl_dev_t *dev)
 {
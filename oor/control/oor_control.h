@@ -24,6 +24,7 @@
 #include "../lib/sockets.h"
 #include "../liblisp/liblisp.h"
 #include "control-data-plane/control-data-plane.h"
+#include "ctrl_pacer.h"
 
 
 typedef struct oor_ctrl oor_ctrl_t;
@@ -38,6 +39,8 @@ struct oor_ctrl {
     glist_t *ipv4_rlocs;
     glist_t *ipv6_rlocs;
     control_dplane_struct_t *control_data_plane;
+    /* queue of the outgoing control messages */
+    ctrl_pacer_t pacer;
 };
 
 oor_ctrl_t *ctrl_create();
@@ -66,6 +69,18 @@ void ctrl_if_link_update(oor_ctrl_t *ctrl, iface_t *iface, int old_iface_index,
 void ctrl_route_update(oor_ctrl_t *ctrl, int command, iface_t *iface,lisp_addr_t *src_pref,
         lisp_addr_t *dst_pref, lisp_addr_t *gateway);
 fwd_info_t *ctrl_get_forwarding_info(packet_tuple_t *);
+fwd_info_t *ctrl_get_mcast_forwarding_info(packet_tuple_t *);
+/* Reachability of the RLOCs learnt by the data plane */
+void ctrl_rloc_reach_update(lisp_addr_t *rloc, uint8_t state);
+void ctrl_lsb_update(lisp_addr_t *eid, lisp_addr_t *rloc, uint32_t lsb,
+        int lsb_count);
+/* Mapping of the source of a packet decapsulated by the data plane */
+void ctrl_glean_mapping(packet_tuple_t *tuple, lisp_addr_t *rloc);
+/* Map-Versions received by the data plane */
+void ctrl_map_versions_update(packet_tuple_t *tuple, lisp_addr_t *rloc,
+        uint16_t src_ver, uint16_t dst_ver);
+/* Peer that sent a packet decapsulated by the data plane */
+void ctrl_peer_activity(packet_tuple_t *tuple, lisp_addr_t *rloc);
 int ctrl_register_device(oor_ctrl_t *ctrl, oor_ctrl_dev_t *dev);
 
 int ctrl_register_eid_prefix(oor_ctrl_dev_t *dev, lisp_addr_t *eid_prefix);
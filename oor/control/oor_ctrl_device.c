@@ -49,7 +49,18 @@ ctrl_dev_class_find(oor_dev_type_e type)
 int
 ctrl_dev_recv(oor_ctrl_dev_t *dev, lbuf_t *b, uconn_t *uc)
 {
-    return(dev->ctrl_class->recv_msg(dev, b, uc));
+    int ret;
+
+    ret = dev->ctrl_class->recv_msg(dev, b, uc);
+    mem_arena_reset(&dev->msg_arena);
+    return(ret);
+}
+
+/* Arena for the temporary objects of the message being processed */
+mem_arena_t *
+ctrl_dev_msg_arena(oor_ctrl_dev_t *dev)
+{
+    return(&dev->msg_arena);
 }
 
 void
@@ -71,6 +82,7 @@ ctrl_dev_create(oor_dev_type_e type, oor_ctrl_dev_t **devp)
     dev = class->alloc();
     dev->mode =type;
     dev->ctrl_class = class;
+    mem_arena_init(&dev->msg_arena, "ctrl_msg", CTRL_MSG_ARENA_SIZE);
     dev->ctrl_class->construct(dev);
     ctrl_dev_set_ctrl(dev, lctrl);
     *devp = dev;
@@ -85,13 +97,41 @@ ctrl_dev_destroy(oor_ctrl_dev_t *dev)
     }
 
     dev->ctrl_class->destruct(dev);
+    mem_arena_uninit(&dev->msg_arena);
     dev->ctrl_class->dealloc(dev);
 }
 
+/* Only the messages the tunnel routers originate periodically or in bursts
+ * are paced: Map-Registers, Map-Requests (also SMRs), both plain and
+ * encapsulated, and Info-Requests. Replies, RLOC probes and the messages of
+ * the Map-Server leave right away: delaying them makes the peers retransmit
+ * and adds the queueing delay to the RTT measured with the probes */
+static int
+send_msg_is_paced(oor_ctrl_dev_t *dev, lbuf_t *b)
+{
+    if (dev->mode == MS_MODE || !lbuf_lisp(b)){
+        return (FALSE);
+    }
+    switch (lisp_msg_type(b)){
+    case LISP_MAP_REQUEST:
+        return (!MREQ_RLOC_PROBE(lbuf_lisp(b)));
+    case LISP_MAP_REGISTER:
+        return (TRUE);
+    case LISP_INFO_NAT:
+        return (INF_REQ_R_bit(lbuf_lisp(b)) == INFO_REQUEST);
+    default:
+        return (FALSE);
+    }
+}
+
 int
 send_msg(oor_ctrl_dev_t *dev, lbuf_t *b, uconn_t *uc)
 {
-    return(dev->ctrl->control_data_plane->control_dp_send_msg(dev->ctrl, b, uc));
+    if (!send_msg_is_paced(dev, b)){
+        return(dev->ctrl->control_data_plane->control_dp_send_msg(dev->ctrl,
+                b, uc));
+    }
+    return(ctrl_pacer_send(&dev->ctrl->pacer, b, uc));
 }
 
 int
@@ -121,6 +161,56 @@ ctrl_dev_get_fwd_entry(oor_ctrl_dev_t *dev, packet_tuple_t *tuple)
     return(dev->ctrl_class->get_fwd_entry(dev, tuple));
 }
 
+fwd_info_t *
+ctrl_dev_get_mcast_fwd_entry(oor_ctrl_dev_t *dev, packet_tuple_t *tuple)
+{
+    return(dev->ctrl_class->get_mcast_fwd_entry(dev, tuple));
+}
+
+void
+ctrl_dev_rloc_reach_update(oor_ctrl_dev_t *dev, lisp_addr_t *rloc, uint8_t state)
+{
+    if (dev->ctrl_class->rloc_reach_update){
+        dev->ctrl_class->rloc_reach_update(dev, rloc, state);
+    }
+}
+
+void
+ctrl_dev_lsb_update(oor_ctrl_dev_t *dev, lisp_addr_t *eid, lisp_addr_t *rloc,
+        uint32_t lsb, int lsb_count)
+{
+    if (dev->ctrl_class->lsb_update){
+        dev->ctrl_class->lsb_update(dev, eid, rloc, lsb, lsb_count);
+    }
+}
+
+void
+ctrl_dev_glean_mapping(oor_ctrl_dev_t *dev, packet_tuple_t *tuple,
+        lisp_addr_t *rloc)
+{
+    if (dev->ctrl_class->glean_mapping){
+        dev->ctrl_class->glean_mapping(dev, tuple, rloc);
+    }
+}
+
+void
+ctrl_dev_map_versions_update(oor_ctrl_dev_t *dev, packet_tuple_t *tuple,
+        lisp_addr_t *rloc, uint16_t src_ver, uint16_t dst_ver)
+{
+    if (dev->ctrl_class->map_versions_update){
+        dev->ctrl_class->map_versions_update(dev, tuple, rloc, src_ver, dst_ver);
+    }
+}
+
+void
+ctrl_dev_peer_activity(oor_ctrl_dev_t *dev, packet_tuple_t *tuple,
+        lisp_addr_t *rloc)
+{
+    if (dev->ctrl_class->peer_activity){
+        dev->ctrl_class->peer_activity(dev, tuple, rloc);
+    }
+}
+
 inline oor_dev_type_e
 ctrl_dev_mode(oor_ctrl_dev_t *dev)
 {
@@ -46,14 +46,42 @@ typedef struct ctrl_dev_class_t {
             lisp_addr_t *, lisp_addr_t *);
 
     fwd_info_t *(*get_fwd_entry)(oor_ctrl_dev_t *, packet_tuple_t *);
+    /* fwd_info of the returned structure is a list of fwd_entry_t with the
+     * replication list of the (S,G) channel of the tuple */
+    fwd_info_t *(*get_mcast_fwd_entry)(oor_ctrl_dev_t *, packet_tuple_t *);
+
+    /* Reachability learnt by the data plane: state of an RLOC and
+     * Locator-Status-Bits received from an RLOC of an EID. Optional */
+    void (*rloc_reach_update)(oor_ctrl_dev_t *, lisp_addr_t *, uint8_t);
+    void (*lsb_update)(oor_ctrl_dev_t *, lisp_addr_t *, lisp_addr_t *,
+            uint32_t, int);
+
+    /* Source and destination EIDs of a packet received from an RLOC, to
+     * glean the mapping of the source. Optional */
+    void (*glean_mapping)(oor_ctrl_dev_t *, packet_tuple_t *, lisp_addr_t *);
+
+    /* Source and Dest Map-Versions received from an RLOC in a packet with
+     * the EIDs of the tuple. Optional */
+    void (*map_versions_update)(oor_ctrl_dev_t *, packet_tuple_t *,
+            lisp_addr_t *, uint16_t, uint16_t);
+
+    /* Source EID of a packet received from an RLOC, to track the peers
+     * with traffic. Optional */
+    void (*peer_activity)(oor_ctrl_dev_t *, packet_tuple_t *, lisp_addr_t *);
 } ctrl_dev_class_t;
 
 
+/* Initial size of the arena used to process a control message */
+#define CTRL_MSG_ARENA_SIZE 4096
+
 struct oor_ctrl_dev {
     oor_dev_type_e mode;
     const ctrl_dev_class_t *ctrl_class;
     /* pointer to lisp ctrl */
     oor_ctrl_t *ctrl;
+    /* Temporary objects of the message being processed. Released once the
+     * message has been processed */
+    mem_arena_t msg_arena;
 };
 
 extern ctrl_dev_class_t ms_ctrl_class;
@@ -66,6 +94,7 @@ oor_ctrl_t *lisp_ctrl_dev_get_ctrl_t(oor_ctrl_dev_t *dev);
 int ctrl_dev_create(oor_dev_type_e , oor_ctrl_dev_t **);
 void ctrl_dev_destroy(oor_ctrl_dev_t *);
 int ctrl_dev_recv(oor_ctrl_dev_t *, lbuf_t *, uconn_t *);
+mem_arena_t *ctrl_dev_msg_arena(oor_ctrl_dev_t *dev);
 void ctrl_dev_run(oor_ctrl_dev_t *);
 int ctrl_dev_if_link_update(oor_ctrl_dev_t *dev, char *iface_name, uint8_t status);
 int ctrl_dev_if_addr_update(oor_ctrl_dev_t *dev, char *iface_name,
@@ -78,6 +107,17 @@ oor_dev_type_e ctrl_dev_mode(oor_ctrl_dev_t *dev);
 oor_ctrl_t * ctrl_dev_ctrl(oor_ctrl_dev_t *dev);
 int ctrl_dev_set_ctrl(oor_ctrl_dev_t *, oor_ctrl_t *);
 fwd_info_t *ctrl_dev_get_fwd_entry(oor_ctrl_dev_t *, packet_tuple_t *);
+fwd_info_t *ctrl_dev_get_mcast_fwd_entry(oor_ctrl_dev_t *, packet_tuple_t *);
+void ctrl_dev_rloc_reach_update(oor_ctrl_dev_t *, lisp_addr_t *rloc,
+        uint8_t state);
+void ctrl_dev_lsb_update(oor_ctrl_dev_t *, lisp_addr_t *eid, lisp_addr_t *rloc,
+        uint32_t lsb, int lsb_count);
+void ctrl_dev_glean_mapping(oor_ctrl_dev_t *, packet_tuple_t *tuple,
+        lisp_addr_t *rloc);
+void ctrl_dev_map_versions_update(oor_ctrl_dev_t *, packet_tuple_t *tuple,
+        lisp_addr_t *rloc, uint16_t src_ver, uint16_t dst_ver);
+void ctrl_dev_peer_activity(oor_ctrl_dev_t *, packet_tuple_t *tuple,
+        lisp_addr_t *rloc);
 
 
 /* PRIVATE functions, used by xtr and ms */
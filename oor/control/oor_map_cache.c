@@ -18,6 +18,7 @@
  */
 
 #include "oor_map_cache.h"
+#include "../lib/loct_set.h"
 #include "../lib/oor_log.h"
 #include <math.h>
 
@@ -89,12 +90,15 @@ void mcache_dump_db(map_cache_db_t *mcdb, int log_level)
 
     mcache_entry_t *mce;
     void *it;
+    uint32_t nsets, nrefs;
 
     OOR_LOG(log_level,"**************** LISP Mapping Cache ******************\n");
     mdb_foreach_entry(mcdb->db, it) {
         mce = (mcache_entry_t *)it;
         map_cache_entry_dump(mce, log_level);
     } mdb_foreach_entry_end;
+    loct_set_table_stats(&nsets, &nrefs);
+    OOR_LOG(log_level,"Shared locator sets: %u (used by %u entries)\n", nsets, nrefs);
     OOR_LOG(log_level,"*******************************************************\n");
 
 }
@@ -25,6 +25,7 @@
 #include "tun.h"
 #include "tun_input.h"
 #include "tun_output.h"
+#include "tun_offload.h"
 #include "../data-plane.h"
 #include "../../oor_external.h"
 #include "../../lib/oor_log.h"
@@ -58,6 +59,11 @@ void tun_process_rm_gateway(iface_t *iface,lisp_addr_t *gateway);
 
 void tun_set_default_output_ifaces();
 void tun_iface_remove_routing_rules(iface_t *iface);
+static int tun_open_output_socket(int afi);
+static void tun_close_output_socket(int sock);
+
+/* Memory of the packet buffers of the data plane */
+static mem_huge_t tun_buf_mem;
 
 
 data_plane_struct_t dplane_tun = {
@@ -85,13 +91,18 @@ tun_configure_data_plane(oor_dev_type_e dev_type, oor_encap_t encap_type, ...)
     int (*cb_func)(sock_t *) = NULL;
     int ipv4_data_input_fd = -1;
     int ipv6_data_input_fd = -1;
+    int icmp_fd;
     int data_port;
     tun_dplane_data_t *data;
 
+    /* Buffers used by the data plane for every packet */
+    mem_huge_init(&tun_buf_mem, "tun_bufs", TUN_BUF_MEM_SIZE);
+
     /* Configure data plane */
     if (create_tun() <= BAD){
         return (BAD);
     }
+    tun_input_init();
 
     switch (dev_type){
     case MN_MODE:
@@ -136,6 +147,24 @@ tun_configure_data_plane(oor_dev_type_e dev_type, oor_encap_t encap_type, ...)
         sockmstr_register_read_listener(smaster, cb_func, NULL,
                 ipv6_data_input_fd);
     }
+
+    /* Generate sockets to learn the path MTU towards the RLOCs */
+    if (default_rloc_afi != AF_INET6) {
+        icmp_fd = open_icmp_raw_socket(AF_INET);
+        if (icmp_fd != ERR_SOCKET) {
+            sockmstr_register_read_listener(smaster, tun_output_recv_icmp,
+                    NULL, icmp_fd);
+        }
+    }
+
+    if (default_rloc_afi != AF_INET) {
+        icmp_fd = open_icmp_raw_socket(AF_INET6);
+        if (icmp_fd != ERR_SOCKET) {
+            sockmstr_register_read_listener(smaster, tun_output_recv_icmp,
+                    NULL, icmp_fd);
+        }
+    }
+
     data = xmalloc(sizeof(tun_dplane_data_t));
     data->encap_type = encap_type;
     dplane_tun.datap_data = (void *)data;
@@ -164,10 +193,18 @@ tun_uninit_data_plane()
         }
 
         tun_output_uninit();
+        mem_huge_uninit(&tun_buf_mem);
         free(data);
     }
 }
 
+/* Buffer of the data plane that lives until the data plane is released */
+void *
+tun_buf_alloc(size_t size)
+{
+    return (mem_huge_carve(&tun_buf_mem, size));
+}
+
 int
 tun_add_datap_iface_addr(iface_t *iface, int afi)
 {
@@ -180,7 +217,7 @@ tun_add_datap_iface_addr(iface_t *iface, int afi)
     case AF_INET:
         addr = iface_address(iface, AF_INET);
         if (addr  && !lisp_addr_is_no_addr(addr)){
-            sock = open_ip_raw_socket(AF_INET);
+            sock = tun_open_output_socket(AF_INET);
             bind_socket(sock, AF_INET,addr,0);
             add_rule(AF_INET, 0, iface->iface_index, iface->iface_index, RTN_UNICAST,
                     addr, NULL, 0);
@@ -194,7 +231,7 @@ tun_add_datap_iface_addr(iface_t *iface, int afi)
     case AF_INET6:
         addr = iface_address(iface, AF_INET6);
         if (addr  && !lisp_addr_is_no_addr(addr)){
-            sock = open_ip_raw_socket(AF_INET6);
+            sock = tun_open_output_socket(AF_INET6);
             bind_socket(sock, AF_INET6, addr, 0);
             add_rule(AF_INET6, 0, iface->iface_index, iface->iface_index, RTN_UNICAST,
                     addr, NULL, 0);
@@ -210,6 +247,37 @@ tun_add_datap_iface_addr(iface_t *iface, int afi)
     return (GOOD);
 }
 
+/* Raw output socket of an interface. The errors of the packets sent through
+ * it are used to learn the path MTU towards the RLOCs */
+static int
+tun_open_output_socket(int afi)
+{
+    int sock;
+
+    sock = open_ip_raw_socket(afi);
+    if (sock == ERR_SOCKET) {
+        return (ERR_SOCKET);
+    }
+    if (socket_conf_recv_errors(sock, afi) == GOOD) {
+        sockmstr_register_read_listener(smaster, tun_output_recv_err, NULL, sock);
+    }
+    return (sock);
+}
+
+static void
+tun_close_output_socket(int sock)
+{
+    sock_t *sl;
+
+    sl = sockmstr_register_get_by_fd(smaster, sock);
+    if (sl) {
+        /* Also closes the socket */
+        sockmstr_unregister_read_listenedr(smaster, sl);
+    } else {
+        close(sock);
+    }
+}
+
 int
 tun_add_eid_prefix(oor_dev_type_e dev_type, lisp_addr_t *eid_prefix){
 
@@ -291,7 +359,9 @@ create_tun()
     struct ifreq ifr;
     int err = 0;
     int tmpsocket = 0;
-    int flags = IFF_TUN | IFF_NO_PI; // Create a tunnel without persistence
+    /* Create a tunnel without persistence. Packets are preceded by a
+     * virtio_net_hdr in order to support segmentation offloads */
+    int flags = IFF_TUN | IFF_NO_PI | IFF_VNET_HDR;
     char *clonedev = CLONEDEV;
 
 
@@ -314,7 +384,13 @@ create_tun()
     strncpy(ifr.ifr_name, TUN_IFACE_NAME, IFNAMSIZ - 1);
 
     // try to create the device
-    if ((err = ioctl(tun_receive_fd, TUNSETIFF, (void *) &ifr)) < 0) {
+    err = ioctl(tun_receive_fd, TUNSETIFF, (void *) &ifr);
+    if (err < 0 && errno == EINVAL) {
+        OOR_LOG(LDBG_1, "TUN/TAP: virtio_net_hdr not supported. Offloads disabled");
+        ifr.ifr_flags = flags & ~IFF_VNET_HDR;
+        err = ioctl(tun_receive_fd, TUNSETIFF, (void *) &ifr);
+    }
+    if (err < 0) {
         close(tun_receive_fd);
         OOR_LOG(LCRIT, "TUN/TAP: Failed to create tunnel interface, errno: %d.", errno);
         if (errno == 16){
@@ -323,6 +399,11 @@ create_tun()
         return(BAD);
     }
 
+    if (ifr.ifr_flags & IFF_VNET_HDR) {
+        tun_vnet_hdr = TRUE;
+        tun_offload_init(tun_receive_fd);
+    }
+
     // get the ifindex for the tun/tap
     tmpsocket = socket(AF_INET, SOCK_DGRAM, 0); // Dummy socket for the ioctl, type/details unimportant
     if ((err = ioctl(tmpsocket, SIOCGIFINDEX, (void *)&ifr)) < 0) {
@@ -348,12 +429,7 @@ create_tun()
 
     close(tmpsocket);
 
-    tun_receive_buf = (uint8_t *)malloc(TUN_RECEIVE_SIZE);
-
-    if (tun_receive_buf == NULL){
-        OOR_LOG(LWRN, "create_tun: Unable to allocate memory for tun_receive_buf: %s", strerror(errno));
-        return(BAD);
-    }
+    tun_receive_buf = tun_buf_alloc(TUN_RECEIVE_SIZE);
 
     /* this is the special file descriptor that the caller will use to talk
      * with the virtual interface */
@@ -903,12 +979,12 @@ tun_updated_addr(iface_t *iface, lisp_addr_t *old_addr, lisp_addr_t *new_addr)
 
         switch(new_addr_ip_afi){
         case AF_INET:
-            iface->out_socket_v4 = open_ip_raw_socket(AF_INET);
+            iface->out_socket_v4 = tun_open_output_socket(AF_INET);
             sckt = iface->out_socket_v4;
             iface_addr = iface->ipv4_address;
             break;
         case AF_INET6:
-            iface->out_socket_v6 = open_ip_raw_socket(AF_INET6);
+            iface->out_socket_v6 = tun_open_output_socket(AF_INET6);
             sckt = iface->out_socket_v6;
             iface_addr = iface->ipv6_address;
             break;
@@ -982,8 +1058,8 @@ tun_updated_link(iface_t *iface, int old_iface_index, int new_iface_index,
                     RTN_UNICAST, iface->ipv4_address, NULL, 0);
             add_rule(AF_INET, 0, new_iface_index, new_iface_index, RTN_UNICAST,
                     iface->ipv4_address, NULL, 0);
-            close(iface->out_socket_v4);
-            iface->out_socket_v4 = open_ip_raw_socket( AF_INET);
+            tun_close_output_socket(iface->out_socket_v4);
+            iface->out_socket_v4 = tun_open_output_socket(AF_INET);
             bind_socket(iface->out_socket_v4, AF_INET, iface->ipv4_address, 0);
         }
         if (iface->ipv6_address && !lisp_addr_is_no_addr(iface->ipv6_address)) {
@@ -991,8 +1067,8 @@ tun_updated_link(iface_t *iface, int old_iface_index, int new_iface_index,
                     RTN_UNICAST, iface->ipv6_address, NULL, 0);
             add_rule(AF_INET6, 0, new_iface_index, new_iface_index, RTN_UNICAST,
                     iface->ipv6_address, NULL, 0);
-            close(iface->out_socket_v6);
-            iface->out_socket_v6 = open_ip_raw_socket(AF_INET6);
+            tun_close_output_socket(iface->out_socket_v6);
+            iface->out_socket_v6 = tun_open_output_socket(AF_INET6);
             bind_socket(iface->out_socket_v6,AF_INET6, iface->ipv6_address, 0);
         }
     }
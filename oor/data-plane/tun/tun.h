@@ -74,6 +74,12 @@ int tun_receive_fd;
 int tun_ifindex;
 uint8_t *tun_receive_buf;
 
+/* Size of the region of the packet buffers. The buffers of all the modules
+ * of the data plane fit in one huge page */
+#define TUN_BUF_MEM_SIZE        MEM_HUGE_PAGE_SIZE
+
+void *tun_buf_alloc(size_t size);
+
 lisp_addr_t * tun_get_default_output_address(int afi);
 int tun_get_default_output_socket(int);
 
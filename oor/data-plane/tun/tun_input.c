@@ -23,28 +23,44 @@
 #include "tun.h"
 #include "tun_input.h"
 #include "tun_output.h"
+#include "tun_offload.h"
 #include "../../lib/packets.h"
 #include "../../lib/mem_util.h"
+#include "../../control/oor_control.h"
 #include "../../liblisp/liblisp.h"
 #include "../../lib/oor_log.h"
 
-/* static buffer to receive packets */
-static uint8_t pkt_recv_buf[MAX_IP_PKT_LEN+1];
+/* buffer to receive packets */
+static uint8_t *pkt_recv_buf;
 static lbuf_t pkt_buf;
 
-int
-tun_read_and_decap_pkt(int sock, lbuf_t *b, uint32_t *iid)
+void
+tun_input_init()
+{
+    pkt_recv_buf = tun_buf_alloc(MAX_IP_PKT_LEN + 1);
+}
+
+/* Receive a data packet and pull its outer headers. On return, 'b' points
+ * to the inner IP packet, which is left untouched. If not NULL, 'srloc' and
+ * 'drloc' are set to the source and local RLOCs and 'lhdr' to the LISP
+ * header (NULL with VXLAN). 'drloc' is left untouched if the local RLOC
+ * is unknown */
+static int
+tun_read_and_pull_hdrs(int sock, lbuf_t *b, uint32_t *iid, uint8_t *ttl,
+        uint8_t *tos, int *port, ip_addr_t *srloc, ip_addr_t *drloc,
+        lisp_data_hdr_t **lhdr)
 {
-    uint8_t ttl = 0, tos = 0;
     int afi;
     struct udphdr *udph;
     lisp_data_hdr_t *lisph;
     vxlan_gpe_hdr_t *vxlanh;
-    int port;
 
-    if (sock_data_recv(sock, b, &afi, &ttl, &tos) != GOOD) {
+    if (sock_data_recv(sock, b, &afi, ttl, tos, srloc, drloc) != GOOD) {
         return(BAD);
     }
+    if (lhdr) {
+        *lhdr = NULL;
+    }
 
     if (afi == AF_INET){
         /* With input RAW UDP sockets in IPv4, we get the whole external
@@ -73,8 +89,11 @@ tun_read_and_decap_pkt(int sock, lbuf_t *b, uint32_t *iid)
         }else{
             *iid = 0;
         }
+        if (lhdr) {
+            *lhdr = lisph;
+        }
 
-        port = LISP_DATA_PORT;
+        *port = LISP_DATA_PORT;
         break;
     case VXLAN_GPE_DATA_PORT:
 
@@ -82,7 +101,7 @@ tun_read_and_decap_pkt(int sock, lbuf_t *b, uint32_t *iid)
         if (VXLAN_HDR_VNI_BIT(vxlanh)){
             *iid = vxlan_gpe_hdr_get_vni(vxlanh);
         }
-        port = VXLAN_GPE_DATA_PORT;
+        *port = VXLAN_GPE_DATA_PORT;
         break;
     default:
         return (ERR_NOT_ENCAP);
@@ -91,6 +110,146 @@ tun_read_and_decap_pkt(int sock, lbuf_t *b, uint32_t *iid)
     /* RESET L3: prepare for output */
     lbuf_reset_l3(b);
 
+    return(GOOD);
+}
+
+/* Learn the reachability of the source RLOC and of the other locators of
+ * the source EID from the nonce and the Locator-Status-Bits of the packet.
+ * 'b' points to the inner packet */
+static void
+tun_input_rloc_status(lbuf_t *b, ip_addr_t *srloc, ip_addr_t *drloc,
+        lisp_data_hdr_t *lhdr, uint32_t iid)
+{
+    rloc_reach_entry_t *entry;
+    lisp_addr_t rloc, ip;
+    lisp_addr_t *eid;
+    struct ip *iph;
+    uint32_t lsb;
+    int mlen;
+
+    if (!lhdr->nonce_present && !lhdr->lsb) {
+        return;
+    }
+    /* Only the LSB and the requests to echo a nonce create the state of an
+     * RLOC. Echoes are only useful for an RLOC already tracked */
+    if (lhdr->lsb || lhdr->echo_nonce) {
+        entry = rloc_reach_table_get(&reach_table, srloc);
+    } else {
+        entry = rloc_reach_table_lookup(&reach_table, srloc);
+    }
+    if (!entry) {
+        return;
+    }
+    lisp_addr_init_from_ip(&rloc, srloc);
+
+    if (rloc_reach_input(entry, lhdr, drloc) == RLOC_REACH_UP) {
+        ctrl_rloc_reach_update(&rloc, UP);
+    }
+
+    if (!lhdr->lsb) {
+        return;
+    }
+    lsb = lisp_data_hdr_get_lsb(lhdr);
+    if (!rloc_reach_lsb_changed(entry, lsb)) {
+        return;
+    }
+    iph = lbuf_data(b);
+    if (iph->ip_v == IPVERSION) {
+        lisp_addr_ip_init(&ip, &iph->ip_src, AF_INET);
+        mlen = 32;
+    } else {
+        lisp_addr_ip_init(&ip, &((struct ip6_hdr *)iph)->ip6_src, AF_INET6);
+        mlen = 128;
+    }
+    eid = (iid > 0) ? lisp_addr_new_init_iid(iid, &ip, mlen) : lisp_addr_clone(&ip);
+    OOR_LOG(LDBG_2, "Locator-Status-Bits of EID %s from RLOC %s changed to %#x",
+            lisp_addr_to_char(eid), lisp_addr_to_char(&rloc), lsb);
+    ctrl_lsb_update(eid, &rloc, lsb, LDHDR_LSB_COUNT(lhdr));
+    lisp_addr_del(eid);
+}
+
+/* Fill the source and destination EIDs of 'tpl' with the addresses of the
+ * inner packet pointed by 'b' */
+static void
+tun_input_eids(lbuf_t *b, uint32_t iid, packet_tuple_t *tpl)
+{
+    struct ip *iph;
+
+    iph = lbuf_data(b);
+    if (iph->ip_v == IPVERSION) {
+        lisp_addr_ip_init(&tpl->src_addr, &iph->ip_src, AF_INET);
+        lisp_addr_ip_init(&tpl->dst_addr, &iph->ip_dst, AF_INET);
+    } else {
+        lisp_addr_ip_init(&tpl->src_addr, &((struct ip6_hdr *)iph)->ip6_src,
+                AF_INET6);
+        lisp_addr_ip_init(&tpl->dst_addr, &((struct ip6_hdr *)iph)->ip6_dst,
+                AF_INET6);
+    }
+    tpl->iid = iid;
+}
+
+/* Let the control glean the mapping of the source EID of the packet from the
+ * RLOC it was received from and record the peer as active. 'b' points to
+ * the inner packet */
+static void
+tun_input_glean(lbuf_t *b, ip_addr_t *srloc, uint32_t iid)
+{
+    packet_tuple_t tpl;
+    lisp_addr_t rloc;
+
+    tun_input_eids(b, iid, &tpl);
+    lisp_addr_init_from_ip(&rloc, srloc);
+
+    ctrl_peer_activity(&tpl, &rloc);
+    ctrl_glean_mapping(&tpl, &rloc);
+}
+
+/* Let the control compare the Map-Versions of the packet with the ones of
+ * the mappings of its EIDs. The same versions from an RLOC are only checked
+ * once per RLOC_REACH_MVER_INTERVAL */
+static void
+tun_input_map_versions(lbuf_t *b, ip_addr_t *srloc, lisp_data_hdr_t *lhdr,
+        uint32_t iid)
+{
+    rloc_reach_entry_t *entry;
+    packet_tuple_t tpl;
+    lisp_addr_t rloc;
+    uint16_t src_ver, dst_ver;
+
+    lisp_data_hdr_get_map_versions(lhdr, &src_ver, &dst_ver);
+    entry = rloc_reach_table_get(&reach_table, srloc);
+    if (!entry || !rloc_reach_map_versions_check(entry, src_ver, dst_ver)) {
+        return;
+    }
+    tun_input_eids(b, iid, &tpl);
+    lisp_addr_init_from_ip(&rloc, srloc);
+
+    ctrl_map_versions_update(&tpl, &rloc, src_ver, dst_ver);
+}
+
+int
+tun_read_and_decap_pkt(int sock, lbuf_t *b, uint32_t *iid)
+{
+    lisp_data_hdr_t *lhdr;
+    ip_addr_t srloc, drloc;
+    uint8_t ttl = 0, tos = 0;
+    int port, ret;
+
+    memset(&drloc, 0, sizeof(ip_addr_t));
+    ret = tun_read_and_pull_hdrs(sock, b, iid, &ttl, &tos, &port, &srloc,
+            &drloc, &lhdr);
+    if (ret != GOOD) {
+        return(ret);
+    }
+    if (lhdr) {
+        tun_input_rloc_status(b, &srloc,
+                ip_addr_afi(&drloc) != 0 ? &drloc : NULL, lhdr, *iid);
+        if (lhdr->map_version) {
+            tun_input_map_versions(b, &srloc, lhdr, *iid);
+        }
+    }
+    tun_input_glean(b, &srloc, *iid);
+
     /* UPDATE IP TOS and TTL. Checksum is also updated for IPv4
      * NOTE: we always assume an IP payload*/
     ip_hdr_set_ttl_and_tos(lbuf_data(b), ttl, tos);
@@ -101,37 +260,63 @@ tun_read_and_decap_pkt(int sock, lbuf_t *b, uint32_t *iid)
     return(GOOD);
 }
 
+/* Decapsulate the packets pending in the socket, up to TUN_GRO_BURST, so
+ * that consecutive segments of a flow are written to the TUN at once.
+ * Without offloads there is nothing to coalesce and only one packet is
+ * read, saving the check of the pending bytes */
 int
 tun_process_input_packet(sock_t *sl)
 {
     uint32_t iid;
-    lbuf_use_stack(&pkt_buf, &pkt_recv_buf, MAX_IP_PKT_LEN);
+    int n = 0, pending = 0, ret = BAD;
 
-    if (tun_read_and_decap_pkt(sl->fd, &pkt_buf, &iid) != GOOD) {
-        return (BAD);
-    }
+    do {
+        lbuf_use_stack(&pkt_buf, pkt_recv_buf, MAX_IP_PKT_LEN);
 
-    /* XXX Destination packet should be checked it belongs to this xTR */
-    if ((write(tun_receive_fd, lbuf_l3(&pkt_buf), lbuf_size(&pkt_buf))) < 0) {
-        OOR_LOG(LDBG_2, "lisp_input: write error: %s\n ", strerror(errno));
-    }
+        if (tun_read_and_decap_pkt(sl->fd, &pkt_buf, &iid) == GOOD) {
+            /* XXX Destination packet should be checked it belongs to this xTR */
+            tun_gro_receive(lbuf_l3(&pkt_buf), lbuf_size(&pkt_buf));
+            ret = GOOD;
+        }
+        n++;
+    } while (tun_gro_enabled() && n < TUN_GRO_BURST
+            && ioctl(sl->fd, FIONREAD, &pending) == 0 && pending > 0);
+
+    tun_gro_flush();
 
-    return (GOOD);
+    return (ret);
 }
 
 int
 tun_rtr_process_input_packet(struct sock *sl)
 {
     packet_tuple_t tpl;
-    lbuf_use_stack(&pkt_buf, &pkt_recv_buf, MAX_IP_PKT_LEN);
+    reencap_key_t key;
+    uint8_t ttl = 0, tos = 0;
+    int port, learn;
+
+    lbuf_use_stack(&pkt_buf, pkt_recv_buf, MAX_IP_PKT_LEN);
     /* Reserve space in case the received packet was IPv6. In this case the IPv6 header is
      * not provided */
     lbuf_reserve(&pkt_buf,LBUF_STACK_OFFSET);
 
-    if (tun_read_and_decap_pkt(sl->fd, &pkt_buf, &(tpl.iid)) != GOOD) {
+    if (tun_read_and_pull_hdrs(sl->fd, &pkt_buf, &(tpl.iid), &ttl, &tos,
+            &port, NULL, NULL, NULL) != GOOD) {
         return (BAD);
     }
 
+    /* Fast path: the outer headers are rewritten in place using the decision
+     * cached for (outer src RLOC, inner dst EID, IID) */
+    learn = (port == LISP_DATA_PORT
+            && tun_rtr_reencap_key(&pkt_buf, tpl.iid, &key) == GOOD);
+    if (learn && tun_rtr_reencap_output(&pkt_buf, &key) == GOOD) {
+        return (GOOD);
+    }
+
+    /* UPDATE IP TOS and TTL. Checksum is also updated for IPv4
+     * NOTE: we always assume an IP payload*/
+    ip_hdr_set_ttl_and_tos(lbuf_data(&pkt_buf), ttl, tos);
+
     OOR_LOG(LDBG_3, "Forwarding packet to OUPUT for re-encapsulation");
 
     lbuf_point_to_l3(&pkt_buf);
@@ -142,6 +327,9 @@ tun_rtr_process_input_packet(struct sock *sl)
     }
     tun_output(&pkt_buf, &tpl);
 
+    if (learn) {
+        tun_rtr_reencap_learn(&key, &tpl);
+    }
+
     return(GOOD);
 }
-
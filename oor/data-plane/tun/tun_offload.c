@@ -0,0 +1,469 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <netinet/ip.h>
+#include <netinet/ip6.h>
+#include <netinet/tcp.h>
+
+#include "tun.h"
+#include "tun_offload.h"
+#include "tun_output.h"
+#include "../../lib/cksum.h"
+#include "../../lib/oor_log.h"
+
+#define TCP_FLAG_FIN    0x01
+#define TCP_FLAG_SYN    0x02
+#define TCP_FLAG_RST    0x04
+#define TCP_FLAG_PSH    0x08
+#define TCP_FLAG_ACK    0x10
+#define TCP_FLAG_CWR    0x80
+/* Offset of the checksum inside the TCP header */
+#define TCP_CSUM_OFFSET 16
+
+/* Coalesced TCP packet pending to be written to the TUN */
+typedef struct tun_gro_ {
+    uint8_t *buf;
+    int len;
+    int afi;
+    int l3_len;         /* IP header length */
+    int hdr_len;        /* IP and TCP headers length */
+    int gso_size;       /* payload length of each coalesced segment */
+    int segs;
+    uint32_t next_seq;
+} tun_gro_t;
+
+int tun_vnet_hdr = FALSE;
+/* TRUE when the TUN accepts and generates TCP super-packets */
+static int tun_offload = FALSE;
+
+/* buffer to build the segments of a super-packet */
+static uint8_t *seg_buf;
+static tun_gro_t gro;
+
+int
+tun_offload_init(int tun_fd)
+{
+    unsigned long offloads = TUN_F_CSUM | TUN_F_TSO4 | TUN_F_TSO6;
+
+    seg_buf = tun_buf_alloc(TUN_RECEIVE_SIZE);
+    gro.buf = tun_buf_alloc(TUN_GSO_MAX_SIZE);
+
+    if (ioctl(tun_fd, TUNSETOFFLOAD, offloads) < 0) {
+        OOR_LOG(LDBG_1, "TUN/TAP: Segmentation offloads not supported: %s",
+                strerror(errno));
+        tun_offload = FALSE;
+        return (BAD);
+    }
+    tun_offload = TRUE;
+    OOR_LOG(LDBG_1, "TUN/TAP: TCP segmentation offloads enabled");
+
+    return (GOOD);
+}
+
+/* Obtain the length of the IP header and of the IP and TCP headers of a
+ * TCP packet. IPv6 extension headers are not supported */
+static int
+tcp_pkt_hdrs_len(uint8_t *pkt, int len, int *afi, int *l3_len, int *hdr_len)
+{
+    struct ip *iph = (struct ip *)pkt;
+    struct ip6_hdr *ip6h;
+    struct tcphdr *th;
+
+    if (len < sizeof(struct ip)) {
+        return (BAD);
+    }
+
+    switch (iph->ip_v) {
+    case IPVERSION:
+        if (iph->ip_p != IPPROTO_TCP) {
+            return (BAD);
+        }
+        *afi = AF_INET;
+        *l3_len = iph->ip_hl * 4;
+        break;
+    case 6:
+        ip6h = (struct ip6_hdr *)pkt;
+        if (len < sizeof(struct ip6_hdr) || ip6h->ip6_nxt != IPPROTO_TCP) {
+            return (BAD);
+        }
+        *afi = AF_INET6;
+        *l3_len = sizeof(struct ip6_hdr);
+        break;
+    default:
+        return (BAD);
+    }
+
+    if (len < *l3_len + sizeof(struct tcphdr)) {
+        return (BAD);
+    }
+    th = (struct tcphdr *)CO(pkt, *l3_len);
+    *hdr_len = *l3_len + tcpoff(th) * 4;
+    if (*hdr_len > len) {
+        return (BAD);
+    }
+
+    return (GOOD);
+}
+
+/* Set the length of the IP header. For IPv4 the checksum is also updated */
+static void
+ip_pkt_set_len(uint8_t *pkt, int afi, int l3_len, int len)
+{
+    struct ip *iph;
+    struct ip6_hdr *ip6h;
+
+    if (afi == AF_INET) {
+        iph = (struct ip *)pkt;
+        iph->ip_len = htons(len);
+        iph->ip_sum = 0;
+        iph->ip_sum = ip_checksum((uint16_t *)iph, l3_len);
+    } else {
+        ip6h = (struct ip6_hdr *)pkt;
+        ip6h->ip6_plen = htons(len - l3_len);
+    }
+}
+
+static uint32_t
+tcp_pkt_sum(uint8_t *pkt, int afi, int l3_len, int len)
+{
+    uint32_t sum;
+
+    sum = cksum_pseudo_hdr(pkt, afi, IPPROTO_TCP, len - l3_len);
+    return (cksum_add(sum, CO(pkt, l3_len), len - l3_len));
+}
+
+/*
+ * Split a TCP super-packet in segments of 'mss' bytes of payload and send
+ * each of them to the encapsulation path
+ */
+static int
+tun_gso_segment(lbuf_t *b, int mss, packet_tuple_t *tpl)
+{
+    uint8_t *pkt = lbuf_data(b);
+    uint8_t *seg;
+    int len = lbuf_size(b);
+    int afi, l3_len, hdr_len, off, seg_len;
+    struct tcphdr *th;
+    uint32_t seq;
+    uint16_t id = 0;
+    uint8_t flags;
+    lbuf_t sb;
+
+    if (tcp_pkt_hdrs_len(pkt, len, &afi, &l3_len, &hdr_len) != GOOD) {
+        OOR_LOG(LDBG_2, "tun_gso_segment: Not a TCP super-packet. Discarding");
+        return (BAD);
+    }
+    if (mss <= 0 || hdr_len + mss > TUN_RECEIVE_SIZE - LBUF_STACK_OFFSET) {
+        OOR_LOG(LDBG_2, "tun_gso_segment: Wrong segment size %d. Discarding", mss);
+        return (BAD);
+    }
+
+    th = (struct tcphdr *)CO(pkt, l3_len);
+    seq = ntohl(tcpseq(th));
+    flags = tcpflags(th);
+    if (afi == AF_INET) {
+        id = ntohs(((struct ip *)pkt)->ip_id);
+    }
+
+    for (off = hdr_len; off < len; off += seg_len) {
+        seg_len = (len - off < mss) ? len - off : mss;
+
+        lbuf_use_stack(&sb, seg_buf, TUN_RECEIVE_SIZE);
+        lbuf_reserve(&sb, LBUF_STACK_OFFSET);
+        seg = lbuf_put_uninit(&sb, hdr_len + seg_len);
+        memcpy(seg, pkt, hdr_len);
+        memcpy(CO(seg, hdr_len), CO(pkt, off), seg_len);
+
+        if (afi == AF_INET) {
+            ((struct ip *)seg)->ip_id = htons(id++);
+        }
+        ip_pkt_set_len(seg, afi, l3_len, hdr_len + seg_len);
+
+        /* CWR only in the first segment, FIN and PSH only in the last one */
+        th = (struct tcphdr *)CO(seg, l3_len);
+        tcpseq(th) = htonl(seq + (off - hdr_len));
+        tcpflags(th) = flags;
+        if (off != hdr_len) {
+            tcpflags(th) &= ~TCP_FLAG_CWR;
+        }
+        if (off + seg_len < len) {
+            tcpflags(th) &= ~(TCP_FLAG_FIN | TCP_FLAG_PSH);
+        }
+        tcpsum(th) = 0;
+        tcpsum(th) = ~cksum_fold(tcp_pkt_sum(seg, afi, l3_len, hdr_len + seg_len));
+
+        lbuf_reset_ip(&sb);
+        tun_output(&sb, tpl);
+    }
+
+    return (GOOD);
+}
+
+/*
+ * Process a packet read from the TUN together with its virtio_net_hdr.
+ * Partial checksums are completed and super-packets are segmented before
+ * being encapsulated
+ */
+int
+tun_gso_output(lbuf_t *b, struct virtio_net_hdr *vh, packet_tuple_t *tpl)
+{
+    uint8_t *pkt = lbuf_data(b);
+    int len = lbuf_size(b);
+    uint16_t *csum;
+
+    switch (vh->gso_type & ~VIRTIO_NET_HDR_GSO_ECN) {
+    case VIRTIO_NET_HDR_GSO_NONE:
+        if (vh->flags & VIRTIO_NET_HDR_F_NEEDS_CSUM) {
+            if (vh->csum_start + vh->csum_offset + sizeof(uint16_t) > len) {
+                return (BAD);
+            }
+            csum = (uint16_t *)CO(pkt, vh->csum_start + vh->csum_offset);
+            *csum = ~cksum_fold(cksum_add(0, CO(pkt, vh->csum_start),
+                    len - vh->csum_start));
+            if (*csum == 0) {
+                *csum = 0xffff;
+            }
+        }
+        return (tun_output(b, tpl));
+    case VIRTIO_NET_HDR_GSO_TCPV4:
+    case VIRTIO_NET_HDR_GSO_TCPV6:
+        return (tun_gso_segment(b, vh->gso_size, tpl));
+    default:
+        OOR_LOG(LDBG_2, "tun_gso_output: GSO type %d not supported. Discarding",
+                vh->gso_type);
+        return (BAD);
+    }
+}
+
+static int
+tun_write(void *pkt, int len, struct virtio_net_hdr *vh)
+{
+    struct virtio_net_hdr no_vh;
+    struct iovec iov[2];
+    int ret;
+
+    if (!tun_vnet_hdr) {
+        ret = write(tun_receive_fd, pkt, len);
+    } else {
+        if (!vh) {
+            memset(&no_vh, 0, sizeof(no_vh));
+            vh = &no_vh;
+        }
+        iov[0].iov_base = vh;
+        iov[0].iov_len = TUN_VNET_HDR_LEN;
+        iov[1].iov_base = pkt;
+        iov[1].iov_len = len;
+        ret = writev(tun_receive_fd, iov, 2);
+    }
+
+    if (ret < 0) {
+        OOR_LOG(LDBG_2, "tun_write: write error: %s\n ", strerror(errno));
+        return (BAD);
+    }
+    return (GOOD);
+}
+
+/* Write a packet to the TUN without coalescing it */
+int
+tun_write_pkt(void *pkt, int len)
+{
+    tun_gro_flush();
+    return (tun_write(pkt, len, NULL));
+}
+
+/* Only TCP segments with payload, no IPv4 options or fragments, a valid
+ * checksum and no flags other than ACK and PSH are coalesced */
+static int
+tun_gro_mergeable(uint8_t *pkt, int len, int *afi, int *l3_len, int *hdr_len)
+{
+    struct ip *iph;
+    struct tcphdr *th;
+
+    if (tcp_pkt_hdrs_len(pkt, len, afi, l3_len, hdr_len) != GOOD
+            || *hdr_len == len) {
+        return (FALSE);
+    }
+
+    if (*afi == AF_INET) {
+        iph = (struct ip *)pkt;
+        if (iph->ip_hl != 5 || ntohs(iph->ip_len) != len
+                || (ntohs(iph->ip_off) & (IP_MF | IP_OFFMASK)) != 0) {
+            return (FALSE);
+        }
+    } else if (ntohs(((struct ip6_hdr *)pkt)->ip6_plen) + *l3_len != len) {
+        return (FALSE);
+    }
+
+    th = (struct tcphdr *)CO(pkt, *l3_len);
+    if ((tcpflags(th) & ~(TCP_FLAG_ACK | TCP_FLAG_PSH)) != 0
+            || !(tcpflags(th) & TCP_FLAG_ACK)) {
+        return (FALSE);
+    }
+
+    /* The kernel will not verify the checksum of the coalesced packet */
+    if (cksum_fold(tcp_pkt_sum(pkt, *afi, *l3_len, len)) != 0xffff) {
+        return (FALSE);
+    }
+
+    return (TRUE);
+}
+
+/* Check if 'pkt' is the next segment of the coalesced packet */
+static int
+tun_gro_can_merge(uint8_t *pkt, int afi, int l3_len, int hdr_len, int payload)
+{
+    struct ip *iph, *giph;
+    struct ip6_hdr *ip6h, *gip6h;
+    struct tcphdr *th, *gth;
+
+    if (gro.len == 0 || afi != gro.afi || hdr_len != gro.hdr_len
+            || payload > gro.gso_size
+            || gro.len + payload > TUN_GSO_MAX_SIZE) {
+        return (FALSE);
+    }
+
+    if (afi == AF_INET) {
+        iph = (struct ip *)pkt;
+        giph = (struct ip *)gro.buf;
+        if (iph->ip_src.s_addr != giph->ip_src.s_addr
+                || iph->ip_dst.s_addr != giph->ip_dst.s_addr
+                || iph->ip_tos != giph->ip_tos || iph->ip_ttl != giph->ip_ttl
+                || iph->ip_off != giph->ip_off) {
+            return (FALSE);
+        }
+    } else {
+        ip6h = (struct ip6_hdr *)pkt;
+        gip6h = (struct ip6_hdr *)gro.buf;
+        if (memcmp(&ip6h->ip6_src, &gip6h->ip6_src, 2 * sizeof(struct in6_addr)) != 0
+                || ip6h->ip6_flow != gip6h->ip6_flow
+                || ip6h->ip6_hlim != gip6h->ip6_hlim) {
+            return (FALSE);
+        }
+    }
+
+    th = (struct tcphdr *)CO(pkt, l3_len);
+    gth = (struct tcphdr *)CO(gro.buf, gro.l3_len);
+    if (tcpsport(th) != tcpsport(gth) || tcpdport(th) != tcpdport(gth)
+            || tcpack(th) != tcpack(gth) || tcpwin(th) != tcpwin(gth)
+            || ntohl(tcpseq(th)) != gro.next_seq) {
+        return (FALSE);
+    }
+
+    /* TCP options, such as timestamps, should be the same */
+    if (memcmp(CO(th, sizeof(struct tcphdr)), CO(gth, sizeof(struct tcphdr)),
+            hdr_len - l3_len - sizeof(struct tcphdr)) != 0) {
+        return (FALSE);
+    }
+
+    return (TRUE);
+}
+
+int
+tun_gro_enabled()
+{
+    return (tun_offload);
+}
+
+/*
+ * Write a decapsulated packet to the TUN. Consecutive TCP segments of the
+ * same flow are coalesced into a single super-packet, which is written when
+ * the flow is interrupted or on tun_gro_flush
+ */
+void
+tun_gro_receive(void *pkt, int len)
+{
+    struct tcphdr *th;
+    int afi, l3_len, hdr_len, payload;
+
+    if (!tun_offload || !tun_gro_mergeable(pkt, len, &afi, &l3_len, &hdr_len)) {
+        tun_write_pkt(pkt, len);
+        return;
+    }
+
+    th = (struct tcphdr *)CO(pkt, l3_len);
+    payload = len - hdr_len;
+
+    if (tun_gro_can_merge(pkt, afi, l3_len, hdr_len, payload)) {
+        memcpy(CO(gro.buf, gro.len), CO(pkt, hdr_len), payload);
+        gro.len += payload;
+        gro.segs++;
+        gro.next_seq += payload;
+        tcpflags((struct tcphdr *)CO(gro.buf, gro.l3_len)) |= tcpflags(th);
+        /* A shorter or pushed segment ends the super-packet */
+        if (payload < gro.gso_size || (tcpflags(th) & TCP_FLAG_PSH)) {
+            tun_gro_flush();
+        }
+        return;
+    }
+
+    tun_gro_flush();
+    memcpy(gro.buf, pkt, len);
+    gro.len = len;
+    gro.afi = afi;
+    gro.l3_len = l3_len;
+    gro.hdr_len = hdr_len;
+    gro.gso_size = payload;
+    gro.segs = 1;
+    gro.next_seq = ntohl(tcpseq(th)) + payload;
+    if (tcpflags(th) & TCP_FLAG_PSH) {
+        tun_gro_flush();
+    }
+}
+
+/* Write to the TUN the coalesced packet, if any */
+void
+tun_gro_flush()
+{
+    struct virtio_net_hdr vh;
+    struct tcphdr *th;
+
+    if (gro.len == 0) {
+        return;
+    }
+
+    if (gro.segs == 1) {
+        tun_write(gro.buf, gro.len, NULL);
+        gro.len = 0;
+        return;
+    }
+
+    ip_pkt_set_len(gro.buf, gro.afi, gro.l3_len, gro.len);
+    /* The kernel completes the checksum from the pseudo header sum */
+    th = (struct tcphdr *)CO(gro.buf, gro.l3_len);
+    tcpsum(th) = cksum_fold(cksum_pseudo_hdr(gro.buf, gro.afi, IPPROTO_TCP,
+            gro.len - gro.l3_len));
+
+    memset(&vh, 0, sizeof(vh));
+    vh.flags = VIRTIO_NET_HDR_F_NEEDS_CSUM;
+    vh.gso_type = (gro.afi == AF_INET) ? VIRTIO_NET_HDR_GSO_TCPV4
+            : VIRTIO_NET_HDR_GSO_TCPV6;
+    vh.gso_size = gro.gso_size;
+    vh.hdr_len = gro.hdr_len;
+    vh.csum_start = gro.l3_len;
+    vh.csum_offset = TCP_CSUM_OFFSET;
+
+    OOR_LOG(LDBG_3, "tun_gro_flush: Writing %d coalesced segments (%d bytes)",
+            gro.segs, gro.len);
+
+    tun_write(gro.buf, gro.len, &vh);
+    gro.len = 0;
+}
@@ -0,0 +1,56 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef TUN_OFFLOAD_H_
+#define TUN_OFFLOAD_H_
+
+#include <linux/virtio_net.h>
+#include "../../lib/lbuf.h"
+#include "../../lib/packets.h"
+
+/*
+ * Segmentation and receive offloads of the TUN device. When the kernel
+ * supports it, the TUN is created with IFF_VNET_HDR and TCP segmentation
+ * offload, so that the local stack hands us TCP super-packets of up to
+ * 64KB. They are segmented just before encapsulation. In the other direction,
+ * consecutive decapsulated TCP segments of the same flow are coalesced and
+ * written to the TUN as a single super-packet.
+ */
+
+#define TUN_VNET_HDR_LEN        sizeof(struct virtio_net_hdr)
+/* Largest packet exchanged with the TUN when offloads are enabled */
+#define TUN_GSO_MAX_SIZE        65535
+#define TUN_GSO_RECEIVE_SIZE    (TUN_GSO_MAX_SIZE + TUN_VNET_HDR_LEN + LBUF_STACK_OFFSET)
+/* Maximum number of packets read from an input socket before flushing the
+ * coalesced packets to the TUN */
+#define TUN_GRO_BURST           64
+
+/* TRUE when every packet exchanged with the TUN is preceded by a
+ * virtio_net_hdr */
+extern int tun_vnet_hdr;
+
+int tun_offload_init(int tun_fd);
+int tun_gso_output(lbuf_t *b, struct virtio_net_hdr *vh, packet_tuple_t *tpl);
+int tun_write_pkt(void *pkt, int len);
+/* TRUE when decapsulated TCP segments are coalesced before writing them */
+int tun_gro_enabled();
+void tun_gro_receive(void *pkt, int len);
+void tun_gro_flush();
+
+#endif /* TUN_OFFLOAD_H_ */
@@ -19,9 +19,12 @@
 
 
 #include <errno.h>
+#include <netinet/icmp6.h>
+#include <netinet/ip_icmp.h>
 
 #include "tun_output.h"
 #include "tun.h"
+#include "tun_offload.h"
 #include "../encapsulations/vxlan-gpe.h"
 #include "../../fwd_policies/fwd_policy.h"
 #include "../../liblisp/liblisp.h"
@@ -34,9 +37,25 @@
 
 
 /* static buffer to receive packets */
-static uint8_t pkt_recv_buf[TUN_RECEIVE_SIZE];
+static uint8_t *pkt_recv_buf;
 static lbuf_t pkt_buf;
 ttable_t ttable;
+/* RTR re-encapsulation decisions */
+static reencap_table_t rtr_rtable;
+/* Multicast replication lists */
+static mcast_table_t mtable;
+/* Path MTU towards the RLOCs */
+static pmtu_table_t pmtu_table;
+rloc_reach_table_t reach_table;
+/* Inner fragments and ICMP messages generated when a packet exceeds the
+ * path MTU of its tunnel */
+static uint8_t *frag_buf;
+static uint8_t *icmp_buf;
+#define ICMP_BUF_SIZE (LBUF_STACK_OFFSET + MAX_IP_PKT_LEN)
+
+/* Outer IPv6, UDP and LISP headers */
+#define MCAST_MAX_HDR_LEN (sizeof(struct ip6_hdr) + sizeof(struct udphdr) \
+        + sizeof(lisp_data_hdr_t))
 
 
 static int tun_output_multicast(lbuf_t *b, packet_tuple_t *tuple);
@@ -48,12 +67,24 @@ void
 tun_output_init()
 {
     ttable_init(&ttable);
+    reencap_table_init(&rtr_rtable);
+    mcast_table_init(&mtable);
+    pmtu_table_init(&pmtu_table);
+    rloc_reach_table_init(&reach_table);
+
+    pkt_recv_buf = tun_buf_alloc(TUN_GSO_RECEIVE_SIZE);
+    frag_buf = tun_buf_alloc(TUN_RECEIVE_SIZE);
+    icmp_buf = tun_buf_alloc(ICMP_BUF_SIZE);
 }
 
 void
 tun_output_uninit()
 {
     ttable_uninit(&ttable);
+    reencap_table_uninit(&rtr_rtable);
+    mcast_table_uninit(&mtable);
+    pmtu_table_uninit(&pmtu_table);
+    rloc_reach_table_uninit(&reach_table);
 }
 
 static int
@@ -98,91 +129,335 @@ is_lisp_packet(packet_tuple_t *tpl)
     return (TRUE);
 }
 
+/* Order the replication list by output socket to batch the sends */
 static int
-make_mcast_addr(packet_tuple_t *tuple, lisp_addr_t *addr){
+mcast_rep_cmp(const void *r1, const void *r2)
+{
+    uintptr_t s1 = (uintptr_t)((mcast_rep_t *)r1)->out_sock;
+    uintptr_t s2 = (uintptr_t)((mcast_rep_t *)r2)->out_sock;
 
-    /* TODO this really needs optimization */
+    return ((s1 > s2) - (s1 < s2));
+}
 
-    uint16_t    plen;
-    lcaf_addr_t *lcaf;
+/*
+ * Ask the control plane for the replication list of the (S,G) channel of
+ * 'tuple' and cache it in the multicast forwarding table
+ */
+static mcast_entry_t *
+tun_mcast_learn(mcast_key_t *key, packet_tuple_t *tuple)
+{
+    fwd_info_t *fi;
+    fwd_entry_t *fe;
+    glist_t *rep_list;
+    glist_entry_t *it;
+    mcast_entry_t *me;
+    mcast_rep_t *rep;
+    int *out_sock;
+    int n = 0;
+
+    fi = ctrl_get_mcast_forwarding_info(tuple);
+    if (!fi) {
+        return (NULL);
+    }
+    rep_list = (glist_t *)fi->fwd_info;
+    if (fi->encap != ENCP_LISP) {
+        OOR_LOG(LDBG_2, "tun_mcast_learn: Only LISP encapsulation is supported "
+                "for multicast. Dropping packets of (%s, %s)",
+                addr_key_to_char(&key->src), addr_key_to_char(&key->dst));
+        glist_remove_all(rep_list);
+    }
 
-    if (ip_addr_is_multicast(lisp_addr_ip(&tuple->dst_addr))) {
-        if (lisp_addr_lafi(&tuple->src_addr) != LM_AFI_IP
-            || lisp_addr_lafi(&tuple->src_addr) != LM_AFI_IP) {
-           OOR_LOG(LDBG_1, "tuple_get_dst_lisp_addr: (S,G) (%s, %s)pair is not "
-                   "of IP syntax!", lisp_addr_to_char(&tuple->src_addr),
-                   lisp_addr_to_char(&tuple->dst_addr));
-           return(BAD);
+    me = mcast_table_insert(&mtable, key, tuple->iid, fi->temporal,
+            glist_size(rep_list));
+    glist_for_each_entry(it, rep_list) {
+        fe = (fwd_entry_t *)glist_entry_data(it);
+        out_sock = get_out_socket_ptr_from_address(fe->srloc);
+        if (out_sock == NULL) {
+            continue;
         }
+        rep = &me->reps[n++];
+        ip_addr_copy(&rep->srloc, lisp_addr_ip(fe->srloc));
+        ip_addr_copy(&rep->drloc, lisp_addr_ip(fe->drloc));
+        rep->out_sock = out_sock;
+    }
+    me->n_reps = n;
+    qsort(me->reps, n, sizeof(mcast_rep_t), mcast_rep_cmp);
 
-        lisp_addr_set_lafi(addr, LM_AFI_LCAF);
-        plen = ip_afi_to_default_mask(lisp_addr_ip_afi(&tuple->dst_addr));
-        lcaf = lisp_addr_get_lcaf(addr);
-        lcaf_addr_set_mc(lcaf, &tuple->src_addr, &tuple->dst_addr, plen, plen,
-                0);
+    fwd_info_del(fi, (fwd_info_data_del)glist_destroy);
+    return (me);
+}
 
-    } else {
-        lisp_addr_set_lafi(addr, LM_AFI_NO_ADDR);
+/* Rewrite the destination RLOC of the outer headers 'hdr' */
+static void
+tun_mcast_set_drloc(uint8_t *hdr, ip_addr_t *old_drloc, ip_addr_t *new_drloc)
+{
+    struct ip *iph;
+    struct ip6_hdr *ip6h;
+    struct udphdr *udph;
+    void *dst;
+    int len;
+
+    switch (ip_addr_afi(new_drloc)) {
+    case AF_INET:
+        iph = (struct ip *)hdr;
+        dst = &iph->ip_dst;
+        len = sizeof(struct in_addr);
+        udph = (struct udphdr *)CO(iph, sizeof(struct ip));
+        iph->ip_sum = cksum_incr_update(iph->ip_sum, ip_addr_get_addr(old_drloc),
+                ip_addr_get_addr(new_drloc), len);
+        break;
+    case AF_INET6:
+        ip6h = (struct ip6_hdr *)hdr;
+        dst = &ip6h->ip6_dst;
+        len = sizeof(struct in6_addr);
+        udph = (struct udphdr *)CO(ip6h, sizeof(struct ip6_hdr));
+        break;
+    default:
+        return;
     }
 
-    return(GOOD);
+    if (udpsum(udph) != 0) {
+        udpsum(udph) = cksum_incr_update(udpsum(udph), ip_addr_get_addr(old_drloc),
+                ip_addr_get_addr(new_drloc), len);
+        if (udpsum(udph) == 0) {
+            udpsum(udph) = 0xffff;
+        }
+    }
+    memcpy(dst, ip_addr_get_addr(new_drloc), len);
 }
 
+/*
+ * Replicate a multicast packet to the RLOCs of its (S,G) channel. The packet
+ * is encapsulated once per source RLOC and the outer headers of each
+ * destination are copies of it with the destination RLOC patched. The
+ * inner packet is shared by all the copies and sent in batches per socket
+ */
 static int
 tun_output_multicast(lbuf_t *b, packet_tuple_t *tuple)
 {
-    glist_t *or_list = NULL;
-    lisp_addr_t *src_rloc = NULL, *daddr = NULL, *dst_rloc = NULL;
-    locator_t *locator = NULL;
-    glist_entry_t *it = NULL;
-    int *out_sock = NULL;
+    mcast_key_t key;
+    mcast_entry_t *me;
+    mcast_rep_t *rep, *tmpl_rep = NULL;
+    lisp_addr_t srloc, drloc;
+    uint8_t hdrs[RAW_BATCH_SIZE][MCAST_MAX_HDR_LEN];
+    struct iovec iov[2 * RAW_BATCH_SIZE];
+    ip_addr_t *dips[RAW_BATCH_SIZE];
+    int *batch_sock = NULL;
+    uint8_t *tmpl = NULL;
+    int i, n = 0, hlen = 0, plen;
+    uint8_t *payload;
+
+    addr_key_from_ip(&key.src, lisp_addr_ip(&tuple->src_addr), tuple->iid);
+    addr_key_from_ip(&key.dst, lisp_addr_ip(&tuple->dst_addr), tuple->iid);
+
+    me = mcast_table_lookup(&mtable, &key);
+    if (!me) {
+        me = tun_mcast_learn(&key, tuple);
+        if (!me) {
+            return (BAD);
+        }
+    }
 
-    OOR_LOG(LDBG_1, "Multicast packets not supported for now!");
-    return(GOOD);
+    if (me->n_reps == 0) {
+        OOR_LOG(LDBG_3, "tun_output_multicast: No replication RLOCs for (%s, %s). "
+                "Packet dropped", addr_key_to_char(&key.src), addr_key_to_char(&key.dst));
+        return (GOOD);
+    }
 
-    /* convert tuple to lisp_addr_t, to be used for map-cache lookup
-     * TODO: should be a tad more efficient  */
-    daddr = lisp_addr_new();
-    if (make_mcast_addr(tuple, daddr) != GOOD) {
-        OOR_LOG(LWRN, "tun_output_multicast: Unable to determine "
-                "destination address from tuple: src %s dst %s",
-                lisp_addr_to_char(&tuple->src_addr),
-                lisp_addr_to_char(&tuple->dst_addr));
-        return(BAD);
-    }
-
-    /* get the output RLOC list */
-    /* or_list = re_get_orlist(dst_eid); */
-    if (!or_list) {
-        return(BAD);
-    }
-
-    glist_for_each_entry(it, or_list)
-    {
-        /* TODO: take locator out, just send mcaddr and out socket */
-        locator = (locator_t *) glist_entry_data(it);
-        src_rloc = lcaf_mc_get_src(lisp_addr_get_lcaf(locator_addr(locator)));
-        dst_rloc = lcaf_mc_get_grp(lisp_addr_get_lcaf(locator_addr(locator)));
-        out_sock = get_out_socket_ptr_from_address(src_rloc);
-        if (out_sock == NULL){
-            return (BAD);
+    payload = lbuf_data(b);
+    plen = lbuf_size(b);
+
+    for (i = 0; i < me->n_reps; i++) {
+        rep = &me->reps[i];
+
+        if (n == RAW_BATCH_SIZE || (n > 0 && rep->out_sock != batch_sock)) {
+            send_raw_packets(*batch_sock, iov, 2, dips, n);
+            n = 0;
+        }
+
+        /* Encapsulate only when the source RLOC changes */
+        if (!tmpl_rep || ip_addr_cmp(&tmpl_rep->srloc, &rep->srloc) != 0) {
+            lbuf_pull(b, lbuf_size(b) - plen);
+            lisp_addr_init_from_ip(&srloc, &rep->srloc);
+            lisp_addr_init_from_ip(&drloc, &rep->drloc);
+            lisp_data_encap(b, LISP_DATA_PORT, LISP_DATA_PORT, &srloc, &drloc,
+                    me->iid);
+            tmpl = lbuf_data(b);
+            hlen = lbuf_size(b) - plen;
+            tmpl_rep = rep;
         }
-        lisp_data_encap(b, LISP_DATA_PORT, LISP_DATA_PORT, src_rloc, dst_rloc, 0);
 
-        send_raw_packet(*out_sock, lbuf_data(b), lbuf_size(b),lisp_addr_ip(dst_rloc));
+        memcpy(hdrs[n], tmpl, hlen);
+        if (rep != tmpl_rep) {
+            tun_mcast_set_drloc(hdrs[n], &tmpl_rep->drloc, &rep->drloc);
+        }
+        iov[2 * n].iov_base = hdrs[n];
+        iov[2 * n].iov_len = hlen;
+        iov[2 * n + 1].iov_base = payload;
+        iov[2 * n + 1].iov_len = plen;
+        dips[n] = &rep->drloc;
+        batch_sock = rep->out_sock;
+        n++;
+
+        OOR_LOG(LDBG_3,"OUTPUT: Replicating multicast packet: RLOC %s -> %s\n",
+                ip_addr_to_char(&rep->srloc), ip_addr_to_char(&rep->drloc));
+    }
+
+    if (n > 0) {
+        send_raw_packets(*batch_sock, iov, 2, dips, n);
+    }
+
+    return (GOOD);
+}
+
+/* Bytes added to a packet by the encapsulation towards fe->drloc */
+static inline int
+tun_encap_overhead(fwd_info_t *fi, fwd_entry_t *fe)
+{
+    int len;
+
+    len = lisp_addr_ip_afi(fe->drloc) == AF_INET ? sizeof(struct ip)
+            : sizeof(struct ip6_hdr);
+    len += sizeof(struct udphdr);
+    switch (fi->encap){
+    case ENCP_VXLAN_GPE:
+        len += sizeof(vxlan_gpe_hdr_t);
+        break;
+    default:
+        len += sizeof(lisp_data_hdr_t);
+        break;
+    }
+    return (len);
+}
+
+/* LISP header of the packets of 'fe': Locator-Status-Bits of the source
+ * mapping, echo-nonce towards the destination RLOC and, when there is no
+ * nonce, the Map-Versions of the mappings */
+static void
+tun_lisp_hdr_init(lisp_data_hdr_t *lhdr, fwd_entry_t *fe)
+{
+    lisp_data_hdr_init(lhdr, fe->iid);
+    if (fe->lsb_set){
+        lisp_data_hdr_set_lsb(lhdr, fe->lsb);
+    }
+    if (fe->reach && rloc_reach_output(fe->reach, lhdr,
+            lisp_addr_ip(fe->srloc)) == RLOC_REACH_DOWN){
+        ctrl_rloc_reach_update(fe->drloc, DOWN);
     }
+    if (!lhdr->nonce_present && (fe->src_map_version || fe->dst_map_version)){
+        lisp_data_hdr_set_map_versions(lhdr, fe->src_map_version,
+                fe->dst_map_version);
+    }
+}
 
-    glist_destroy(or_list);
+static int
+tun_encap_and_send(lbuf_t *b, fwd_info_t *fi, fwd_entry_t *fe)
+{
+    lisp_data_hdr_t lhdr;
+
+    switch (fi->encap){
+    case ENCP_LISP:
+        tun_lisp_hdr_init(&lhdr, fe);
+        lisp_data_encap_hdr(b, LISP_DATA_PORT, LISP_DATA_PORT, fe->srloc,
+                fe->drloc, &lhdr);
+        break;
+    case ENCP_VXLAN_GPE:
+        vxlan_gpe_data_encap(b, VXLAN_GPE_DATA_PORT, VXLAN_GPE_DATA_PORT, fe->srloc, fe->drloc, fe->iid);
+        break;
+    }
+
+    return(send_raw_packet(*(fe->out_sock), lbuf_data(b), lbuf_size(b),
+               lisp_addr_ip(fe->drloc)));
+}
+
+/* Split the IPv4 packet 'b' in fragments of at most 'mtu' bytes and
+ * encapsulate each of them. IP options are copied to all the fragments */
+static int
+tun_output_fragment(lbuf_t *b, fwd_info_t *fi, fwd_entry_t *fe, int mtu)
+{
+    struct ip *iph, *fiph;
+    lbuf_t frag;
+    int hlen, plen, flen, len, off;
+    uint16_t ip_off;
+
+    iph = lbuf_data(b);
+    hlen = iph->ip_hl << 2;
+    plen = lbuf_size(b) - hlen;
+    ip_off = ntohs(iph->ip_off);
+
+    if (mtu > TUN_RECEIVE_SIZE - LBUF_STACK_OFFSET) {
+        mtu = TUN_RECEIVE_SIZE - LBUF_STACK_OFFSET;
+    }
+    flen = (mtu - hlen) & ~7;
+    if (flen <= 0) {
+        return (BAD);
+    }
+
+    OOR_LOG(LDBG_3, "OUTPUT: Fragmenting packet of %d bytes to fit in %d bytes",
+            lbuf_size(b), mtu);
+
+    for (off = 0; off < plen; off += flen) {
+        len = (plen - off < flen) ? plen - off : flen;
+        lbuf_use_stack(&frag, frag_buf, TUN_RECEIVE_SIZE);
+        lbuf_reserve(&frag, LBUF_STACK_OFFSET);
+        fiph = lbuf_put(&frag, iph, hlen);
+        lbuf_put(&frag, CO(iph, hlen + off), len);
+        fiph->ip_len = htons(hlen + len);
+        fiph->ip_off = htons(((ip_off & IP_OFFMASK) + (off >> 3))
+                | ((off + len < plen || (ip_off & IP_MF)) ? IP_MF : 0));
+        fiph->ip_sum = 0;
+        fiph->ip_sum = ip_checksum((uint16_t *)fiph, hlen);
+        if (tun_encap_and_send(&frag, fi, fe) != GOOD) {
+            return (BAD);
+        }
+    }
 
     return (GOOD);
 }
 
+/*
+ * Process a packet that doesn't fit in the path MTU of its tunnel once
+ * encapsulated (RFC 6830, section 5.4). IPv4 packets without the DF bit are
+ * fragmented before the encapsulation. Otherwise the source is notified with
+ * an ICMP Fragmentation Needed or Packet Too Big message reporting the
+ * 'mtu' available for the inner packet.
+ */
+static int
+tun_output_too_big(lbuf_t *b, fwd_info_t *fi, fwd_entry_t *fe, int mtu)
+{
+    struct ip *iph;
+    lbuf_t icmp;
+
+    iph = lbuf_data(b);
+    if (iph->ip_v == IPVERSION) {
+        if (!(ntohs(iph->ip_off) & IP_DF)) {
+            return (tun_output_fragment(b, fi, fe, mtu));
+        }
+    } else if (mtu < IPV6_MIN_MTU) {
+        /* IPv6 sources can't go below the minimum MTU. Let the outer
+         * packet be dropped */
+        return (tun_encap_and_send(b, fi, fe));
+    }
+
+    OOR_LOG(LDBG_3, "OUTPUT: Packet of %d bytes exceeds the MTU %d towards %s. "
+            "Notifying the source", lbuf_size(b), mtu,
+            lisp_addr_to_char(fe->drloc));
+
+    lbuf_use_stack(&icmp, icmp_buf, ICMP_BUF_SIZE);
+    lbuf_reserve(&icmp, LBUF_STACK_OFFSET);
+    if (pkt_push_icmp_too_big(&icmp, lbuf_data(b), lbuf_size(b), mtu) != GOOD) {
+        return (BAD);
+    }
+    return (tun_write_pkt(lbuf_data(&icmp), lbuf_size(&icmp)));
+}
+
 static int
 tun_output_unicast(lbuf_t *b, packet_tuple_t *tuple)
 {
     fwd_info_t *fi;
     fwd_entry_t *fe;
     uint32_t iid = tuple->iid;
+    int mtu;
 
     /* XXX Since OOR doesn't support same local prefixes with different IIDs when
      * operating as a XTR or MN, we use IID = 0 to calculate the hash of the ttable.
@@ -198,9 +473,11 @@ tun_output_unicast(lbuf_t *b, packet_tuple_t *tuple)
         fe = fi->fwd_info;
         if (fe && fe->srloc && fe->drloc)  {
             fe->out_sock = get_out_socket_ptr_from_address(fe->srloc);
+            fe->pmtu = pmtu_table_get(&pmtu_table, lisp_addr_ip(fe->drloc));
+            fe->reach = rloc_reach_table_get(&reach_table, lisp_addr_ip(fe->drloc));
         }
         tuple->iid = iid;
-        ttable_insert(&ttable, pkt_tuple_clone(tuple), fi);
+        ttable_insert(&ttable, tuple, fi);
     }else{
         fe = fi->fwd_info;
     }
@@ -219,23 +496,22 @@ tun_output_unicast(lbuf_t *b, packet_tuple_t *tuple)
         }
     }
 
+    if (!fe->out_sock) {
+        OOR_LOG(LDBG_2, "tun_output_unicast: No output socket for RLOC %s",
+                lisp_addr_to_char(fe->srloc));
+        return (BAD);
+    }
+
     OOR_LOG(LDBG_3,"OUTPUT: Sending encapsulated packet: RLOC %s -> %s\n",
             lisp_addr_to_char(fe->srloc),
             lisp_addr_to_char(fe->drloc));
 
-    switch (fi->encap){
-    case ENCP_LISP:
-        lisp_data_encap(b, LISP_DATA_PORT, LISP_DATA_PORT, fe->srloc, fe->drloc, fe->iid);
-        break;
-    case ENCP_VXLAN_GPE:
-        vxlan_gpe_data_encap(b, VXLAN_GPE_DATA_PORT, VXLAN_GPE_DATA_PORT, fe->srloc, fe->drloc, fe->iid);
-        break;
+    mtu = fe->pmtu ? pmtu_entry_mtu(fe->pmtu) : 0;
+    if (mtu != 0 && lbuf_size(b) + tun_encap_overhead(fi, fe) > mtu) {
+        return (tun_output_too_big(b, fi, fe, mtu - tun_encap_overhead(fi, fe)));
     }
 
-
-    return(send_raw_packet(*(fe->out_sock), lbuf_data(b), lbuf_size(b),
-               lisp_addr_ip(fe->drloc)));
-
+    return (tun_encap_and_send(b, fi, fe));
 }
 
 int
@@ -258,23 +534,271 @@ tun_output(lbuf_t *b, packet_tuple_t *tpl)
     return(GOOD);
 }
 
+/*
+ * Fill the re-encapsulation key of a packet received by an RTR. 'b' should
+ * point to the inner packet with the outer headers already pulled.
+ * Only packets whose outer header can be rewritten in place are eligible:
+ * IPv4 outer header without options and unicast non LISP inner packets
+ */
+int
+tun_rtr_reencap_key(lbuf_t *b, uint32_t iid, reencap_key_t *key)
+{
+    struct ip *oiph;
+    struct iphdr *iph;
+    struct ip6_hdr *ip6h;
+    struct udphdr *udph;
+    ip_addr_t idst, osrc;
+    uint8_t *l4;
+    uint8_t proto;
+    uint16_t sport, dport;
+
+    oiph = lbuf_ip(b);
+    if (!oiph || oiph->ip_v != IPVERSION || oiph->ip_hl != 5) {
+        return (BAD);
+    }
+
+    iph = lbuf_data(b);
+    switch (iph->version) {
+    case 4:
+        ip_addr_init(&idst, &iph->daddr, AF_INET);
+        proto = iph->protocol;
+        l4 = CO(iph, iph->ihl * 4);
+        break;
+    case 6:
+        ip6h = (struct ip6_hdr *)iph;
+        ip_addr_init(&idst, &ip6h->ip6_dst, AF_INET6);
+        proto = ip6h->ip6_nxt;
+        l4 = CO(ip6h, sizeof(struct ip6_hdr));
+        break;
+    default:
+        return (BAD);
+    }
+
+    if (ip_addr_is_multicast(&idst)) {
+        return (BAD);
+    }
+
+    /* LISP packets are forwarded natively by tun_output */
+    if (proto == IPPROTO_UDP) {
+        if (CO(l4, sizeof(struct udphdr)) > (uint8_t *)lbuf_tail(b)) {
+            return (BAD);
+        }
+        udph = (struct udphdr *)l4;
+        sport = ntohs(udpsport(udph));
+        dport = ntohs(udpdport(udph));
+        if (sport == LISP_CONTROL_PORT || dport == LISP_CONTROL_PORT
+                || sport == LISP_DATA_PORT || dport == LISP_DATA_PORT) {
+            return (BAD);
+        }
+    }
+
+    ip_addr_init(&osrc, &oiph->ip_src, AF_INET);
+    addr_key_from_ip(&key->src, &osrc, iid);
+    addr_key_from_ip(&key->dst, &idst, iid);
+
+    return (GOOD);
+}
+
+/*
+ * Re-encapsulate a packet received by an RTR rewriting its outer IP, UDP and
+ * LISP headers in place. The payload is not touched and checksums are
+ * updated incrementally. Returns BAD if there is no cached decision for
+ * 'key', in which case the packet is left unchanged
+ */
+int
+tun_rtr_reencap_output(lbuf_t *b, reencap_key_t *key)
+{
+    reencap_entry_t *re;
+    struct ip *iph;
+    struct udphdr *udph;
+    lisp_data_hdr_t *lhdr, old_lhdr;
+    struct in_addr old_addrs[2];
+    uint16_t old_ports[2];
+    uint16_t sum;
+
+    re = reencap_table_lookup(&rtr_rtable, key);
+    if (!re) {
+        return (BAD);
+    }
+
+    iph = lbuf_ip(b);
+    udph = lbuf_udp(b);
+    lhdr = (lisp_data_hdr_t *)CO(udph, sizeof(struct udphdr));
+
+    memcpy(old_addrs, &iph->ip_src, sizeof(old_addrs));
+    memcpy(old_ports, udph, sizeof(old_ports));
+    old_lhdr = *lhdr;
+
+    iph->ip_src = *ip_addr_get_v4(&re->srloc);
+    iph->ip_dst = *ip_addr_get_v4(&re->drloc);
+    iph->ip_sum = cksum_incr_update(iph->ip_sum, old_addrs, &iph->ip_src,
+            sizeof(old_addrs));
+
+    udpsport(udph) = htons(LISP_DATA_PORT);
+    udpdport(udph) = htons(LISP_DATA_PORT);
+    lisp_data_hdr_init(lhdr, re->iid);
+
+    /* A zero UDP checksum was not computed by the sender. Keep it that way */
+    if (udpsum(udph) != 0) {
+        sum = cksum_incr_update(udpsum(udph), old_addrs, &iph->ip_src,
+                sizeof(old_addrs));
+        sum = cksum_incr_update(sum, old_ports, udph, sizeof(old_ports));
+        sum = cksum_incr_update(sum, &old_lhdr, lhdr, sizeof(lisp_data_hdr_t));
+        udpsum(udph) = (sum == 0) ? 0xffff : sum;
+    }
+
+    lbuf_point_to_ip(b);
+
+    OOR_LOG(LDBG_3,"OUTPUT: Re-encapsulating packet in place: RLOC %s -> %s\n",
+            ip_addr_to_char(&re->srloc), ip_addr_to_char(&re->drloc));
+
+    return(send_raw_packet(*(re->out_sock), lbuf_data(b), lbuf_size(b),
+            &re->drloc));
+}
+
+/*
+ * Cache the decision taken by the slow path for a packet received by an RTR
+ * so that next packets with the same 'key' are rewritten in place
+ */
+void
+tun_rtr_reencap_learn(reencap_key_t *key, packet_tuple_t *tpl)
+{
+    fwd_info_t *fi;
+    fwd_entry_t *fe;
+
+    fi = ttable_lookup(&ttable, tpl);
+    if (!fi || fi->temporal || fi->encap != ENCP_LISP) {
+        return;
+    }
+    fe = fi->fwd_info;
+    if (!fe || !fe->srloc || !fe->drloc || !fe->out_sock) {
+        return;
+    }
+    /* The outer IPv4 header is reused, so the new one should be IPv4 too */
+    if (lisp_addr_ip_afi(fe->srloc) != AF_INET
+            || lisp_addr_ip_afi(fe->drloc) != AF_INET) {
+        return;
+    }
+
+    reencap_table_insert(&rtr_rtable, key, lisp_addr_ip(fe->srloc),
+            lisp_addr_ip(fe->drloc), fe->iid, fe->out_sock);
+}
+
 int
 tun_output_recv(sock_t *sl)
 {
     packet_tuple_t tpl;
+    struct virtio_net_hdr vh;
 
-    lbuf_use_stack(&pkt_buf, &pkt_recv_buf, TUN_RECEIVE_SIZE);
+    lbuf_use_stack(&pkt_buf, pkt_recv_buf, TUN_GSO_RECEIVE_SIZE);
     lbuf_reserve(&pkt_buf, LBUF_STACK_OFFSET);
 
     if (sock_recv(sl->fd, &pkt_buf) != GOOD) {
         OOR_LOG(LWRN, "OUTPUT: Error while reading from tun!");
         return (BAD);
     }
+    if (tun_vnet_hdr) {
+        if (lbuf_size(&pkt_buf) < TUN_VNET_HDR_LEN) {
+            return (BAD);
+        }
+        memcpy(&vh, lbuf_data(&pkt_buf), TUN_VNET_HDR_LEN);
+        lbuf_pull(&pkt_buf, TUN_VNET_HDR_LEN);
+    }
     lbuf_reset_ip(&pkt_buf);
     if (pkt_parse_5_tuple(&pkt_buf, &tpl) != GOOD) {
         return (BAD);
     }
     tpl.iid = 0;
-    tun_output(&pkt_buf, &tpl);
+    if (tun_vnet_hdr) {
+        tun_gso_output(&pkt_buf, &vh, &tpl);
+    } else {
+        tun_output(&pkt_buf, &tpl);
+    }
+    return (GOOD);
+}
+
+/* Learn the path MTU towards the RLOCs from the errors queued on an output
+ * socket: packets larger than the MTU of the output interface */
+int
+tun_output_recv_err(sock_t *sl)
+{
+    ip_addr_t rloc;
+    int mtu;
+
+    while (sock_recv_pmtu_err(sl->fd, &rloc, &mtu) == GOOD) {
+        if (mtu != 0) {
+            pmtu_table_update(&pmtu_table, &rloc, mtu);
+        }
+    }
+    return (GOOD);
+}
+
+static inline int
+is_data_port(uint16_t port)
+{
+    return (port == LISP_DATA_PORT || port == VXLAN_GPE_DATA_PORT);
+}
+
+/* Learn the path MTU towards the RLOCs from the ICMP Fragmentation Needed and
+ * ICMPv6 Packet Too Big messages sent in response to encapsulated packets */
+int
+tun_output_recv_icmp(sock_t *sl)
+{
+    uint8_t buf[256];
+    struct ip *iph, *oiph;
+    struct icmp *icmph;
+    struct icmp6_hdr *icmp6h;
+    struct ip6_hdr *oip6h;
+    struct udphdr *udph;
+    ip_addr_t rloc;
+    int len, hlen, mtu;
+
+    len = recv(sl->fd, buf, sizeof(buf), 0);
+    if (len <= 0) {
+        return (BAD);
+    }
+
+    /* IPv4 raw sockets deliver the IP header, IPv6 ones start with the ICMPv6
+     * header, whose type (2) can't be mistaken for the IP version */
+    iph = (struct ip *)buf;
+    if (iph->ip_v == IPVERSION) {
+        hlen = iph->ip_hl << 2;
+        if (len < hlen + ICMP_MINLEN + sizeof(struct ip) + UDP_HDR_LEN) {
+            return (BAD);
+        }
+        icmph = (struct icmp *)CO(buf, hlen);
+        if (icmph->icmp_type != ICMP_DEST_UNREACH
+                || icmph->icmp_code != ICMP_FRAG_NEEDED) {
+            return (GOOD);
+        }
+        oiph = &icmph->icmp_ip;
+        udph = (struct udphdr *)CO(oiph, (oiph->ip_hl << 2));
+        if (oiph->ip_p != IPPROTO_UDP || (uint8_t *)(udph + 1) > CO(buf, len)
+                || !is_data_port(ntohs(udpdport(udph)))) {
+            return (GOOD);
+        }
+        ip_addr_init(&rloc, &oiph->ip_dst, AF_INET);
+        mtu = ntohs(icmph->icmp_nextmtu);
+    } else {
+        if (len < sizeof(struct icmp6_hdr) + sizeof(struct ip6_hdr) + UDP_HDR_LEN) {
+            return (BAD);
+        }
+        icmp6h = (struct icmp6_hdr *)buf;
+        if (icmp6h->icmp6_type != ICMP6_PACKET_TOO_BIG) {
+            return (GOOD);
+        }
+        oip6h = (struct ip6_hdr *)(icmp6h + 1);
+        udph = (struct udphdr *)(oip6h + 1);
+        if (oip6h->ip6_nxt != IPPROTO_UDP || !is_data_port(ntohs(udpdport(udph)))) {
+            return (GOOD);
+        }
+        ip_addr_init(&rloc, &oip6h->ip6_dst, AF_INET6);
+        mtu = ntohl(icmp6h->icmp6_mtu);
+    }
+
+    OOR_LOG(LDBG_2, "Received ICMP reporting an MTU of %d towards RLOC %s",
+            mtu, ip_addr_to_char(&rloc));
+    pmtu_table_update(&pmtu_table, &rloc, mtu);
+
     return (GOOD);
 }
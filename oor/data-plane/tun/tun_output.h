@@ -32,11 +32,25 @@
 #include "../../iface_list.h"
 #include "../../oor_external.h"
 #include "../../lib/cksum.h"
+#include "../../lib/reencap_table.h"
+#include "../../lib/mcast_table.h"
+#include "../../lib/pmtu_table.h"
+#include "../../lib/rloc_reach_table.h"
+
+/* Reachability of the remote RLOCs learnt from the LISP headers. Shared
+ * with the input path */
+extern rloc_reach_table_t reach_table;
 
 
 int tun_output_recv(sock_t *sl);
+int tun_output_recv_err(sock_t *sl);
+int tun_output_recv_icmp(sock_t *sl);
 int tun_output(lbuf_t *, packet_tuple_t *);
 void tun_output_init();
 void tun_output_uninit();
 
+int tun_rtr_reencap_key(lbuf_t *b, uint32_t iid, reencap_key_t *key);
+int tun_rtr_reencap_output(lbuf_t *b, reencap_key_t *key);
+void tun_rtr_reencap_learn(reencap_key_t *key, packet_tuple_t *tpl);
+
 #endif /*TUN_OUTPUT_H_*/
@@ -47,7 +47,7 @@ vpnapi_read_and_decap_pkt(int sock, lbuf_t *b, uint32_t *iid)
 
     data = (vpnapi_data_t *)dplane_vpnapi.datap_data;
 
-    if (sock_data_recv(sock, b, &afi, &ttl, &tos) != GOOD) {
+    if (sock_data_recv(sock, b, &afi, &ttl, &tos, NULL, NULL) != GOOD) {
         return(BAD);
     }
     if (lbuf_size(b) < 8){ // 8-> At least LISP header size
@@ -113,7 +113,7 @@ vpnapi_output_unicast(lbuf_t *b, packet_tuple_t *tuple)
             }
         }
         tuple->iid = iid;
-        ttable_insert(&ttable, pkt_tuple_clone(tuple), fi);
+        ttable_insert(&ttable, tuple, fi);
     }else{
         fe = fi->fwd_info;
     }
@@ -19,25 +19,28 @@
 
 #include "flow_balancing.h"
 #include "fb_addr_func.h"
+#include "../../lib/loct_set.h"
 #include "../../lib/oor_log.h"
 #include "../../liblisp/liblisp.h"
 
 fb_dev_parm *fb_dev_parm_new();
-void *fb_dev_parm_new_init(oor_ctrl_dev_t *ctrl_dev,
+static void *fb_latency_dev_parm_new_init(oor_ctrl_dev_t *ctrl_dev,
         fwd_policy_dev_parm *dev_parm_inf);
-void fb_dev_parm_del(void *dev_parm);
 balancing_locators_vecs *balancing_locators_vecs_new();
 int mle_balancing_locators_vecs_new_init(void *dev_parm, map_local_entry_t *mle,
         fwd_policy_map_parm *map_parm,fwd_info_del_fct fwd_del_fct);
 int mce_balancing_locators_vecs_new_init(void *dev_parm, mcache_entry_t *mce,
         routing_info_del_fct del_fct);
 static void *balancing_locators_vecs_new_init(void *dev_parm, mapping_t *map, uint8_t is_mce);
+static balancing_locators_vecs *shared_balancing_locators_vecs(void *dev_parm,
+        mapping_t *map, uint8_t recalculate);
 void balancing_locators_vecs_del(void * bal_vec);
+static void balancing_locators_vecs_shared_del(void * bal_vec);
 void fb_get_fw_entry(void *fwd_dev_parm, void *src_map_parm,
         void *dst_map_parm, packet_tuple_t *tuple, fwd_info_t *fwd_info);
-static locator_t **set_balancing_vector(locator_t **, int, int, int *);
-static int select_best_priority_locators(glist_t *, locator_t **, uint8_t);
-static inline void get_hcf_locators_weight(locator_t **, int *, int *);
+static locator_t **set_balancing_vector(locator_t **, int *, int, int, int *);
+static void get_locators_weight(fb_dev_parm *, locator_t **, int *);
+static inline void get_hcf_locators_weight(locator_t **, int *, int *, int *);
 static int highest_common_factor(int a, int b);
 /* Initialize to 0 balancing_locators_vecs */
 static void balancing_locators_vecs_reset (balancing_locators_vecs *blv);
@@ -48,8 +51,6 @@ int mle_balancing_vectors_calculate(void *dev_parm, map_local_entry_t *mle);
 int mce_balancing_vectors_calculate(void *dev_parm, mcache_entry_t *mce);
 static int balancing_vectors_calculate(void *dev_parm, balancing_locators_vecs *blv,
         mapping_t *map, uint8_t is_mce);
-void fb_locators_classify_in_4_6(mapping_t *mapping,glist_t *loc_loct_addr,
-        glist_t *ipv4_loct_list,glist_t *ipv6_loct_list);
 
 fwd_policy_class  fwd_policy_flow_balancing = {
         .new_dev_policy_inf = fb_dev_parm_new_init,
@@ -64,6 +65,20 @@ fwd_policy_class  fwd_policy_flow_balancing = {
         .get_fwd_ip_addr = fb_addr_get_fwd_ip_addr
 };
 
+/* Flow balancing favouring the locators with lower RTT */
+fwd_policy_class  fwd_policy_latency = {
+        .new_dev_policy_inf = fb_latency_dev_parm_new_init,
+        .del_dev_policy_inf = fb_dev_parm_del,
+        .init_map_loc_policy_inf = mle_balancing_locators_vecs_new_init,
+        .del_map_loc_policy_inf = balancing_locators_vecs_del,
+        .init_map_cache_policy_inf = mce_balancing_locators_vecs_new_init,
+        .del_map_cache_policy_inf = balancing_locators_vecs_del,
+        .updated_map_loc_inf = mle_balancing_vectors_calculate,
+        .updated_map_cache_inf = mce_balancing_vectors_calculate,
+        .policy_get_fwd_info = fb_get_fw_entry,
+        .get_fwd_ip_addr = fb_addr_get_fwd_ip_addr
+};
+
 
 inline fb_dev_parm *
 fb_dev_parm_new()
@@ -93,6 +108,21 @@ fb_dev_parm_new_init(oor_ctrl_dev_t *ctrl_dev,
     return(dev_parm);
 }
 
+static void *
+fb_latency_dev_parm_new_init(oor_ctrl_dev_t *ctrl_dev,
+        fwd_policy_dev_parm *dev_parm_inf)
+{
+    fb_dev_parm *   dev_parm;
+
+    dev_parm = fb_dev_parm_new_init(ctrl_dev, dev_parm_inf);
+    if(dev_parm == NULL){
+        return (NULL);
+    }
+    dev_parm->latency_bias = TRUE;
+
+    return(dev_parm);
+}
+
 inline void
 fb_dev_parm_del(void *dev_parm)
 {
@@ -127,7 +157,16 @@ mle_balancing_locators_vecs_new_init(void *dev_parm, map_local_entry_t *mle, fwd
 int
 mce_balancing_locators_vecs_new_init(void *dev_parm, mcache_entry_t *mce, routing_info_del_fct del_fct)
 {
-    void * routing_inf =  balancing_locators_vecs_new_init(dev_parm, mcache_entry_mapping(mce), TRUE);
+    void * routing_inf;
+
+    /* Entries with interned locators use the vectors of the locator set */
+    routing_inf = shared_balancing_locators_vecs(dev_parm, mcache_entry_mapping(mce), FALSE);
+    if (routing_inf){
+        mcache_entry_set_routing_info(mce, routing_inf, balancing_locators_vecs_shared_del);
+        return (GOOD);
+    }
+
+    routing_inf =  balancing_locators_vecs_new_init(dev_parm, mcache_entry_mapping(mce), TRUE);
     if (!routing_inf){
         return (BAD);
     }
@@ -161,6 +200,44 @@ balancing_locators_vecs_del(void * bal_vec)
     free((balancing_locators_vecs *)bal_vec);
 }
 
+/* The vectors of a locator set are freed with the set */
+static void
+balancing_locators_vecs_shared_del(void * bal_vec)
+{
+}
+
+/* Returns the balancing vectors of the locator set of 'map', calculating them
+ * if the set doesn't have them yet or if 'recalculate' is TRUE. Returns NULL
+ * if the locators of 'map' are not shared */
+static balancing_locators_vecs *
+shared_balancing_locators_vecs(void *dev_parm, mapping_t *map, uint8_t recalculate)
+{
+    loct_set_t *lset = mapping_loct_set(map);
+    balancing_locators_vecs *bal_vec;
+
+    if (lset == NULL){
+        return (NULL);
+    }
+
+    bal_vec = (balancing_locators_vecs *)loct_set_fwd_info(lset, dev_parm);
+    if (bal_vec != NULL){
+        if (recalculate){
+            balancing_vectors_calculate(dev_parm, bal_vec, map, TRUE);
+        }
+        return (bal_vec);
+    }
+
+    bal_vec = balancing_locators_vecs_new_init(dev_parm, map, TRUE);
+    if (!bal_vec){
+        return (NULL);
+    }
+    if (loct_set_set_fwd_info(lset, dev_parm, bal_vec, balancing_locators_vecs_del) != GOOD){
+        balancing_locators_vecs_del(bal_vec);
+        return (NULL);
+    }
+    return (bal_vec);
+}
+
 /* Initialize to 0 balancing_locators_vecs */
 static void
 balancing_locators_vecs_reset(balancing_locators_vecs *blv)
@@ -243,23 +320,26 @@ balancing_locators_vec_dump(balancing_locators_vecs b_locators_vecs,
 
 /**************************************** TRAFFIC BALANCING FUNCTIONS ************************/
 
-static int
-select_best_priority_locators(glist_t *loct_list, locator_t **selected_locators, uint8_t is_mce)
+int
+fb_select_best_priority_locators(loct_vec_elt_t **locts, int count,
+        locator_t **selected_locators, uint8_t is_mce)
 {
-    glist_entry_t *it_loct;
+    loct_vec_elt_t *elt;
     locator_t *locator;
     int min_priority = UNUSED_RLOC_PRIORITY;
     int pos = 0;
+    int ctr;
 
-    if (glist_size(loct_list) == 0){
+    if (count == 0){
         return (BAD);
     }
 
-    glist_for_each_entry(it_loct,loct_list){
-        locator = (locator_t *)glist_entry_data(it_loct);
+    for (ctr = 0; ctr < count; ctr++){
+        elt = locts[ctr];
+        locator = elt->loct;
         /* Only use locators with status UP  */
         if (locator_state(locator) == DOWN
-                || locator_priority(locator) == UNUSED_RLOC_PRIORITY ) {
+                || elt->priority == UNUSED_RLOC_PRIORITY ) {
             continue;
         }
         /* For local mappings, the locator should be local */
@@ -268,16 +348,16 @@ select_best_priority_locators(glist_t *loct_list, locator_t **selected_locators,
         }
         /* If priority of the locator equal to min_priority, then add the
          * locator to the list */
-        if (locator_priority(locator) == min_priority) {
+        if (elt->priority == min_priority) {
             selected_locators[pos] = locator;
             pos++;
             selected_locators[pos] = NULL;
         }
         /* If priority of the locator is minor than the min_priority, then
          * min_priority and list of rlocs is updated */
-        if (locator_priority(locator) < min_priority) {
+        if (elt->priority < min_priority) {
             pos = 0;
-            min_priority = locator_priority(locator);
+            min_priority = elt->priority;
             selected_locators[pos] = locator;
             pos++;
             selected_locators[pos] = NULL;
@@ -288,8 +368,8 @@ select_best_priority_locators(glist_t *loct_list, locator_t **selected_locators,
 }
 
 static locator_t **
-set_balancing_vector(locator_t **locators, int total_weight, int hcf,
-        int *locators_vec_length)
+set_balancing_vector(locator_t **locators, int *weights, int total_weight,
+        int hcf, int *locators_vec_length)
 {
     locator_t **balancing_locators_vec;
     int vector_length = 0;
@@ -317,7 +397,7 @@ set_balancing_vector(locator_t **locators, int total_weight, int hcf,
 
     while (locators[ctr] != NULL) {
         if (total_weight != 0) {
-            used_pos = locator_weight(locators[ctr]) / hcf;
+            used_pos = weights[ctr] / hcf;
         } else {
             /* If all locators has weight equal to 0, we assign one position
              * for each locator. Simetric balancing */
@@ -342,8 +422,34 @@ mle_balancing_vectors_calculate(void *dev_parm,map_local_entry_t *mle){
 
 int
 mce_balancing_vectors_calculate(void *dev_parm,mcache_entry_t *mce){
+    mapping_t *map = mcache_entry_mapping(mce);
+    balancing_locators_vecs *bal_vec;
+
+    /* The locators of the entry may have joined or left a locator set since
+     * the vectors were calculated */
+    bal_vec = shared_balancing_locators_vecs(dev_parm, map, TRUE);
+    if (bal_vec != NULL){
+        if (mce->routing_inf_del != balancing_locators_vecs_shared_del
+                && mcache_entry_routing_info(mce) != NULL){
+            mce->routing_inf_del(mcache_entry_routing_info(mce));
+        }
+        mcache_entry_set_routing_info(mce, bal_vec, balancing_locators_vecs_shared_del);
+        return (GOOD);
+    }
+
+    if (mcache_entry_routing_info(mce) == NULL
+            || mce->routing_inf_del == balancing_locators_vecs_shared_del){
+        bal_vec = balancing_locators_vecs_new_init(dev_parm, map, TRUE);
+        if (!bal_vec){
+            mcache_entry_set_routing_info(mce, NULL, balancing_locators_vecs_del);
+            return (BAD);
+        }
+        mcache_entry_set_routing_info(mce, bal_vec, balancing_locators_vecs_del);
+        return (GOOD);
+    }
+
     return (balancing_vectors_calculate(dev_parm, mcache_entry_routing_info(mce),
-            mcache_entry_mapping(mce),TRUE));
+            map,TRUE));
 }
 
 
@@ -353,11 +459,15 @@ mce_balancing_vectors_calculate(void *dev_parm,mcache_entry_t *mce){
 static int
 balancing_vectors_calculate(void *dev_parm, balancing_locators_vecs *blv, mapping_t * map, uint8_t is_mce)
 {
-    // Store locators with same priority. Maximum 32 locators (33 to no get out of array)
-    locator_t *locators[3][33];
-    // Aux list to classify all locators between IP4 and IPv6
-    glist_t *ipv4_loct_list  = glist_new();
-    glist_t *ipv6_loct_list  = glist_new();
+    // Store locators with same priority (+1 to no get out of array)
+    locator_t *locators[3][2 * FB_MAX_LOCATORS + 1];
+    // Weight used for each of the locators
+    int weights[3][2 * FB_MAX_LOCATORS];
+    // Aux arrays to classify all locators between IP4 and IPv6
+    loct_vec_elt_t *ipv4_locts[FB_MAX_LOCATORS];
+    loct_vec_elt_t *ipv6_locts[FB_MAX_LOCATORS];
+    int ipv4_count = 0;
+    int ipv6_count = 0;
     fb_dev_parm *fw_dev_parm = (fb_dev_parm *)dev_parm;
 
     int min_priority[2] = { 255, 255 };
@@ -372,33 +482,38 @@ balancing_vectors_calculate(void *dev_parm, balancing_locators_vecs *blv, mappin
 
     balancing_locators_vecs_reset(blv);
 
-    fb_locators_classify_in_4_6(map,fw_dev_parm->loc_loct,ipv4_loct_list,ipv6_loct_list);
+    fb_locators_classify_in_4_6(map,fw_dev_parm->loc_loct,ipv4_locts,&ipv4_count,
+            ipv6_locts,&ipv6_count);
 
 
     /* Fill the locator balancing vec using only IPv4 locators and according
      * to their priority and weight */
-    if (glist_size(ipv4_loct_list) != 0)
+    if (ipv4_count != 0)
     {
-        min_priority[0] = select_best_priority_locators(
-                ipv4_loct_list, locators[0], is_mce);
+        min_priority[0] = fb_select_best_priority_locators(
+                ipv4_locts, ipv4_count, locators[0], is_mce);
         if (min_priority[0] != UNUSED_RLOC_PRIORITY) {
-            get_hcf_locators_weight(locators[0], &total_weight[0], &hcf[0]);
+            get_locators_weight(fw_dev_parm, locators[0], weights[0]);
+            get_hcf_locators_weight(locators[0], weights[0], &total_weight[0],
+                    &hcf[0]);
             blv->v4_balancing_locators_vec = set_balancing_vector(
-                    locators[0], total_weight[0], hcf[0],
+                    locators[0], weights[0], total_weight[0], hcf[0],
                     &(blv->v4_locators_vec_length));
         }
     }
 
     /* Fill the locator balancing vec using only IPv6 locators and according
      * to their priority and weight*/
-    if (glist_size(ipv6_loct_list) != 0)
+    if (ipv6_count != 0)
     {
-        min_priority[1] = select_best_priority_locators(
-                ipv6_loct_list, locators[1], is_mce);
+        min_priority[1] = fb_select_best_priority_locators(
+                ipv6_locts, ipv6_count, locators[1], is_mce);
         if (min_priority[1] != UNUSED_RLOC_PRIORITY) {
-            get_hcf_locators_weight(locators[1], &total_weight[1], &hcf[1]);
+            get_locators_weight(fw_dev_parm, locators[1], weights[1]);
+            get_hcf_locators_weight(locators[1], weights[1], &total_weight[1],
+                    &hcf[1]);
             blv->v6_balancing_locators_vec = set_balancing_vector(
-                    locators[1], total_weight[1], hcf[1],
+                    locators[1], weights[1], total_weight[1], hcf[1],
                     &(blv->v6_locators_vec_length));
         }
     }
@@ -426,27 +541,67 @@ balancing_vectors_calculate(void *dev_parm, balancing_locators_vecs *blv, mappin
                 ctr1 = 0;
                 while (locators[ctr][ctr1] != NULL) {
                     locators[2][pos] = locators[ctr][ctr1];
+                    weights[2][pos] = weights[ctr][ctr1];
                     ctr1++;
                     pos++;
                 }
             }
             locators[2][pos] = NULL;
             blv->balancing_locators_vec = set_balancing_vector(
-                    locators[2], total_weight[2], hcf[2],
+                    locators[2], weights[2], total_weight[2], hcf[2],
                     &(blv->locators_vec_length));
         }
     }
 
     balancing_locators_vec_dump(*blv, map, LDBG_1);
 
-    glist_destroy(ipv4_loct_list);
-    glist_destroy(ipv6_loct_list);
-
     return (GOOD);
 }
 
+/* Weight of each locator of the NULL terminated list 'locators'. In latency
+ * mode, the weights are biased toward the locators with lower RTT. The RTT
+ * of the locators only changes when the measurements differ significantly
+ * and the bias has few levels, so flows don't move with small variations */
+static void
+get_locators_weight(fb_dev_parm *dev_parm, locator_t **locators, int *weights)
+{
+    uint32_t min_rtt = 0;
+    uint32_t rtt;
+    int all_zero = TRUE;
+    int factor;
+    int ctr;
+
+    for (ctr = 0; locators[ctr] != NULL; ctr++) {
+        weights[ctr] = locator_weight(locators[ctr]);
+        if (weights[ctr] != 0) {
+            all_zero = FALSE;
+        }
+        rtt = locator_rtt(locators[ctr]);
+        if (rtt != 0 && (min_rtt == 0 || rtt < min_rtt)) {
+            min_rtt = rtt;
+        }
+    }
+    if (!dev_parm->latency_bias || min_rtt == 0) {
+        return;
+    }
+
+    for (ctr = 0; locators[ctr] != NULL; ctr++) {
+        rtt = locator_rtt(locators[ctr]);
+        if (rtt == 0) {
+            factor = FB_RTT_BIAS_UNKNOWN;
+        } else {
+            factor = ((uint64_t)FB_RTT_BIAS_MAX * min_rtt + rtt / 2) / rtt;
+            if (factor < 1) {
+                factor = 1;
+            }
+        }
+        /* If all the weights are 0, the locators are equivalent */
+        weights[ctr] = (all_zero ? 1 : weights[ctr]) * factor;
+    }
+}
+
 static inline void
-get_hcf_locators_weight(locator_t **locators, int *total_weight,
+get_hcf_locators_weight(locator_t **locators, int *weights, int *total_weight,
         int *hcf)
 {
     int ctr = 0;
@@ -454,10 +609,10 @@ get_hcf_locators_weight(locator_t **locators, int *total_weight,
     int tmp_hcf = 0;
 
     if (locators[0] != NULL) {
-        tmp_hcf = locator_weight(locators[0]);
+        tmp_hcf = weights[0];
         while (locators[ctr] != NULL) {
-            weight = weight + locator_weight(locators[ctr]);
-            tmp_hcf = highest_common_factor(tmp_hcf, locator_weight(locators[ctr]));
+            weight = weight + weights[ctr];
+            tmp_hcf = highest_common_factor(tmp_hcf, weights[ctr]);
             ctr++;
         }
     }
@@ -493,31 +648,43 @@ highest_common_factor(int a, int b)
 
 void
 fb_locators_classify_in_4_6(mapping_t *mapping, glist_t *loc_loct_addr,
-        glist_t *ipv4_loct_list, glist_t *ipv6_loct_list)
+        loct_vec_elt_t **ipv4_locts, int *ipv4_count, loct_vec_elt_t **ipv6_locts,
+        int *ipv6_count)
 {
-    locator_t *locator;
-    lisp_addr_t *addr;
+    loct_vec_t *vec = mapping_loct_vec(mapping);
+    loct_vec_elt_t *elt;
     lisp_addr_t *ip_addr;
 
-    if (glist_size(mapping->locators_lists) == 0){
+    *ipv4_count = 0;
+    *ipv6_count = 0;
+    if (vec->count == 0){
         OOR_LOG(LDBG_3,"locators_classify_in_4_6: No locators to classify for mapping with eid %s",
                 lisp_addr_to_char(mapping_eid(mapping)));
         return;
     }
-    mapping_foreach_active_locator(mapping,locator){
-        addr = locator_addr(locator);
-        ip_addr = fb_addr_get_fwd_ip_addr(addr,loc_loct_addr);
+    loct_vec_foreach(vec, elt){
+        ip_addr = fb_addr_get_fwd_ip_addr(&elt->addr,loc_loct_addr);
         if (ip_addr == NULL){
-            OOR_LOG(LDBG_2,"locators_classify_in_4_6: No IP address for %s", lisp_addr_to_char(addr));
+            OOR_LOG(LDBG_2,"locators_classify_in_4_6: No IP address for %s", lisp_addr_to_char(&elt->addr));
             continue;
         }
 
         if (lisp_addr_ip_afi(ip_addr) == AF_INET){
-            glist_add(locator,ipv4_loct_list);
+            if (*ipv4_count == FB_MAX_LOCATORS){
+                OOR_LOG(LDBG_1,"locators_classify_in_4_6: More than %d IPv4 locators. "
+                        "Ignoring %s", FB_MAX_LOCATORS, lisp_addr_to_char(&elt->addr));
+                continue;
+            }
+            ipv4_locts[(*ipv4_count)++] = elt;
         }else{
-            glist_add(locator,ipv6_loct_list);
+            if (*ipv6_count == FB_MAX_LOCATORS){
+                OOR_LOG(LDBG_1,"locators_classify_in_4_6: More than %d IPv6 locators. "
+                        "Ignoring %s", FB_MAX_LOCATORS, lisp_addr_to_char(&elt->addr));
+                continue;
+            }
+            ipv6_locts[(*ipv6_count)++] = elt;
         }
-    }mapping_foreach_active_locator_end;
+    }
 }
 
 /*************************** Forward Select Function *************************/
@@ -548,6 +715,11 @@ fb_get_fw_entry(void *fwd_dev_parm, void *src_map_parm, void *dst_map_parm,
     lisp_addr_t * dst_ip_addr;
     int afi;
 
+    if (dst_blv == NULL) {
+        OOR_LOG(LDBG_3, "fb_get_fw_entry: No DST balancing vectors");
+        return;
+    }
+
     if (src_blv->balancing_locators_vec != NULL
             && dst_blv->balancing_locators_vec != NULL) {
         src_loc_vec = src_blv->balancing_locators_vec;
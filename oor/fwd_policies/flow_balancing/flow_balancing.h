@@ -22,10 +22,20 @@
 #include "../fwd_policy.h"
 #include "../../control/oor_ctrl_device.h"
 
+/* Maximum number of locators of each afi used to balance the traffic */
+#define FB_MAX_LOCATORS 32
+
+/* Latency mode: the weight of each locator of the best priority is multiplied
+ * by a factor from 1 to FB_RTT_BIAS_MAX proportional to the lowest RTT of the
+ * locators over its own RTT. Locators without RTT use FB_RTT_BIAS_UNKNOWN */
+#define FB_RTT_BIAS_MAX     4
+#define FB_RTT_BIAS_UNKNOWN 2
 
 typedef struct fb_dev_parm_ {
     oor_dev_type_e     dev_type;
     glist_t *           loc_loct;
+    /* Bias the weights toward the locators with lower RTT */
+    uint8_t            latency_bias;
 }fb_dev_parm;
 
 /*
@@ -45,4 +55,14 @@ typedef struct balancing_locators_vecs_ {
     int locators_vec_length;
 } balancing_locators_vecs;
 
+/* Shared with the other policies that select locators by priority and weight */
+void *fb_dev_parm_new_init(oor_ctrl_dev_t *ctrl_dev,
+        fwd_policy_dev_parm *dev_parm_inf);
+void fb_dev_parm_del(void *dev_parm);
+void fb_locators_classify_in_4_6(mapping_t *mapping,glist_t *loc_loct_addr,
+        loct_vec_elt_t **ipv4_locts, int *ipv4_count, loct_vec_elt_t **ipv6_locts,
+        int *ipv6_count);
+int fb_select_best_priority_locators(loct_vec_elt_t **locts, int count,
+        locator_t **selected_locators, uint8_t is_mce);
+
 #endif /* FLOW_BALANCING_H_ */
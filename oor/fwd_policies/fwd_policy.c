@@ -20,8 +20,10 @@
 #include "fwd_policy.h"
 #include "../lib/oor_log.h"
 
-static fwd_policy_class *fwd_policy_libs[1] = {
+static fwd_policy_class *fwd_policy_libs[3] = {
         &fwd_policy_flow_balancing,
+        &fwd_policy_maglev,
+        &fwd_policy_latency,
 };
 
 void policy_loct_parm_del(fwd_policy_loct_parm *pol_loct);
@@ -32,6 +34,12 @@ fwd_policy_class_find(char *lib)
 	if (strcmp(lib,"flow_balancing") == 0){
 		return(fwd_policy_libs[0]);
 	}
+	if (strcmp(lib,"maglev") == 0){
+		return(fwd_policy_libs[1]);
+	}
+	if (strcmp(lib,"latency") == 0){
+		return(fwd_policy_libs[2]);
+	}
 	OOR_LOG(LERR, "The forward policy library \"%s\" has not been found",lib);
 	return (NULL);
 }
@@ -90,15 +98,17 @@ policy_loct_parm_del(fwd_policy_loct_parm *pol_loct)
 }
 
 
+static mem_slab_t fwd_info_slab = MEM_SLAB_INITIALIZER("fwd_info", fwd_info_t);
+
 fwd_info_t *
 fwd_info_new()
 {
-    return (xzalloc(sizeof(fwd_info_t)));
+    return (mem_slab_alloc(&fwd_info_slab));
 }
 
 void
 fwd_info_del(fwd_info_t * fwd_info,fwd_info_data_del del_fn)
 {
     del_fn(fwd_info->fwd_info);
-    free(fwd_info);
+    mem_slab_free(&fwd_info_slab, fwd_info);
 }
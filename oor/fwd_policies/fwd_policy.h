@@ -82,6 +82,8 @@ typedef struct fwd_policy_class {
 
 
 extern fwd_policy_class fwd_policy_flow_balancing;
+extern fwd_policy_class fwd_policy_maglev;
+extern fwd_policy_class fwd_policy_latency;
 
 fwd_policy_dev_parm *fwd_policy_dev_parm_new();
 void fwd_policy_dev_parm_del(fwd_policy_dev_parm *pol_dev);
@@ -0,0 +1,499 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include "maglev.h"
+#include "../flow_balancing/fb_addr_func.h"
+#include "../../lib/addr_key.h"
+#include "../../lib/loct_set.h"
+#include "../../lib/oor_log.h"
+#include "../../liblisp/liblisp.h"
+
+/* Seeds of the hashes of the locator address used to get its permutation */
+#define MAGLEV_OFFSET_SEED  0x4d61676c
+#define MAGLEV_SKIP_SEED    0x6c657621
+
+maglev_tables_t *maglev_tables_new();
+int mle_maglev_tables_new_init(void *dev_parm, map_local_entry_t *mle,
+        fwd_policy_map_parm *map_parm, fwd_info_del_fct fwd_del_fct);
+int mce_maglev_tables_new_init(void *dev_parm, mcache_entry_t *mce,
+        routing_info_del_fct del_fct);
+static maglev_tables_t *maglev_tables_new_init(void *dev_parm, mapping_t *map,
+        uint8_t is_mce);
+static maglev_tables_t *shared_maglev_tables(void *dev_parm, mapping_t *map,
+        uint8_t recalculate);
+void maglev_tables_del(void *tables);
+static void maglev_tables_shared_del(void *tables);
+int mle_maglev_tables_calculate(void *dev_parm, map_local_entry_t *mle);
+int mce_maglev_tables_calculate(void *dev_parm, mcache_entry_t *mce);
+static int maglev_tables_calculate(void *dev_parm, maglev_tables_t *mt,
+        mapping_t *map, uint8_t is_mce);
+static void maglev_table_fill(maglev_table_t *table, locator_t **locators,
+        glist_t *loc_loct);
+static void maglev_table_reset(maglev_table_t *table);
+static void maglev_tables_dump(maglev_tables_t *mt, mapping_t *map,
+        int log_level);
+void maglev_get_fw_entry(void *fwd_dev_parm, void *src_map_parm,
+        void *dst_map_parm, packet_tuple_t *tuple, fwd_info_t *fwd_info);
+
+fwd_policy_class  fwd_policy_maglev = {
+        .new_dev_policy_inf = fb_dev_parm_new_init,
+        .del_dev_policy_inf = fb_dev_parm_del,
+        .init_map_loc_policy_inf = mle_maglev_tables_new_init,
+        .del_map_loc_policy_inf = maglev_tables_del,
+        .init_map_cache_policy_inf = mce_maglev_tables_new_init,
+        .del_map_cache_policy_inf = maglev_tables_del,
+        .updated_map_loc_inf = mle_maglev_tables_calculate,
+        .updated_map_cache_inf = mce_maglev_tables_calculate,
+        .policy_get_fwd_info = maglev_get_fw_entry,
+        .get_fwd_ip_addr = fb_addr_get_fwd_ip_addr
+};
+
+
+inline maglev_tables_t *
+maglev_tables_new()
+{
+    return (xzalloc(sizeof(maglev_tables_t)));
+}
+
+int
+mle_maglev_tables_new_init(void *dev_parm, map_local_entry_t *mle,
+        fwd_policy_map_parm *map_parm, fwd_info_del_fct fwd_del_fct)
+{
+    maglev_tables_t *mt;
+
+    mt = maglev_tables_new_init(dev_parm, map_local_entry_mapping(mle), FALSE);
+    if (!mt){
+        return (BAD);
+    }
+    map_local_entry_set_fwd_info(mle, mt, fwd_del_fct);
+    return (GOOD);
+}
+
+int
+mce_maglev_tables_new_init(void *dev_parm, mcache_entry_t *mce,
+        routing_info_del_fct del_fct)
+{
+    maglev_tables_t *mt;
+
+    /* Entries with interned locators use the tables of the locator set */
+    mt = shared_maglev_tables(dev_parm, mcache_entry_mapping(mce), FALSE);
+    if (mt){
+        mcache_entry_set_routing_info(mce, mt, maglev_tables_shared_del);
+        return (GOOD);
+    }
+
+    mt = maglev_tables_new_init(dev_parm, mcache_entry_mapping(mce), TRUE);
+    if (!mt){
+        return (BAD);
+    }
+    mcache_entry_set_routing_info(mce, mt, del_fct);
+    return (GOOD);
+}
+
+static maglev_tables_t *
+maglev_tables_new_init(void *dev_parm, mapping_t *map, uint8_t is_mce)
+{
+    maglev_tables_t *mt;
+
+    mt = maglev_tables_new();
+    if (maglev_tables_calculate(dev_parm, mt, map, is_mce) != GOOD){
+        maglev_tables_del(mt);
+        OOR_LOG(LDBG_2,"maglev_tables_new_init: Error calculating maglev tables");
+        return (NULL);
+    }
+
+    return (mt);
+}
+
+void
+maglev_tables_del(void *tables)
+{
+    maglev_tables_t *mt = (maglev_tables_t *)tables;
+
+    maglev_table_reset(&mt->v4_table);
+    maglev_table_reset(&mt->v6_table);
+    maglev_table_reset(&mt->v4_v6_table);
+    free(mt);
+}
+
+/* The tables of a locator set are freed with the set */
+static void
+maglev_tables_shared_del(void *tables)
+{
+}
+
+/* Returns the tables of the locator set of 'map', calculating them if the set
+ * doesn't have them yet or if 'recalculate' is TRUE. Returns NULL if the
+ * locators of 'map' are not shared */
+static maglev_tables_t *
+shared_maglev_tables(void *dev_parm, mapping_t *map, uint8_t recalculate)
+{
+    loct_set_t *lset = mapping_loct_set(map);
+    maglev_tables_t *mt;
+
+    if (lset == NULL){
+        return (NULL);
+    }
+
+    mt = (maglev_tables_t *)loct_set_fwd_info(lset, dev_parm);
+    if (mt != NULL){
+        if (recalculate){
+            maglev_tables_calculate(dev_parm, mt, map, TRUE);
+        }
+        return (mt);
+    }
+
+    mt = maglev_tables_new_init(dev_parm, map, TRUE);
+    if (!mt){
+        return (NULL);
+    }
+    if (loct_set_set_fwd_info(lset, dev_parm, mt, maglev_tables_del) != GOOD){
+        maglev_tables_del(mt);
+        return (NULL);
+    }
+    return (mt);
+}
+
+int
+mle_maglev_tables_calculate(void *dev_parm, map_local_entry_t *mle)
+{
+    return (maglev_tables_calculate(dev_parm, map_local_entry_fwd_info(mle),
+            map_local_entry_mapping(mle), FALSE));
+}
+
+int
+mce_maglev_tables_calculate(void *dev_parm, mcache_entry_t *mce)
+{
+    mapping_t *map = mcache_entry_mapping(mce);
+    maglev_tables_t *mt;
+
+    /* The locators of the entry may have joined or left a locator set since
+     * the tables were calculated */
+    mt = shared_maglev_tables(dev_parm, map, TRUE);
+    if (mt != NULL){
+        if (mce->routing_inf_del != maglev_tables_shared_del
+                && mcache_entry_routing_info(mce) != NULL){
+            mce->routing_inf_del(mcache_entry_routing_info(mce));
+        }
+        mcache_entry_set_routing_info(mce, mt, maglev_tables_shared_del);
+        return (GOOD);
+    }
+
+    if (mcache_entry_routing_info(mce) == NULL
+            || mce->routing_inf_del == maglev_tables_shared_del){
+        mt = maglev_tables_new_init(dev_parm, map, TRUE);
+        if (!mt){
+            mcache_entry_set_routing_info(mce, NULL, maglev_tables_del);
+            return (BAD);
+        }
+        mcache_entry_set_routing_info(mce, mt, maglev_tables_del);
+        return (GOOD);
+    }
+
+    return (maglev_tables_calculate(dev_parm, mcache_entry_routing_info(mce),
+            map, TRUE));
+}
+
+/*
+ * Fill the tables with the locators of the mapping with the best priority.
+ * The locators are selected as in flow_balancing, only the way the flows are
+ * distributed among them changes
+ */
+static int
+maglev_tables_calculate(void *dev_parm, maglev_tables_t *mt, mapping_t *map,
+        uint8_t is_mce)
+{
+    /* Store locators with same priority (+1 to no get out of array) */
+    locator_t *locators[3][2 * FB_MAX_LOCATORS + 1];
+    loct_vec_elt_t *ipv4_locts[FB_MAX_LOCATORS];
+    loct_vec_elt_t *ipv6_locts[FB_MAX_LOCATORS];
+    int ipv4_count = 0;
+    int ipv6_count = 0;
+    fb_dev_parm *fw_dev_parm = (fb_dev_parm *)dev_parm;
+    int min_priority[2] = { UNUSED_RLOC_PRIORITY, UNUSED_RLOC_PRIORITY };
+    int ctr, ctr1, pos = 0;
+
+    locators[0][0] = NULL;
+    locators[1][0] = NULL;
+    locators[2][0] = NULL;
+
+    fb_locators_classify_in_4_6(map, fw_dev_parm->loc_loct, ipv4_locts,
+            &ipv4_count, ipv6_locts, &ipv6_count);
+
+    if (ipv4_count != 0){
+        min_priority[0] = fb_select_best_priority_locators(ipv4_locts,
+                ipv4_count, locators[0], is_mce);
+    }
+    if (ipv6_count != 0){
+        min_priority[1] = fb_select_best_priority_locators(ipv6_locts,
+                ipv6_count, locators[1], is_mce);
+    }
+    maglev_table_fill(&mt->v4_table, locators[0], fw_dev_parm->loc_loct);
+    maglev_table_fill(&mt->v6_table, locators[1], fw_dev_parm->loc_loct);
+
+    mt->table = NULL;
+    if (mt->v4_table.n_locators != 0 && mt->v6_table.n_locators != 0){
+        if (min_priority[0] < min_priority[1]){
+            mt->table = &mt->v4_table;
+        }else if (min_priority[0] > min_priority[1]){
+            mt->table = &mt->v6_table;
+        }else{
+            for (ctr = 0; ctr < 2; ctr++){
+                for (ctr1 = 0; locators[ctr][ctr1] != NULL; ctr1++){
+                    locators[2][pos++] = locators[ctr][ctr1];
+                }
+            }
+            locators[2][pos] = NULL;
+            mt->table = &mt->v4_v6_table;
+        }
+    }
+    maglev_table_fill(&mt->v4_v6_table, locators[2], fw_dev_parm->loc_loct);
+
+    maglev_tables_dump(mt, map, LDBG_1);
+
+    return (GOOD);
+}
+
+/*
+ * Fill the table with the NULL terminated list of 'locators'. Each locator
+ * goes through its own permutation of the positions of the table, obtained
+ * from the hash of its address, and claims in turns its next free position.
+ * The permutations don't depend on the rest of locators, so when a locator
+ * is removed, mainly its positions change of owner and the flows of the
+ * other locators keep their locator. Locators with a higher weight claim
+ * positions more often. As in flow_balancing, if all locators have weight 0
+ * all of them get the same number of positions and otherwise locators with
+ * weight 0 get none.
+ */
+static void
+maglev_table_fill(maglev_table_t *table, locator_t **locators,
+        glist_t *loc_loct)
+{
+    uint32_t offset[2 * FB_MAX_LOCATORS];
+    uint32_t skip[2 * FB_MAX_LOCATORS];
+    int weight[2 * FB_MAX_LOCATORS];
+    int credit[2 * FB_MAX_LOCATORS];
+    lisp_addr_t *ip_addr;
+    addr_key_t key;
+    int max_weight = 0;
+    int filled = 0;
+    int ctr, n = 0;
+
+    maglev_table_reset(table);
+
+    for (ctr = 0; locators[ctr] != NULL; ctr++){
+        if (locator_weight(locators[ctr]) > max_weight){
+            max_weight = locator_weight(locators[ctr]);
+        }
+    }
+    if (ctr == 0){
+        return;
+    }
+
+    table->locators = xmalloc(ctr * sizeof(locator_t *));
+    for (ctr = 0; locators[ctr] != NULL; ctr++){
+        if (max_weight != 0 && locator_weight(locators[ctr]) == 0){
+            continue;
+        }
+        weight[n] = max_weight != 0 ? locator_weight(locators[ctr]) : 1;
+        table->locators[n++] = locators[ctr];
+    }
+    table->n_locators = n;
+    if (n == 1){
+        return;
+    }
+    if (max_weight == 0){
+        max_weight = 1;
+    }
+
+    for (ctr = 0; ctr < n; ctr++){
+        memset(&key, 0, sizeof(addr_key_t));
+        ip_addr = fb_addr_get_fwd_ip_addr(locator_addr(table->locators[ctr]),
+                loc_loct);
+        if (ip_addr != NULL){
+            addr_key_from_lisp_addr(&key, ip_addr);
+        }
+        offset[ctr] = hashword((uint32_t *)&key, ADDR_KEY_WORDS,
+                MAGLEV_OFFSET_SEED) % MAGLEV_TABLE_SIZE;
+        skip[ctr] = hashword((uint32_t *)&key, ADDR_KEY_WORDS,
+                MAGLEV_SKIP_SEED) % (MAGLEV_TABLE_SIZE - 1) + 1;
+        credit[ctr] = 0;
+    }
+
+    /* Free positions are marked with the number of locators */
+    table->entries = xmalloc(MAGLEV_TABLE_SIZE);
+    memset(table->entries, n, MAGLEV_TABLE_SIZE);
+    while (filled < MAGLEV_TABLE_SIZE){
+        for (ctr = 0; ctr < n && filled < MAGLEV_TABLE_SIZE; ctr++){
+            credit[ctr] += weight[ctr];
+            if (credit[ctr] < max_weight){
+                continue;
+            }
+            credit[ctr] -= max_weight;
+            while (table->entries[offset[ctr]] != n){
+                offset[ctr] = (offset[ctr] + skip[ctr]) % MAGLEV_TABLE_SIZE;
+            }
+            table->entries[offset[ctr]] = ctr;
+            filled++;
+        }
+    }
+}
+
+static void
+maglev_table_reset(maglev_table_t *table)
+{
+    free(table->locators);
+    free(table->entries);
+    table->locators = NULL;
+    table->entries = NULL;
+    table->n_locators = 0;
+}
+
+static inline locator_t *
+maglev_table_lookup(maglev_table_t *table, uint32_t hash)
+{
+    if (table->entries == NULL){
+        return (table->locators[0]);
+    }
+    return (table->locators[table->entries[hash % MAGLEV_TABLE_SIZE]]);
+}
+
+static void
+maglev_table_dump(maglev_table_t *table, char *name, int log_level)
+{
+    int positions[2 * FB_MAX_LOCATORS];
+    char str[3000];
+    size_t str_size = sizeof(str);
+    int ctr;
+
+    snprintf(str, str_size, "  %s table (%d locators):  ", name,
+            table->n_locators);
+    for (ctr = 0; ctr < table->n_locators; ctr++){
+        positions[ctr] = table->entries ? 0 : MAGLEV_TABLE_SIZE;
+    }
+    for (ctr = 0; table->entries && ctr < MAGLEV_TABLE_SIZE; ctr++){
+        positions[table->entries[ctr]]++;
+    }
+    for (ctr = 0; ctr < table->n_locators; ctr++){
+        if (strlen(str) > 2900) {
+            snprintf(str + strlen(str),str_size - strlen(str), " ...");
+            break;
+        }
+        snprintf(str + strlen(str), str_size - strlen(str), " %s (%d/%d)  ",
+                lisp_addr_to_char(locator_addr(table->locators[ctr])),
+                positions[ctr], MAGLEV_TABLE_SIZE);
+    }
+    OOR_LOG(log_level, "%s", str);
+}
+
+/* Print the locators of the tables with the positions they own */
+static void
+maglev_tables_dump(maglev_tables_t *mt, mapping_t *map, int log_level)
+{
+    if (!is_loggable(log_level)) {
+        return;
+    }
+    OOR_LOG(log_level, "Maglev tables for %s: ",
+            lisp_addr_to_char(mapping_eid(map)));
+    maglev_table_dump(&mt->v4_table, "IPv4", log_level);
+    maglev_table_dump(&mt->v6_table, "IPv6", log_level);
+    if (mt->table != NULL){
+        maglev_table_dump(mt->table, "IPv4 & IPv6", log_level);
+    }
+}
+
+/*************************** Forward Select Function *************************/
+
+/* Select the source and destination RLOC from the maglev tables. As in
+ * flow_balancing, the destination RLOC is selected according to the AFI of
+ * the selected source RLOC */
+
+void
+maglev_get_fw_entry(void *fwd_dev_parm, void *src_map_parm, void *dst_map_parm,
+        packet_tuple_t *tuple, fwd_info_t *fwd_info)
+{
+    fb_dev_parm *dev_parm = (fb_dev_parm *)fwd_dev_parm;
+    maglev_tables_t *src_mt = (maglev_tables_t *)src_map_parm;
+    maglev_tables_t *dst_mt = (maglev_tables_t *)dst_map_parm;
+    maglev_table_t *src_table, *dst_table;
+    lisp_addr_t *src_ip_addr, *dst_ip_addr;
+    locator_t *src_loct, *dst_loct;
+    uint32_t hash;
+
+    if (dst_mt == NULL) {
+        OOR_LOG(LDBG_3, "maglev_get_fw_entry: No DST maglev tables");
+        return;
+    }
+
+    if (src_mt->table != NULL && dst_mt->table != NULL) {
+        src_table = src_mt->table;
+    } else if (src_mt->v6_table.n_locators != 0
+            && dst_mt->v6_table.n_locators != 0) {
+        src_table = &src_mt->v6_table;
+    } else if (src_mt->v4_table.n_locators != 0
+            && dst_mt->v4_table.n_locators != 0) {
+        src_table = &src_mt->v4_table;
+    } else {
+        if (src_mt->v4_table.n_locators == 0
+                && src_mt->v6_table.n_locators == 0) {
+            OOR_LOG(LDBG_3, "maglev_get_fw_entry: No SRC locators available");
+        } else if (dst_mt->v4_table.n_locators == 0
+                && dst_mt->v6_table.n_locators == 0) {
+            OOR_LOG(LDBG_3, "maglev_get_fw_entry: No DST locators available");
+        } else {
+            OOR_LOG(LDBG_3, "maglev_get_fw_entry: Source and destination "
+                    "RLOCs are not compatible");
+        }
+        return;
+    }
+
+    hash = pkt_tuple_hash(tuple);
+
+    src_loct = maglev_table_lookup(src_table, hash);
+    src_ip_addr = fb_addr_get_fwd_ip_addr(locator_addr(src_loct),
+            dev_parm->loc_loct);
+
+    /* decide dst afi based on src afi*/
+    switch (lisp_addr_ip_afi(src_ip_addr)) {
+    case (AF_INET):
+        dst_table = &dst_mt->v4_table;
+        break;
+    case (AF_INET6):
+        dst_table = &dst_mt->v6_table;
+        break;
+    default:
+        OOR_LOG(LDBG_2, "maglev_get_fw_entry: Unknown IP AFI %d",
+                lisp_addr_ip_afi(src_ip_addr));
+        return;
+    }
+
+    dst_loct = maglev_table_lookup(dst_table, hash);
+    dst_ip_addr = fb_addr_get_fwd_ip_addr(locator_addr(dst_loct),
+            dev_parm->loc_loct);
+
+    fwd_info->fwd_info = fwd_entry_new_init(src_ip_addr, dst_ip_addr,
+            tuple->iid, NULL);
+
+    OOR_LOG(LDBG_3, "maglev_get_fw_entry: EID: %s -> %s, protocol: %d, "
+            "port: %d -> %d\n  --> RLOC: %s -> %s",
+            lisp_addr_to_char(&(tuple->src_addr)),
+            lisp_addr_to_char(&(tuple->dst_addr)), tuple->protocol,
+            tuple->src_port, tuple->dst_port,
+            lisp_addr_to_char(src_ip_addr),
+            lisp_addr_to_char(dst_ip_addr));
+}
@@ -0,0 +1,57 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef MAGLEV_H_
+#define MAGLEV_H_
+
+#include "../fwd_policy.h"
+#include "../flow_balancing/flow_balancing.h"
+
+/* Number of positions of a lookup table. It is prime so the permutation of
+ * each locator goes through all the positions, and much bigger than the
+ * number of locators so few flows change of locator when a table is
+ * refilled */
+#define MAGLEV_TABLE_SIZE   1021
+
+/*
+ * Maglev lookup table of a set of locators. Each position holds the index in
+ * 'locators' of the locator used by the flows whose hash falls in it. Tables
+ * with a single locator have no positions.
+ */
+typedef struct maglev_table_ {
+    locator_t **locators;
+    uint8_t *entries;
+    int n_locators;
+} maglev_table_t;
+
+/*
+ * Used to select the locator to be used for an identifier, as the vectors
+ * of flow_balancing:
+ *  v4_table: If we just have IPv4 RLOCs
+ *  v6_table: If we just hace IPv6 RLOCs
+ *  table: If we have IPv4 & IPv6 RLOCs. Points to v4_table or v6_table when
+ *         only the locators of one afi have the best priority
+ */
+typedef struct maglev_tables_ {
+    maglev_table_t v4_table;
+    maglev_table_t v6_table;
+    maglev_table_t v4_v6_table;
+    maglev_table_t *table;
+} maglev_tables_t;
+
+#endif /* MAGLEV_H_ */
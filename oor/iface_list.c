@@ -29,6 +29,8 @@
 #include "iface_list.h"
 #include "iface_mgmt.h"
 #include "oor_external.h"
+#include "elibs/khash/khash.h"
+#include "lib/packets.h"
 #include "lib/routing_tables_lib.h"
 #include "lib/sockets.h"
 #include "lib/shash.h"
@@ -40,11 +42,40 @@
   int freeifaddrs(ifaddrs *addrlist);
 #endif
 
+static inline uint32_t
+iface_addr_hash(ip_addr_t *addr)
+{
+    switch (ip_addr_afi(addr)){
+    case AF_INET:
+        return (hashword((uint32_t *)ip_addr_get_v4(addr), 1, 2013));
+    case AF_INET6:
+        return (hashword((uint32_t *)ip_addr_get_v6(addr), 4, 2013));
+    default:
+        return (0);
+    }
+}
+
+static inline int
+iface_addr_equal(ip_addr_t *addr1, ip_addr_t *addr2)
+{
+    return (ip_addr_cmp(addr1, addr2) == 0);
+}
+
+KHASH_INIT(iface_addr, ip_addr_t *, iface_t *, 1, iface_addr_hash, iface_addr_equal)
+
 /* List with all the interfaces used by OOR */
 glist_t *interface_list = NULL;
 
 shash_t *iface_addr_ht = NULL;
 
+/* Interfaces indexed by their RLOC address. Kept up to date with the address
+ * changes so the data plane doesn't walk interface_list to find the output
+ * socket of an RLOC */
+static khash_t(iface_addr) *iface_addr_index = NULL;
+
+static void iface_addr_index_add(iface_t *iface, lisp_addr_t *addr);
+static void iface_addr_index_remove(iface_t *iface, lisp_addr_t *addr);
+
 int
 build_iface_addr_hash_table()
 {
@@ -92,6 +123,7 @@ int
 ifaces_init()
 {
     interface_list = glist_new_managed((glist_del_fct)iface_destroy);
+    iface_addr_index = kh_init(iface_addr);
     build_iface_addr_hash_table();
     return(GOOD);
 }
@@ -108,6 +140,9 @@ iface_destroy(iface_t *iface)
         close(iface->out_socket_v6);
     }
 
+    iface_addr_index_remove(iface, iface->ipv4_address);
+    iface_addr_index_remove(iface, iface->ipv6_address);
+
     /* Free data structure */
     free(iface->iface_name);
 
@@ -124,6 +159,8 @@ inline void
 ifaces_destroy()
 {
     glist_destroy(interface_list);
+    /* Interfaces remove their addresses from the index when destroyed */
+    kh_destroy(iface_addr, iface_addr_index);
 
     shash_destroy(iface_addr_ht);
 }
@@ -244,11 +281,13 @@ iface_setup_addr(iface_t *iface, int afi)
         return (ERR_AFI);
     }
 
+    iface_addr_index_remove(iface, *addr);
     *addr = get_iface_address(iface->iface_name, afi);
 
     if (lisp_addr_is_no_addr(*addr)) {
         return(BAD);
     }
+    iface_addr_index_add(iface, *addr);
 
     iface->status = UP;
     return(GOOD);
@@ -347,28 +386,67 @@ get_interface_from_index(int iface_index)
 iface_t *
 get_interface_with_address(lisp_addr_t *address)
 {
-    glist_entry_t * iface_it;
-    iface_t * iface;
+    khiter_t k;
 
-    glist_for_each_entry(iface_it,interface_list){
-        iface = (iface_t *)glist_entry_data(iface_it);
-        switch (lisp_addr_ip_afi(address)) {
-        case AF_INET:
-            if (iface->ipv4_address && lisp_addr_cmp(address, iface->ipv4_address) == 0) {
-                return (iface);
-            }
-            break;
-        case AF_INET6:
-            if (iface->ipv6_address && lisp_addr_cmp(address, iface->ipv6_address) == 0) {
-                return (iface);
-            }
-            break;
+    if (lisp_addr_lafi(address) == LM_AFI_IP) {
+        k = kh_get(iface_addr, iface_addr_index, lisp_addr_ip(address));
+        if (k != kh_end(iface_addr_index)) {
+            return (kh_value(iface_addr_index, k));
         }
     }
     OOR_LOG(LDBG_2,"get_interface_with_address: No interface found for the address %s", lisp_addr_to_char(address));
     return (NULL);
 }
 
+static void
+iface_addr_index_add(iface_t *iface, lisp_addr_t *addr)
+{
+    ip_addr_t *key;
+    khiter_t k;
+    int ret;
+
+    if (!addr || lisp_addr_lafi(addr) != LM_AFI_IP) {
+        return;
+    }
+
+    k = kh_get(iface_addr, iface_addr_index, lisp_addr_ip(addr));
+    if (k == kh_end(iface_addr_index)) {
+        key = ip_addr_new();
+        ip_addr_copy(key, lisp_addr_ip(addr));
+        k = kh_put(iface_addr, iface_addr_index, key, &ret);
+    }
+    kh_value(iface_addr_index, k) = iface;
+}
+
+static void
+iface_addr_index_remove(iface_t *iface, lisp_addr_t *addr)
+{
+    ip_addr_t *key;
+    khiter_t k;
+
+    if (!addr || lisp_addr_lafi(addr) != LM_AFI_IP) {
+        return;
+    }
+
+    k = kh_get(iface_addr, iface_addr_index, lisp_addr_ip(addr));
+    if (k == kh_end(iface_addr_index) || kh_value(iface_addr_index, k) != iface) {
+        return;
+    }
+    key = kh_key(iface_addr_index, k);
+    kh_del(iface_addr, iface_addr_index, k);
+    ip_addr_del(key);
+}
+
+/* Update the address index after the address of 'iface' has changed from
+ * 'old_addr' to 'new_addr' */
+void
+iface_addr_index_update(iface_t *iface, lisp_addr_t *old_addr,
+        lisp_addr_t *new_addr)
+{
+    iface_addr_index_remove(iface, old_addr);
+    iface_addr_index_add(iface, new_addr);
+}
+
 int *
 get_out_socket_ptr_from_address(lisp_addr_t *address)
 {
@@ -86,6 +86,8 @@ int iface_setup_addr(iface_t *iface, int afi);
 iface_t *get_interface(char *iface_name);
 iface_t *get_interface_from_index(int iface_index);
 iface_t *get_interface_with_address(lisp_addr_t *address);
+void iface_addr_index_update(iface_t *iface, lisp_addr_t *old_addr,
+        lisp_addr_t *new_addr);
 int *get_out_socket_ptr_from_address(lisp_addr_t *address);
 
 /* Print the interfaces and locators of the lisp node */
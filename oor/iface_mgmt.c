@@ -213,6 +213,7 @@ process_address_change(iface_t *iface, lisp_addr_t *new_addr)
 
     /* raise event to data plane */
     data_plane->datap_updated_addr(iface,iface_addr,new_addr);
+    iface_addr_index_update(iface, old_addr_cpy, new_addr_cpy);
 
     /* raise event in ctrl */
     ctrl_if_addr_update(lctrl, iface, old_addr_cpy, new_addr_cpy);
@@ -0,0 +1,101 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <arpa/inet.h>
+#include <stdio.h>
+
+#include "addr_key.h"
+#include "../defs.h"
+#include "../liblisp/lisp_lcaf.h"
+
+
+void
+addr_key_from_ip(addr_key_t *key, ip_addr_t *ip, uint32_t iid)
+{
+    int afi = ip_addr_afi(ip);
+
+    addr_key_set(key, afi, ip_addr_get_addr(ip),
+            ip_afi_to_default_mask(afi), iid);
+}
+
+void
+addr_key_from_ippref(addr_key_t *key, ip_prefix_t *ippref, uint32_t iid)
+{
+    ip_addr_t *ip = ip_prefix_addr(ippref);
+
+    addr_key_set(key, ip_addr_afi(ip), ip_addr_get_addr(ip),
+            ip_prefix_get_plen(ippref), iid);
+}
+
+/* Key of an IP, IP prefix or IID address. Returns BAD for other addresses */
+int
+addr_key_from_lisp_addr(addr_key_t *key, lisp_addr_t *laddr)
+{
+    lcaf_addr_t *lcaf;
+    lisp_addr_t *addr;
+    uint32_t iid = 0;
+
+    addr = laddr;
+    if (lisp_addr_lafi(laddr) == LM_AFI_LCAF) {
+        lcaf = lisp_addr_get_lcaf(laddr);
+        if (lcaf_addr_get_type(lcaf) != LCAF_IID) {
+            return (BAD);
+        }
+        iid = lcaf_iid_get_iid(lcaf);
+        addr = iid_type_get_addr(lcaf_addr_get_iid(lcaf));
+    }
+
+    switch (lisp_addr_lafi(addr)) {
+    case LM_AFI_IP:
+        addr_key_from_ip(key, lisp_addr_ip(addr), iid);
+        return (GOOD);
+    case LM_AFI_IPPREF:
+        addr_key_from_ippref(key, lisp_addr_get_ippref(addr), iid);
+        return (GOOD);
+    default:
+        return (BAD);
+    }
+}
+
+void
+addr_key_to_ip(addr_key_t *key, ip_addr_t *ip)
+{
+    ip_addr_init(ip, key->addr.u8, key->afi);
+}
+
+char *
+addr_key_to_char(addr_key_t *key)
+{
+    static char buf[2][INET6_ADDRSTRLEN + 24];
+    static int i = 0;
+    char addr[INET6_ADDRSTRLEN];
+
+    /* hack to allow more than one key per line */
+    i++; i = i % 2;
+    if (!inet_ntop(key->afi, key->addr.u8, addr, sizeof(addr))) {
+        sprintf(buf[i], "_UNKNOWN_");
+        return (buf[i]);
+    }
+    if (key->plen == addr_key_full_len(key)) {
+        snprintf(buf[i], sizeof(buf[i]), "[%u]%s", key->iid, addr);
+    } else {
+        snprintf(buf[i], sizeof(buf[i]), "[%u]%s/%u", key->iid, addr, key->plen);
+    }
+    return (buf[i]);
+}
@@ -0,0 +1,123 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef ADDR_KEY_H_
+#define ADDR_KEY_H_
+
+#include <stdint.h>
+#include <string.h>
+#include "../liblisp/lisp_address.h"
+
+/*
+ * Compact key for EIDs and RLOCs used by the data plane tables instead of
+ * lisp_addr_t. It has a fixed size and no pointers, and it is always fully
+ * written (address bits after the prefix length are zero), so keys can be
+ * hashed and compared as plain words. Conversions from lisp_addr_t and
+ * ip_addr_t are done where addresses leave the control plane.
+ */
+typedef struct addr_key {
+    uint32_t    iid;
+    uint16_t    afi;
+    uint8_t     plen;
+    uint8_t     pad;
+    union {
+        uint8_t     u8[16];
+        uint32_t    u32[4];
+        uint64_t    u64[2];
+    } addr;
+} addr_key_t;
+
+#define ADDR_KEY_WORDS  (sizeof(addr_key_t) / sizeof(uint32_t))
+
+/* Bob Jenkins' hashword, compiled in packets.c */
+uint32_t hashword(const uint32_t *k, size_t length, uint32_t initval);
+
+/* Set the key from the 'plen' first bits of the address in network byte
+ * order 'addr' */
+static inline void
+addr_key_set(addr_key_t *key, uint16_t afi, const void *addr, uint8_t plen,
+        uint32_t iid)
+{
+    int size = (afi == AF_INET) ? sizeof(struct in_addr) : sizeof(struct in6_addr);
+    int i;
+
+    key->iid = iid;
+    key->afi = afi;
+    key->plen = plen;
+    key->pad = 0;
+    key->addr.u64[0] = 0;
+    key->addr.u64[1] = 0;
+    memcpy(key->addr.u8, addr, size);
+    if (plen < size * 8) {
+        key->addr.u8[plen / 8] &= (uint8_t)(0xff00 >> (plen % 8));
+        for (i = plen / 8 + 1; i < size; i++) {
+            key->addr.u8[i] = 0;
+        }
+    }
+}
+
+static inline int
+addr_key_equal(const addr_key_t *k1, const addr_key_t *k2)
+{
+    const uint64_t *w1 = (const uint64_t *)k1;
+    const uint64_t *w2 = (const uint64_t *)k2;
+
+    /* No branches: compilers turn it into vector compares */
+    return (((w1[0] ^ w2[0]) | (w1[1] ^ w2[1]) | (w1[2] ^ w2[2])) == 0);
+}
+
+static inline uint32_t
+addr_key_hash(const addr_key_t *key)
+{
+    return (hashword((const uint32_t *)key, ADDR_KEY_WORDS, 2013));
+}
+
+/* Key of the tables indexed by a pair of addresses, such as the source and
+ * destination of the packets. Both keys have the IID of the pair */
+typedef struct addr_pair_key {
+    addr_key_t  src;
+    addr_key_t  dst;
+} addr_pair_key_t;
+
+static inline int
+addr_pair_key_equal(const addr_pair_key_t *k1, const addr_pair_key_t *k2)
+{
+    return (addr_key_equal(&k1->dst, &k2->dst)
+            && addr_key_equal(&k1->src, &k2->src));
+}
+
+static inline uint32_t
+addr_pair_key_hash(const addr_pair_key_t *key)
+{
+    return (hashword((const uint32_t *)key, 2 * ADDR_KEY_WORDS, 2013));
+}
+
+static inline int
+addr_key_full_len(const addr_key_t *key)
+{
+    return (key->afi == AF_INET ? 32 : 128);
+}
+
+void addr_key_from_ip(addr_key_t *key, ip_addr_t *ip, uint32_t iid);
+void addr_key_from_ippref(addr_key_t *key, ip_prefix_t *ippref, uint32_t iid);
+int addr_key_from_lisp_addr(addr_key_t *key, lisp_addr_t *laddr);
+void addr_key_to_ip(addr_key_t *key, ip_addr_t *ip);
+char *addr_key_to_char(addr_key_t *key);
+
+#endif /* ADDR_KEY_H_ */
@@ -47,6 +47,88 @@ ip_checksum(uint16_t *buffer, int size)
     return ((uint16_t) (~cksum));
 }
 
+/*
+ * Incrementally update a one's complement checksum when the 16-bit aligned
+ * region 'old' of 'len' bytes is replaced by 'new':
+ *      HC' = ~(~HC + ~m + m')     (RFC 1624, eqn. 3)
+ */
+uint16_t
+cksum_incr_update(uint16_t cksum, const void *old, const void *new, int len)
+{
+    const uint16_t *o = old;
+    const uint16_t *n = new;
+    uint32_t sum = (uint16_t)~cksum;
+
+    while (len > 1) {
+        sum += (uint16_t)~(*o++);
+        sum += *n++;
+        len -= sizeof(uint16_t);
+    }
+
+    while (sum >> 16) {
+        sum = (sum & 0xffff) + (sum >> 16);
+    }
+
+    return ((uint16_t) (~sum));
+}
+
+/* Add the 'len' bytes of 'buf' to the one's complement partial sum 'sum' */
+uint32_t
+cksum_add(uint32_t sum, const void *buf, int len)
+{
+    const uint16_t *b = buf;
+    uint16_t last = 0;
+
+    sum = (sum & 0xffff) + (sum >> 16);
+    while (len > 1) {
+        sum += *b++;
+        len -= sizeof(uint16_t);
+    }
+    if (len) {
+        *(uint8_t *)&last = *(uint8_t *)b;
+        sum += last;
+    }
+
+    return (sum);
+}
+
+/* Fold a partial sum to 16 bits. The result is not complemented */
+uint16_t
+cksum_fold(uint32_t sum)
+{
+    while (sum >> 16) {
+        sum = (sum & 0xffff) + (sum >> 16);
+    }
+    return ((uint16_t)sum);
+}
+
+/* Partial sum of the IPv4 or IPv6 pseudo header of a transport segment of
+ * 'len' bytes and protocol 'proto' */
+uint32_t
+cksum_pseudo_hdr(void *iphdr, int afi, uint8_t proto, int len)
+{
+    struct ip *iph;
+    struct ip6_hdr *ip6h;
+    uint32_t sum = 0;
+
+    switch (afi) {
+    case AF_INET:
+        iph = (struct ip *)iphdr;
+        sum = cksum_add(sum, &iph->ip_src, 2 * sizeof(struct in_addr));
+        break;
+    case AF_INET6:
+        ip6h = (struct ip6_hdr *)iphdr;
+        sum = cksum_add(sum, &ip6h->ip6_src, 2 * sizeof(struct in6_addr));
+        break;
+    default:
+        return (0);
+    }
+    sum += htons(proto);
+    sum += htons(len);
+
+    return (sum);
+}
+
 /*
  *
  *  Calculate the IPv4 UDP checksum (calculated with the whole packet).
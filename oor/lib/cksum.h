@@ -26,6 +26,17 @@
 
 uint16_t ip_checksum(uint16_t *buffer, int size);
 
+/* Update a checksum after replacing the 16-bit aligned bytes of 'old' by the
+ * ones of 'new' (RFC 1624) */
+uint16_t cksum_incr_update(uint16_t cksum, const void *old, const void *new,
+        int len);
+
+/* One's complement sum helpers. The checksum of a buffer is
+ * ~cksum_fold(cksum_add(0, buf, len)) */
+uint32_t cksum_add(uint32_t sum, const void *buf, int len);
+uint16_t cksum_fold(uint32_t sum);
+uint32_t cksum_pseudo_hdr(void *iphdr, int afi, uint8_t proto, int len);
+
 /* Calculate the IPv4 or IPv6 UDP checksum */
 uint16_t udp_checksum(struct udphdr *udph, int udp_len, void *iphdr, int afi);
 
@@ -22,6 +22,10 @@
 #include "oor_log.h"
 #include "mem_util.h"
 
+static mem_slab_t glist_slab = MEM_SLAB_INITIALIZER("glist", glist_t);
+static mem_slab_t glist_entry_slab = MEM_SLAB_INITIALIZER("glist_entry",
+        glist_entry_t);
+
 void
 glist_init_complete(glist_t *lst, glist_cmp_fct cmp_fct, glist_del_fct del_fct)
 {
@@ -54,7 +58,7 @@ glist_t *
 glist_new_complete(glist_cmp_fct cmp_fct, glist_del_fct del_fct)
 {
     glist_t *glist = NULL;
-    glist = xzalloc(sizeof(glist_t));
+    glist = mem_slab_alloc(&glist_slab);
 
     glist_init_complete(glist, cmp_fct, del_fct);
     return(glist);
@@ -131,7 +135,7 @@ glist_add(void *data, glist_t *glist)
     int ctr = 0;
     int cmp = 0;
 
-    new = xzalloc(sizeof(glist_entry_t));
+    new = mem_slab_alloc(&glist_entry_slab);
     new->data = data;
     list_init(&new->list);
 
@@ -145,7 +149,7 @@ glist_add(void *data, glist_t *glist)
                 if( cmp == 2){
                     break;
                 }else if (cmp < 0){
-                    free(new);
+                    mem_slab_free(&glist_entry_slab, new);
                     return (BAD);
                 }
                 ctr++;
@@ -181,7 +185,7 @@ glist_add_tail(void *data, glist_t *glist)
         return(BAD);
     }
 
-    new = xzalloc(sizeof(glist_entry_t));
+    new = mem_slab_alloc(&glist_entry_slab);
     new->data = data;
     list_init(&(new->list));
 
@@ -262,7 +266,7 @@ glist_extract(glist_entry_t *entry, glist_t *list)
 
     list_remove(&(entry->list));
 
-    free(entry);
+    mem_slab_free(&glist_entry_slab, entry);
     list->size--;
 }
 
@@ -286,7 +290,7 @@ glist_remove(glist_entry_t *entry, glist_t *list)
         (*list->del_fct)(entry->data);
     }
 
-    free(entry);
+    mem_slab_free(&glist_entry_slab, entry);
     list->size--;
 }
 
@@ -377,7 +381,7 @@ glist_destroy(glist_t *lst)
     }
 
     glist_remove_all(lst);
-    free(lst);
+    mem_slab_free(&glist_slab, lst);
 }
 
 
@@ -17,6 +17,7 @@
  *
  */
 
+#include <inttypes.h>
 #include <stdint.h>
 #include <stdlib.h>
 
@@ -67,12 +68,21 @@ lbuf_init(lbuf_t *b, uint32_t size)
     lbuf_use(b, size ? xzalloc(size) : NULL, size);
 }
 
+/* Memory of a pooled lbuf, allocated after the lbuf itself */
+#define LBUF_POOL_HDR   ((sizeof(lbuf_t) + 15) & ~(size_t)15)
+#define lbuf_pool_mem(_b) ((uint8_t *)(_b) + LBUF_POOL_HDR)
+
+static void lbuf_pool_put(lbuf_t *);
+
 void
 lbuf_uninit(lbuf_t *b)
 {
     if (b) {
         if (b->source == LBUF_MALLOC) {
             free(b->base);
+        } else if (b->source == LBUF_POOL && b->base != lbuf_pool_mem(b)) {
+            /* Data moved to the heap when the lbuf grew */
+            free(b->base);
         }
     }
 }
@@ -90,6 +100,10 @@ inline void
 lbuf_del(lbuf_t *b)
 {
     if (b) {
+        if (b->source == LBUF_POOL) {
+            lbuf_pool_put(b);
+            return;
+        }
         lbuf_uninit(b);
         free(b);
     }
@@ -112,12 +126,19 @@ lbuf_resize_(lbuf_t *b, uint32_t new_headroom, size_t new_tailroom)
     uint32_t new_allocated = new_headroom + b->size + new_tailroom;
     uint32_t diff_offset = new_headroom - lbuf_headroom(b);
 
-    if (new_headroom == lbuf_headroom(b)) {
+    if (new_headroom == lbuf_headroom(b) && b->source == LBUF_MALLOC) {
         b->base = xrealloc(b->base, new_allocated);
     } else {
         new_base = xmalloc(new_allocated);
         memcpy((uint8_t *)new_base + new_headroom, b->data, b->size);
-        free(b->base);
+        /* Only the heap memory is released. The memory of a pooled lbuf
+         * is kept with it */
+        lbuf_uninit(b);
+        if (b->source == LBUF_STACK) {
+            b->source = LBUF_MALLOC;
+        } else if (b->source == LBUF_POOL) {
+            b->pool->resized++;
+        }
         b->base = new_base;
         if (b->ip != UINT16_MAX){
             b->ip = b->ip + diff_offset;
@@ -206,8 +227,15 @@ lbuf_reserve(lbuf_t *b, uint32_t size)
 lbuf_t *
 lbuf_clone(lbuf_t *b)
 {
-    lbuf_t *new_buf = lbuf_new(b->size);
-    lbuf_put(new_buf->data, b->data, b->size);
+    /* Same headroom, so the header offsets are still valid and the headers
+     * can be pushed as in the original */
+    lbuf_t *new_buf = lbuf_new_with_headroom(b->size, lbuf_headroom(b));
+    lbuf_put(new_buf, b->data, b->size);
+    new_buf->ip = b->ip;
+    new_buf->udp = b->udp;
+    new_buf->lhdr = b->lhdr;
+    new_buf->l3 = b->l3;
+    new_buf->l4 = b->l4;
     new_buf->lisp = b->lisp;
     return new_buf;
 }
@@ -283,3 +311,90 @@ inline int lbuf_point_to_lisp(lbuf_t *b)
 
     return (GOOD);
 }
+
+
+/* Pools in use, for the statistics */
+static lbuf_pool_t *pools = NULL;
+
+static void
+lbuf_pool_register(lbuf_pool_t *pool)
+{
+#ifndef MEM_NO_SLAB
+    size_t stride = LBUF_POOL_HDR + pool->headroom + pool->size;
+    uint8_t *block;
+    lbuf_t *b;
+    int i;
+#endif
+
+    list_init(&pool->free);
+    pool->next = pools;
+    pools = pool;
+    pool->registered = TRUE;
+
+#ifndef MEM_NO_SLAB
+    block = xmalloc(stride * pool->n_bufs);
+    for (i = 0; i < pool->n_bufs; i++) {
+        b = (lbuf_t *)(block + i * stride);
+        b->pool = pool;
+        list_push_back(&pool->free, &b->list);
+    }
+#endif
+}
+
+/* Get a zeroed lbuf from 'pool'. It must be released with lbuf_del */
+lbuf_t *
+lbuf_pool_get(lbuf_pool_t *pool)
+{
+    lbuf_t *b;
+    uint32_t allocated = pool->headroom + pool->size;
+
+    if (!pool->registered) {
+        lbuf_pool_register(pool);
+    }
+
+    pool->gets++;
+    if (list_is_empty(&pool->free)) {
+        pool->exhausted++;
+        return (lbuf_new_with_headroom(pool->size, pool->headroom));
+    }
+
+    b = CONTAINER_OF(list_pop_front(&pool->free), lbuf_t, list);
+    memset(lbuf_pool_mem(b), 0, allocated);
+    lbuf_use__(b, lbuf_pool_mem(b), allocated, LBUF_POOL);
+    b->data = (uint8_t *)b->base + pool->headroom;
+
+    if (++pool->in_use > pool->max_in_use) {
+        pool->max_in_use = pool->in_use;
+    }
+    return (b);
+}
+
+static void
+lbuf_pool_put(lbuf_t *b)
+{
+    lbuf_pool_t *pool = b->pool;
+
+    lbuf_uninit(b);
+    list_push_front(&pool->free, &b->list);
+    pool->in_use--;
+}
+
+/* Log the usage of the lbuf pools */
+void
+lbuf_pool_stats_dump(int log_level)
+{
+    lbuf_pool_t *pool;
+
+    if (is_loggable(log_level) == FALSE) {
+        return;
+    }
+
+    OOR_LOG(log_level, "Lbuf pool          Size  Bufs    In use       Max"
+            "             Gets     Exhausted       Resized");
+    for (pool = pools; pool != NULL; pool = pool->next) {
+        OOR_LOG(log_level, "%-16s %6u %5u %9u %9u %16"PRIu64" %13"PRIu64
+                " %13"PRIu64, pool->name, pool->headroom + pool->size,
+                pool->n_bufs, pool->in_use, pool->max_in_use, pool->gets,
+                pool->exhausted, pool->resized);
+    }
+}
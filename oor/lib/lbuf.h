@@ -30,9 +30,12 @@
 
 typedef enum lbuf_source {
     LBUF_MALLOC,
-    LBUF_STACK
+    LBUF_STACK,
+    LBUF_POOL
 } lbuf_source_e;
 
+struct lbuf_pool;
+
 struct lbuf {
     struct ovs_list list;      /* for queueing, to be implemented*/
 
@@ -49,12 +52,42 @@ struct lbuf {
     uint16_t lisp;              /* lisp payload offset */
 
     lbuf_source_e source;       /* source of memory allocated as 'base' */
+    struct lbuf_pool *pool;     /* pool the lbuf returns to if LBUF_POOL */
     void *base;                 /* start of allocated space */
     void *data;                 /* start of in-use space */
 };
 
 typedef struct lbuf lbuf_t;
 
+/*
+ * Pool of lbufs of 'size' bytes with 'headroom' bytes reserved in front of
+ * the data, for the headers pushed when the message is encapsulated. Each
+ * lbuf is allocated together with its memory, 'n_bufs' of them the first
+ * time the pool is used, and lbuf_del returns it to the pool. When the pool
+ * is exhausted the lbufs are allocated with malloc, and the event counted.
+ * A pooled lbuf can still grow: its data is moved to the heap until it is
+ * returned. With -DMEM_NO_SLAB the pools are empty and every lbuf comes from
+ * malloc.
+ */
+typedef struct lbuf_pool {
+    const char          *name;
+    uint32_t            size;
+    uint32_t            headroom;
+    uint32_t            n_bufs;
+    struct ovs_list     free;           /* Free lbufs, linked by 'list' */
+    struct lbuf_pool    *next;          /* List of pools in use */
+    uint8_t             registered;
+    /* Statistics */
+    uint64_t            gets;
+    uint64_t            exhausted;
+    uint64_t            resized;
+    uint32_t            in_use;
+    uint32_t            max_in_use;
+} lbuf_pool_t;
+
+#define LBUF_POOL_INITIALIZER(_name, _size, _headroom, _n_bufs) \
+    { _name, _size, _headroom, _n_bufs, { NULL, NULL }, NULL, 0, 0, 0, 0, 0, 0 }
+
 void lbuf_use(lbuf_t *, void *, uint32_t);
 void lbuf_use_stack(lbuf_t *, void *, uint32_t);
 void lbuf_init(lbuf_t *, uint32_t);
@@ -64,6 +97,9 @@ lbuf_t *lbuf_new_with_headroom(uint32_t, uint32_t);
 lbuf_t *lbuf_clone(lbuf_t *);
 void lbuf_del(lbuf_t *);
 
+lbuf_t *lbuf_pool_get(lbuf_pool_t *);
+void lbuf_pool_stats_dump(int log_level);
+
 
 static inline void *lbuf_at(const lbuf_t *, uint32_t, uint32_t);
 static inline void *lbuf_tail(const lbuf_t *);
@@ -64,3 +64,29 @@ lisp_reg_site_del(lisp_reg_site_t *rs)
     mapping_del(rs->site_map);
     free(rs);
 }
+
+lisp_subscriber_t *
+lisp_subscriber_new_init(lisp_addr_t *itr_rloc, lisp_xtr_id *xtr_id,
+        lisp_site_id site_id, char *key, uint64_t nonce)
+{
+    lisp_subscriber_t *sub;
+
+    sub = xzalloc(sizeof(lisp_subscriber_t));
+    sub->itr_rloc = lisp_addr_clone(itr_rloc);
+    memcpy(&sub->xtr_id, xtr_id, sizeof(lisp_xtr_id));
+    sub->site_id = site_id;
+    sub->key = strdup(key);
+    sub->nonce = nonce;
+
+    return(sub);
+}
+
+void
+lisp_subscriber_del(lisp_subscriber_t *sub)
+{
+    if (!sub)
+        return;
+    lisp_addr_del(sub->itr_rloc);
+    free(sub->key);
+    free(sub);
+}
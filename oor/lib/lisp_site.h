@@ -36,11 +36,26 @@ typedef struct lisp_reg_site {
     mapping_t *site_map;
 } lisp_reg_site_t;
 
+/* ITR subscribed to the changes of a registered mapping (LISP Pub/Sub) */
+typedef struct lisp_subscriber {
+    lisp_addr_t *itr_rloc;
+    lisp_xtr_id xtr_id;
+    lisp_site_id site_id;
+    /* Key of the site of the ITR used to sign the Map-Notify messages */
+    char *key;
+    /* Nonce of the last Map-Notify sent to the ITR */
+    uint64_t nonce;
+    time_t expires;
+} lisp_subscriber_t;
+
 lisp_site_prefix_t *lisp_site_prefix_init(lisp_addr_t *eid_prefix, uint32_t iid,
         int key_type, char *key, uint8_t more_specifics, uint8_t proxy_reply,
         uint8_t merge);
 void lisp_site_prefix_del(lisp_site_prefix_t *sp);
 void lisp_reg_site_del(lisp_reg_site_t *rs);
+lisp_subscriber_t *lisp_subscriber_new_init(lisp_addr_t *itr_rloc,
+        lisp_xtr_id *xtr_id, lisp_site_id site_id, char *key, uint64_t nonce);
+void lisp_subscriber_del(lisp_subscriber_t *sub);
 
 static inline lisp_addr_t *lsite_prefix(lisp_site_prefix_t *ls) {
     return(ls->eid_prefix);
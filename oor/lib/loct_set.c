@@ -0,0 +1,290 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "loct_set.h"
+#include "addr_key.h"
+#include "mem_util.h"
+#include "oor_log.h"
+#include "../elibs/khash/khash.h"
+
+#define loct_set_key_hash(_s) ((_s)->hash)
+#define loct_set_key_equal(_a, _b) ((_a) == (_b) || ((_a)->hash == (_b)->hash \
+        && loct_set_lists_equal((_a)->locators_lists, (_b)->locators_lists)))
+
+static int loct_set_lists_equal(glist_t *lists1, glist_t *lists2);
+
+KHASH_INIT(loct_set, loct_set_t *, char, 0, loct_set_key_hash, loct_set_key_equal)
+
+/* All the sets in use */
+static khash_t(loct_set) *loct_sets = NULL;
+
+
+static uint32_t
+loct_set_hash_str(const char *str, uint32_t hash)
+{
+    while (*str != '\0') {
+        hash = hash * 31 + (uint8_t)*str++;
+    }
+    return (hash);
+}
+
+/* Hash of the locators of a mapping. The state of the locators is not used:
+ * it is learnt by the xTR and not part of the received mapping */
+static uint32_t
+loct_set_hash_lists(glist_t *lists)
+{
+    glist_entry_t *it_list;
+    glist_entry_t *it_loct;
+    locator_t *loct;
+    addr_key_t key;
+    uint32_t words[2];
+    uint32_t hash = 0;
+
+    glist_for_each_entry(it_list, lists){
+        glist_for_each_entry(it_loct, (glist_t *)glist_entry_data(it_list)){
+            loct = (locator_t *)glist_entry_data(it_loct);
+            words[0] = loct->priority << 24 | loct->weight << 16
+                    | loct->mpriority << 8 | loct->mweight;
+            words[1] = loct->L_bit << 8 | loct->R_bit;
+            hash = hashword(words, 2, hash);
+            if (addr_key_from_lisp_addr(&key, locator_addr(loct)) == GOOD){
+                hash = hashword((uint32_t *)&key,
+                        sizeof(addr_key_t) / sizeof(uint32_t), hash);
+            }else{
+                hash = loct_set_hash_str(lisp_addr_to_char(locator_addr(loct)),
+                        hash);
+            }
+        }
+    }
+
+    return (hash);
+}
+
+static int
+loct_set_lists_equal(glist_t *lists1, glist_t *lists2)
+{
+    glist_t *loct_list1;
+    glist_t *loct_list2;
+    glist_entry_t *it_list1;
+    glist_entry_t *it_list2;
+    glist_entry_t *it_loct1;
+    glist_entry_t *it_loct2;
+    locator_t *loct1;
+    locator_t *loct2;
+
+    if (glist_size(lists1) != glist_size(lists2)){
+        return (FALSE);
+    }
+
+    it_list2 = glist_first(lists2);
+    glist_for_each_entry(it_list1, lists1){
+        loct_list1 = (glist_t *)glist_entry_data(it_list1);
+        loct_list2 = (glist_t *)glist_entry_data(it_list2);
+        if (glist_size(loct_list1) != glist_size(loct_list2)){
+            return (FALSE);
+        }
+        it_loct2 = glist_first(loct_list2);
+        glist_for_each_entry(it_loct1, loct_list1){
+            loct1 = (locator_t *)glist_entry_data(it_loct1);
+            loct2 = (locator_t *)glist_entry_data(it_loct2);
+            if (locator_cmp(loct1, loct2) != 0
+                    || loct1->L_bit != loct2->L_bit
+                    || loct1->R_bit != loct2->R_bit){
+                return (FALSE);
+            }
+            it_loct2 = glist_next(it_loct2);
+        }
+        it_list2 = glist_next(it_list2);
+    }
+
+    return (TRUE);
+}
+
+static void
+loct_set_free(loct_set_t *lset)
+{
+    loct_vec_reset(&lset->locts);
+    if (lset->fwd_info != NULL){
+        lset->fwd_info_del(lset->fwd_info);
+    }
+    free(lset);
+}
+
+static void
+loct_set_table_remove(loct_set_t *lset)
+{
+    khiter_t k;
+
+    k = kh_get(loct_set, loct_sets, lset);
+    if (k != kh_end(loct_sets)){
+        kh_del(loct_set, loct_sets, k);
+    }
+}
+
+/* Make the mapping use the set with its locators, creating it if there is
+ * none. The locators of the mapping are freed when an equal set already
+ * exists, so pointers to them are not valid after the call. Mappings without
+ * locators are not interned (BAD is returned) */
+int
+loct_set_intern(mapping_t *m)
+{
+    loct_set_t key;
+    loct_set_t *lset;
+    khiter_t k;
+    int ret;
+
+    if (m->lset != NULL){
+        return (GOOD);
+    }
+    if (m->locator_count == 0){
+        return (BAD);
+    }
+    if (loct_sets == NULL){
+        loct_sets = kh_init(loct_set);
+    }
+    /* The locators of the mapping go to the set or are freed */
+    loct_vec_reset(&m->locts);
+
+    key.locators_lists = m->locators_lists;
+    key.hash = loct_set_hash_lists(m->locators_lists);
+
+    k = kh_get(loct_set, loct_sets, &key);
+    if (k != kh_end(loct_sets)){
+        lset = kh_key(loct_sets, k);
+        lset->refcnt++;
+        glist_destroy(m->locators_lists);
+        OOR_LOG(LDBG_3, "loct_set_intern: The mapping %s shares its locators "
+                "with %d other mappings", lisp_addr_to_char(mapping_eid(m)),
+                lset->refcnt - 1);
+    }else{
+        lset = xzalloc(sizeof(loct_set_t));
+        lset->locators_lists = m->locators_lists;
+        lset->locator_count = m->locator_count;
+        lset->hash = key.hash;
+        lset->refcnt = 1;
+        kh_put(loct_set, loct_sets, lset, &ret);
+    }
+
+    m->lset = lset;
+    m->locators_lists = lset->locators_lists;
+    m->locator_count = lset->locator_count;
+
+    return (GOOD);
+}
+
+/* Give the mapping its own list of locators, a copy of the ones of its set
+ * if 'keep_locators' is TRUE or an empty list otherwise */
+void
+loct_set_unshare(mapping_t *m, uint8_t keep_locators)
+{
+    loct_set_t *lset = m->lset;
+    glist_entry_t *it_list;
+    glist_t *loct_list;
+
+    if (lset == NULL){
+        return;
+    }
+    m->lset = NULL;
+
+    /* Last user of the set: take its locators */
+    if (lset->refcnt == 1){
+        loct_set_table_remove(lset);
+        if (!keep_locators){
+            glist_remove_all(m->locators_lists);
+            m->locator_count = 0;
+        }
+        loct_set_free(lset);
+        return;
+    }
+
+    m->locators_lists = glist_new_complete(
+            (glist_cmp_fct) locator_list_cmp_afi,
+            (glist_del_fct) glist_destroy);
+    if (keep_locators){
+        glist_for_each_entry(it_list, lset->locators_lists){
+            loct_list = locator_list_clone((glist_t *)glist_entry_data(it_list));
+            if (loct_list != NULL){
+                glist_add(loct_list, m->locators_lists);
+            }
+        }
+    }else{
+        m->locator_count = 0;
+    }
+    loct_set_release(lset);
+}
+
+void
+loct_set_release(loct_set_t *lset)
+{
+    if (--lset->refcnt > 0){
+        return;
+    }
+    loct_set_table_remove(lset);
+    glist_destroy(lset->locators_lists);
+    loct_set_free(lset);
+}
+
+/* Forwarding information of the set calculated by 'owner' */
+void *
+loct_set_fwd_info(loct_set_t *lset, void *owner)
+{
+    if (lset->fwd_info_owner != owner){
+        return (NULL);
+    }
+    return (lset->fwd_info);
+}
+
+/* Store the forwarding information calculated by 'owner' for the set. Only
+ * one instance of the forwarding policy can store information in a set */
+int
+loct_set_set_fwd_info(loct_set_t *lset, void *owner, void *fwd_info,
+        loct_set_fwd_info_del_fct del_fct)
+{
+    if (lset->fwd_info != NULL){
+        if (lset->fwd_info_owner != owner){
+            return (BAD);
+        }
+        if (lset->fwd_info != fwd_info){
+            lset->fwd_info_del(lset->fwd_info);
+        }
+    }
+    lset->fwd_info = fwd_info;
+    lset->fwd_info_owner = owner;
+    lset->fwd_info_del = del_fct;
+
+    return (GOOD);
+}
+
+void
+loct_set_table_stats(uint32_t *nsets, uint32_t *nrefs)
+{
+    khiter_t k;
+
+    *nsets = 0;
+    *nrefs = 0;
+    if (loct_sets == NULL){
+        return;
+    }
+    for (k = kh_begin(loct_sets); k != kh_end(loct_sets); ++k){
+        if (kh_exist(loct_sets, k)){
+            (*nsets)++;
+            *nrefs += kh_key(loct_sets, k)->refcnt;
+        }
+    }
+}
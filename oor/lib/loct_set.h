@@ -0,0 +1,59 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef LOCT_SET_H_
+#define LOCT_SET_H_
+
+#include "../liblisp/lisp_mapping.h"
+
+/*
+ * Interned sets of locators. Map-cache mappings with the same locators
+ * (address, priority, weight and flags) point to a single set, reference
+ * counted, instead of keeping their own copy. The locators, and so their
+ * reachability state, are common to all the mappings of the set. A mapping
+ * never modifies the locators of a set: it gets its own copy first
+ * (loct_set_unshare).
+ */
+
+typedef void (*loct_set_fwd_info_del_fct)(void *);
+
+typedef struct loct_set {
+    glist_t                     *locators_lists; //<glist_t *>
+    uint16_t                    locator_count;
+    uint32_t                    hash;
+    uint32_t                    refcnt;
+    /* Flat copy of the locators, common to all the mappings of the set */
+    loct_vec_t                  locts;
+
+    /* Forwarding information calculated for the set by the instance of the
+     * forwarding policy 'fwd_info_owner' */
+    void                        *fwd_info;
+    void                        *fwd_info_owner;
+    loct_set_fwd_info_del_fct   fwd_info_del;
+} loct_set_t;
+
+int loct_set_intern(mapping_t *m);
+void loct_set_unshare(mapping_t *m, uint8_t keep_locators);
+void loct_set_release(loct_set_t *lset);
+void *loct_set_fwd_info(loct_set_t *lset, void *owner);
+int loct_set_set_fwd_info(loct_set_t *lset, void *owner, void *fwd_info,
+        loct_set_fwd_info_del_fct del_fct);
+void loct_set_table_stats(uint32_t *nsets, uint32_t *nrefs);
+
+#endif /* LOCT_SET_H_ */
@@ -0,0 +1,350 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "lpm_trie.h"
+#include "../defs.h"
+
+#define LPM_MAX_LEVELS  (128 / LPM_STRIDE)
+
+
+static void
+lpm_map_set_base(const uint64_t *map, uint8_t *base)
+{
+    int i;
+
+    base[0] = 0;
+    for (i = 1; i < LPM_MAP_WORDS; i++) {
+        base[i] = base[i - 1] + __builtin_popcountll(map[i - 1]);
+    }
+}
+
+static inline size_t
+lpm_node_size(int n_slots)
+{
+    return (sizeof(lpm_node_t) + n_slots * sizeof(void *));
+}
+
+static lpm_node_t *
+lpm_node_new(lpm_trie_t *t)
+{
+    lpm_node_t *node;
+
+    /* A single run without data */
+    node = xzalloc(lpm_node_size(1));
+    node->n_leaves = 1;
+    node->leaf_map[0] = 1;
+    lpm_map_set_base(node->leaf_map, node->leaf_base);
+    t->mem += lpm_node_size(1);
+    return (node);
+}
+
+static void
+lpm_node_del(lpm_trie_t *t, lpm_node_t *node)
+{
+    int i;
+
+    for (i = 0; i < node->n_children; i++) {
+        lpm_node_del(t, node->slots[i]);
+    }
+    t->mem -= lpm_node_size(node->n_children + node->n_leaves)
+            + node->n_pfxs * sizeof(lpm_pfx_t);
+    free(node->pfxs);
+    free(node);
+}
+
+/* Reallocate the node referenced by 'ref' to hold 'n_slots' slots */
+static lpm_node_t *
+lpm_node_resize(lpm_trie_t *t, lpm_node_t **ref, int n_slots)
+{
+    lpm_node_t *node = *ref;
+
+    t->mem += lpm_node_size(n_slots)
+            - lpm_node_size(node->n_children + node->n_leaves);
+    node = xrealloc(node, lpm_node_size(n_slots));
+    *ref = node;
+    return (node);
+}
+
+/* Recompute the runs of leaves of a node from the prefixes ending in it */
+static void
+lpm_node_build_leaves(lpm_trie_t *t, lpm_node_t **ref)
+{
+    void *slot_data[LPM_SLOTS];
+    uint8_t slot_len[LPM_SLOTS];
+    uint64_t leaf_map[LPM_MAP_WORDS];
+    lpm_node_t *node = *ref;
+    lpm_pfx_t *pfx;
+    int i, s, first, last, n;
+
+    memset(slot_data, 0, sizeof(slot_data));
+    memset(slot_len, 0, sizeof(slot_len));
+    for (i = 0; i < node->n_pfxs; i++) {
+        pfx = &node->pfxs[i];
+        first = pfx->bits << (LPM_STRIDE - pfx->len);
+        last = first + (1 << (LPM_STRIDE - pfx->len));
+        for (s = first; s < last; s++) {
+            if (pfx->len > slot_len[s]) {
+                slot_len[s] = pfx->len;
+                slot_data[s] = pfx->data;
+            }
+        }
+    }
+
+    memset(leaf_map, 0, sizeof(leaf_map));
+    n = 0;
+    for (s = 0; s < LPM_SLOTS; s++) {
+        if (s == 0 || slot_data[s] != slot_data[s - 1]) {
+            leaf_map[s >> 6] |= 1ULL << (s & 63);
+            slot_data[n++] = slot_data[s];
+        }
+    }
+
+    node = lpm_node_resize(t, ref, node->n_children + n);
+    memcpy(node->leaf_map, leaf_map, sizeof(leaf_map));
+    lpm_map_set_base(node->leaf_map, node->leaf_base);
+    memcpy(&node->slots[node->n_children], slot_data, n * sizeof(void *));
+    node->n_leaves = n;
+}
+
+/* Return the reference to the child of a node in 'slot' or NULL */
+static lpm_node_t **
+lpm_node_child(lpm_node_t *node, int slot)
+{
+    if (!lpm_map_test(node->child_map, slot)) {
+        return (NULL);
+    }
+    return ((lpm_node_t **)&node->slots[lpm_map_rank(node->child_map, node->child_base, slot)]);
+}
+
+static lpm_node_t **
+lpm_node_add_child(lpm_trie_t *t, lpm_node_t **ref, int slot)
+{
+    lpm_node_t *node = *ref;
+    int idx, n_slots;
+
+    n_slots = node->n_children + node->n_leaves;
+    idx = lpm_map_rank(node->child_map, node->child_base, slot);
+    node = lpm_node_resize(t, ref, n_slots + 1);
+    memmove(&node->slots[idx + 1], &node->slots[idx],
+            (n_slots - idx) * sizeof(void *));
+    node->slots[idx] = lpm_node_new(t);
+    node->n_children++;
+    node->child_map[slot >> 6] |= 1ULL << (slot & 63);
+    lpm_map_set_base(node->child_map, node->child_base);
+
+    return ((lpm_node_t **)&node->slots[idx]);
+}
+
+static void
+lpm_node_remove_child(lpm_trie_t *t, lpm_node_t **ref, int slot)
+{
+    lpm_node_t *node = *ref;
+    int idx, n_slots;
+
+    n_slots = node->n_children + node->n_leaves;
+    idx = lpm_map_rank(node->child_map, node->child_base, slot);
+    lpm_node_del(t, node->slots[idx]);
+    memmove(&node->slots[idx], &node->slots[idx + 1],
+            (n_slots - idx - 1) * sizeof(void *));
+    node->child_map[slot >> 6] &= ~(1ULL << (slot & 63));
+    lpm_map_set_base(node->child_map, node->child_base);
+    node = lpm_node_resize(t, ref, n_slots - 1);
+    node->n_children--;
+}
+
+static lpm_pfx_t *
+lpm_node_find_pfx(lpm_node_t *node, int len, int bits)
+{
+    int i;
+
+    for (i = 0; i < node->n_pfxs; i++) {
+        if (node->pfxs[i].len == len && node->pfxs[i].bits == bits) {
+            return (&node->pfxs[i]);
+        }
+    }
+    return (NULL);
+}
+
+/* Reference to the node where the prefixes of length 'plen' end, or NULL if
+ * it doesn't exist. The references of the path are stored in 'path' if not
+ * NULL */
+static lpm_node_t **
+lpm_trie_find_node(lpm_trie_t *t, const uint8_t *key, int plen,
+        lpm_node_t ***path)
+{
+    lpm_node_t **ref = &t->root;
+    int level, depth;
+
+    depth = (plen - 1) / LPM_STRIDE;
+    for (level = 0; level < depth && ref; level++) {
+        if (path) {
+            path[level] = ref;
+        }
+        ref = lpm_node_child(*ref, key[level]);
+    }
+    return (ref);
+}
+
+lpm_trie_t *
+lpm_trie_new(int maxlen)
+{
+    lpm_trie_t *t;
+
+    t = xzalloc(sizeof(lpm_trie_t));
+    t->maxlen = maxlen;
+    t->root = lpm_node_new(t);
+    return (t);
+}
+
+void
+lpm_trie_del(lpm_trie_t *t)
+{
+    if (!t) {
+        return;
+    }
+    lpm_node_del(t, t->root);
+    free(t);
+}
+
+/* Add the prefix 'key'/'plen'. Returns BAD if the prefix already exists */
+int
+lpm_trie_insert(lpm_trie_t *t, const uint8_t *key, int plen, void *data)
+{
+    lpm_node_t **ref, **child;
+    lpm_node_t *node;
+    lpm_pfx_t *pfx;
+    int level, depth, len, bits;
+
+    if (plen < 0 || plen > t->maxlen) {
+        return (BAD);
+    }
+    if (plen == 0) {
+        if (t->def) {
+            return (BAD);
+        }
+        t->def = data;
+        t->n_entries++;
+        return (GOOD);
+    }
+
+    depth = (plen - 1) / LPM_STRIDE;
+    len = plen - depth * LPM_STRIDE;
+    bits = key[depth] >> (LPM_STRIDE - len);
+
+    ref = &t->root;
+    for (level = 0; level < depth; level++) {
+        child = lpm_node_child(*ref, key[level]);
+        if (!child) {
+            child = lpm_node_add_child(t, ref, key[level]);
+        }
+        ref = child;
+    }
+
+    node = *ref;
+    if (lpm_node_find_pfx(node, len, bits)) {
+        return (BAD);
+    }
+
+    node->pfxs = xrealloc(node->pfxs, (node->n_pfxs + 1) * sizeof(lpm_pfx_t));
+    pfx = &node->pfxs[node->n_pfxs++];
+    pfx->len = len;
+    pfx->bits = bits;
+    pfx->data = data;
+    t->mem += sizeof(lpm_pfx_t);
+    lpm_node_build_leaves(t, ref);
+    t->n_entries++;
+
+    return (GOOD);
+}
+
+/* Remove the prefix 'key'/'plen' and return its data */
+void *
+lpm_trie_remove(lpm_trie_t *t, const uint8_t *key, int plen)
+{
+    lpm_node_t **path[LPM_MAX_LEVELS];
+    lpm_node_t **ref;
+    lpm_node_t *node;
+    lpm_pfx_t *pfx;
+    void *data;
+    int level, depth, len;
+
+    if (plen <= 0 || plen > t->maxlen) {
+        data = (plen == 0) ? t->def : NULL;
+        if (data) {
+            t->def = NULL;
+            t->n_entries--;
+        }
+        return (data);
+    }
+
+    depth = (plen - 1) / LPM_STRIDE;
+    len = plen - depth * LPM_STRIDE;
+    ref = lpm_trie_find_node(t, key, plen, path);
+    if (!ref) {
+        return (NULL);
+    }
+    node = *ref;
+    pfx = lpm_node_find_pfx(node, len, key[depth] >> (LPM_STRIDE - len));
+    if (!pfx) {
+        return (NULL);
+    }
+
+    data = pfx->data;
+    *pfx = node->pfxs[--node->n_pfxs];
+    t->mem -= sizeof(lpm_pfx_t);
+    if (node->n_pfxs == 0) {
+        free(node->pfxs);
+        node->pfxs = NULL;
+    }
+    lpm_node_build_leaves(t, ref);
+    t->n_entries--;
+
+    /* Release the nodes of the path left empty */
+    for (level = depth - 1; level >= 0; level--) {
+        node = *ref;
+        if (node->n_pfxs != 0 || node->n_children != 0) {
+            break;
+        }
+        lpm_node_remove_child(t, path[level], key[level]);
+        ref = path[level];
+    }
+
+    return (data);
+}
+
+void *
+lpm_trie_lookup_exact(lpm_trie_t *t, const uint8_t *key, int plen)
+{
+    lpm_node_t **ref;
+    lpm_pfx_t *pfx;
+    int depth, len;
+
+    if (plen <= 0 || plen > t->maxlen) {
+        return ((plen == 0) ? t->def : NULL);
+    }
+
+    depth = (plen - 1) / LPM_STRIDE;
+    len = plen - depth * LPM_STRIDE;
+    ref = lpm_trie_find_node(t, key, plen, NULL);
+    if (!ref) {
+        return (NULL);
+    }
+    pfx = lpm_node_find_pfx(*ref, len, key[depth] >> (LPM_STRIDE - len));
+    return (pfx ? pfx->data : NULL);
+}
@@ -0,0 +1,127 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef LPM_TRIE_H_
+#define LPM_TRIE_H_
+
+#include "mem_util.h"
+
+/*
+ * Compressed multibit trie for longest prefix match of IPv4 and IPv6 keys.
+ * Each level consumes a stride of 8 bits of the key. Nodes store their
+ * slots in popcount indexed arrays, as in Poptrie: a bitmap marks the slots
+ * with a child and a second one the slots where a run of equal leaves
+ * starts. Lookups do no memory allocation and visit at most one node per
+ * byte of the key.
+ */
+
+#define LPM_STRIDE      8
+#define LPM_SLOTS       (1 << LPM_STRIDE)
+#define LPM_MAP_WORDS   (LPM_SLOTS / 64)
+
+/* Prefix ending in a node: the 'len' bits of the stride in 'bits' */
+typedef struct lpm_pfx {
+    uint8_t len;
+    uint8_t bits;
+    void    *data;
+} lpm_pfx_t;
+
+/* The child pointers and the leaves share a single block with the header of
+ * the node, to touch as few cache lines as possible on lookups */
+typedef struct lpm_node {
+    uint64_t        child_map[LPM_MAP_WORDS];
+    uint64_t        leaf_map[LPM_MAP_WORDS];
+    /* Bits set in the previous words of each map */
+    uint8_t         child_base[LPM_MAP_WORDS];
+    uint8_t         leaf_base[LPM_MAP_WORDS];
+    lpm_pfx_t       *pfxs;
+    uint16_t        n_children;
+    uint16_t        n_leaves;
+    uint16_t        n_pfxs;
+    /* 'n_children' child nodes followed by the data of the longest prefix
+     * of each of the 'n_leaves' runs */
+    void            *slots[];
+} lpm_node_t;
+
+typedef struct lpm_trie {
+    lpm_node_t  *root;
+    void        *def;       /* data of the zero length prefix */
+    int         maxlen;     /* 32 or 128 */
+    int         n_entries;
+    size_t      mem;        /* bytes used by the nodes */
+} lpm_trie_t;
+
+lpm_trie_t *lpm_trie_new(int maxlen);
+void lpm_trie_del(lpm_trie_t *t);
+int lpm_trie_insert(lpm_trie_t *t, const uint8_t *key, int plen, void *data);
+void *lpm_trie_remove(lpm_trie_t *t, const uint8_t *key, int plen);
+void *lpm_trie_lookup_exact(lpm_trie_t *t, const uint8_t *key, int plen);
+
+static inline int
+lpm_map_test(const uint64_t *map, int pos)
+{
+    return ((map[pos >> 6] >> (pos & 63)) & 1);
+}
+
+/* Number of bits set in 'map' below position 'pos', 'base' holding the bits
+ * set in the words before each word */
+static inline int
+lpm_map_rank(const uint64_t *map, const uint8_t *base, int pos)
+{
+    int w = pos >> 6;
+
+    return (base[w] + __builtin_popcountll(map[w] & ((1ULL << (pos & 63)) - 1)));
+}
+
+/* Index of the run of leaves containing 'slot' */
+static inline int
+lpm_leaf_index(const lpm_node_t *node, int slot)
+{
+    int w = slot >> 6;
+
+    return (node->leaf_base[w] - 1 + __builtin_popcountll(
+            node->leaf_map[w] & ((2ULL << (slot & 63)) - 1)));
+}
+
+/* Return the data of the longest prefix matching the address 'key' */
+static inline void *
+lpm_trie_lookup(lpm_trie_t *t, const uint8_t *key)
+{
+    lpm_node_t *node = t->root;
+    void *best = t->def;
+    void *data;
+    int level = 0;
+    int slot;
+
+    for (;;) {
+        slot = key[level];
+        data = node->slots[node->n_children + lpm_leaf_index(node, slot)];
+        if (data) {
+            best = data;
+        }
+        if (!lpm_map_test(node->child_map, slot)) {
+            return (best);
+        }
+        node = node->slots[lpm_map_rank(node->child_map, node->child_base,
+                slot)];
+        level++;
+    }
+}
+
+#endif /* LPM_TRIE_H_ */
@@ -0,0 +1,48 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "lru_list.h"
+
+/*
+ * Make room in a full table. All its expired entries are removed and, if
+ * they are less than 'n_old', the least recently used ones up to 'n_old'.
+ * Returns the number of expired entries removed
+ */
+int
+lru_list_evict(struct ovs_list *lru, int n_old, void *table,
+        lru_expired_fct expired_fct, lru_remove_fct remove_fct)
+{
+    struct ovs_list *elt, *next;
+    int removed = 0, expired;
+
+    for (elt = lru->next; elt != lru; elt = next){
+        next = elt->next;
+        if (expired_fct(elt)){
+            remove_fct(table, elt);
+            removed++;
+        }
+    }
+    expired = removed;
+
+    while (removed < n_old && !list_is_empty(lru)){
+        remove_fct(table, list_back(lru));
+        removed++;
+    }
+    return (expired);
+}
@@ -0,0 +1,55 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef LRU_LIST_H_
+#define LRU_LIST_H_
+
+#include "../elibs/ovs/list.h"
+
+/*
+ * Use order of the entries of the data plane caches (tuple, re-encapsulation
+ * and multicast tables). Entries embed a struct ovs_list linked in the list
+ * of the table, most recently used first, so that the oldest ones can be
+ * evicted when the table is full.
+ */
+
+/* Returns TRUE if the entry linked by 'elt' has expired */
+typedef int (*lru_expired_fct)(struct ovs_list *elt);
+/* Remove from 'table' and free the entry linked by 'elt' */
+typedef void (*lru_remove_fct)(void *table, struct ovs_list *elt);
+
+/* Link a new entry */
+static inline void
+lru_list_add(struct ovs_list *lru, struct ovs_list *elt)
+{
+    list_push_front(lru, elt);
+}
+
+/* Mark the entry as the most recently used */
+static inline void
+lru_list_touch(struct ovs_list *lru, struct ovs_list *elt)
+{
+    list_remove(elt);
+    list_push_front(lru, elt);
+}
+
+int lru_list_evict(struct ovs_list *lru, int n_old, void *table,
+        lru_expired_fct expired_fct, lru_remove_fct remove_fct);
+
+#endif /* LRU_LIST_H_ */
@@ -46,6 +46,14 @@ mcache_entry_init(mcache_entry_t *mce, mapping_t *mapping)
     mce->how_learned = MCE_DYNAMIC;
 }
 
+void
+mcache_entry_init_gleaned(mcache_entry_t *mce, mapping_t *mapping)
+{
+
+    mce->mapping = mapping;
+    mce->how_learned = MCE_GLEANED;
+}
+
 void
 mcache_entry_init_static(mcache_entry_t *mce, mapping_t *mapping)
 {
@@ -62,10 +70,13 @@ mcache_entry_del(mcache_entry_t *entry)
     locator_t *loct;
 
     assert(entry);
-    /* Stop timers associated to the locators */
-    mapping_foreach_locator(mcache_entry_mapping(entry),loct){
-        stop_timers_from_obj(loct,ptrs_to_timers_ht, nonces_ht);
-    }mapping_foreach_locator_end;
+    /* Stop timers associated to the locators. Shared locators are still
+     * used by other entries */
+    if (mapping_loct_set(mcache_entry_mapping(entry)) == NULL){
+        mapping_foreach_locator(mcache_entry_mapping(entry),loct){
+            stop_timers_from_obj(loct,ptrs_to_timers_ht, nonces_ht);
+        }mapping_foreach_locator_end;
+    }
     stop_timers_from_obj(entry,ptrs_to_timers_ht, nonces_ht);
 
     mapping_del(mcache_entry_mapping(entry));
@@ -107,6 +118,8 @@ map_cache_entry_dump (mcache_entry_t *entry, int log_level)
 
     if (entry->how_learned == MCE_STATIC) {
         snprintf(str + strlen(str),sizeof(str) - strlen(str),"TYPE: Static, ");
+    } else if (entry->how_learned == MCE_GLEANED) {
+        snprintf(str + strlen(str),sizeof(str) - strlen(str),"TYPE: Gleaned, ");
     } else {
         snprintf(str + strlen(str),sizeof(str) - strlen(str),"TYPE: Dynamic, ");
     }
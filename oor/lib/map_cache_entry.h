@@ -30,7 +30,9 @@
 typedef enum mce_type {
     MCE_= 0,
     MCE_DYNAMIC,
-    MCE_STATIC
+    MCE_STATIC,
+    /* Learnt from the data traffic received. Not active until verified */
+    MCE_GLEANED
 } mce_type_e;
 
 /*
@@ -52,6 +54,8 @@ typedef struct map_cache_entry_ {
     uint8_t active;
     uint8_t active_witin_period;
     time_t timestamp;
+    /* Time the entry expires, unless it is updated before */
+    time_t expires;
 
     /* Routing info */
     void *                  routing_info;
@@ -59,11 +63,16 @@ typedef struct map_cache_entry_ {
 
     /* EID that requested the mapping. Helps with timers */
     lisp_addr_t *requester;
+
+    /* LISP Pub/Sub: nonce of the last publication accepted, starting from
+     * the one of the Map-Request that subscribed. 0 if not subscribed */
+    uint64_t pubsub_nonce;
 } mcache_entry_t;
 
 mcache_entry_t *mcache_entry_new();
 void mcache_entry_init(mcache_entry_t *, mapping_t *);
 void mcache_entry_init_static(mcache_entry_t *, mapping_t *);
+void mcache_entry_init_gleaned(mcache_entry_t *, mapping_t *);
 
 
 void mcache_entry_del(mcache_entry_t *entry);
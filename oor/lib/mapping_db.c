@@ -129,6 +129,115 @@ get_mc_pt_from_lcaf(mdb_t *db, lcaf_addr_t *lcaf)
     return (NULL);
 }
 
+static lpm_trie_t *
+get_ip_lpm_from_afi(mdb_t *db, uint16_t afi)
+{
+    switch (afi) {
+    case AF_INET:
+        return (db->AF4_ip_lpm);
+    case AF_INET6:
+        return (db->AF6_ip_lpm);
+    default:
+        return (NULL);
+    }
+}
+
+static lpm_trie_t *
+get_iid_lpm(mdb_t *db, uint32_t iid, uint16_t afi)
+{
+    switch (afi) {
+    case AF_INET:
+        return (int_htable_lookup(db->AF4_iid_lpm, iid));
+    case AF_INET6:
+        return (int_htable_lookup(db->AF6_iid_lpm, iid));
+    default:
+        return (NULL);
+    }
+}
+
+static lpm_trie_t *
+get_iid_lpm_from_lcaf(mdb_t *db, lcaf_addr_t *iidaddr)
+{
+    lisp_addr_t *addr;
+
+    addr = iid_type_get_addr(lcaf_addr_get_iid(iidaddr));
+    if (lisp_addr_lafi(addr) == LM_AFI_LCAF){
+        return (NULL);
+    }
+    return (get_iid_lpm(db, iid_type_get_iid(lcaf_addr_get_iid(iidaddr)),
+            lisp_addr_ip_afi(addr)));
+}
+
+static void
+lpm_add_ip_addr(lpm_trie_t *lpm, lisp_addr_t *ip_pref, void *data)
+{
+    if (lpm_trie_insert(lpm, ip_addr_get_addr(lisp_addr_ip_get_addr(ip_pref)),
+            lisp_addr_ip_get_plen(ip_pref), data) != GOOD) {
+        OOR_LOG(LDBG_3, "lpm_add_ip_addr: %s already in the LPM trie",
+                lisp_addr_to_char(ip_pref));
+    }
+}
+
+static void
+lpm_remove_ip_addr(lpm_trie_t *lpm, lisp_addr_t *ip_pref)
+{
+    if (lpm) {
+        lpm_trie_remove(lpm, ip_addr_get_addr(lisp_addr_ip_get_addr(ip_pref)),
+                lisp_addr_ip_get_plen(ip_pref));
+    }
+}
+
+static void *
+lpm_find_ip_addr(lpm_trie_t *lpm, lisp_addr_t *laddr, uint8_t exact)
+{
+    ip_addr_t *ip;
+
+    if (!lpm) {
+        return (NULL);
+    }
+    ip = lisp_addr_ip_get_addr(laddr);
+    if (exact) {
+        return (lpm_trie_lookup_exact(lpm, ip_addr_get_addr(ip),
+                lisp_addr_ip_get_plen(laddr)));
+    } else {
+        return (lpm_trie_lookup(lpm, ip_addr_get_addr(ip)));
+    }
+}
+
+/* Lookup of IP and IID addresses in the LPM tries. Returns BAD if the
+ * address is not indexed by them */
+static int
+_lpm_find_entry(mdb_t *db, lisp_addr_t *laddr, uint8_t exact, void **data)
+{
+    lcaf_addr_t *lcaf;
+    lisp_addr_t *ip_pref;
+
+    *data = NULL;
+    switch (lisp_addr_lafi(laddr)) {
+    case LM_AFI_IP:
+    case LM_AFI_IPPREF:
+        *data = lpm_find_ip_addr(get_ip_lpm_from_afi(db, lisp_addr_ip_afi(laddr)),
+                laddr, exact);
+        return (GOOD);
+    case LM_AFI_LCAF:
+        lcaf = lisp_addr_get_lcaf(laddr);
+        if (lcaf_addr_get_type(lcaf) != LCAF_IID) {
+            return (BAD);
+        }
+        ip_pref = exact ? NULL : lcaf_get_ip_addr(lcaf);
+        if (!ip_pref){
+            ip_pref = lcaf_get_ip_pref_addr(lcaf);
+            if (!ip_pref){
+                return (GOOD);
+            }
+        }
+        *data = lpm_find_ip_addr(get_iid_lpm_from_lcaf(db, lcaf), ip_pref, exact);
+        return (GOOD);
+    default:
+        return (BAD);
+    }
+}
+
 static patricia_node_t *
 _find_ip_node(mdb_t *db, lisp_addr_t *laddr, uint8_t exact)
 {
@@ -227,6 +336,13 @@ _add_ippref_entry(mdb_t *db, void *entry, ip_prefix_t *ippref)
         return (BAD);
     }
 
+    if (lpm_trie_insert(get_ip_lpm_from_afi(db, ip_prefix_afi(ippref)),
+            ip_addr_get_addr(ip_prefix_addr(ippref)),
+            ip_prefix_get_plen(ippref), entry) != GOOD) {
+        OOR_LOG(LDBG_3, "_add_ippref_entry: %s already in the LPM trie",
+                ip_prefix_to_char(ippref));
+    }
+
     OOR_LOG(LDBG_3, "_add_ippref_entry: Added map cache data for %s",
             ip_prefix_to_char(ippref));
     return (GOOD);
@@ -247,12 +363,14 @@ _db_add_iid(mdb_t *db, uint32_t iid, uint16_t afi){
         size = sizeof(struct in_addr);
         pt = New_Patricia( size * 8);
         ht = db->AF4_iid_db;
+        int_htable_insert(db->AF4_iid_lpm, iid, lpm_trie_new(size * 8));
         break;
     case AF_INET6:
         ip_addr_set_afi(&ip, AF_INET6);
         size = sizeof(struct in6_addr);
         pt = New_Patricia(size * 8);
         ht = db->AF6_iid_db;
+        int_htable_insert(db->AF6_iid_lpm, iid, lpm_trie_new(size * 8));
         break;
     default:
         OOR_LOG(LDBG_1, "_db_add_iid: AFI %u not recognized!", afi);
@@ -298,6 +416,8 @@ _add_iid_entry(mdb_t *db, void *entry, lcaf_addr_t *iidaddr)
         return (BAD);
     }
 
+    lpm_add_ip_addr(get_iid_lpm(db, iid, afi), ip_pref, entry);
+
     OOR_LOG(LDBG_3, "_add_iid_entry: Added map cache data for %s",
             lcaf_addr_to_char(iidaddr));
     return (GOOD);
@@ -321,6 +441,7 @@ _rm_iid_entry(mdb_t *db, lcaf_addr_t *iidaddr)
         return (NULL);
     }
 
+    lpm_remove_ip_addr(get_iid_lpm_from_lcaf(db, iidaddr), ip_pref);
     return (pt_remove_ippref(pt, lisp_addr_get_ippref(ip_pref)));
 }
 
@@ -461,6 +582,10 @@ mdb_new()
     /* IID TABLES*/
     db->AF4_iid_db = int_htable_new();
     db->AF6_iid_db = int_htable_new();
+    db->AF4_ip_lpm = lpm_trie_new(sizeof(struct in_addr) * 8);
+    db->AF6_ip_lpm = lpm_trie_new(sizeof(struct in6_addr) * 8);
+    db->AF4_iid_lpm = int_htable_new_managed((free_value_fn_t)lpm_trie_del);
+    db->AF6_iid_lpm = int_htable_new_managed((free_value_fn_t)lpm_trie_del);
 
 
     /* MC is stored as patricia in patricia, what follows is a HACK
@@ -485,6 +610,7 @@ mdb_new()
     }
 
     db->n_entries = 0;
+    db->version = 0;
 
     return (db);
 }
@@ -526,6 +652,11 @@ mdb_del(mdb_t *db, mdb_del_fct del_fct)
         } PATRICIA_WALK_END;
     }
     Destroy_Patricia(db->AF6_mc_db, NULL);
+
+    lpm_trie_del(db->AF4_ip_lpm);
+    lpm_trie_del(db->AF6_ip_lpm);
+    int_htable_destroy(db->AF4_iid_lpm);
+    int_htable_destroy(db->AF6_iid_lpm);
     free(db);
 }
 
@@ -533,6 +664,9 @@ int
 mdb_add_entry(mdb_t *db, lisp_addr_t *addr, void *data)
 {
     int retval = 0;
+
+    /* Even failed insertions may have changed the trees */
+    db->version++;
     switch (lisp_addr_lafi(addr)) {
     case LM_AFI_IP:
         OOR_LOG(LWRN, "mdb_add_entry: mapping stores an IP prefix not an IP!");
@@ -568,6 +702,7 @@ mdb_remove_entry(mdb_t *db, lisp_addr_t *laddr)
     lisp_addr_t *taddr;
     void *ret = NULL;
 
+    db->version++;
     switch (lisp_addr_lafi(laddr)) {
     case LM_AFI_IP:
         /* make ippref */
@@ -575,12 +710,14 @@ mdb_remove_entry(mdb_t *db, lisp_addr_t *laddr)
         lisp_addr_ip_to_ippref(taddr);
         ippref = lisp_addr_get_ippref(taddr);
         ret = pt_remove_ippref(get_ip_pt_from_afi(db, ip_prefix_afi(ippref)), ippref);
+        lpm_remove_ip_addr(get_ip_lpm_from_afi(db, ip_prefix_afi(ippref)), taddr);
         lisp_addr_del(taddr);
         break;
     case LM_AFI_IPPREF:
         ippref = lisp_addr_get_ippref(laddr);
         ret = pt_remove_ippref(
                 get_ip_pt_from_afi(db, ip_prefix_afi(ippref)), ippref);
+        lpm_remove_ip_addr(get_ip_lpm_from_afi(db, ip_prefix_afi(ippref)), laddr);
         break;
     case LM_AFI_LCAF:
         ret = _del_lcaf_entry(db, lisp_addr_get_lcaf(laddr));
@@ -601,6 +738,11 @@ void *
 mdb_lookup_entry(mdb_t *db, lisp_addr_t *laddr)
 {
     patricia_node_t *node;
+    void *data;
+
+    if (_lpm_find_entry(db, laddr, NOT_EXACT, &data) == GOOD) {
+        return (data);
+    }
 
     node = _find_node(db, laddr, NOT_EXACT);
     if (node){
@@ -614,6 +756,12 @@ void *
 mdb_lookup_entry_exact(mdb_t *db, lisp_addr_t *laddr)
 {
     patricia_node_t *node;
+    void *data;
+
+    if (_lpm_find_entry(db, laddr, EXACT, &data) == GOOD) {
+        return (data);
+    }
+
     node = _find_node(db, laddr, EXACT);
     if (node){
         return(node->data);
@@ -627,6 +775,335 @@ mdb_n_entries(mdb_t *mdb) {
     return(mdb->n_entries);
 }
 
+/*
+ * Iterators
+ */
+
+enum {
+    MDB_ITER_AF4_IP,
+    MDB_ITER_AF6_IP,
+    MDB_ITER_AF4_IID,
+    MDB_ITER_AF6_IID,
+    MDB_ITER_AF4_MC,
+    MDB_ITER_AF6_MC,
+    MDB_ITER_END
+};
+
+#define pt_bit_test(_addr, _bit) ((_addr)[(_bit) >> 3] & (0x80 >> ((_bit) & 0x07)))
+
+static inline uint8_t *
+pt_prefix_addr(prefix_t *prefix)
+{
+    return ((uint8_t *)&prefix->add);
+}
+
+/* First bit, lower than len, in which both addresses differ. Returns len if
+ * they are equal */
+static int
+pt_differ_bit(uint8_t *a1, uint8_t *a2, int len)
+{
+    int i, bit;
+    uint8_t diff;
+
+    for (i = 0; i * 8 < len; i++) {
+        diff = a1[i] ^ a2[i];
+        if (diff) {
+            bit = i * 8;
+            while (!(diff & 0x80)) {
+                diff <<= 1;
+                bit++;
+            }
+            return (bit < len ? bit : len);
+        }
+    }
+    return (len);
+}
+
+static inline void
+pt_cursor_init(pt_cursor_t *c, patricia_node_t *head)
+{
+    c->depth = 0;
+    c->next = head;
+}
+
+static inline patricia_node_t *
+pt_cursor_pop(pt_cursor_t *c)
+{
+    return (c->depth > 0 ? c->stack[--c->depth] : NULL);
+}
+
+/* Same step as PATRICIA_WALK_END */
+static inline void
+pt_cursor_advance(pt_cursor_t *c)
+{
+    patricia_node_t *node = c->next;
+
+    if (node->l) {
+        if (node->r) {
+            c->stack[c->depth++] = node->r;
+        }
+        c->next = node->l;
+    } else if (node->r) {
+        c->next = node->r;
+    } else {
+        c->next = pt_cursor_pop(c);
+    }
+}
+
+static patricia_node_t *
+pt_cursor_next(pt_cursor_t *c)
+{
+    patricia_node_t *node;
+
+    while ((node = c->next)) {
+        pt_cursor_advance(c);
+        if (node->prefix) {
+            return (node);
+        }
+    }
+    return (NULL);
+}
+
+/*
+ * Position the cursor at the first node of the tree that the walk finds
+ * after the one with prefix 'key' (or at that node if 'inclusive' is set).
+ * The walk is a preorder of the tree, so all the nodes of a subtree share
+ * the first node->bit bits and the bits of the key decide which subtrees
+ * are after it.
+ */
+static void
+pt_cursor_seek(pt_cursor_t *c, patricia_node_t *head, prefix_t *key,
+        uint8_t inclusive)
+{
+    patricia_node_t *node, *ref;
+    uint8_t *kaddr;
+    int len, bit;
+
+    kaddr = pt_prefix_addr(key);
+    pt_cursor_init(c, NULL);
+    node = head;
+    while (node) {
+        /* Glue nodes don't have a prefix: use any of their descendants */
+        ref = node;
+        while (!ref->prefix) {
+            ref = ref->l ? ref->l : ref->r;
+        }
+        len = node->bit < key->bitlen ? node->bit : key->bitlen;
+        bit = pt_differ_bit(pt_prefix_addr(ref->prefix), kaddr, len);
+        if (bit < len) {
+            if (pt_bit_test(kaddr, bit)) {
+                /* The whole subtree is before the key */
+                c->next = pt_cursor_pop(c);
+            } else {
+                c->next = node;
+            }
+            return;
+        }
+        if (node->bit >= key->bitlen) {
+            c->next = node;
+            if (node->bit == key->bitlen && node->prefix && !inclusive) {
+                pt_cursor_advance(c);
+            }
+            return;
+        }
+        /* The node is a prefix of the key */
+        if (pt_bit_test(kaddr, node->bit)) {
+            node = node->r;
+        } else {
+            if (node->r) {
+                c->stack[c->depth++] = node->r;
+            }
+            node = node->l;
+        }
+    }
+    c->next = pt_cursor_pop(c);
+}
+
+static inline uint8_t
+pt_prefix_equal(prefix_t *p1, prefix_t *p2)
+{
+    return (p1->bitlen == p2->bitlen && pt_differ_bit(pt_prefix_addr(p1),
+            pt_prefix_addr(p2), p1->bitlen) == p1->bitlen);
+}
+
+static int_htable *
+mdb_iter_iid_db(mdb_iter_t *it)
+{
+    return (it->tree == MDB_ITER_AF4_IID ? it->db->AF4_iid_db : it->db->AF6_iid_db);
+}
+
+static patricia_tree_t *
+mdb_iter_tree(mdb_iter_t *it)
+{
+    switch (it->tree) {
+    case MDB_ITER_AF4_IP:
+        return (it->db->AF4_ip_db);
+    case MDB_ITER_AF6_IP:
+        return (it->db->AF6_ip_db);
+    case MDB_ITER_AF4_IID:
+    case MDB_ITER_AF6_IID:
+        return (int_htable_lookup(mdb_iter_iid_db(it), it->iid));
+    case MDB_ITER_AF4_MC:
+        return (it->db->AF4_mc_db);
+    case MDB_ITER_AF6_MC:
+        return (it->db->AF6_mc_db);
+    default:
+        return (NULL);
+    }
+}
+
+/* IID trees are walked in increasing IID order. Unlike the position in
+ * the hash table, this order is not changed by rehashing */
+static int
+mdb_iter_next_iid(mdb_iter_t *it, uint8_t first)
+{
+    int_htable *ht = mdb_iter_iid_db(it);
+    uint32_t iid, next = 0;
+    uint8_t found = FALSE;
+
+    int_htable_foreach_key(ht, iid) {
+        if ((first || iid > it->iid) && (!found || iid < next)) {
+            next = iid;
+            found = TRUE;
+        }
+    } int_htable_foreach_key_end;
+
+    if (!found) {
+        return (BAD);
+    }
+    it->iid = next;
+    return (GOOD);
+}
+
+/* Move to the next tree after 'tree' to be walked, or to the end */
+static void
+mdb_iter_next_tree(mdb_iter_t *it, uint8_t first_iid)
+{
+    patricia_tree_t *pt;
+
+    while (it->tree != MDB_ITER_END) {
+        if (it->tree == MDB_ITER_AF4_IID || it->tree == MDB_ITER_AF6_IID) {
+            if (mdb_iter_next_iid(it, first_iid) == GOOD) {
+                break;
+            }
+        }
+        it->tree++;
+        first_iid = TRUE;
+        if (it->tree == MDB_ITER_AF4_MC && !(it->flags & MDB_ITER_MC)) {
+            it->tree = MDB_ITER_END;
+        }
+        if (it->tree != MDB_ITER_AF4_IID && it->tree != MDB_ITER_AF6_IID) {
+            break;
+        }
+    }
+
+    pt = mdb_iter_tree(it);
+    pt_cursor_init(&it->outer, pt ? pt->head : NULL);
+    it->outer_node = NULL;
+    it->has_outer_key = FALSE;
+    it->has_inner_key = FALSE;
+}
+
+/* The db has been modified since the cursors were set: the nodes they point
+ * to may have been freed. Set them again from the keys of the last entry */
+static void
+mdb_iter_resync(mdb_iter_t *it)
+{
+    patricia_tree_t *pt;
+    patricia_node_t *node;
+
+    it->version = it->db->version;
+    if (it->tree == MDB_ITER_END) {
+        return;
+    }
+    pt = mdb_iter_tree(it);
+    if (!pt) {
+        /* IID db removed */
+        mdb_iter_next_tree(it, FALSE);
+        return;
+    }
+    if (!it->has_outer_key) {
+        pt_cursor_init(&it->outer, pt->head);
+        it->outer_node = NULL;
+        return;
+    }
+
+    /* Once the inner tree of an outer node has been walked, continue after
+     * that node. Otherwise, go back to it */
+    pt_cursor_seek(&it->outer, pt->head, &it->outer_key, it->outer_node != NULL);
+    node = it->outer.next;
+    it->outer_node = NULL;
+    if (!node || !node->prefix || !pt_prefix_equal(node->prefix, &it->outer_key)) {
+        return;
+    }
+    pt_cursor_advance(&it->outer);
+    pt = node->data;
+    if (!pt) {
+        return;
+    }
+    it->outer_node = node;
+    if (it->has_inner_key) {
+        pt_cursor_seek(&it->inner, pt->head, &it->inner_key, FALSE);
+    } else {
+        pt_cursor_init(&it->inner, pt->head);
+    }
+}
+
+void
+mdb_iter_init(mdb_iter_t *it, mdb_t *db, int flags)
+{
+    it->db = db;
+    it->flags = flags;
+    it->version = db->version;
+    it->tree = (flags & MDB_ITER_IP) ? MDB_ITER_AF4_IP : MDB_ITER_AF4_MC;
+    if (!(flags & MDB_ITER_MC) && it->tree == MDB_ITER_AF4_MC) {
+        it->tree = MDB_ITER_END;
+    }
+    it->iid = 0;
+    pt_cursor_init(&it->outer, it->tree != MDB_ITER_END ? mdb_iter_tree(it)->head : NULL);
+    it->outer_node = NULL;
+    it->has_outer_key = FALSE;
+    it->has_inner_key = FALSE;
+}
+
+/* Returns the next entry of the db or NULL at the end of the walk */
+void *
+mdb_iter_next(mdb_iter_t *it)
+{
+    patricia_node_t *node;
+
+    if (it->version != it->db->version) {
+        mdb_iter_resync(it);
+    }
+
+    while (it->tree != MDB_ITER_END) {
+        if (it->outer_node) {
+            while ((node = pt_cursor_next(&it->inner))) {
+                if (node->data) {
+                    it->inner_key = *node->prefix;
+                    it->has_inner_key = TRUE;
+                    return (node->data);
+                }
+            }
+            it->outer_node = NULL;
+        }
+        node = pt_cursor_next(&it->outer);
+        if (node && !node->data) {
+            continue;
+        }
+        if (node) {
+            it->outer_node = node;
+            it->outer_key = *node->prefix;
+            it->has_outer_key = TRUE;
+            it->has_inner_key = FALSE;
+            pt_cursor_init(&it->inner, ((patricia_tree_t *)node->data)->head);
+            continue;
+        }
+        mdb_iter_next_tree(it, FALSE);
+    }
+    return (NULL);
+}
+
 /*
  * Patricia trie wrappers
  */
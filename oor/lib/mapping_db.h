@@ -27,6 +27,7 @@
 #define MAPPING_DB_H_
 
 #include "int_table.h"
+#include "lpm_trie.h"
 #include "../elibs/patricia/patricia.h"
 #include "../liblisp/lisp_address.h"
 
@@ -45,11 +46,53 @@ typedef struct {
     int_htable *AF6_iid_db;
     patricia_tree_t *AF4_mc_db;
     patricia_tree_t *AF6_mc_db;
+    /* LPM tries indexing the IP and IID entries. They serve the lookups
+     * while the patricia trees are still used to walk the entries */
+    lpm_trie_t *AF4_ip_lpm;
+    lpm_trie_t *AF6_ip_lpm;
+    int_htable *AF4_iid_lpm;
+    int_htable *AF6_iid_lpm;
     int n_entries;
+    /* Incremented each time entries are added or removed */
+    uint32_t version;
 } mdb_t;
 
 typedef void (*mdb_del_fct)(void *);
 
+/* Entries visited by an iterator */
+#define MDB_ITER_IP     0x01    /* IP and IID entries */
+#define MDB_ITER_MC     0x02    /* multicast (S,G) entries */
+#define MDB_ITER_ALL    (MDB_ITER_IP | MDB_ITER_MC)
+
+/* Resumable preorder walk of a patricia tree, equivalent to PATRICIA_WALK */
+typedef struct {
+    patricia_node_t *stack[PATRICIA_MAXBITS + 1];
+    int depth;
+    patricia_node_t *next;
+} pt_cursor_t;
+
+/*
+ * Iterator over the entries of an mdb_t. It doesn't allocate memory and
+ * can be kept between calls: if the database is modified in between, the
+ * walk is resumed after the last entry returned using its key, so entries
+ * may be added or removed (including the last one returned) while
+ * iterating. Entries added behind the iterator position are not visited.
+ */
+typedef struct {
+    mdb_t *db;
+    int flags;
+    int tree;               /* mdb tree being walked */
+    uint32_t iid;           /* IID of the tree when walking an IID db */
+    uint32_t version;       /* db version the cursors are valid for */
+    pt_cursor_t outer;      /* walk of the tree */
+    pt_cursor_t inner;      /* walk of the tree stored in the outer node */
+    patricia_node_t *outer_node;
+    uint8_t has_outer_key;
+    uint8_t has_inner_key;
+    prefix_t outer_key;     /* keys of the last entry returned */
+    prefix_t inner_key;
+} mdb_iter_t;
+
 mdb_t *mdb_new();
 void mdb_del(mdb_t *db, mdb_del_fct del_fct);
 int mdb_add_entry(mdb_t *db, lisp_addr_t *addr, void *data);
@@ -58,164 +101,62 @@ void *mdb_lookup_entry(mdb_t *db, lisp_addr_t *laddr);
 void *mdb_lookup_entry_exact(mdb_t *db, lisp_addr_t *laddr);
 int mdb_n_entries(mdb_t *);
 
+void mdb_iter_init(mdb_iter_t *it, mdb_t *db, int flags);
+void *mdb_iter_next(mdb_iter_t *it);
+
 patricia_tree_t *_get_local_db_for_lcaf_addr(mdb_t *db, lcaf_addr_t *lcaf);
 patricia_tree_t *_get_local_db_for_addr(mdb_t *db, lisp_addr_t *addr);
 
 
-#define mdb_foreach_entry(_mdb, _it) \
-    do {                                                                            \
-        void * _pt_;                                                                 \
-        glist_entry_t *_pt_it_;                                                     \
-        patricia_tree_t *_ptree_;                                                   \
-        patricia_node_t *_node, *_nodein;                                           \
-        glist_t *_pt_list_ = glist_new();                                           \
-        glist_add((_mdb)->AF4_ip_db,_pt_list_);                                     \
-        glist_add((_mdb)->AF6_ip_db,_pt_list_);                                     \
-        int_htable_foreach_value((_mdb)->AF4_iid_db,_pt_){                          \
-            glist_add(_pt_,_pt_list_);                                              \
-        }int_htable_foreach_value_end;                                              \
-        int_htable_foreach_value((_mdb)->AF6_iid_db,_pt_){                          \
-            glist_add(_pt_,_pt_list_);                                              \
-        }int_htable_foreach_value_end;                                              \
-        glist_add((_mdb)->AF4_mc_db,_pt_list_);                                     \
-        glist_add((_mdb)->AF4_mc_db,_pt_list_);                                     \
-        glist_for_each_entry(_pt_it_, _pt_list_){                                   \
-            _ptree_ = (patricia_tree_t *)glist_entry_data(_pt_it_);                 \
-            PATRICIA_WALK(_ptree_->head, _node) {                                   \
-                PATRICIA_WALK(((patricia_tree_t *)(_node->data))->head, _nodein) {  \
-                    if ((_it = _nodein->data)){
+#define mdb_foreach_entry(_mdb, _it)                                    \
+    do {                                                                \
+        mdb_iter_t _mdb_it_;                                            \
+        mdb_iter_init(&_mdb_it_, (_mdb), MDB_ITER_ALL);                 \
+        while (((_it) = mdb_iter_next(&_mdb_it_))) {
 
 #define mdb_foreach_entry_end           \
-                    }                   \
-                } PATRICIA_WALK_END;    \
-            } PATRICIA_WALK_END;        \
         }                               \
-        glist_destroy(_pt_list_);       \
     } while (0)
 
 
-#define mdb_foreach_entry_with_break(_mdb, _it, _break) \
-    do {                                                                            \
-        void * _pt_;                                                                 \
-        glist_entry_t *_pt_it_;                                                     \
-        patricia_tree_t *_ptree_;                                                   \
-        patricia_node_t *_node, *_nodein;                                           \
-        glist_t *_pt_list_ = glist_new();                                           \
-        glist_add((_mdb)->AF4_ip_db,_pt_list_);                                     \
-        glist_add((_mdb)->AF6_ip_db,_pt_list_);                                     \
-        int_htable_foreach_value((_mdb)->AF4_iid_db,_pt_){                          \
-            glist_add(_pt_,_pt_list_);                                              \
-        }int_htable_foreach_value_end;                                              \
-        int_htable_foreach_value((_mdb)->AF6_iid_db,_pt_){                          \
-            glist_add(_pt_,_pt_list_);                                              \
-        }int_htable_foreach_value_end;                                              \
-        glist_add((_mdb)->AF4_mc_db,_pt_list_);                                     \
-        glist_add((_mdb)->AF4_mc_db,_pt_list_);                                     \
-        glist_for_each_entry(_pt_it_, _pt_list_){                                   \
-            _ptree_ = (patricia_tree_t *)glist_entry_data(_pt_it_);                 \
-            PATRICIA_WALK(_ptree_->head, _node) {                                   \
-                PATRICIA_WALK(((patricia_tree_t *)(_node->data))->head, _nodein) {  \
-                    if ((_it = _nodein->data)){
+#define mdb_foreach_entry_with_break(_mdb, _it, _break)                 \
+    mdb_foreach_entry(_mdb, _it)
 
 #define mdb_foreach_entry_with_break_end(_break) \
-                        if (_break){    \
-                            break;      \
-                        }               \
-                    }                   \
-                } PATRICIA_WALK_END;    \
-                if (_break){            \
-                    break;              \
-                }                       \
-            } PATRICIA_WALK_END;        \
             if (_break){                \
                 break;                  \
             }                           \
-        }                               \
-        glist_destroy(_pt_list_);       \
-    } while (0)
+    mdb_foreach_entry_end
 
 
-#define mdb_foreach_ip_entry(_mdb, _it)                                             \
-    do {                                                                            \
-        void * _pt_;                                                                \
-        glist_entry_t *_pt_it_;                                                     \
-        patricia_tree_t *_ptree_;                                                   \
-        patricia_node_t *_node, *_nodein;                                           \
-        glist_t *_pt_list_ = glist_new();                                           \
-        glist_add((_mdb)->AF4_ip_db,_pt_list_);                                     \
-        glist_add((_mdb)->AF6_ip_db,_pt_list_);                                     \
-        int_htable_foreach_value((_mdb)->AF4_iid_db,_pt_){                          \
-            glist_add(_pt_,_pt_list_);                                              \
-        }int_htable_foreach_value_end;                                              \
-        int_htable_foreach_value((_mdb)->AF6_iid_db,_pt_){                          \
-            glist_add(_pt_,_pt_list_);                                              \
-        }int_htable_foreach_value_end;                                              \
-        glist_for_each_entry(_pt_it_, _pt_list_){                                   \
-            _ptree_ = (patricia_tree_t *)glist_entry_data(_pt_it_);                 \
-            PATRICIA_WALK(_ptree_->head, _node) {                                   \
-                PATRICIA_WALK(((patricia_tree_t *)(_node->data))->head, _nodein) {  \
-                if ((_it = _nodein->data)){
+#define mdb_foreach_ip_entry(_mdb, _it)                                 \
+    do {                                                                \
+        mdb_iter_t _mdb_it_;                                            \
+        mdb_iter_init(&_mdb_it_, (_mdb), MDB_ITER_IP);                  \
+        while (((_it) = mdb_iter_next(&_mdb_it_))) {
 
 #define mdb_foreach_ip_entry_end        \
-                }                       \
-                } PATRICIA_WALK_END;    \
-            } PATRICIA_WALK_END;        \
         }                               \
-        glist_destroy(_pt_list_);       \
     } while (0)
 
 
-#define mdb_foreach_ip_entry_with_break(_mdb, _it, _break)                          \
-    do {                                                                            \
-        void * _pt_;                                                                \
-        glist_entry_t *_pt_it_;                                                     \
-        patricia_tree_t *_ptree_;                                                   \
-        patricia_node_t *_node, *_nodein;                                           \
-        glist_t *_pt_list_ = glist_new();                                           \
-        glist_add((_mdb)->AF4_ip_db,_pt_list_);                                     \
-        glist_add((_mdb)->AF6_ip_db,_pt_list_);                                     \
-        int_htable_foreach_value((_mdb)->AF4_iid_db,_pt_){                          \
-            glist_add(_pt_,_pt_list_);                                              \
-        }int_htable_foreach_value_end;                                              \
-        int_htable_foreach_value((_mdb)->AF6_iid_db,_pt_){                          \
-            glist_add(_pt_,_pt_list_);                                              \
-        }int_htable_foreach_value_end;                                              \
-        glist_for_each_entry(_pt_it_, _pt_list_){                                   \
-            _ptree_ = (patricia_tree_t *)glist_entry_data(_pt_it_);                 \
-            PATRICIA_WALK(_ptree_->head, _node) {                                   \
-                PATRICIA_WALK(((patricia_tree_t *)(_node->data))->head, _nodein) {  \
-                    if ((_it = _nodein->data)){
+#define mdb_foreach_ip_entry_with_break(_mdb, _it, _break)              \
+    mdb_foreach_ip_entry(_mdb, _it)
 
 #define mdb_foreach_ip_entry_with_break_end(_break)        \
-                        if (_break){    \
-                            break;      \
-                        }               \
-                    }                   \
-                } PATRICIA_WALK_END;    \
-                if (_break){            \
-                    break;              \
-                }                       \
-            } PATRICIA_WALK_END;        \
             if (_break){                \
                 break;                  \
             }                           \
-        } glist_destroy(_pt_list_);     \
-    } while (0)
+    mdb_foreach_ip_entry_end
 
-#define mdb_foreach_mc_entry(_mdb, _it) \
-    do { \
-        patricia_tree_t *_ptstack[2] = {(_mdb)->AF4_mc_db, (_mdb)->AF6_mc_db};  \
-        patricia_node_t *_node, *_nodemc;                                       \
-        int _i;                                                                 \
-        for (_i=0; _i < 2; _i++) {                                              \
-            PATRICIA_WALK(_ptstack[_i]->head, _node) {                          \
-                PATRICIA_WALK(((patricia_tree_t *)(_node->data))->head, _nodemc) {      \
-                    if ((_it = _nodemc->data)){
-
-#define mdb_foreach_mc_entry_end \
-                    }                   \
-                } PATRICIA_WALK_END;    \
-            } PATRICIA_WALK_END;        \
+
+#define mdb_foreach_mc_entry(_mdb, _it)                                 \
+    do {                                                                \
+        mdb_iter_t _mdb_it_;                                            \
+        mdb_iter_init(&_mdb_it_, (_mdb), MDB_ITER_MC);                  \
+        while (((_it) = mdb_iter_next(&_mdb_it_))) {
+
+#define mdb_foreach_mc_entry_end        \
         }                               \
     } while (0)
 
@@ -0,0 +1,171 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "mcast_table.h"
+#include "mem_util.h"
+#include "oor_log.h"
+#include "lru_list.h"
+#include "util.h"
+
+/* Time after which an entry is considered to have timed out and is removed
+ * from the table. Same values as the tuple table */
+#define TIMEOUT 3
+#define NEGATIVE_TIMEOUT 0.1
+
+/* Maximum size of the multicast forwarding table */
+#define MAX_SIZE 1000
+#define OLD_ENTRIES 100
+
+static void mcast_table_remove_with_khiter(mcast_table_t *mt, khiter_t k);
+
+static int
+mcast_entry_expired(mcast_entry_t *entry)
+{
+    if (entry->temporal){
+        return (time_elapsed(&entry->ts) > NEGATIVE_TIMEOUT);
+    }
+    return (time_elapsed(&entry->ts) > TIMEOUT);
+}
+
+static int
+mcast_lru_expired(struct ovs_list *list_elt)
+{
+    return (mcast_entry_expired(CONTAINER_OF(list_elt, mcast_entry_t, list_elt)));
+}
+
+static void
+mcast_lru_remove(mcast_table_t *mt, struct ovs_list *list_elt)
+{
+    mcast_entry_t *entry = CONTAINER_OF(list_elt, mcast_entry_t, list_elt);
+    mcast_table_remove(mt, &entry->key);
+}
+
+static void
+mcast_entry_del(mcast_entry_t *entry)
+{
+    free(entry->reps);
+    free(entry);
+}
+
+void
+mcast_table_init(mcast_table_t *mt)
+{
+    mt->htable = kh_init(mcast);
+    list_init(&mt->head_list);
+}
+
+void
+mcast_table_uninit(mcast_table_t *mt)
+{
+    khiter_t k;
+
+    for (k = kh_begin(mt->htable); k != kh_end(mt->htable); ++k){
+        if (kh_exist(mt->htable, k)){
+            mcast_entry_del(kh_value(mt->htable,k));
+        }
+    }
+    kh_destroy(mcast, mt->htable);
+}
+
+mcast_entry_t *
+mcast_table_insert(mcast_table_t *mt, mcast_key_t *key, uint32_t iid,
+        uint8_t temporal, int n_reps)
+{
+    khiter_t k;
+    int ret;
+    mcast_entry_t *entry;
+
+    k = kh_get(mcast, mt->htable, key);
+    if (k != kh_end(mt->htable)){
+        mcast_table_remove_with_khiter(mt, k);
+    }
+
+    /* If table is full, remove expired entries. If it is still full, remove
+     * old entries */
+    if (kh_size(mt->htable) >= MAX_SIZE) {
+        OOR_LOG(LDBG_1,"mcast_table_insert: Max size of multicast forwarding table reached. "
+                "Removing expired and older entries");
+        lru_list_evict(&mt->head_list, OLD_ENTRIES, mt, mcast_lru_expired,
+                (lru_remove_fct)mcast_lru_remove);
+    }
+
+    entry = xzalloc(sizeof(mcast_entry_t));
+    entry->key = *key;
+    entry->iid = iid;
+    entry->temporal = temporal;
+    entry->n_reps = n_reps;
+    if (n_reps > 0){
+        entry->reps = xzalloc(n_reps * sizeof(mcast_rep_t));
+    }
+    clock_gettime(CLOCK_MONOTONIC, &entry->ts);
+
+    lru_list_add(&mt->head_list, &entry->list_elt);
+
+    k = kh_put(mcast, mt->htable, &entry->key, &ret);
+    kh_value(mt->htable, k) = entry;
+    OOR_LOG(LDBG_3,"mcast_table_insert: (%s, %s) replicated to %d RLOCs",
+            addr_key_to_char(&key->src), addr_key_to_char(&key->dst), n_reps);
+
+    return (entry);
+}
+
+void
+mcast_table_remove(mcast_table_t *mt, mcast_key_t *key)
+{
+    khiter_t k;
+
+    k = kh_get(mcast, mt->htable, key);
+    if (k == kh_end(mt->htable)){
+        return;
+    }
+    mcast_table_remove_with_khiter(mt, k);
+}
+
+static void
+mcast_table_remove_with_khiter(mcast_table_t *mt, khiter_t k)
+{
+    mcast_entry_t *entry;
+
+    entry = kh_value(mt->htable,k);
+    list_remove(&entry->list_elt);
+    kh_del(mcast, mt->htable, k);
+    mcast_entry_del(entry);
+}
+
+mcast_entry_t *
+mcast_table_lookup(mcast_table_t *mt, mcast_key_t *key)
+{
+    mcast_entry_t *entry;
+    khiter_t k;
+
+    k = kh_get(mcast, mt->htable, key);
+    if (k == kh_end(mt->htable)){
+        return (NULL);
+    }
+    entry = kh_value(mt->htable,k);
+
+    if (mcast_entry_expired(entry)){
+        mcast_table_remove_with_khiter(mt, k);
+        return (NULL);
+    }
+
+    lru_list_touch(&mt->head_list, &entry->list_elt);
+
+    return (entry);
+}
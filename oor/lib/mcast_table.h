@@ -0,0 +1,71 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef MCAST_TABLE_H_
+#define MCAST_TABLE_H_
+
+#include <time.h>
+#include "addr_key.h"
+#include "packets.h"
+#include "../elibs/khash/khash.h"
+#include "../elibs/ovs/list.h"
+
+/*
+ * Multicast forwarding table of the data plane. It caches, for each (S,G)
+ * channel of an IID, the replication list obtained from the control plane,
+ * so that the map-cache is only consulted once per channel and timeout.
+ */
+
+/* Source ('src') and group ('dst') of the channel, with the IID */
+typedef addr_pair_key_t mcast_key_t;
+
+/* A destination of the replication list */
+typedef struct mcast_rep {
+    ip_addr_t   srloc;
+    ip_addr_t   drloc;
+    int         *out_sock;
+} mcast_rep_t;
+
+typedef struct mcast_entry {
+    struct ovs_list list_elt;
+    mcast_key_t     key;
+    uint32_t        iid;        /* IID to be written in the LISP header */
+    uint8_t         temporal;   /* No mapping yet. Short timeout */
+    int             n_reps;
+    mcast_rep_t     *reps;
+    struct timespec ts;
+} mcast_entry_t;
+
+KHASH_INIT(mcast, mcast_key_t *, mcast_entry_t *, 1, addr_pair_key_hash, addr_pair_key_equal)
+
+typedef struct mcast_table {
+    khash_t(mcast) *htable;
+    struct ovs_list head_list; /* To order entries */
+} mcast_table_t;
+
+void mcast_table_init(mcast_table_t *mt);
+void mcast_table_uninit(mcast_table_t *mt);
+/* Add an entry to the table. The entry is returned so that the caller can
+ * fill its 'n_reps' destinations */
+mcast_entry_t *mcast_table_insert(mcast_table_t *mt, mcast_key_t *key,
+        uint32_t iid, uint8_t temporal, int n_reps);
+void mcast_table_remove(mcast_table_t *mt, mcast_key_t *key);
+mcast_entry_t *mcast_table_lookup(mcast_table_t *mt, mcast_key_t *key);
+
+#endif /* MCAST_TABLE_H_ */
@@ -17,6 +17,8 @@
  *
  */
 
+#include <sys/mman.h>
+
 #include "mem_util.h"
 #include "oor_log.h"
 
@@ -87,6 +89,314 @@ xstrdup(const char *s)
     return xmemdup0(s, strlen(s));
 }
 
+
+/* Slabs, arenas and regions in use, for the statistics */
+static mem_slab_t *slabs = NULL;
+static mem_arena_t *arenas = NULL;
+static mem_huge_t *huge_regions = NULL;
+
+#ifndef MEM_NO_SLAB
+static void
+mem_slab_grow(mem_slab_t *slab)
+{
+    uint8_t *block;
+    void *obj;
+    int nobjs, i;
+
+    block = xmalloc(MEM_SLAB_BLOCK_SIZE);
+    nobjs = MEM_SLAB_BLOCK_SIZE / slab->obj_size;
+    for (i = nobjs - 1; i >= 0; i--) {
+        obj = block + i * slab->obj_size;
+        *(void **)obj = slab->free_list;
+        slab->free_list = obj;
+    }
+    slab->blocks++;
+}
+#endif
+
+void *
+mem_slab_alloc(mem_slab_t *slab)
+{
+    void *obj;
+
+    if (!slab->registered) {
+        lm_assert(slab->obj_size <= MEM_SLAB_BLOCK_SIZE);
+        slab->next = slabs;
+        slabs = slab;
+        slab->registered = TRUE;
+    }
+
+#ifdef MEM_NO_SLAB
+    obj = xzalloc(slab->obj_size);
+#else
+    if (slab->free_list == NULL) {
+        mem_slab_grow(slab);
+    }
+    obj = slab->free_list;
+    slab->free_list = *(void **)obj;
+    memset(obj, 0, slab->obj_size);
+#endif
+
+    slab->allocs++;
+    if (++slab->in_use > slab->max_in_use) {
+        slab->max_in_use = slab->in_use;
+    }
+    return (obj);
+}
+
+void
+mem_slab_free(mem_slab_t *slab, void *obj)
+{
+    if (obj == NULL) {
+        return;
+    }
+
+#ifdef MEM_NO_SLAB
+    free(obj);
+#else
+    *(void **)obj = slab->free_list;
+    slab->free_list = obj;
+#endif
+
+    slab->frees++;
+    slab->in_use--;
+}
+
+/* Maximum size the chunks of an arena grow to */
+#define MEM_ARENA_MAX_CHUNK     65536
+
+void
+mem_arena_init(mem_arena_t *arena, const char *name, size_t chunk_size)
+{
+    memset(arena, 0, sizeof(mem_arena_t));
+    arena->name = name;
+    arena->chunk_size = chunk_size;
+    arena->next = arenas;
+    arenas = arena;
+}
+
+static void
+mem_arena_free_chunks(mem_arena_t *arena)
+{
+    mem_arena_chunk_t *chunk;
+
+    while (arena->chunks != NULL) {
+        chunk = arena->chunks;
+        arena->chunks = chunk->next;
+        free(chunk);
+    }
+}
+
+void
+mem_arena_uninit(mem_arena_t *arena)
+{
+    mem_arena_t **it;
+
+    mem_arena_reset(arena);
+    mem_arena_free_chunks(arena);
+    for (it = &arenas; *it != NULL; it = &(*it)->next) {
+        if (*it == arena) {
+            *it = arena->next;
+            break;
+        }
+    }
+}
+
+/* Slow path of mem_arena_alloc: the object doesn't fit in the current chunk.
+ * 'size' is already rounded */
+void *
+mem_arena_alloc_chunk(mem_arena_t *arena, size_t size)
+{
+    mem_arena_chunk_t *chunk;
+    size_t chunk_size;
+    void *obj;
+
+    chunk_size = size > arena->chunk_size ? size : arena->chunk_size;
+    chunk = xmalloc(MEM_ARENA_CHUNK_HDR + chunk_size);
+    chunk->size = chunk_size;
+    chunk->used = size;
+    chunk->next = arena->chunks;
+    arena->chunks = chunk;
+
+    obj = (uint8_t *)chunk + MEM_ARENA_CHUNK_HDR;
+    memset(obj, 0, size);
+
+    arena->allocs++;
+    arena->used += size;
+    return (obj);
+}
+
+/* Call 'fct' with 'obj' when the arena is reset */
+void
+mem_arena_add_cleanup(mem_arena_t *arena, mem_arena_cleanup_fct fct, void *obj)
+{
+    mem_arena_cleanup_t *cleanup;
+
+    cleanup = mem_arena_alloc(arena, sizeof(mem_arena_cleanup_t));
+    cleanup->fct = fct;
+    cleanup->obj = obj;
+    cleanup->next = arena->cleanups;
+    arena->cleanups = cleanup;
+}
+
+/* Release all the objects of the arena. The first chunk is kept for the next
+ * message. If the objects didn't fit in it, the chunk grows to the size used */
+void
+mem_arena_reset(mem_arena_t *arena)
+{
+    mem_arena_cleanup_t *cleanup;
+
+    if (arena->used > arena->max_used) {
+        arena->max_used = arena->used;
+    }
+
+    for (cleanup = arena->cleanups; cleanup != NULL; cleanup = cleanup->next) {
+        cleanup->fct(cleanup->obj);
+    }
+    arena->cleanups = NULL;
+
+    if (arena->chunks != NULL && arena->chunks->next != NULL) {
+        mem_arena_free_chunks(arena);
+        if (arena->used > arena->chunk_size) {
+            arena->chunk_size = arena->used < MEM_ARENA_MAX_CHUNK ?
+                    arena->used : MEM_ARENA_MAX_CHUNK;
+        }
+    } else if (arena->chunks != NULL) {
+        arena->chunks->used = 0;
+    }
+
+    if (arena->used > 0) {
+        arena->resets++;
+    }
+    arena->used = 0;
+}
+
+/* Map 'size' bytes, rounded up to whole huge pages, preferring huge pages */
+void
+mem_huge_init(mem_huge_t *region, const char *name, size_t size)
+{
+    uint8_t *mem = MAP_FAILED;
+    size_t head;
+
+    memset(region, 0, sizeof(mem_huge_t));
+    region->name = name;
+    region->size = (size + MEM_HUGE_PAGE_SIZE - 1) & ~((size_t)MEM_HUGE_PAGE_SIZE - 1);
+
+#if defined(MAP_HUGETLB) && !defined(MEM_NO_HUGEPAGES)
+    mem = mmap(NULL, region->size, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (mem != MAP_FAILED) {
+        region->pages = MEM_PAGES_HUGETLB;
+    }
+#endif
+
+    if (mem == MAP_FAILED) {
+        /* Align the region to a huge page so that it can be backed by
+         * transparent huge pages */
+        mem = mmap(NULL, region->size + MEM_HUGE_PAGE_SIZE,
+                PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mem == MAP_FAILED) {
+            out_of_memory();
+        }
+        head = -(uintptr_t)mem & (MEM_HUGE_PAGE_SIZE - 1);
+        if (head > 0) {
+            munmap(mem, head);
+            mem += head;
+        }
+        munmap(mem + region->size, MEM_HUGE_PAGE_SIZE - head);
+        region->pages = MEM_PAGES_NORMAL;
+#if defined(MADV_HUGEPAGE) && !defined(MEM_NO_HUGEPAGES)
+        if (madvise(mem, region->size, MADV_HUGEPAGE) == 0) {
+            region->pages = MEM_PAGES_THP;
+        }
+#endif
+    }
+
+    region->base = mem;
+    region->next = huge_regions;
+    huge_regions = region;
+    OOR_LOG(LDBG_1, "Memory region %s: %zu KB of %s", name, region->size / 1024,
+            mem_pages_to_char(region->pages));
+}
+
+void
+mem_huge_uninit(mem_huge_t *region)
+{
+    mem_huge_t **it;
+
+    if (region->base == NULL) {
+        return;
+    }
+    munmap(region->base, region->size);
+    region->base = NULL;
+    for (it = &huge_regions; *it != NULL; it = &(*it)->next) {
+        if (*it == region) {
+            *it = region->next;
+            break;
+        }
+    }
+}
+
+/* Zeroed buffer of 'size' bytes, aligned to a cache line, that lives until
+ * the region is released */
+void *
+mem_huge_carve(mem_huge_t *region, size_t size)
+{
+    void *buf;
+
+    size = (size + MEM_HUGE_ALIGN - 1) & ~((size_t)MEM_HUGE_ALIGN - 1);
+    lm_assert(region->used + size <= region->size);
+
+    buf = region->base + region->used;
+    region->used += size;
+    memset(buf, 0, size);
+    return (buf);
+}
+
+char *
+mem_pages_to_char(mem_pages_e pages)
+{
+    switch (pages) {
+    case MEM_PAGES_HUGETLB:
+        return ("huge pages");
+    case MEM_PAGES_THP:
+        return ("transparent huge pages");
+    default:
+        return ("normal pages");
+    }
+}
+
+void
+mem_stats_dump(int log_level)
+{
+    mem_slab_t *slab;
+    mem_arena_t *arena;
+    mem_huge_t *region;
+
+    if (is_loggable(log_level) == FALSE) {
+        return;
+    }
+
+    OOR_LOG(log_level, "Slab              Size    In use       Max  Blocks"
+            "           Allocs");
+    for (slab = slabs; slab != NULL; slab = slab->next) {
+        OOR_LOG(log_level, "%-16s %5zu %9u %9u %7u %16"PRIu64, slab->name,
+                slab->obj_size, slab->in_use, slab->max_in_use, slab->blocks,
+                slab->allocs);
+    }
+    for (arena = arenas; arena != NULL; arena = arena->next) {
+        OOR_LOG(log_level, "Arena %s: chunk of %zu bytes, up to %zu bytes used, "
+                "%"PRIu64" allocations in %"PRIu64" resets", arena->name,
+                arena->chunk_size, arena->max_used, arena->allocs,
+                arena->resets);
+    }
+    for (region = huge_regions; region != NULL; region = region->next) {
+        OOR_LOG(log_level, "Region %s: %zu KB of %s, %zu KB used", region->name,
+                region->size / 1024, mem_pages_to_char(region->pages),
+                region->used / 1024);
+    }
+}
+
 void
 lm_assert_failure(const char *where, const char *function,
                    const char *condition)
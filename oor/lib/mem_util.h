@@ -101,4 +101,143 @@ void *xmemdup(const void *p_, size_t size);
 char *xmemdup0(const char *p_, size_t length);
 char *xstrdup(const char *s);
 
+
+/*
+ * Slab allocator for the small objects that are allocated and released all
+ * the time. Each object type has its own slab, with the size of the object
+ * rounded up to a multiple of MEM_SLAB_ALIGN. Objects are carved from blocks
+ * of MEM_SLAB_BLOCK_SIZE bytes and, when freed, kept in a free list to be
+ * reused. Blocks are never returned to the system. Objects are zeroed when
+ * allocated. Compile with -DMEM_NO_SLAB to use malloc for each object, e.g.
+ * to look for leaks with valgrind.
+ */
+
+#define MEM_SLAB_ALIGN          16
+#define MEM_SLAB_BLOCK_SIZE     16384
+#define MEM_SLAB_SIZE(_size) \
+    (((_size) + MEM_SLAB_ALIGN - 1) & ~((size_t)MEM_SLAB_ALIGN - 1))
+
+typedef struct mem_slab {
+    const char          *name;
+    size_t              obj_size;
+    void                *free_list;
+    struct mem_slab     *next;          /* List of slabs in use */
+    uint8_t             registered;
+    /* Statistics */
+    uint64_t            allocs;
+    uint64_t            frees;
+    uint32_t            in_use;
+    uint32_t            max_in_use;
+    uint32_t            blocks;
+} mem_slab_t;
+
+#define MEM_SLAB_INITIALIZER(_name, _type) \
+    { _name, MEM_SLAB_SIZE(sizeof(_type)), NULL, NULL, 0, 0, 0, 0, 0, 0 }
+
+void *mem_slab_alloc(mem_slab_t *slab);
+void mem_slab_free(mem_slab_t *slab, void *obj);
+
+
+/*
+ * Arena for the temporary objects used while processing a message. Objects
+ * are carved sequentially from chunks of memory and all of them are released
+ * at once by mem_arena_reset. They can't be freed individually: objects that
+ * own other memory register a cleanup function that is called on reset.
+ */
+
+typedef void (*mem_arena_cleanup_fct)(void *);
+
+typedef struct mem_arena_chunk {
+    struct mem_arena_chunk  *next;
+    size_t                  size;
+    size_t                  used;
+} mem_arena_chunk_t;
+
+/* Objects of the arena start after the header of the chunk */
+#define MEM_ARENA_CHUNK_HDR     MEM_SLAB_SIZE(sizeof(mem_arena_chunk_t))
+
+typedef struct mem_arena_cleanup {
+    struct mem_arena_cleanup    *next;
+    mem_arena_cleanup_fct       fct;
+    void                        *obj;
+} mem_arena_cleanup_t;
+
+typedef struct mem_arena {
+    const char              *name;
+    size_t                  chunk_size;
+    mem_arena_chunk_t       *chunks;    /* The first one is the current */
+    mem_arena_cleanup_t     *cleanups;
+    struct mem_arena        *next;      /* List of arenas in use */
+    /* Statistics */
+    size_t                  used;       /* Bytes used since the last reset */
+    size_t                  max_used;
+    uint64_t                allocs;
+    uint64_t                resets;
+} mem_arena_t;
+
+void mem_arena_init(mem_arena_t *arena, const char *name, size_t chunk_size);
+void mem_arena_uninit(mem_arena_t *arena);
+void *mem_arena_alloc_chunk(mem_arena_t *arena, size_t size);
+void mem_arena_add_cleanup(mem_arena_t *arena, mem_arena_cleanup_fct fct,
+        void *obj);
+void mem_arena_reset(mem_arena_t *arena);
+
+/* Zeroed object of 'size' bytes that lives until the next reset */
+static inline void *
+mem_arena_alloc(mem_arena_t *arena, size_t size)
+{
+    mem_arena_chunk_t *chunk = arena->chunks;
+    void *obj;
+
+    size = MEM_SLAB_SIZE(size ? size : 1);
+    if (LM_UNLIKELY(chunk == NULL || chunk->used + size > chunk->size)) {
+        return (mem_arena_alloc_chunk(arena, size));
+    }
+
+    obj = (uint8_t *)chunk + MEM_ARENA_CHUNK_HDR + chunk->used;
+    chunk->used += size;
+    memset(obj, 0, size);
+
+    arena->allocs++;
+    arena->used += size;
+    return (obj);
+}
+
+
+/*
+ * Region of memory for the buffers accessed on every packet, backed by huge
+ * pages when the system provides them so that all the buffers share a few
+ * TLB entries. Explicit huge pages (MAP_HUGETLB) are tried first, then
+ * transparent huge pages, and otherwise normal pages are used. Buffers are
+ * carved from the region by the thread that uses them, so that the kernel
+ * places them in its NUMA node, and are released all together with the
+ * region. Compile with -DMEM_NO_HUGEPAGES to always use normal pages.
+ */
+
+#define MEM_HUGE_PAGE_SIZE      (2 * 1024 * 1024)
+#define MEM_HUGE_ALIGN          64
+
+typedef enum mem_pages {
+    MEM_PAGES_NORMAL,
+    MEM_PAGES_THP,
+    MEM_PAGES_HUGETLB
+} mem_pages_e;
+
+typedef struct mem_huge {
+    const char              *name;
+    uint8_t                 *base;
+    size_t                  size;
+    size_t                  used;
+    mem_pages_e             pages;
+    struct mem_huge         *next;      /* List of regions in use */
+} mem_huge_t;
+
+void mem_huge_init(mem_huge_t *region, const char *name, size_t size);
+void mem_huge_uninit(mem_huge_t *region);
+void *mem_huge_carve(mem_huge_t *region, size_t size);
+char *mem_pages_to_char(mem_pages_e pages);
+
+/* Log the statistics of the slabs, arenas and regions in use */
+void mem_stats_dump(int log_level);
+
 #endif /* MEM_UTIL_H_ */
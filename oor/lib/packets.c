@@ -23,6 +23,8 @@
 #include <netinet/in.h>
 #include <netinet/ip.h>
 #include <netinet/ip6.h>
+#include <netinet/ip_icmp.h>
+#include <netinet/icmp6.h>
 #include <netinet/tcp.h>
 #include <netinet/udp.h>
 
@@ -171,6 +173,69 @@ pkt_push_ip(lbuf_t *b, ip_addr_t *src, ip_addr_t *dst, int proto)
     return(iph);
 }
 
+/*
+ * Build in 'b' an ICMP Fragmentation Needed (IPv4) or an ICMPv6 Packet Too Big
+ * message reporting 'mtu' to the source of the IP packet 'orig'. The message
+ * is sourced from the destination address of 'orig'. No message is built in
+ * response to ICMP errors.
+ */
+int
+pkt_push_icmp_too_big(lbuf_t *b, uint8_t *orig, int orig_len, int mtu)
+{
+    struct ip *oiph;
+    struct ip6_hdr *oip6h, *ip6h;
+    struct icmphdr *icmph;
+    struct icmp6_hdr *icmp6h;
+    int len;
+
+    oiph = (struct ip *)orig;
+    switch (oiph->ip_v) {
+    case IPVERSION:
+        if (oiph->ip_p == IPPROTO_ICMP && orig_len > (oiph->ip_hl << 2)) {
+            icmph = (struct icmphdr *)CO(orig, (oiph->ip_hl << 2));
+            if (icmph->type != ICMP_ECHO && icmph->type != ICMP_ECHOREPLY) {
+                return (BAD);
+            }
+        }
+        len = orig_len < ICMP_TOO_BIG_MAX_LEN_V4 ? orig_len : ICMP_TOO_BIG_MAX_LEN_V4;
+        lbuf_put(b, orig, len);
+        icmph = lbuf_push_uninit(b, sizeof(struct icmphdr));
+        icmph->type = ICMP_DEST_UNREACH;
+        icmph->code = ICMP_FRAG_NEEDED;
+        icmph->un.gateway = 0;
+        icmph->un.frag.mtu = htons(mtu);
+        icmph->checksum = 0;
+        icmph->checksum = ip_checksum((uint16_t *)icmph, lbuf_size(b));
+        pkt_push_ipv4(b, &oiph->ip_dst, &oiph->ip_src, IPPROTO_ICMP);
+        break;
+    case IP6VERSION:
+        oip6h = (struct ip6_hdr *)orig;
+        if (oip6h->ip6_nxt == IPPROTO_ICMPV6
+                && orig_len > sizeof(struct ip6_hdr)
+                && !(*CO(orig, sizeof(struct ip6_hdr)) & ICMP6_INFOMSG_MASK)) {
+            return (BAD);
+        }
+        len = orig_len < ICMP_TOO_BIG_MAX_LEN_V6 ? orig_len : ICMP_TOO_BIG_MAX_LEN_V6;
+        lbuf_put(b, orig, len);
+        icmp6h = lbuf_push_uninit(b, sizeof(struct icmp6_hdr));
+        icmp6h->icmp6_type = ICMP6_PACKET_TOO_BIG;
+        icmp6h->icmp6_code = 0;
+        icmp6h->icmp6_mtu = htonl(mtu);
+        icmp6h->icmp6_cksum = 0;
+        len = lbuf_size(b);
+        ip6h = pkt_push_ipv6(b, &oip6h->ip6_dst, &oip6h->ip6_src,
+                IPPROTO_ICMPV6);
+        icmp6h->icmp6_cksum = ~cksum_fold(cksum_add(
+                cksum_pseudo_hdr(ip6h, AF_INET6, IPPROTO_ICMPV6, len),
+                icmp6h, len));
+        break;
+    default:
+        return (BAD);
+    }
+
+    return (GOOD);
+}
+
 int
 pkt_push_udp_and_ip(lbuf_t *b, uint16_t sp, uint16_t dp, ip_addr_t *sip,
         ip_addr_t *dip)
@@ -259,10 +324,9 @@ pkt_parse_5_tuple(lbuf_t *b, packet_tuple_t *tuple)
 uint32_t
 pkt_tuple_hash(packet_tuple_t *tuple)
 {
-    int hash = 0;
     int len = 0;
     int port = tuple->src_port;
-    uint32_t *tuples = NULL;
+    uint32_t tuples[11];
 
     port = port + ((int)tuple->dst_port << 16);
     switch (lisp_addr_ip_afi(&tuple->src_addr)){
@@ -273,7 +337,6 @@ pkt_tuple_hash(packet_tuple_t *tuple)
          * + 1 integer protocol
          * + 1 iid*/
         len = 5;
-        tuples = xmalloc(len * sizeof(uint32_t));
         lisp_addr_copy_to(&tuples[0], &tuple->src_addr);
         lisp_addr_copy_to(&tuples[1], &tuple->dst_addr);
         tuples[2] = port;
@@ -287,19 +350,43 @@ pkt_tuple_hash(packet_tuple_t *tuple)
          * + 1 integer protocol
          * + 1 iid */
         len = 11;
-        tuples = xmalloc(len * sizeof(uint32_t));
         lisp_addr_copy_to(&tuples[0], &tuple->src_addr);
         lisp_addr_copy_to(&tuples[4], &tuple->dst_addr);
         tuples[8] = port;
         tuples[9] = tuple->protocol;
         tuples[10] = tuple->iid;
         break;
+    default:
+        return (0);
     }
 
     /* XXX: why 2013 used as initial value? */
-    hash = hashword(tuples, len, 2013);
-    free(tuples);
-    return (hash);
+    return (hashword(tuples, len, 2013));
+}
+
+/* Compact key of the tuple for the flow table */
+void
+pkt_tuple_to_flow_key(packet_tuple_t *tpl, flow_key_t *key)
+{
+    addr_key_from_ip(&key->src, lisp_addr_ip(&tpl->src_addr), tpl->iid);
+    addr_key_from_ip(&key->dst, lisp_addr_ip(&tpl->dst_addr), tpl->iid);
+    key->src_port = tpl->src_port;
+    key->dst_port = tpl->dst_port;
+    key->protocol = tpl->protocol;
+}
+
+char *
+flow_key_to_char(flow_key_t *key)
+{
+    static char buf[2][200];
+    static int i = 0;
+
+    /* hack to allow more than one key per line */
+    i++; i = i % 2;
+    snprintf(buf[i], sizeof(buf[i]), "%s:%u -> %s:%u proto %u",
+            addr_key_to_char(&key->src), key->src_port,
+            addr_key_to_char(&key->dst), key->dst_port, key->protocol);
+    return (buf[i]);
 }
 
 int
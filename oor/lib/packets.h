@@ -28,6 +28,7 @@
 #include <netinet/tcp.h>
 #include <netinet/udp.h>
 
+#include "addr_key.h"
 #include "lbuf.h"
 #include "mem_util.h"
 #include "../defs.h"
@@ -38,6 +39,11 @@
 #define MAX_IP_PKT_LEN          4096
 #define MAX_IP_HDR_LEN          40  /* without options or IPv6 hdr extensions */
 #define UDP_HDR_LEN             8
+#define IPV6_MIN_MTU            1280
+/* Bytes of the original packet quoted in ICMP errors: the whole error must
+ * fit in 576 bytes (IPv4) or in the IPv6 minimum MTU */
+#define ICMP_TOO_BIG_MAX_LEN_V4 (576 - 28)
+#define ICMP_TOO_BIG_MAX_LEN_V6 (IPV6_MIN_MTU - 48)
 
 #ifdef BSD
 #define udpsport(x) x->uh_sport
@@ -54,10 +60,22 @@
 #ifdef BSD
 #define tcpsport(x) x->th_sport
 #define tcpdport(x) x->th_dport
+#define tcpseq(x) x->th_seq
+#define tcpack(x) x->th_ack
+#define tcpoff(x) x->th_off
+#define tcpwin(x) x->th_win
+#define tcpsum(x) x->th_sum
 #else
 #define tcpsport(x) x->source
 #define tcpdport(x) x->dest
+#define tcpseq(x) x->seq
+#define tcpack(x) x->ack_seq
+#define tcpoff(x) x->doff
+#define tcpwin(x) x->window
+#define tcpsum(x) x->check
 #endif
+/* Byte with the TCP flags (FIN, SYN, RST, PSH, ACK, URG, ECE, CWR) */
+#define tcpflags(x) (((uint8_t *)(x))[13])
 
 
 
@@ -71,6 +89,39 @@ typedef struct packet_tuple {
     uint32_t                        iid;
 } packet_tuple_t;
 
+/* Compact form of the tuple used as key of the flow table. All its bytes
+ * are written so it is hashed and compared as words */
+typedef struct flow_key {
+    addr_key_t                      src;
+    addr_key_t                      dst;
+    uint16_t                        src_port;
+    uint16_t                        dst_port;
+    uint32_t                        protocol;
+} flow_key_t;
+
+#define FLOW_KEY_WORDS  (sizeof(flow_key_t) / sizeof(uint64_t))
+
+static inline int
+flow_key_equal(const flow_key_t *k1, const flow_key_t *k2)
+{
+    const uint64_t *w1 = (const uint64_t *)k1;
+    const uint64_t *w2 = (const uint64_t *)k2;
+    uint64_t diff = 0;
+    int i;
+
+    for (i = 0; i < FLOW_KEY_WORDS; i++) {
+        diff |= w1[i] ^ w2[i];
+    }
+    return (diff == 0);
+}
+
+static inline uint32_t
+flow_key_hash(const flow_key_t *key)
+{
+    return (hashword((const uint32_t *)key, sizeof(flow_key_t) / sizeof(uint32_t),
+            2013));
+}
+
 
 
 /*
@@ -101,6 +152,7 @@ void *pkt_push_udp(lbuf_t *, uint16_t , uint16_t);
 void *pkt_push_ip(lbuf_t *, ip_addr_t *, ip_addr_t *, int proto);
 int pkt_push_udp_and_ip(lbuf_t *, uint16_t, uint16_t, ip_addr_t *,
         ip_addr_t *);
+int pkt_push_icmp_too_big(lbuf_t *b, uint8_t *orig, int orig_len, int mtu);
 int ip_hdr_set_ttl_and_tos(struct iphdr *, int ttl, int tos);
 int ip_hdr_ttl_and_tos(struct iphdr *, int *ttl, int *tos);
 
@@ -110,6 +162,8 @@ int pkt_tuple_cmp(packet_tuple_t *t1, packet_tuple_t *t2);
 packet_tuple_t *pkt_tuple_clone(packet_tuple_t *);
 void pkt_tuple_del(packet_tuple_t *tpl);
 char *pkt_tuple_to_char(packet_tuple_t *tpl);
+void pkt_tuple_to_flow_key(packet_tuple_t *tpl, flow_key_t *key);
+char *flow_key_to_char(flow_key_t *key);
 
 char * ip_src_and_dst_to_char(struct iphdr *iph, char *fmt);
 
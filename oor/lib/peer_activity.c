@@ -0,0 +1,121 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "peer_activity.h"
+#include "oor_log.h"
+#include "../liblisp/lisp_lcaf.h"
+
+static time_t
+peer_activity_now()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec);
+}
+
+/* Rotate the buckets once the current one is PEER_ACTIVITY_PERIOD old */
+static void
+peer_activity_rotate(peer_activity_t *pa, time_t now)
+{
+    if (now - pa->start < PEER_ACTIVITY_PERIOD) {
+        return;
+    }
+    if (now - pa->start >= 2 * PEER_ACTIVITY_PERIOD) {
+        /* No traffic in the last period either */
+        kh_clear(peers, pa->bucket[pa->cur]);
+    }
+    pa->cur = !pa->cur;
+    kh_clear(peers, pa->bucket[pa->cur]);
+    pa->start = now;
+}
+
+void
+peer_activity_init(peer_activity_t *pa)
+{
+    pa->bucket[0] = kh_init(peers);
+    pa->bucket[1] = kh_init(peers);
+    pa->cur = 0;
+    pa->start = peer_activity_now();
+    pa->dropped = 0;
+}
+
+void
+peer_activity_uninit(peer_activity_t *pa)
+{
+    kh_destroy(peers, pa->bucket[0]);
+    kh_destroy(peers, pa->bucket[1]);
+}
+
+void
+peer_activity_add(peer_activity_t *pa, lisp_addr_t *rloc, lisp_addr_t *eid,
+        uint32_t iid)
+{
+    khash_t(peers) *b;
+    peer_key_t key;
+    int ret;
+
+    peer_activity_rotate(pa, peer_activity_now());
+    b = pa->bucket[pa->cur];
+
+    addr_key_from_ip(&key.rloc, lisp_addr_ip(rloc), 0);
+    addr_key_from_ip(&key.eid, lisp_addr_ip(eid), iid);
+    if (kh_get(peers, b, key) != kh_end(b)) {
+        return;
+    }
+    if (kh_size(b) >= PEER_ACTIVITY_MAX_SIZE) {
+        if (pa->dropped++ == 0) {
+            OOR_LOG(LDBG_1, "peer_activity_add: Max size of the peer activity "
+                    "table reached. New peers are not tracked");
+        }
+        return;
+    }
+    kh_put(peers, b, key, &ret);
+}
+
+void
+peer_activity_expire(peer_activity_t *pa)
+{
+    peer_activity_rotate(pa, peer_activity_now());
+}
+
+int
+peer_activity_size(peer_activity_t *pa)
+{
+    return (kh_size(pa->bucket[0]) + kh_size(pa->bucket[1]));
+}
+
+lisp_addr_t *
+peer_key_eid(peer_key_t *key)
+{
+    lisp_addr_t ip;
+
+    lisp_addr_ip_init(&ip, key->eid.addr.u8, key->eid.afi);
+    if (key->eid.iid > 0) {
+        return (lisp_addr_new_init_iid(key->eid.iid, &ip,
+                addr_key_full_len(&key->eid)));
+    }
+    return (lisp_addr_clone(&ip));
+}
+
+void
+peer_key_rloc(peer_key_t *key, lisp_addr_t *rloc)
+{
+    lisp_addr_ip_init(rloc, key->rloc.addr.u8, key->rloc.afi);
+}
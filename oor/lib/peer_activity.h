@@ -0,0 +1,101 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef PEER_ACTIVITY_H_
+#define PEER_ACTIVITY_H_
+
+#include <time.h>
+
+#include "addr_key.h"
+#include "../elibs/khash/khash.h"
+#include "../liblisp/lisp_address.h"
+
+/*
+ * Peers that sent traffic to the xTR recently: pairs of outer source RLOC
+ * and inner source EID of the packets decapsulated. The pairs are kept in
+ * two buckets of PEER_ACTIVITY_PERIOD seconds, the current one and the
+ * previous one, rotated when the period elapses. A pair is active while it
+ * is in any of them, that is, if it was seen in the last period at least.
+ * Adding a pair already in the current bucket only costs a lookup, as it is
+ * done for every packet.
+ */
+
+/* Seconds of each bucket */
+#define PEER_ACTIVITY_PERIOD    60
+/* Maximum number of pairs of each bucket */
+#define PEER_ACTIVITY_MAX_SIZE  100000
+
+typedef struct peer_key {
+    addr_key_t  rloc;
+    addr_key_t  eid;
+} peer_key_t;
+
+#define PEER_KEY_WORDS  (sizeof(peer_key_t) / sizeof(uint32_t))
+
+#define peer_key_hash(_k) \
+    hashword((const uint32_t *)&(_k), PEER_KEY_WORDS, 2013)
+#define peer_key_equal(_k1, _k2) \
+    (addr_key_equal(&(_k1).rloc, &(_k2).rloc) \
+            && addr_key_equal(&(_k1).eid, &(_k2).eid))
+
+KHASH_INIT(peers, peer_key_t, char, 0, peer_key_hash, peer_key_equal)
+
+typedef struct peer_activity {
+    khash_t(peers)  *bucket[2];
+    int             cur;
+    /* Start of the current bucket */
+    time_t          start;
+    /* Pairs not tracked because the bucket was full */
+    uint64_t        dropped;
+} peer_activity_t;
+
+/* Iterate the active pairs. A pair may be visited twice, once per bucket */
+#define peer_activity_foreach(_pa, _key)                                \
+    do {                                                                \
+        khash_t(peers) *_b_;                                            \
+        khiter_t _k_;                                                   \
+        int _i_;                                                        \
+        for (_i_ = 0; _i_ < 2; _i_++){                                  \
+            _b_ = (_pa)->bucket[_i_];                                   \
+            for (_k_ = kh_begin(_b_); _k_ != kh_end(_b_); ++_k_){       \
+                if (!kh_exist(_b_, _k_)){                               \
+                    continue;                                           \
+                }                                                       \
+                (_key) = &kh_key(_b_, _k_);
+
+#define peer_activity_foreach_end                                       \
+            }                                                           \
+        }                                                               \
+    } while (0)
+
+void peer_activity_init(peer_activity_t *pa);
+void peer_activity_uninit(peer_activity_t *pa);
+/* Record a packet of the IP 'eid' in instance 'iid' received from the IP
+ * 'rloc' */
+void peer_activity_add(peer_activity_t *pa, lisp_addr_t *rloc, lisp_addr_t *eid,
+        uint32_t iid);
+/* Discard the pairs not seen in the last period */
+void peer_activity_expire(peer_activity_t *pa);
+int peer_activity_size(peer_activity_t *pa);
+/* Return a new address with the EID of 'key', with its IID if not 0 */
+lisp_addr_t *peer_key_eid(peer_key_t *key);
+/* Fill 'rloc' with the RLOC of 'key' */
+void peer_key_rloc(peer_key_t *key, lisp_addr_t *rloc);
+
+#endif /* PEER_ACTIVITY_H_ */
@@ -0,0 +1,115 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "pmtu_table.h"
+#include "mem_util.h"
+#include "oor_log.h"
+#include "packets.h"
+#include "util.h"
+
+/* Minimum MTU accepted from an ICMP message */
+#define PMTU_MIN_V4     576
+#define PMTU_MIN_V6     1280
+
+void
+pmtu_table_init(pmtu_table_t *pt)
+{
+    pt->htable = kh_init(pmtu);
+}
+
+void
+pmtu_table_uninit(pmtu_table_t *pt)
+{
+    khiter_t k;
+
+    for (k = kh_begin(pt->htable); k != kh_end(pt->htable); ++k){
+        if (kh_exist(pt->htable, k)){
+            free(kh_value(pt->htable,k));
+        }
+    }
+    kh_destroy(pmtu, pt->htable);
+}
+
+pmtu_entry_t *
+pmtu_table_get(pmtu_table_t *pt, ip_addr_t *rloc)
+{
+    pmtu_entry_t *entry;
+    addr_key_t key;
+    khiter_t k;
+    int ret;
+
+    addr_key_from_ip(&key, rloc, 0);
+    k = kh_get(pmtu, pt->htable, &key);
+    if (k != kh_end(pt->htable)){
+        return (kh_value(pt->htable,k));
+    }
+
+    if (kh_size(pt->htable) >= PMTU_MAX_SIZE) {
+        OOR_LOG(LDBG_1,"pmtu_table_get: Max size of PMTU table reached. "
+                "PMTU of %s not tracked", ip_addr_to_char(rloc));
+        return (NULL);
+    }
+
+    entry = xzalloc(sizeof(pmtu_entry_t));
+    entry->rloc = key;
+
+    k = kh_put(pmtu, pt->htable, &entry->rloc, &ret);
+    kh_value(pt->htable, k) = entry;
+
+    return (entry);
+}
+
+/* Record the MTU reported for the path to 'rloc'. Only decreases are
+ * accepted until the current value times out */
+void
+pmtu_table_update(pmtu_table_t *pt, ip_addr_t *rloc, int mtu)
+{
+    pmtu_entry_t *entry;
+    int min_mtu;
+
+    min_mtu = (ip_addr_afi(rloc) == AF_INET) ? PMTU_MIN_V4 : PMTU_MIN_V6;
+    if (mtu < min_mtu) {
+        OOR_LOG(LDBG_2, "pmtu_table_update: Ignoring MTU %d reported for %s",
+                mtu, ip_addr_to_char(rloc));
+        return;
+    }
+
+    entry = pmtu_table_get(pt, rloc);
+    if (!entry) {
+        return;
+    }
+    if (pmtu_entry_mtu(entry) != 0 && mtu >= entry->mtu) {
+        return;
+    }
+
+    entry->mtu = mtu;
+    clock_gettime(CLOCK_MONOTONIC, &entry->ts);
+    OOR_LOG(LDBG_1, "Path MTU to RLOC %s set to %d", ip_addr_to_char(rloc), mtu);
+}
+
+/* Return the PMTU of the entry or 0 if it is unknown */
+int
+pmtu_entry_mtu(pmtu_entry_t *entry)
+{
+    if (entry->mtu != 0 && time_elapsed(&entry->ts) > PMTU_TIMEOUT) {
+        OOR_LOG(LDBG_2, "Path MTU to RLOC %s expired", addr_key_to_char(&entry->rloc));
+        entry->mtu = 0;
+    }
+    return (entry->mtu);
+}
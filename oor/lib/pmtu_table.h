@@ -0,0 +1,60 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef PMTU_TABLE_H_
+#define PMTU_TABLE_H_
+
+#include <time.h>
+#include "addr_key.h"
+#include "../elibs/khash/khash.h"
+#include "../liblisp/lisp_ip.h"
+
+/*
+ * Path MTU cache of the data plane, indexed by destination RLOC. It is fed
+ * by the ICMP Fragmentation Needed / Packet Too Big messages reported on the
+ * output sockets. Forwarding entries keep a pointer to the entry of their
+ * destination RLOC, so entries are never removed while the table is in use.
+ */
+
+/* Time after which a learnt PMTU is forgotten so that larger packets are
+ * tried again (RFC 1191, section 6.3) */
+#define PMTU_TIMEOUT    600
+/* Maximum number of RLOCs tracked */
+#define PMTU_MAX_SIZE   10000
+
+typedef struct pmtu_entry {
+    addr_key_t      rloc;
+    int             mtu;    /* 0 when the PMTU is unknown */
+    struct timespec ts;
+} pmtu_entry_t;
+
+KHASH_INIT(pmtu, addr_key_t *, pmtu_entry_t *, 1, addr_key_hash, addr_key_equal)
+
+typedef struct pmtu_table {
+    khash_t(pmtu) *htable;
+} pmtu_table_t;
+
+void pmtu_table_init(pmtu_table_t *pt);
+void pmtu_table_uninit(pmtu_table_t *pt);
+/* Return the entry of 'rloc', creating it if it doesn't exist */
+pmtu_entry_t *pmtu_table_get(pmtu_table_t *pt, ip_addr_t *rloc);
+void pmtu_table_update(pmtu_table_t *pt, ip_addr_t *rloc, int mtu);
+int pmtu_entry_mtu(pmtu_entry_t *entry);
+
+#endif /* PMTU_TABLE_H_ */
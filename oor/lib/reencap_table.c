@@ -0,0 +1,153 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "reencap_table.h"
+#include "mem_util.h"
+#include "oor_log.h"
+#include "lru_list.h"
+#include "util.h"
+
+/* Time after which an entry is considered to have timed out and is removed
+ * from the table. Same as the tuple table, so that mapping changes are
+ * picked up at the same pace by both caches */
+#define TIMEOUT 3
+
+/* Maximum size of the re-encapsulation table */
+#define MAX_SIZE 10000
+#define OLD_ENTRIES 1000
+
+static void reencap_table_remove_with_khiter(reencap_table_t *rt, khiter_t k);
+
+static int
+reencap_entry_expired(struct ovs_list *list_elt)
+{
+    reencap_entry_t *entry = CONTAINER_OF(list_elt, reencap_entry_t, list_elt);
+    return (time_elapsed(&entry->ts) > TIMEOUT);
+}
+
+static void
+reencap_entry_remove(reencap_table_t *rt, struct ovs_list *list_elt)
+{
+    reencap_entry_t *entry = CONTAINER_OF(list_elt, reencap_entry_t, list_elt);
+    reencap_table_remove(rt, &entry->key);
+}
+
+void
+reencap_table_init(reencap_table_t *rt)
+{
+    rt->htable = kh_init(reencap);
+    list_init(&rt->head_list);
+}
+
+void
+reencap_table_uninit(reencap_table_t *rt)
+{
+    khiter_t k;
+
+    for (k = kh_begin(rt->htable); k != kh_end(rt->htable); ++k){
+        if (kh_exist(rt->htable, k)){
+            free(kh_value(rt->htable,k));
+        }
+    }
+    kh_destroy(reencap, rt->htable);
+}
+
+void
+reencap_table_insert(reencap_table_t *rt, reencap_key_t *key, ip_addr_t *srloc,
+        ip_addr_t *drloc, uint32_t iid, int *out_sock)
+{
+    khiter_t k;
+    int ret;
+    reencap_entry_t *entry;
+
+    k = kh_get(reencap, rt->htable, key);
+    if (k != kh_end(rt->htable)){
+        reencap_table_remove_with_khiter(rt, k);
+    }
+
+    /* If table is full, remove expired entries. If it is still full, remove
+     * old entries */
+    if (kh_size(rt->htable) >= MAX_SIZE) {
+        OOR_LOG(LDBG_1,"reencap_table_insert: Max size of re-encapsulation table reached. "
+                "Removing expired and older entries");
+        lru_list_evict(&rt->head_list, OLD_ENTRIES, rt, reencap_entry_expired,
+                (lru_remove_fct)reencap_entry_remove);
+    }
+
+    entry = xzalloc(sizeof(reencap_entry_t));
+    entry->key = *key;
+    ip_addr_copy(&entry->srloc, srloc);
+    ip_addr_copy(&entry->drloc, drloc);
+    entry->iid = iid;
+    entry->out_sock = out_sock;
+    clock_gettime(CLOCK_MONOTONIC, &entry->ts);
+
+    lru_list_add(&rt->head_list, &entry->list_elt);
+
+    k = kh_put(reencap, rt->htable, &entry->key, &ret);
+    kh_value(rt->htable, k) = entry;
+    OOR_LOG(LDBG_3,"reencap_table_insert: %s -> %s re-encapsulated to RLOC %s",
+            addr_key_to_char(&key->src), addr_key_to_char(&key->dst),
+            ip_addr_to_char(drloc));
+}
+
+void
+reencap_table_remove(reencap_table_t *rt, reencap_key_t *key)
+{
+    khiter_t k;
+
+    k = kh_get(reencap, rt->htable, key);
+    if (k == kh_end(rt->htable)){
+        return;
+    }
+    reencap_table_remove_with_khiter(rt, k);
+}
+
+static void
+reencap_table_remove_with_khiter(reencap_table_t *rt, khiter_t k)
+{
+    reencap_entry_t *entry;
+
+    entry = kh_value(rt->htable,k);
+    list_remove(&entry->list_elt);
+    kh_del(reencap, rt->htable, k);
+    free(entry);
+}
+
+reencap_entry_t *
+reencap_table_lookup(reencap_table_t *rt, reencap_key_t *key)
+{
+    reencap_entry_t *entry;
+    khiter_t k;
+
+    k = kh_get(reencap, rt->htable, key);
+    if (k == kh_end(rt->htable)){
+        return (NULL);
+    }
+    entry = kh_value(rt->htable,k);
+
+    if (time_elapsed(&entry->ts) > TIMEOUT){
+        reencap_table_remove_with_khiter(rt, k);
+        return (NULL);
+    }
+
+    lru_list_touch(&rt->head_list, &entry->list_elt);
+
+    return (entry);
+}
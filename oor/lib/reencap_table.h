@@ -0,0 +1,62 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef REENCAP_TABLE_H_
+#define REENCAP_TABLE_H_
+
+#include <time.h>
+#include "addr_key.h"
+#include "packets.h"
+#include "../elibs/khash/khash.h"
+#include "../elibs/ovs/list.h"
+
+/*
+ * Cache of the re-encapsulation decisions taken by an RTR. A decision is
+ * keyed by the outer source RLOC of the received packet ('src'), the inner
+ * destination EID ('dst') and the IID, and stores everything needed to
+ * rewrite the outer headers of the packet in place.
+ */
+
+typedef addr_pair_key_t reencap_key_t;
+
+typedef struct reencap_entry {
+    struct ovs_list list_elt;
+    reencap_key_t   key;
+    ip_addr_t       srloc;  /* new outer source RLOC */
+    ip_addr_t       drloc;  /* new outer destination RLOC */
+    uint32_t        iid;    /* IID to be written in the LISP header */
+    int             *out_sock;
+    struct timespec ts;
+} reencap_entry_t;
+
+KHASH_INIT(reencap, reencap_key_t *, reencap_entry_t *, 1, addr_pair_key_hash, addr_pair_key_equal)
+
+typedef struct reencap_table {
+    khash_t(reencap) *htable;
+    struct ovs_list head_list; /* To order entries */
+} reencap_table_t;
+
+void reencap_table_init(reencap_table_t *rt);
+void reencap_table_uninit(reencap_table_t *rt);
+void reencap_table_insert(reencap_table_t *rt, reencap_key_t *key,
+        ip_addr_t *srloc, ip_addr_t *drloc, uint32_t iid, int *out_sock);
+void reencap_table_remove(reencap_table_t *rt, reencap_key_t *key);
+reencap_entry_t *reencap_table_lookup(reencap_table_t *rt, reencap_key_t *key);
+
+#endif /* REENCAP_TABLE_H_ */
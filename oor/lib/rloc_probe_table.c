@@ -0,0 +1,168 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "rloc_probe_table.h"
+#include "mem_util.h"
+#include "oor_log.h"
+#include "timers_utils.h"
+
+static void
+rloc_probe_del(rloc_probe_t *probe)
+{
+    stop_timers_from_obj(probe, ptrs_to_timers_ht, nonces_ht);
+    lisp_addr_del(probe->rloc);
+    lisp_addr_del(probe->eid);
+    free(probe);
+}
+
+void
+rloc_probe_table_init(rloc_probe_table_t *pt)
+{
+    pt->htable = kh_init(rprobe);
+}
+
+void
+rloc_probe_table_uninit(rloc_probe_table_t *pt)
+{
+    rloc_probe_t *probe;
+
+    rloc_probe_table_foreach(pt, probe) {
+        rloc_probe_del(probe);
+    } rloc_probe_table_foreach_end;
+    kh_destroy(rprobe, pt->htable);
+}
+
+rloc_probe_t *
+rloc_probe_table_lookup(rloc_probe_table_t *pt, lisp_addr_t *rloc)
+{
+    addr_key_t key;
+    khiter_t k;
+
+    if (addr_key_from_lisp_addr(&key, rloc) != GOOD) {
+        return (NULL);
+    }
+    k = kh_get(rprobe, pt->htable, &key);
+    if (k == kh_end(pt->htable)) {
+        return (NULL);
+    }
+    return (kh_value(pt->htable, k));
+}
+
+rloc_probe_t *
+rloc_probe_table_add(rloc_probe_table_t *pt, lisp_addr_t *rloc,
+        lisp_addr_t *eid)
+{
+    rloc_probe_t *probe;
+    addr_key_t key;
+    khiter_t k;
+    int ret;
+
+    if (addr_key_from_lisp_addr(&key, rloc) != GOOD) {
+        return (NULL);
+    }
+    if (kh_size(pt->htable) >= RLOC_PROBE_MAX_SIZE) {
+        OOR_LOG(LDBG_1, "rloc_probe_table_add: Max number of probed RLOCs "
+                "reached. RLOC %s not probed", lisp_addr_to_char(rloc));
+        return (NULL);
+    }
+
+    probe = xzalloc(sizeof(rloc_probe_t));
+    probe->key = key;
+    probe->rloc = lisp_addr_clone(rloc);
+    probe->eid = lisp_addr_clone(eid);
+    probe->in_use = TRUE;
+
+    k = kh_put(rprobe, pt->htable, &probe->key, &ret);
+    kh_value(pt->htable, k) = probe;
+
+    return (probe);
+}
+
+void
+rloc_probe_table_remove(rloc_probe_table_t *pt, rloc_probe_t *probe)
+{
+    khiter_t k;
+
+    k = kh_get(rprobe, pt->htable, &probe->key);
+    if (k != kh_end(pt->htable)) {
+        kh_del(rprobe, pt->htable, k);
+    }
+    rloc_probe_del(probe);
+}
+
+int
+rloc_probe_table_size(rloc_probe_table_t *pt)
+{
+    return (kh_size(pt->htable));
+}
+
+void
+rloc_probe_sent(rloc_probe_t *probe, uint64_t nonce)
+{
+    probe->last_nonce = nonce;
+    clock_gettime(CLOCK_MONOTONIC, &probe->last_sent);
+}
+
+int
+rloc_probe_rtt_sample(rloc_probe_t *probe, uint64_t nonce)
+{
+    struct timespec now;
+    uint32_t rtt, diff, hyst;
+    int64_t elapsed;
+
+    /* Replies to retransmissions are ambiguous */
+    if (nonce != probe->last_nonce) {
+        return (FALSE);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    elapsed = (int64_t)(now.tv_sec - probe->last_sent.tv_sec) * 1000000
+            + (now.tv_nsec - probe->last_sent.tv_nsec) / 1000;
+    rtt = elapsed > 0 ? (uint32_t)elapsed : 1;
+
+    /* Smoothed RTT and variation as RFC 6298 */
+    if (probe->samples == 0) {
+        probe->srtt = rtt;
+        probe->rttvar = rtt / 2;
+    } else {
+        diff = probe->srtt > rtt ? probe->srtt - rtt : rtt - probe->srtt;
+        probe->rttvar = (3 * (uint64_t)probe->rttvar + diff) / 4;
+        probe->srtt = (7 * (uint64_t)probe->srtt + rtt) / 8;
+    }
+    if (probe->srtt == 0) {
+        probe->srtt = 1;
+    }
+    probe->samples++;
+    OOR_LOG(LDBG_3, "RLOC %s: RTT %u us, smoothed RTT %u us, variation %u us",
+            lisp_addr_to_char(probe->rloc), rtt, probe->srtt, probe->rttvar);
+
+    /* Hysteresis: small changes don't modify the locators */
+    if (probe->pub_rtt != 0) {
+        diff = probe->srtt > probe->pub_rtt ? probe->srtt - probe->pub_rtt
+                : probe->pub_rtt - probe->srtt;
+        hyst = (uint64_t)probe->pub_rtt * RLOC_PROBE_RTT_HYST_PCT / 100;
+        if (hyst < RLOC_PROBE_RTT_HYST_MIN) {
+            hyst = RLOC_PROBE_RTT_HYST_MIN;
+        }
+        if (diff <= hyst) {
+            return (FALSE);
+        }
+    }
+    probe->pub_rtt = probe->srtt;
+    return (TRUE);
+}
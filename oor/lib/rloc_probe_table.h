@@ -0,0 +1,96 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef RLOC_PROBE_TABLE_H_
+#define RLOC_PROBE_TABLE_H_
+
+#include <time.h>
+
+#include "addr_key.h"
+#include "../elibs/khash/khash.h"
+#include "../liblisp/lisp_address.h"
+
+/*
+ * RLOC probing state of the xTR, indexed by the IP address probed. Each
+ * address is probed once per interval, however many map-cache entries have
+ * locators with it, and the result is applied to all of them. The probing
+ * timer of an address is associated with its entry.
+ */
+
+/* Maximum number of RLOCs probed */
+#define RLOC_PROBE_MAX_SIZE     100000
+/* The RTT of the locators is updated when the smoothed RTT differs from it
+ * more than RLOC_PROBE_RTT_HYST_PCT percent and RLOC_PROBE_RTT_HYST_MIN us */
+#define RLOC_PROBE_RTT_HYST_PCT 25
+#define RLOC_PROBE_RTT_HYST_MIN 2000
+
+typedef struct rloc_probe {
+    addr_key_t      key;
+    lisp_addr_t     *rloc;      /* address where the probes are sent */
+    lisp_addr_t     *eid;       /* EID of a mapping with the RLOC, asked in
+                                 * the probes */
+    uint8_t         state;      /* UP or DOWN once 'probed' */
+    uint8_t         probed;
+    uint8_t         in_use;     /* found in the last walk of the map-cache */
+    /* Round trip time measured with the probes, in microseconds. Only the
+     * reply to the last probe sent is a sample (Karn's algorithm) */
+    uint64_t        last_nonce;
+    struct timespec last_sent;
+    uint32_t        srtt;       /* smoothed RTT, 0 until the first sample */
+    uint32_t        rttvar;     /* RTT variation (jitter) */
+    uint32_t        samples;
+    uint32_t        pub_rtt;    /* RTT last applied to the locators */
+} rloc_probe_t;
+
+KHASH_INIT(rprobe, addr_key_t *, rloc_probe_t *, 1, addr_key_hash, addr_key_equal)
+
+typedef struct rloc_probe_table {
+    khash_t(rprobe) *htable;
+} rloc_probe_table_t;
+
+#define rloc_probe_table_foreach(_pt, _probe)                           \
+    do {                                                                \
+        khiter_t _k_;                                                   \
+        for (_k_ = kh_begin((_pt)->htable); _k_ != kh_end((_pt)->htable); ++_k_){ \
+            if (!kh_exist((_pt)->htable, _k_)){                         \
+                continue;                                               \
+            }                                                           \
+            (_probe) = kh_value((_pt)->htable, _k_);
+
+#define rloc_probe_table_foreach_end                                    \
+        }                                                               \
+    } while (0)
+
+void rloc_probe_table_init(rloc_probe_table_t *pt);
+void rloc_probe_table_uninit(rloc_probe_table_t *pt);
+rloc_probe_t *rloc_probe_table_lookup(rloc_probe_table_t *pt, lisp_addr_t *rloc);
+/* Add the entry of 'rloc', probed asking for 'eid'. Returns NULL if the
+ * table is full */
+rloc_probe_t *rloc_probe_table_add(rloc_probe_table_t *pt, lisp_addr_t *rloc,
+        lisp_addr_t *eid);
+/* Remove the entry and stop its timers */
+void rloc_probe_table_remove(rloc_probe_table_t *pt, rloc_probe_t *probe);
+int rloc_probe_table_size(rloc_probe_table_t *pt);
+/* Record the time the probe with 'nonce' is sent */
+void rloc_probe_sent(rloc_probe_t *probe, uint64_t nonce);
+/* Update the RTT of the RLOC with the reply to the probe with 'nonce'.
+ * Returns TRUE if the RTT to publish to the locators has changed */
+int rloc_probe_rtt_sample(rloc_probe_t *probe, uint64_t nonce);
+
+#endif /* RLOC_PROBE_TABLE_H_ */
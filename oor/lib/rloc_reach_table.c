@@ -0,0 +1,214 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <stdlib.h>
+
+#include "rloc_reach_table.h"
+#include "mem_util.h"
+#include "oor_log.h"
+#include "util.h"
+
+void
+rloc_reach_table_init(rloc_reach_table_t *rt)
+{
+    rt->htable = kh_init(rreach);
+}
+
+void
+rloc_reach_table_uninit(rloc_reach_table_t *rt)
+{
+    khiter_t k;
+
+    for (k = kh_begin(rt->htable); k != kh_end(rt->htable); ++k){
+        if (kh_exist(rt->htable, k)){
+            free(kh_value(rt->htable,k));
+        }
+    }
+    kh_destroy(rreach, rt->htable);
+}
+
+rloc_reach_entry_t *
+rloc_reach_table_lookup(rloc_reach_table_t *rt, ip_addr_t *rloc)
+{
+    addr_key_t key;
+    khiter_t k;
+
+    addr_key_from_ip(&key, rloc, 0);
+    k = kh_get(rreach, rt->htable, &key);
+    if (k == kh_end(rt->htable)){
+        return (NULL);
+    }
+    return (kh_value(rt->htable,k));
+}
+
+rloc_reach_entry_t *
+rloc_reach_table_get(rloc_reach_table_t *rt, ip_addr_t *rloc)
+{
+    rloc_reach_entry_t *entry;
+    addr_key_t key;
+    khiter_t k;
+    int ret;
+
+    addr_key_from_ip(&key, rloc, 0);
+    k = kh_get(rreach, rt->htable, &key);
+    if (k != kh_end(rt->htable)){
+        return (kh_value(rt->htable,k));
+    }
+
+    if (kh_size(rt->htable) >= RLOC_REACH_MAX_SIZE) {
+        OOR_LOG(LDBG_1,"rloc_reach_table_get: Max size of the RLOC reachability "
+                "table reached. %s not tracked", ip_addr_to_char(rloc));
+        return (NULL);
+    }
+
+    entry = xzalloc(sizeof(rloc_reach_entry_t));
+    entry->rloc = key;
+
+    k = kh_put(rreach, rt->htable, &entry->rloc, &ret);
+    kh_value(rt->htable, k) = entry;
+
+    return (entry);
+}
+
+rloc_reach_e
+rloc_reach_output(rloc_reach_entry_t *entry, lisp_data_hdr_t *lhdr,
+        ip_addr_t *local)
+{
+    struct timespec now;
+    rloc_reach_e ret = RLOC_REACH_NONE;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (entry->req_nonce != 0){
+        if (time_diff(&now, &entry->req_ts) > RLOC_REACH_ECHO_TIMEOUT){
+            /* Without traffic from the RLOC the result is unknown */
+            if (entry->echo_capable
+                    && entry->rx_no_echo >= RLOC_REACH_ECHO_MIN_RX){
+                OOR_LOG(LDBG_1, "RLOC %s didn't echo the nonce %06x in %d packets",
+                        addr_key_to_char(&entry->rloc), entry->req_nonce,
+                        entry->rx_no_echo);
+                entry->reported = ret = RLOC_REACH_DOWN;
+            }
+            entry->req_nonce = 0;
+            entry->check_ts = now;
+        }
+    }else if (time_diff(&now, &entry->check_ts) >= RLOC_REACH_ECHO_INTERVAL){
+        do {
+            entry->req_nonce = random() & 0xffffff;
+        } while (entry->req_nonce == 0);
+        entry->req_ts = now;
+        entry->rx_no_echo = 0;
+        if (local){
+            addr_key_from_ip(&entry->req_local, local, 0);
+        }else{
+            memset(&entry->req_local, 0, sizeof(addr_key_t));
+        }
+    }
+
+    /* Only one nonce fits in the header: echoing the one of the RLOC goes
+     * first, the request is repeated in the next packets */
+    if (entry->echo_pending){
+        lisp_data_hdr_set_nonce(lhdr, entry->echo_nonce, FALSE);
+        entry->echo_pending = FALSE;
+    }else if (entry->req_nonce != 0){
+        lisp_data_hdr_set_nonce(lhdr, entry->req_nonce, TRUE);
+    }
+
+    return (ret);
+}
+
+rloc_reach_e
+rloc_reach_input(rloc_reach_entry_t *entry, lisp_data_hdr_t *lhdr,
+        ip_addr_t *local)
+{
+    struct timespec now;
+    addr_key_t lkey;
+    uint32_t nonce;
+
+    if (lhdr->nonce_present){
+        nonce = lisp_data_hdr_get_nonce(lhdr);
+        if (lhdr->echo_nonce){
+            entry->echo_nonce = nonce;
+            entry->echo_pending = TRUE;
+            entry->echo_capable = TRUE;
+        }else if (entry->req_nonce != 0 && nonce == entry->req_nonce){
+            clock_gettime(CLOCK_MONOTONIC, &entry->check_ts);
+            entry->req_nonce = 0;
+            entry->echo_capable = TRUE;
+            if (entry->reported == RLOC_REACH_DOWN){
+                entry->reported = RLOC_REACH_UP;
+                return (RLOC_REACH_UP);
+            }
+            return (RLOC_REACH_NONE);
+        }
+    }
+
+    if (entry->req_nonce != 0){
+        /* The RLOC may send to another local RLOC packets that don't know
+         * about the request */
+        if (local && entry->req_local.afi != 0){
+            addr_key_from_ip(&lkey, local, 0);
+            if (!addr_key_equal(&lkey, &entry->req_local)){
+                return (RLOC_REACH_NONE);
+            }
+        }
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (time_diff(&now, &entry->req_ts) > RLOC_REACH_ECHO_TIMEOUT / 2.0){
+            entry->rx_no_echo++;
+        }
+    }
+
+    return (RLOC_REACH_NONE);
+}
+
+int
+rloc_reach_lsb_changed(rloc_reach_entry_t *entry, uint32_t lsb)
+{
+    struct timespec now;
+
+    if (entry->lsb_valid && entry->lsb == lsb){
+        return (FALSE);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (entry->lsb_valid
+            && time_diff(&now, &entry->lsb_ts) < RLOC_REACH_LSB_INTERVAL){
+        return (FALSE);
+    }
+    entry->lsb_valid = TRUE;
+    entry->lsb = lsb;
+    entry->lsb_ts = now;
+    return (TRUE);
+}
+
+int
+rloc_reach_map_versions_check(rloc_reach_entry_t *entry, uint16_t src_ver,
+        uint16_t dst_ver)
+{
+    struct timespec now;
+    uint32_t mver = (uint32_t)src_ver << 16 | dst_ver;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (entry->mver_valid && entry->mver == mver
+            && time_diff(&now, &entry->mver_ts) < RLOC_REACH_MVER_INTERVAL){
+        return (FALSE);
+    }
+    entry->mver_valid = TRUE;
+    entry->mver = mver;
+    entry->mver_ts = now;
+    return (TRUE);
+}
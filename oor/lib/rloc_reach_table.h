@@ -0,0 +1,128 @@
+/*
+ *
+ * Copyright (C) 2011, 2015 Cisco Systems, Inc.
+ * Copyright (C) 2015 CBA research group, Technical University of Catalonia.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef RLOC_REACH_TABLE_H_
+#define RLOC_REACH_TABLE_H_
+
+#include <time.h>
+#include "addr_key.h"
+#include "../elibs/khash/khash.h"
+#include "../liblisp/lisp_data.h"
+#include "../liblisp/lisp_ip.h"
+
+/*
+ * Reachability state of the remote RLOCs learnt by the data plane from the
+ * LISP header of the packets exchanged with them (RFC 6830, section 6.3):
+ *  - Echo-nonce: while traffic is sent to an RLOC, a nonce is periodically
+ *    requested to be echoed. The RLOC is reachable when the nonce comes back
+ *    and unreachable when it keeps sending packets without echoing it to the
+ *    local RLOC that requested it. Packets returned to other local RLOCs
+ *    (asymmetric multihoming) don't count as failures.
+ *  - Locator-Status-Bits: last LSB received from the RLOC, to notify only
+ *    their changes, at most once per RLOC_REACH_LSB_INTERVAL.
+ *  - Map-Versions: last versions received from the RLOC (RFC 6834), to
+ *    limit how often they are checked by the control.
+ * Forwarding entries keep a pointer to the entry of their destination RLOC,
+ * so entries are never removed while the table is in use.
+ */
+
+/* Seconds between the verifications of an RLOC with traffic */
+#define RLOC_REACH_ECHO_INTERVAL    1
+/* Seconds to wait for the echo of a nonce */
+#define RLOC_REACH_ECHO_TIMEOUT     1
+/* Packets received from the RLOC without the echo once it has had time to
+ * see the request (half the timeout) needed to consider it unreachable */
+#define RLOC_REACH_ECHO_MIN_RX      3
+/* Seconds between the notifications of LSB changes of an RLOC. Each one
+ * makes the control walk the map-cache */
+#define RLOC_REACH_LSB_INTERVAL     1
+/* Seconds a locator found down by the data plane stays down before it is
+ * used, and so verified, again. Only when it is not probed */
+#define RLOC_REACH_DOWN_HOLD        60
+/* Seconds before checking again the same Map-Versions from an RLOC */
+#define RLOC_REACH_MVER_INTERVAL    1
+/* Maximum number of RLOCs tracked */
+#define RLOC_REACH_MAX_SIZE         10000
+
+typedef enum {
+    RLOC_REACH_NONE,    /* No new information */
+    RLOC_REACH_UP,      /* The RLOC echoed our nonce */
+    RLOC_REACH_DOWN     /* The RLOC sends traffic without echoing our nonce */
+} rloc_reach_e;
+
+typedef struct rloc_reach_entry {
+    addr_key_t      rloc;
+    /* Nonce requested to be echoed, 0 if there is no request in progress */
+    uint32_t        req_nonce;
+    struct timespec req_ts;
+    /* Local RLOC of the packet with the request. Its AFI is 0 if unknown */
+    addr_key_t      req_local;
+    /* End of the last verification */
+    struct timespec check_ts;
+    /* Packets received without the echo since the request was seen */
+    uint32_t        rx_no_echo;
+    /* Nonce the RLOC requested to be echoed */
+    uint32_t        echo_nonce;
+    uint8_t         echo_pending;
+    /* The RLOC implements echo-nonce: it has echoed or requested a nonce.
+     * Until then, the lack of echo is not a failure */
+    uint8_t         echo_capable;
+    /* Last state reported. Echoes are only reported after a failure, as
+     * the traffic to the RLOC already implies it is considered UP */
+    rloc_reach_e    reported;
+    uint8_t         lsb_valid;
+    uint32_t        lsb;
+    struct timespec lsb_ts;
+    /* Source and Dest Map-Versions last checked */
+    uint8_t         mver_valid;
+    uint32_t        mver;
+    struct timespec mver_ts;
+} rloc_reach_entry_t;
+
+KHASH_INIT(rreach, addr_key_t *, rloc_reach_entry_t *, 1, addr_key_hash, addr_key_equal)
+
+typedef struct rloc_reach_table {
+    khash_t(rreach) *htable;
+} rloc_reach_table_t;
+
+void rloc_reach_table_init(rloc_reach_table_t *rt);
+void rloc_reach_table_uninit(rloc_reach_table_t *rt);
+/* Return the entry of 'rloc', creating it if it doesn't exist */
+rloc_reach_entry_t *rloc_reach_table_get(rloc_reach_table_t *rt, ip_addr_t *rloc);
+rloc_reach_entry_t *rloc_reach_table_lookup(rloc_reach_table_t *rt, ip_addr_t *rloc);
+/* Set the nonce bits of a packet sent from the local RLOC 'local' to the
+ * RLOC of 'entry'. Returns RLOC_REACH_DOWN when the RLOC fails to echo the
+ * nonce */
+rloc_reach_e rloc_reach_output(rloc_reach_entry_t *entry, lisp_data_hdr_t *lhdr,
+        ip_addr_t *local);
+/* Process the nonce bits of a packet received from the RLOC of 'entry' in
+ * the local RLOC 'local', NULL if unknown. Returns RLOC_REACH_UP when the
+ * RLOC echoes the nonce, if it was not already the last state reported */
+rloc_reach_e rloc_reach_input(rloc_reach_entry_t *entry, lisp_data_hdr_t *lhdr,
+        ip_addr_t *local);
+/* Record the LSB received from the RLOC. Returns TRUE if they changed and
+ * the last change was notified RLOC_REACH_LSB_INTERVAL ago. Otherwise the
+ * change is notified with the next packets */
+int rloc_reach_lsb_changed(rloc_reach_entry_t *entry, uint32_t lsb);
+/* Record the Map-Versions received from the RLOC. Returns TRUE if they
+ * have to be checked: they changed or were checked long ago */
+int rloc_reach_map_versions_check(rloc_reach_entry_t *entry, uint16_t src_ver,
+        uint16_t dst_ver);
+
+#endif /* RLOC_REACH_TABLE_H_ */
@@ -17,15 +17,25 @@
  *
  */
 
+#define _GNU_SOURCE /* sendmmsg */
+
 #include <errno.h>
 #include <netdb.h>
 #include <unistd.h>
+#include <netinet/icmp6.h>
+#include <netinet/ip_icmp.h>
+#include <linux/errqueue.h>
 #include <linux/netlink.h>
 #include <linux/rtnetlink.h>
 
 #include "oor_log.h"
 #include "sockets-util.h"
 
+/* From linux/icmp.h, which conflicts with the libc network headers */
+#ifndef ICMP_FILTER
+#define ICMP_FILTER 1
+#endif
+
 int
 open_ip_raw_socket(int afi)
 {
@@ -52,6 +62,47 @@ open_ip_raw_socket(int afi)
 }
 
 
+/* Raw socket receiving only the ICMP Destination Unreachable (IPv4) or the
+ * ICMPv6 Packet Too Big messages addressed to this host */
+int
+open_icmp_raw_socket(int afi)
+{
+    uint32_t filter;
+    struct icmp6_filter filter6;
+    int s;
+
+    switch (afi) {
+    case AF_INET:
+        if ((s = socket(AF_INET, SOCK_RAW, IPPROTO_ICMP)) < 0) {
+            break;
+        }
+        filter = ~(1 << ICMP_DEST_UNREACH);
+        if (setsockopt(s, SOL_RAW, ICMP_FILTER, &filter, sizeof(filter)) < 0) {
+            OOR_LOG(LWRN, "open_icmp_raw_socket: setsockopt ICMP_FILTER: %s",
+                    strerror(errno));
+        }
+        return (s);
+    case AF_INET6:
+        if ((s = socket(AF_INET6, SOCK_RAW, IPPROTO_ICMPV6)) < 0) {
+            break;
+        }
+        ICMP6_FILTER_SETBLOCKALL(&filter6);
+        ICMP6_FILTER_SETPASS(ICMP6_PACKET_TOO_BIG, &filter6);
+        if (setsockopt(s, IPPROTO_ICMPV6, ICMP6_FILTER, &filter6,
+                sizeof(filter6)) < 0) {
+            OOR_LOG(LWRN, "open_icmp_raw_socket: setsockopt ICMP6_FILTER: %s",
+                    strerror(errno));
+        }
+        return (s);
+    default:
+        return (ERR_SOCKET);
+    }
+
+    OOR_LOG(LERR, "open_icmp_raw_socket: socket creation failed %s",
+            strerror(errno));
+    return (ERR_SOCKET);
+}
+
 int
 open_udp_raw_socket(int afi)
 {
@@ -214,6 +265,96 @@ socket_conf_req_ttl_tos(int sock, int afi)
 }
 
 
+/* Queue the ICMP errors and local errors of the packets sent through 'sock'
+ * in its error queue. Used to learn the path MTU of raw output sockets */
+int
+socket_conf_recv_errors(int sock, int afi)
+{
+    const int on = 1;
+
+    switch (afi) {
+    case AF_INET:
+        if (setsockopt(sock, IPPROTO_IP, IP_RECVERR, &on, sizeof(on)) < 0) {
+            OOR_LOG(LWRN, "socket_conf_recv_errors: setsockopt IP_RECVERR: %s", strerror(errno));
+            return (BAD);
+        }
+        break;
+    case AF_INET6:
+        if (setsockopt(sock, IPPROTO_IPV6, IPV6_RECVERR, &on, sizeof(on)) < 0) {
+            OOR_LOG(LWRN, "socket_conf_recv_errors: setsockopt IPV6_RECVERR: %s", strerror(errno));
+            return (BAD);
+        }
+        break;
+    default:
+        return (BAD);
+    }
+
+    return (GOOD);
+}
+
+/*
+ * Read one message from the error queue of 'sock'. If it reports a path MTU
+ * (ICMP Fragmentation Needed, ICMPv6 Packet Too Big or a local EMSGSIZE),
+ * 'dst' and 'mtu' are filled with the destination of the original packet
+ * and the reported MTU, otherwise 'mtu' is set to 0.
+ * Returns BAD when the queue is empty
+ */
+int
+sock_recv_pmtu_err(int sock, ip_addr_t *dst, int *mtu)
+{
+    struct msghdr msg;
+    struct iovec iov;
+    struct cmsghdr *cmsg;
+    struct sock_extended_err *ee;
+    struct sockaddr_storage name;
+    uint8_t data[64];
+    union control_data {
+        struct cmsghdr cmsg;
+        uint8_t data[CMSG_SPACE(sizeof(struct sock_extended_err)
+                + sizeof(struct sockaddr_in6))];
+    } control;
+
+    memset(&msg, 0, sizeof(msg));
+    iov.iov_base = data;
+    iov.iov_len = sizeof(data);
+    msg.msg_name = &name;
+    msg.msg_namelen = sizeof(name);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = &control;
+    msg.msg_controllen = sizeof(control);
+
+    if (recvmsg(sock, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+        return (BAD);
+    }
+
+    *mtu = 0;
+    for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (!(cmsg->cmsg_level == IPPROTO_IP && cmsg->cmsg_type == IP_RECVERR)
+                && !(cmsg->cmsg_level == IPPROTO_IPV6
+                        && cmsg->cmsg_type == IPV6_RECVERR)) {
+            continue;
+        }
+        ee = (struct sock_extended_err *)CMSG_DATA(cmsg);
+        if (ee->ee_errno != EMSGSIZE) {
+            continue;
+        }
+        switch (name.ss_family) {
+        case AF_INET:
+            ip_addr_init(dst, &((struct sockaddr_in *)&name)->sin_addr, AF_INET);
+            break;
+        case AF_INET6:
+            ip_addr_init(dst, &((struct sockaddr_in6 *)&name)->sin6_addr, AF_INET6);
+            break;
+        default:
+            continue;
+        }
+        *mtu = ee->ee_info;
+    }
+
+    return (GOOD);
+}
+
 /*
  * Bind a socket to a specific address and port if specified
  * Afi is used when the src address is not specified
@@ -317,6 +458,62 @@ send_raw_packet(int socket, const void *pkt, int plen, ip_addr_t *dip)
     return (GOOD);
 }
 
+/*
+ * Sends 'n' raw packets out the socket 'sock' using a single system call.
+ * Each packet is described by 'iovlen' consecutive elements of 'iov' and
+ * is sent to the address with the same index in 'dips'. 'n' should not be
+ * greater than RAW_BATCH_SIZE. Returns the number of packets sent
+ */
+int
+send_raw_packets(int sock, struct iovec *iov, int iovlen, ip_addr_t **dips,
+        int n)
+{
+    struct mmsghdr msgs[RAW_BATCH_SIZE];
+    union {
+        struct sockaddr_in s4;
+        struct sockaddr_in6 s6;
+    } saddrs[RAW_BATCH_SIZE];
+    int i, ret, sent = 0;
+
+    if (n > RAW_BATCH_SIZE) {
+        n = RAW_BATCH_SIZE;
+    }
+
+    memset(msgs, 0, n * sizeof(struct mmsghdr));
+    memset(saddrs, 0, n * sizeof(saddrs[0]));
+    for (i = 0; i < n; i++) {
+        switch (ip_addr_afi(dips[i])) {
+        case AF_INET:
+            saddrs[i].s4.sin_family = AF_INET;
+            ip_addr_copy_to(&saddrs[i].s4.sin_addr, dips[i]);
+            msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+            break;
+        case AF_INET6:
+            saddrs[i].s6.sin6_family = AF_INET6;
+            ip_addr_copy_to(&saddrs[i].s6.sin6_addr, dips[i]);
+            msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in6);
+            break;
+        default:
+            return(sent);
+        }
+        msgs[i].msg_hdr.msg_name = &saddrs[i];
+        msgs[i].msg_hdr.msg_iov = &iov[i * iovlen];
+        msgs[i].msg_hdr.msg_iovlen = iovlen;
+    }
+
+    while (sent < n) {
+        ret = sendmmsg(sock, &msgs[sent], n - sent, 0);
+        if (ret <= 0) {
+            OOR_LOG(LDBG_2, "send_raw_packets: send packet to %s using fail descriptor %d failed -> %s",
+                    ip_addr_to_char(dips[sent]), sock, strerror(errno));
+            break;
+        }
+        sent += ret;
+    }
+
+    return (sent);
+}
+
 int
 send_datagram_packet (int sock, const void *packet, int packet_length,
         lisp_addr_t *addr_dest, int port_dest)
@@ -21,18 +21,27 @@
 #ifndef SOCKETS_UTIL_H_
 #define SOCKETS_UTIL_H_
 
+#include <sys/uio.h>
 #include "../liblisp/lisp_address.h"
 
+/* Maximum number of packets sent by send_raw_packets */
+#define RAW_BATCH_SIZE 64
+
 int open_ip_raw_socket(int afi);
 int open_udp_raw_socket(int afi);
+int open_icmp_raw_socket(int afi);
 int opent_netlink_socket();
 
 int open_udp_datagram_socket(int afi);
 int socket_bindtodevice(int sock, char *device);
 int socket_conf_req_ttl_tos(int sock, int afi);
+int socket_conf_recv_errors(int sock, int afi);
+int sock_recv_pmtu_err(int sock, ip_addr_t *dst, int *mtu);
 
 int bind_socket(int sock,int afi, lisp_addr_t *src_addr, int src_port);
 int send_raw_packet(int, const void *, int, ip_addr_t *);
+int send_raw_packets(int sock, struct iovec *iov, int iovlen, ip_addr_t **dips,
+        int n);
 int send_datagram_packet (int sock, const void *packet, int packet_length,
         lisp_addr_t *addr_dest, int port_dest);
 
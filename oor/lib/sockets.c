@@ -33,10 +33,13 @@
 #include "../iface_list.h"
 #include "../liblisp/liblisp.h"
 
+static mem_slab_t fwd_entry_slab = MEM_SLAB_INITIALIZER("fwd_entry",
+        fwd_entry_t);
+
 inline fwd_entry_t *
 fwd_entry_new_init(lisp_addr_t *srloc, lisp_addr_t *drloc, uint32_t iid, int *out_socket)
 {
-    fwd_entry_t *fw_entry = xzalloc(sizeof(fwd_entry_t));
+    fwd_entry_t *fw_entry = mem_slab_alloc(&fwd_entry_slab);
     if (!fw_entry){
         return (NULL);
     }
@@ -44,6 +47,12 @@ fwd_entry_new_init(lisp_addr_t *srloc, lisp_addr_t *drloc, uint32_t iid, int *ou
     fw_entry->drloc = lisp_addr_clone(drloc);
     fw_entry->iid = iid;
     fw_entry->out_sock = out_socket;
+    fw_entry->pmtu = NULL;
+    fw_entry->reach = NULL;
+    fw_entry->lsb = 0;
+    fw_entry->lsb_set = FALSE;
+    fw_entry->src_map_version = 0;
+    fw_entry->dst_map_version = 0;
     return (fw_entry);
 }
 
@@ -55,7 +64,7 @@ fwd_entry_del(fwd_entry_t *fwd_entry)
     }
     lisp_addr_del(fwd_entry->srloc);
     lisp_addr_del(fwd_entry->drloc);
-    free(fwd_entry);
+    mem_slab_free(&fwd_entry_slab, fwd_entry);
 }
 
 
@@ -317,6 +326,28 @@ open_control_input_socket(int afi)
     return (sock);
 }
 
+/* Request the destination address of the incoming data packets: the local
+ * RLOC where they are received */
+static void
+socket_conf_req_dst(int sock, int afi)
+{
+    const int on = 1;
+
+    switch (afi) {
+    case AF_INET:
+        if (setsockopt(sock, IPPROTO_IP, IP_PKTINFO, &on, sizeof(on)) < 0) {
+            OOR_LOG(LWRN, "setsockopt IP_PKTINFO: %s", strerror(errno));
+        }
+        break;
+    case AF_INET6:
+        if (setsockopt(sock, IPPROTO_IPV6, IPV6_RECVPKTINFO, &on, sizeof(on))
+                < 0) {
+            OOR_LOG(LWRN, "setsockopt IPV6_RECVPKTINFO: %s", strerror(errno));
+        }
+        break;
+    }
+}
+
 int
 open_data_raw_input_socket(int afi, uint16_t port)
 {
@@ -337,6 +368,7 @@ open_data_raw_input_socket(int afi, uint16_t port)
         close(dummy_sock);
         return (ERR_SOCKET);
     }
+    socket_conf_req_dst(sock, afi);
 
     return (sock);
 }
@@ -359,6 +391,7 @@ open_data_datagram_input_socket(int afi, int port)
         close(sock);
         return (ERR_SOCKET);
     }
+    socket_conf_req_dst(sock, afi);
 
     return (sock);
 }
@@ -450,12 +483,14 @@ sock_ctrl_recv(int sock, struct lbuf *buf, uconn_t *uc)
 }
 
 int
-sock_data_recv(int sock, lbuf_t *b, int *afi, uint8_t *ttl, uint8_t *tos)
+sock_data_recv(int sock, lbuf_t *b, int *afi, uint8_t *ttl, uint8_t *tos,
+        ip_addr_t *src, ip_addr_t *dst)
 {
-    /* Space for TTL and TOS data */
+    /* Space for TTL, TOS and destination address data */
     union control_data {
         struct cmsghdr cmsg;
-        u_char data[CMSG_SPACE(sizeof(int)) + CMSG_SPACE(sizeof(int))];
+        u_char data[CMSG_SPACE(sizeof(int)) + CMSG_SPACE(sizeof(int))
+                    + CMSG_SPACE(sizeof(struct in6_pktinfo))];
     };
 
     union sockunion su;
@@ -497,8 +532,18 @@ sock_data_recv(int sock, lbuf_t *b, int *afi, uint8_t *ttl, uint8_t *tos)
                     && cmsgptr->cmsg_type == IP_TOS) {
                 *tos = *((uint8_t *) CMSG_DATA(cmsgptr));
             }
+
+            if (dst && cmsgptr->cmsg_level == IPPROTO_IP
+                    && cmsgptr->cmsg_type == IP_PKTINFO) {
+                ip_addr_init(dst,
+                        &(((struct in_pktinfo *) (CMSG_DATA(cmsgptr)))->ipi_addr),
+                        AF_INET);
+            }
         }
         *afi = AF_INET;
+        if (src) {
+            ip_addr_init(src, &su.s4.sin_addr, AF_INET);
+        }
     } else {
         for (cmsgptr = CMSG_FIRSTHDR(&msg); cmsgptr != NULL; cmsgptr =
                 CMSG_NXTHDR(&msg, cmsgptr)) {
@@ -512,8 +557,18 @@ sock_data_recv(int sock, lbuf_t *b, int *afi, uint8_t *ttl, uint8_t *tos)
                     && cmsgptr->cmsg_type == IPV6_TCLASS) {
                 *tos = *((uint8_t *) CMSG_DATA(cmsgptr));
             }
+
+            if (dst && cmsgptr->cmsg_level == IPPROTO_IPV6
+                    && cmsgptr->cmsg_type == IPV6_PKTINFO) {
+                ip_addr_init(dst,
+                        &(((struct in6_pktinfo *) (CMSG_DATA(cmsgptr)))->ipi6_addr),
+                        AF_INET6);
+            }
         }
         *afi = AF_INET6;
+        if (src) {
+            ip_addr_init(src, &su.s6.sin6_addr, AF_INET6);
+        }
     }
 
     return (GOOD);
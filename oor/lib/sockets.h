@@ -23,6 +23,8 @@
 #include "../defs.h"
 #include "sockets-util.h"
 #include "packets.h"
+#include "pmtu_table.h"
+#include "rloc_reach_table.h"
 #include "../liblisp/lisp_address.h"
 #include "lbuf.h"
 
@@ -83,6 +85,17 @@ typedef struct fwd_entry {
     lisp_addr_t *drloc;
     int *out_sock;
     uint32_t iid;
+    /* Path MTU towards drloc. Owned by the data plane */
+    pmtu_entry_t *pmtu;
+    /* Echo-nonce state of drloc. Owned by the data plane */
+    rloc_reach_entry_t *reach;
+    /* Locator-Status-Bits of the source mapping, if lsb_set */
+    uint32_t lsb;
+    uint8_t lsb_set;
+    /* Map-Versions of the source and destination mappings. Not sent when
+     * both are the Null Map-Version */
+    uint16_t src_map_version;
+    uint16_t dst_map_version;
 } fwd_entry_t;
 
 fwd_entry_t *fwd_entry_new_init(lisp_addr_t *srloc, lisp_addr_t *drloc,
@@ -109,7 +122,11 @@ int open_control_input_socket(int afi);
 
 int sock_recv(int, lbuf_t *);
 int sock_ctrl_recv(int, lbuf_t *, uconn_t *);
-int sock_data_recv(int sock, lbuf_t *b, int *afi, uint8_t *ttl, uint8_t *tos);
+/* Receive a data packet. If 'src' and 'dst' are not NULL, they are set to
+ * the source and destination addresses of the packet. 'dst' is left
+ * untouched if the socket doesn't provide it */
+int sock_data_recv(int sock, lbuf_t *b, int *afi, uint8_t *ttl, uint8_t *tos,
+        ip_addr_t *src, ip_addr_t *dst);
 int uconn_init(uconn_t *uc, int lp, int rp, lisp_addr_t *la,
         lisp_addr_t *ra);
 
@@ -20,6 +20,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <signal.h>
+#include <stdlib.h>
 #include <sys/time.h>
 #include <time.h>
 
@@ -50,6 +51,8 @@ static int signal_pipe[2];
 
 static timer_t timer_id;
 
+static mem_slab_t timer_slab = MEM_SLAB_INITIALIZER("timer", oor_timer_t);
+
 /* timers file descriptor */
 int timers_fd = 0;
 
@@ -175,7 +178,7 @@ oor_timers_destroy()
 oor_timer_t *
 oor_timer_create(timer_type type)
 {
-    oor_timer_t *new_timer = xzalloc(sizeof(oor_timer_t));
+    oor_timer_t *new_timer = mem_slab_alloc(&timer_slab);
     new_timer->type = type;
     new_timer->links.prev = NULL;
     new_timer->links.next = NULL;
@@ -282,6 +285,23 @@ oor_timer_start(oor_timer_t *tptr, int sexpiry)
     return;
 }
 
+/*
+ * Start the timer to expire after 'sexpiry' seconds minus a random amount of
+ * up to 1/TIMER_JITTER_DIV of them. Used by the periodic timers so that the
+ * ones programmed at the same time (startup, interface changes) don't keep
+ * expiring in the same tick.
+ */
+void
+oor_timer_start_jitter(oor_timer_t *tptr, int sexpiry)
+{
+    int jitter = sexpiry / TIMER_JITTER_DIV;
+
+    if (jitter > 0) {
+        sexpiry -= random() % (jitter + 1);
+    }
+    oor_timer_start(tptr, sexpiry);
+}
+
 
 /*
  * stop_timer()
@@ -318,7 +338,7 @@ oor_timer_stop(oor_timer_t *tptr)
         tptr->del_arg_fn(tptr->cb_argument);
     }
 
-    free(tptr);
+    mem_slab_free(&timer_slab, tptr);
 }
 
 
@@ -33,10 +33,15 @@ typedef enum {
     INFO_REQUEST_TIMER,
     RE_UPSTREAM_JOIN_TIMER,
     RE_ITR_RESOLUTION_TIMER,
-    REG_SITE_EXPRY_TIMER
+    REG_SITE_EXPRY_TIMER,
+    REFRESH_MAP_CACHE_TIMER,
+    RLOC_REACH_HOLD_TIMER
 } timer_type;
 
 #define TIMER_NAME_LEN          64
+/* oor_timer_start_jitter advances the expiration up to 1/TIMER_JITTER_DIV
+ * of its duration */
+#define TIMER_JITTER_DIV        4
 
 typedef struct oor_timer_links {
     struct oor_timer_links *prev;
@@ -69,6 +74,7 @@ void oor_timer_init(oor_timer_t *new_timer, void *owner, oor_timer_callback_t cb
         void *arg, oor_timer_del_cb_arg_fn del_arg_fn, void *nonces_lst);
 
 void oor_timer_start(oor_timer_t *, int);
+void oor_timer_start_jitter(oor_timer_t *, int);
 
 void oor_timer_stop(oor_timer_t *);
 
@@ -21,7 +21,9 @@
 #include "mem_util.h"
 #include "packets.h"
 #include "oor_log.h"
+#include "lru_list.h"
 #include "sockets.h"
+#include "util.h"
 #include "../fwd_policies/fwd_policy.h"
 #include "../liblisp/liblisp.h"
 
@@ -38,34 +40,16 @@
 #define OLD_ENTRIES 1000
 
 static void ttable_remove_with_khiter(ttable_t *tt, khiter_t k);
+static void ttable_remove_key(ttable_t *tt, flow_key_t *key);
 
-static double
-time_diff(struct timespec *x , struct timespec *y)
-{
-    double x_s, y_s, diff;
-
-    x_s = (double)x->tv_sec + 1.0e-9*x->tv_nsec;
-    y_s = (double)y->tv_sec + 1.0e-9*y->tv_nsec;
-
-    diff = (double)y_s - (double)x_s;
-
-    return diff;
-}
-
-static double
-time_elapsed(struct timespec *time_node)
-{
-    struct timespec now;
-    clock_gettime(CLOCK_MONOTONIC, &now);
-    return(time_diff(time_node, &now));
-}
+static mem_slab_t ttable_node_slab = MEM_SLAB_INITIALIZER("ttable_node",
+        ttable_node_t);
 
 static void
 ttable_node_del(ttable_node_t *tn)
 {
-    pkt_tuple_del(tn->tpl);
     fwd_info_del(tn->fi,(fwd_info_data_del)fwd_entry_del);
-    free(tn);
+    mem_slab_free(&ttable_node_slab, tn);
 }
 
 void
@@ -104,72 +88,71 @@ ttable_destroy(ttable_t *tt)
 }
 
 static int
-tnode_expired(ttable_node_t *tn)
+tnode_expired(struct ovs_list *list_elt)
 {
+    ttable_node_t *tn = CONTAINER_OF(list_elt, ttable_node_t, list_elt);
     return(time_elapsed(&tn->ts) > TIMEOUT);
 }
 
+static void
+tnode_remove(ttable_t *tt, struct ovs_list *list_elt)
+{
+    ttable_node_t *tn = CONTAINER_OF(list_elt, ttable_node_t, list_elt);
+    ttable_remove_key(tt, &tn->key);
+}
+
 void
 ttable_insert(ttable_t *tt, packet_tuple_t *tpl, fwd_info_t *fi)
 {
     khiter_t k;
-    int ret,i,removed,to_remove;
+    int ret;
     ttable_node_t *node;
-    struct ovs_list *list_elt;
 
-    /* If table is full, lookup and remove expired entries. If it is still
-     * full, remove old entries */
+    /* If table is full, remove expired entries. If it is still full,
+     * remove old entries */
     if (kh_size(tt->htable) >= MAX_SIZE) {
-        OOR_LOG(LDBG_1,"ttable_insert: Max size of forwarding table reached. Removing expired entries");
-        removed = 0;
-        for (k = kh_begin(tt->htable); k != kh_end(tt->htable); ++k){
-            if (!kh_exist(tt->htable, k)){
-                continue;
-            }
-            if (tnode_expired(kh_value(tt->htable,k))){
-                ttable_remove_with_khiter(tt,k);
-                removed++;
-            }
-        }
-        if (removed <  OLD_ENTRIES){
-            OOR_LOG(LDBG_1,"ttable_insert: Max size of forwarding table reached. Removing older entries");
-            to_remove = OLD_ENTRIES - removed;
-            for (i = 0 ; i < to_remove ; i++){
-                list_elt = list_back(&tt->head_list);
-                node = CONTAINER_OF(list_elt, ttable_node_t, list_elt);
-                ttable_remove(tt, node->tpl);
-            }
-        }
+        OOR_LOG(LDBG_1,"ttable_insert: Max size of forwarding table reached. Removing expired and older entries");
+        lru_list_evict(&tt->head_list, OLD_ENTRIES, tt, tnode_expired,
+                (lru_remove_fct)tnode_remove);
     }
 
-    node = xzalloc(sizeof(ttable_node_t));
+    node = mem_slab_alloc(&ttable_node_slab);
     node->fi = fi;
-    node->tpl = tpl;
+    pkt_tuple_to_flow_key(tpl, &node->key);
     clock_gettime(CLOCK_MONOTONIC, &node->ts);
 
-    list_init(&node->list_elt);
-    list_push_front(&tt->head_list, &node->list_elt);
+    lru_list_add(&tt->head_list, &node->list_elt);
 
-    k = kh_put(ttable,tt->htable,tpl,&ret);
+    k = kh_put(ttable,tt->htable,&node->key,&ret);
+    if (ret == 0){
+        /* Replace the entry of the flow. The key points to the old node */
+        list_remove(&kh_value(tt->htable, k)->list_elt);
+        ttable_node_del(kh_value(tt->htable, k));
+        kh_key(tt->htable, k) = &node->key;
+    }
     kh_value(tt->htable, k) = node;
     OOR_LOG(LDBG_3,"ttable_insert: Inserted tupla: %s ", pkt_tuple_to_char(tpl));
 }
 
 void
 ttable_remove(ttable_t *tt, packet_tuple_t *tpl)
+{
+    flow_key_t key;
+
+    pkt_tuple_to_flow_key(tpl, &key);
+    ttable_remove_key(tt, &key);
+}
+
+static void
+ttable_remove_key(ttable_t *tt, flow_key_t *key)
 {
     khiter_t k;
-    ttable_node_t *tn;
 
-    k = kh_get(ttable,tt->htable, tpl);
+    k = kh_get(ttable,tt->htable, key);
     if (k == kh_end(tt->htable)){
         return;
     }
-    tn = kh_value(tt->htable,k);
-    OOR_LOG(LDBG_3,"ttable_remove: Remove tupla: %s ", pkt_tuple_to_char(tn->tpl));
-    list_remove(&tn->list_elt);
-    ttable_node_del(tn);
-    kh_del(ttable,tt->htable,k);
+    ttable_remove_with_khiter(tt, k);
 }
 
 static void
@@ -178,7 +161,7 @@ ttable_remove_with_khiter(ttable_t *tt, khiter_t k)
     ttable_node_t *node;
 
     node = kh_value(tt->htable,k);
-    OOR_LOG(LDBG_3,"ttable_remove_with_khiter: Remove tupla: %s ", pkt_tuple_to_char(node->tpl));
+    OOR_LOG(LDBG_3,"ttable_remove_with_khiter: Remove flow: %s ", flow_key_to_char(&node->key));
     list_remove(&node->list_elt);
     ttable_node_del(node);
     kh_del(ttable,tt->htable,k);
@@ -188,10 +171,12 @@ fwd_info_t *
 ttable_lookup(ttable_t *tt, packet_tuple_t *tpl)
 {
     ttable_node_t *tn;
+    flow_key_t key;
     khiter_t k;
     double elapsed;
 
-    k = kh_get(ttable,tt->htable, tpl);
+    pkt_tuple_to_flow_key(tpl, &key);
+    k = kh_get(ttable,tt->htable, &key);
     if (k == kh_end(tt->htable)){
         return (NULL);
     }
@@ -208,8 +193,7 @@ ttable_lookup(ttable_t *tt, packet_tuple_t *tpl)
         }
     }
 
-    list_remove(&tn->list_elt);
-    list_push_front(&tt->head_list, &tn->list_elt);
+    lru_list_touch(&tt->head_list, &tn->list_elt);
 
     return (tn->fi);
 
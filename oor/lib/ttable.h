@@ -29,12 +29,12 @@ typedef struct fwd_info_ fwd_info_t;
 
 typedef struct ttable_node {
     struct ovs_list list_elt;
-    packet_tuple_t *tpl;
+    flow_key_t key;
     fwd_info_t *fi;
     struct timespec ts;
 } ttable_node_t;
 
-KHASH_INIT(ttable, packet_tuple_t *, ttable_node_t *, 1, pkt_tuple_hash, pkt_tuple_cmp)
+KHASH_INIT(ttable, flow_key_t *, ttable_node_t *, 1, flow_key_hash, flow_key_equal)
 
 typedef struct ttable {
     khash_t(ttable) *htable;
@@ -45,6 +45,7 @@ void ttable_init(ttable_t *tt);
 void ttable_uninit(ttable_t *tt);
 ttable_t *ttable_create();
 void ttable_destroy(ttable_t *tt);
+/* The table keeps a compact copy of the tuple and the ownership of 'fe' */
 void ttable_insert(ttable_t *, packet_tuple_t *tpl, fwd_info_t *fe);
 void ttable_remove(ttable_t *tt, packet_tuple_t *tpl);
 fwd_info_t *ttable_lookup(ttable_t *tt, packet_tuple_t *tpl);
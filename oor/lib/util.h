@@ -20,6 +20,7 @@
 #ifndef UTIL_H_
 #define UTIL_H_
 
+#include <time.h>
 #include "../liblisp/lisp_address.h"
 
 int convert_hex_string_to_bytes(char *hex, uint8_t *bytes, int bytes_len);
@@ -30,6 +31,24 @@ char *get_char_from_xTR_ID (lisp_xtr_id *xtrid);
 void addr_list_rm_not_compatible_addr(glist_t *addr_lst, int compatible_addr_flags);
 uint8_t is_compatible_addr(lisp_addr_t *addr, int compatible_addr_flags);
 
+/* Seconds from 't0' to 't1' */
+static inline double
+time_diff(struct timespec *t1, struct timespec *t0)
+{
+    return ((double)(t1->tv_sec - t0->tv_sec)
+            + 1.0e-9 * (double)(t1->tv_nsec - t0->tv_nsec));
+}
+
+/* Seconds elapsed since 'ts' in the monotonic clock */
+static inline double
+time_elapsed(struct timespec *ts)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (time_diff(&now, ts));
+}
+
 #endif /* UTIL_H_ */
 
 
@@ -99,11 +99,53 @@ lisp_msg_ecm_decap(lbuf_t *pkt, uint16_t *src_port)
     return (GOOD);
 }
 
+/* Length of the encoded address at 'addr'. -1 if the address is not known
+ * or doesn't end before 'end' */
+int
+lisp_msg_addr_len(uint8_t *addr, uint8_t *end)
+{
+    int len;
+
+    if (addr + sizeof(uint16_t) > end) {
+        return(-1);
+    }
+
+    switch (ntohs(*(uint16_t *)addr)) {
+    case LISP_AFI_NO_ADDR:
+        len = sizeof(uint16_t);
+        break;
+    case LISP_AFI_IP:
+        len = sizeof(uint16_t) + sizeof(struct in_addr);
+        break;
+    case LISP_AFI_IPV6:
+        len = sizeof(uint16_t) + sizeof(struct in6_addr);
+        break;
+    case LISP_AFI_LCAF:
+        if (addr + sizeof(lcaf_hdr_t) > end) {
+            return(-1);
+        }
+        len = sizeof(lcaf_hdr_t) + ntohs(LCAF_CAST(addr)->len);
+        break;
+    default:
+        return(-1);
+    }
+
+    if (addr + len > end) {
+        return(-1);
+    }
+    return(len);
+}
+
 int
 lisp_msg_parse_addr(lbuf_t *msg, lisp_addr_t *eid)
 {
-    int len = lisp_addr_parse(lbuf_data(msg), eid);
-    if (len < 0) {
+    int len;
+
+    if (lisp_msg_addr_len(lbuf_data(msg), lbuf_tail(msg)) < 0) {
+        return(BAD);
+    }
+    len = lisp_addr_parse(lbuf_data(msg), eid);
+    if (len <= 0) {
         return(BAD);
     }
     lbuf_pull(msg, len);
@@ -116,29 +158,44 @@ int
 lisp_msg_parse_eid_rec(lbuf_t *msg, lisp_addr_t *eid)
 {
     eid_record_hdr_t *hdr = lbuf_data(msg);
-    int len = lisp_addr_parse(EID_REC_ADDR(hdr), eid);
-    lbuf_pull(msg, len);
+    int len;
+
+    if (lbuf_size(msg) < sizeof(eid_record_hdr_t)
+            || lisp_msg_addr_len(EID_REC_ADDR(hdr), lbuf_tail(msg)) < 0) {
+        OOR_LOG(LDBG_1, "lisp_msg_parse_eid_rec: Truncated EID record");
+        return(BAD);
+    }
+    len = lisp_addr_parse(EID_REC_ADDR(hdr), eid);
+    if (len <= 0) {
+        return(BAD);
+    }
+    lbuf_pull(msg, sizeof(eid_record_hdr_t) + len);
     lisp_addr_set_plen(eid, EID_REC_MLEN(hdr));
 
     return(GOOD);
 }
 
+/* Parse the ITR-RLOCs of a Map-Request and add them to 'rlocs'. If 'arena'
+ * is not NULL, the addresses are allocated in it and 'rlocs' must not free
+ * them */
 int
-lisp_msg_parse_itr_rlocs(lbuf_t *b, glist_t *rlocs)
+lisp_msg_parse_itr_rlocs(lbuf_t *b, glist_t *rlocs, mem_arena_t *arena)
 {
     lisp_addr_t *tloc;
     void *mreq_hdr = lbuf_lisp(b);
     int i;
 
-    tloc = lisp_addr_new();
     for (i = 0; i < MREQ_ITR_RLOC_COUNT(mreq_hdr) + 1; i++) {
+        tloc = arena ? lisp_addr_new_arena(arena) : lisp_addr_new();
         if (lisp_msg_parse_addr(b, tloc) != GOOD) {
+            if (!arena) {
+                lisp_addr_del(tloc);
+            }
             return(BAD);
         }
-        glist_add(lisp_addr_clone(tloc), rlocs);
+        glist_add(tloc, rlocs);
         OOR_LOG(LDBG_1," itr-rloc: %s", lisp_addr_to_char(tloc));
     }
-    lisp_addr_del(tloc);
     return(GOOD);
 }
 
@@ -164,38 +221,115 @@ lisp_msg_parse_loc(lbuf_t *b, locator_t *loc)
     return(GOOD);
 }
 
+/* Take a view of the mapping record at the head of 'b' and pull it. The
+ * whole record, EID and locators, must be within the buffer */
 int
-lisp_msg_parse_mapping_record_split(lbuf_t *b, lisp_addr_t *eid,
-        glist_t *loc_list, locator_t **probed_)
+lisp_msg_pull_rec_view(lbuf_t *b, lisp_rec_view_t *rv)
 {
-    void *mrec_hdr = NULL, *loc_hdr = NULL;
-    locator_t *loc = NULL, *probed = NULL;
-    int i = 0, len = 0;
+    uint8_t *ptr = lbuf_data(b);
+    uint8_t *end = lbuf_tail(b);
+    int i, len;
 
-    probed = NULL;
-    mrec_hdr = lbuf_data(b);
-    lbuf_pull(b, sizeof(mapping_record_hdr_t));
+    if (lbuf_size(b) < sizeof(mapping_record_hdr_t)) {
+        goto trunc;
+    }
+    rv->hdr = (mapping_record_hdr_t *)ptr;
+    rv->eid = ptr + sizeof(mapping_record_hdr_t);
+    if ((len = lisp_msg_addr_len(rv->eid, end)) < 0) {
+        goto trunc;
+    }
+    rv->locs = rv->eid + len;
 
-    len = lisp_addr_parse(lbuf_data(b), eid);
-    if (len <= 0) {
+    ptr = rv->locs;
+    for (i = 0; i < MAP_REC_LOC_COUNT(rv->hdr); i++) {
+        if (ptr + sizeof(locator_hdr_t) > end
+                || (len = lisp_msg_addr_len(LOC_ADDR(ptr), end)) < 0) {
+            goto trunc;
+        }
+        ptr = LOC_ADDR(ptr) + len;
+    }
+    rv->end = ptr;
+
+    lbuf_pull(b, rv->end - (uint8_t *)rv->hdr);
+    return(GOOD);
+
+trunc:
+    OOR_LOG(LDBG_1, "lisp_msg_pull_rec_view: Truncated or unknown mapping "
+            "record");
+    return(BAD);
+}
+
+/* Parse the EID of the record in 'eid', that must be released with
+ * lisp_addr_dealloc */
+int
+lisp_rec_view_eid(lisp_rec_view_t *rv, lisp_addr_t *eid)
+{
+    memset(eid, 0, sizeof(lisp_addr_t));
+    if (lisp_addr_parse(rv->eid, eid) <= 0) {
         return(BAD);
     }
-    lbuf_pull(b, len);
-    lisp_addr_set_plen(eid, MAP_REC_EID_PLEN(mrec_hdr));
+    lisp_addr_set_plen(eid, MAP_REC_EID_PLEN(rv->hdr));
+    return(GOOD);
+}
 
-    OOR_LOG(LDBG_1, "  %s eid: %s", mapping_record_hdr_to_char(mrec_hdr),
-            lisp_addr_to_char(eid));
+/* Move 'lv' to the next locator of the record. Its 'hdr' must be NULL to
+ * get the first one. Returns FALSE when there are no more locators */
+int
+lisp_rec_view_next_loc(lisp_rec_view_t *rv, lisp_loc_view_t *lv)
+{
+    uint8_t *next;
+
+    if (lv->hdr == NULL) {
+        next = rv->locs;
+    } else {
+        next = lv->addr + lisp_msg_addr_len(lv->addr, rv->end);
+    }
+    if (next >= rv->end) {
+        return(FALSE);
+    }
+    lv->hdr = (locator_hdr_t *)next;
+    lv->addr = LOC_ADDR(next);
+    return(TRUE);
+}
+
+/* Parse the address of the locator in 'addr', that must be released with
+ * lisp_addr_dealloc */
+int
+lisp_loc_view_addr(lisp_loc_view_t *lv, lisp_addr_t *addr)
+{
+    memset(addr, 0, sizeof(lisp_addr_t));
+    if (lisp_addr_parse(lv->addr, addr) <= 0) {
+        return(BAD);
+    }
+    return(GOOD);
+}
+
+static int
+lisp_rec_view_split(lisp_rec_view_t *rv, lisp_addr_t *eid, glist_t *loc_list,
+        locator_t **probed_)
+{
+    lisp_loc_view_t lv;
+    locator_t *loc = NULL, *probed = NULL;
+
+    if (lisp_addr_parse(rv->eid, eid) <= 0) {
+        return(BAD);
+    }
+    lisp_addr_set_plen(eid, MAP_REC_EID_PLEN(rv->hdr));
 
-    for (i = 0; i < MAP_REC_LOC_COUNT(mrec_hdr); i++) {
-        loc_hdr = lbuf_data(b);
+    OOR_LOG(LDBG_1, "  %s eid: %s", mapping_record_hdr_to_char(rv->hdr),
+            lisp_addr_to_char(eid));
 
+    lisp_rec_view_foreach_loc(rv, &lv) {
         loc = locator_new();
-        if (lisp_msg_parse_loc(b, loc) != GOOD) {
+        if (locator_parse(lv.hdr, loc) <= 0) {
+            locator_del(loc);
             return(BAD);
         }
+        OOR_LOG(LDBG_1, "    %s, addr: %s", locator_record_hdr_to_char(lv.hdr),
+                lisp_addr_to_char(locator_addr(loc)));
         glist_add(loc, loc_list);
 
-        if (LOC_PROBED(loc_hdr)) {
+        if (LOC_PROBED(lv.hdr)) {
             if (probed != NULL) {
                 OOR_LOG(LDBG_1, "Multiple probed locators! Probing only the first one: %s",
                         lisp_addr_to_char(locator_addr(loc)));
@@ -211,32 +345,38 @@ lisp_msg_parse_mapping_record_split(lbuf_t *b, lisp_addr_t *eid,
     return(GOOD);
 }
 
-/* extracts a mapping record out of lbuf 'b' and stores it into 'm'. 'm' must
- * be preallocated. If a locator is probed, a pointer to it is stored in
- * 'probed'. */
 int
-lisp_msg_parse_mapping_record(lbuf_t *b, mapping_t *m, locator_t **probed)
+lisp_msg_parse_mapping_record_split(lbuf_t *b, lisp_addr_t *eid,
+        glist_t *loc_list, locator_t **probed_)
+{
+    lisp_rec_view_t rv;
+
+    if (lisp_msg_pull_rec_view(b, &rv) != GOOD) {
+        return(BAD);
+    }
+    return(lisp_rec_view_split(&rv, eid, loc_list, probed_));
+}
+
+/* Create the locators of the record and store them, with the EID and the
+ * attributes of the record, into 'm'. If a locator is probed, a pointer to
+ * it is stored in 'probed' */
+int
+lisp_rec_view_to_mapping(lisp_rec_view_t *rv, mapping_t *m, locator_t **probed)
 {
     glist_t *loc_list;
     glist_entry_t *lit;
     locator_t *loc;
     int ret;
-    void *hdr;
-
-    if (!m) {
-        return(BAD);
-    }
 
-    hdr = lbuf_data(b);
-    mapping_set_ttl(m, ntohl(MAP_REC_TTL(hdr)));
-    mapping_set_action(m, MAP_REC_ACTION(hdr));
-    mapping_set_auth(m, MAP_REC_AUTH(hdr));
+    mapping_set_ttl(m, ntohl(MAP_REC_TTL(rv->hdr)));
+    mapping_set_action(m, MAP_REC_ACTION(rv->hdr));
+    mapping_set_auth(m, MAP_REC_AUTH(rv->hdr));
+    mapping_set_version(m, MAP_REC_VERSION(rv->hdr));
 
     /* no free is called when destroyed*/
     loc_list = glist_new();
 
-    ret = lisp_msg_parse_mapping_record_split(b, mapping_eid(m), loc_list,
-                                              probed);
+    ret = lisp_rec_view_split(rv, mapping_eid(m), loc_list, probed);
     if (ret != GOOD) {
         goto err;
     }
@@ -244,6 +384,9 @@ lisp_msg_parse_mapping_record(lbuf_t *b, mapping_t *m, locator_t **probed)
     glist_for_each_entry(lit, loc_list) {
         loc = glist_entry_data(lit);
         if ((ret = mapping_add_locator(m, loc)) != GOOD) {
+            if (probed != NULL && *probed == loc) {
+                *probed = NULL;
+            }
             locator_del(loc);
             if (ret != ERR_EXIST){
                 goto err;
@@ -259,6 +402,71 @@ err:
     return(BAD);
 }
 
+/* extracts a mapping record out of lbuf 'b' and stores it into 'm'. 'm' must
+ * be preallocated. If a locator is probed, a pointer to it is stored in
+ * 'probed'. */
+int
+lisp_msg_parse_mapping_record(lbuf_t *b, mapping_t *m, locator_t **probed)
+{
+    lisp_rec_view_t rv;
+
+    if (!m) {
+        return(BAD);
+    }
+
+    if (lisp_msg_pull_rec_view(b, &rv) != GOOD) {
+        return(BAD);
+    }
+    return(lisp_rec_view_to_mapping(&rv, m, probed));
+}
+
+/* Compare the locators of the record with the ones of 'm', as mapping_cmp
+ * does, without creating them. Returns 0 if they are the same and 1
+ * otherwise */
+int
+lisp_rec_view_cmp_locators(lisp_rec_view_t *rv, mapping_t *m)
+{
+    loct_vec_t *vec = mapping_loct_vec(m);
+    loct_vec_elt_t *elt;
+    lisp_loc_view_t lv;
+    lisp_addr_t addr;
+    uint64_t matched = 0;
+    int idx;
+
+    /* Locators without address are never equal */
+    if (vec->inactive != 0 || vec->count > 64
+            || MAP_REC_LOC_COUNT(rv->hdr) != vec->count) {
+        return(1);
+    }
+
+    lisp_rec_view_foreach_loc(rv, &lv) {
+        if (lisp_loc_view_afi(&lv) == LISP_AFI_NO_ADDR
+                || lisp_loc_view_addr(&lv, &addr) != GOOD) {
+            return(1);
+        }
+        elt = loct_vec_get_with_addr(vec, &addr);
+        lisp_addr_dealloc(&addr);
+        if (elt == NULL) {
+            return(1);
+        }
+        /* Each locator of the record must match a different one */
+        idx = elt - vec->elts;
+        if (matched & (1ULL << idx)) {
+            return(1);
+        }
+        matched |= 1ULL << idx;
+
+        if (elt->priority != LOC_PRIORITY(lv.hdr)
+                || elt->weight != LOC_WEIGHT(lv.hdr)
+                || elt->mpriority != LOC_MPRIORITY(lv.hdr)
+                || elt->mweight != LOC_MWEIGHT(lv.hdr)) {
+            return(1);
+        }
+    }
+
+    return(0);
+}
+
 static unsigned int
 msg_type_to_hdr_len(lisp_msg_type_e type)
 {
@@ -359,6 +567,17 @@ increment_record_count(lbuf_t *b)
 
 }
 
+/* Copy the record of the view, as it is, to the message 'b' */
+void *
+lisp_msg_put_rec_view(lbuf_t *b, lisp_rec_view_t *rv)
+{
+    void *rec;
+
+    rec = lbuf_put(b, rv->hdr, rv->end - (uint8_t *)rv->hdr);
+    increment_record_count(b);
+    return(rec);
+}
+
 void *
 lisp_msg_put_mapping_hdr(lbuf_t *b)
 {
@@ -376,7 +595,8 @@ lisp_msg_put_mapping(
     mapping_record_hdr_t    *rec            = NULL;
     locator_hdr_t           *ploc           = NULL;
     lisp_addr_t             *eid            = NULL;
-    locator_t				*loct			= NULL;
+    loct_vec_t              *vec            = NULL;
+    loct_vec_elt_t          *elt            = NULL;
     int                     locator_count   = 0;
 
     eid = mapping_eid(m);
@@ -384,24 +604,33 @@ lisp_msg_put_mapping(
     MAP_REC_EID_PLEN(rec) = lisp_addr_get_plen(eid);
     MAP_REC_TTL(rec) = htonl(m->ttl);
     MAP_REC_AUTH(rec) = m->authoritative;
+    MAP_REC_SET_VERSION(rec, m->version);
 
     if (lisp_msg_put_addr(b, eid) == NULL) {
         return(NULL);
     }
 
     /* Add locators */
-    mapping_foreach_active_locator(m,loct){
-        if (locator_state(loct) == DOWN){
+    vec = mapping_loct_vec(m);
+    loct_vec_foreach(vec, elt){
+        if (locator_state(elt->loct) == DOWN){
             continue;
         }
-        ploc = lisp_msg_put_locator(b, loct);
-        if (probed_loc)
-            if (probed_loc != NULL
-                    && lisp_addr_cmp(lisp_addr_get_ip_addr(locator_addr(loct)), probed_loc) == 0) {
-                LOC_PROBED(ploc) = 1;
-            }
+        ploc = lbuf_put_uninit(b, sizeof(locator_hdr_t));
+        memset(ploc, 0, sizeof(locator_hdr_t));
+        ploc->priority = elt->priority;
+        ploc->weight = elt->weight;
+        ploc->mpriority = elt->mpriority;
+        ploc->mweight = elt->mweight;
+        ploc->local = elt->loct->L_bit;
+        ploc->reachable = elt->loct->R_bit;
+        lisp_msg_put_addr(b, &elt->addr);
+        if (probed_loc != NULL
+                && lisp_addr_cmp(lisp_addr_get_ip_addr(&elt->addr), probed_loc) == 0) {
+            LOC_PROBED(ploc) = 1;
+        }
         locator_count++;
-    }mapping_foreach_active_locator_end;
+    }
     MAP_REC_LOC_COUNT(rec) = locator_count;
     increment_record_count(b);
 
@@ -501,12 +730,18 @@ lisp_msg_encap(lbuf_t *b, int lp, int rp, lisp_addr_t *la, lisp_addr_t *ra)
     return(lbuf_data(b));
 }
 
+/* Buffers of the control messages received and sent. The headroom covers
+ * the ECM and the inner and outer IP/UDP headers of an encapsulated message.
+ * Only a few are in use at the same time */
+static lbuf_pool_t ctrl_msg_pool = LBUF_POOL_INITIALIZER("ctrl_msg",
+        MAX_IP_PKT_LEN, MAX_LISP_MSG_ENCAP_LEN, 32);
+
 lbuf_t *
 lisp_msg_create_buf()
 {
     lbuf_t* b;
 
-    b = lbuf_new_with_headroom(MAX_IP_PKT_LEN, MAX_LISP_MSG_ENCAP_LEN);
+    b = lbuf_pool_get(&ctrl_msg_pool);
     lbuf_reset_lisp(b);
     return(b);
 }
@@ -574,6 +809,53 @@ lisp_msg_mreq_create(lisp_addr_t *seid, glist_t *itr_rlocs, lisp_addr_t *deid)
     return(b);
 }
 
+/* Map-Request that subscribes the ITR to the changes of the mapping of
+ * 'deid' (LISP Pub/Sub) */
+lbuf_t *
+lisp_msg_pubsub_mreq_create(lisp_addr_t *seid, glist_t *itr_rlocs,
+        lisp_addr_t *deid, lisp_xtr_id *xtr_id, lisp_site_id site_id)
+{
+    eid_record_hdr_t *rec;
+    lbuf_t *b = lisp_msg_create(LISP_MAP_REQUEST);
+
+    if (lisp_msg_put_addr(b, seid) == NULL
+            || lisp_msg_put_itr_rlocs(b, itr_rlocs) == NULL) {
+        lbuf_del(b);
+        return(NULL);
+    }
+
+    rec = lisp_msg_put_eid_rec(b, deid);
+    if (rec == NULL) {
+        lbuf_del(b);
+        return(NULL);
+    }
+    EID_REC_NOTIFY(rec) = 1;
+
+    lbuf_put(b, xtr_id, sizeof(lisp_xtr_id));
+    lbuf_put(b, &site_id, sizeof(lisp_site_id));
+    MREQ_XTR_ID_PRESENT(lisp_msg_hdr(b)) = 1;
+
+    return(b);
+}
+
+/* Get the xTR-ID and Site-ID appended at the end of the LISP message 'b' */
+int
+lisp_msg_parse_xtr_id_site_id(lbuf_t *b, lisp_xtr_id *xtr_id,
+        lisp_site_id *site_id)
+{
+    uint8_t *tail = lbuf_tail(b);
+    int len = sizeof(lisp_xtr_id) + sizeof(lisp_site_id);
+
+    if (tail - (uint8_t *)lbuf_lisp(b) < len) {
+        OOR_LOG(LDBG_1, "lisp_msg_parse_xtr_id_site_id: Truncated message");
+        return(BAD);
+    }
+    memcpy(xtr_id, tail - len, sizeof(lisp_xtr_id));
+    memcpy(site_id, tail - sizeof(lisp_site_id), sizeof(lisp_site_id));
+
+    return(GOOD);
+}
+
 lbuf_t *
 lisp_msg_neg_mrep_create(lisp_addr_t *eid, int ttl, lisp_action_e ac,
         lisp_authoritative_e a, uint64_t nonce)
@@ -625,6 +907,25 @@ lisp_msg_mreg_create(mapping_t *m, lisp_key_type_e keyid)
     return(b);
 }
 
+/* Add the record of 'm' to the Map-Register 'b' if the message doesn't
+ * exceed 'max_len' bytes with it. The first record is always added. Returns
+ * BAD, leaving 'b' as it was, if the record is not added */
+int
+lisp_msg_mreg_put_mapping(lbuf_t *b, mapping_t *m, int max_len)
+{
+    uint32_t size = lbuf_size(b);
+    int rec_count = MREG_REC_COUNT(lisp_msg_hdr(b));
+
+    if (lisp_msg_put_mapping(b, m, NULL) != NULL
+            && (lbuf_size(b) <= max_len || rec_count == 0)) {
+        return(GOOD);
+    }
+
+    lbuf_set_size(b, size);
+    MREG_REC_COUNT(lisp_msg_hdr(b)) = rec_count;
+    return(BAD);
+}
+
 lbuf_t *
 lisp_msg_nat_mreg_create(mapping_t *m,lisp_site_id site_id,
         lisp_xtr_id *xtr_id, lisp_key_type_e keyid)
@@ -774,6 +1075,17 @@ lisp_data_push_hdr(lbuf_t *b, uint32_t iid)
 
 void *
 lisp_data_encap(lbuf_t *b, int lp, int rp, lisp_addr_t *la, lisp_addr_t *ra, uint32_t iid)
+{
+    lisp_data_hdr_t lhdr;
+
+    lisp_data_hdr_init(&lhdr, iid);
+    return (lisp_data_encap_hdr(b, lp, rp, la, ra, &lhdr));
+}
+
+/* Encapsulate with a copy of the LISP header 'lhdr' */
+void *
+lisp_data_encap_hdr(lbuf_t *b, int lp, int rp, lisp_addr_t *la, lisp_addr_t *ra,
+        lisp_data_hdr_t *lhdr)
 {
     int ttl = 0, tos = 0;
 
@@ -781,7 +1093,8 @@ lisp_data_encap(lbuf_t *b, int lp, int rp, lisp_addr_t *la, lisp_addr_t *ra, uin
     ip_hdr_ttl_and_tos(lbuf_data(b), &ttl, &tos);
 
     /* push lisp data hdr */
-    lisp_data_push_hdr(b, iid);
+    memcpy(lbuf_push_uninit(b, sizeof(lisp_data_hdr_t)), lhdr,
+            sizeof(lisp_data_hdr_t));
 
     /* push outer UDP and IP */
     pkt_push_udp_and_ip(b, lp, rp, lisp_addr_ip(la), lisp_addr_ip(ra));
@@ -33,20 +33,56 @@
 #define LISP_ECM_HDR_LEN        4
 #define MAX_LISP_MSG_ENCAP_LEN  2*(MAX_IP_HDR_LEN + UDP_HDR_LEN)+ LISP_ECM_HDR_LEN
 #define MAX_LISP_PKT_ENCAP_LEN  MAX_IP_HDR_LEN + UDP_HDR_LEN + LISP_DATA_HDR_LEN
+/* Maximum size of a Map-Register with several records to fit in a 1500
+ * bytes MTU */
+#define MAX_LISP_MREG_LEN       (1500 - MAX_IP_HDR_LEN - UDP_HDR_LEN)
 
 #define LISP_CONTROL_PORT               4342
 #define LISP_DATA_PORT                  4341
 
 
+/*
+ * Views of the mapping records of a message. A view points into the buffer
+ * of the message, whose bounds are validated once when the view is taken.
+ * Addresses, locators and mappings are only created from it when they are
+ * needed, e.g. when the mapping is stored.
+ */
+typedef struct lisp_loc_view {
+    locator_hdr_t           *hdr;
+    uint8_t                 *addr;      /* Encoded address of the locator */
+} lisp_loc_view_t;
+
+typedef struct lisp_rec_view {
+    mapping_record_hdr_t    *hdr;
+    uint8_t                 *eid;       /* Encoded EID */
+    uint8_t                 *locs;      /* First locator */
+    uint8_t                 *end;       /* End of the record */
+} lisp_rec_view_t;
+
+
 lisp_msg_type_e lisp_msg_type(lbuf_t *);
 int lisp_msg_parse_addr(lbuf_t *, lisp_addr_t *);
 int lisp_msg_parse_eid_rec(lbuf_t *, lisp_addr_t *);
-int lisp_msg_parse_itr_rlocs(lbuf_t *, glist_t *);
+int lisp_msg_parse_itr_rlocs(lbuf_t *, glist_t *, mem_arena_t *);
 int lisp_msg_parse_loc(lbuf_t *, locator_t *);
 int lisp_msg_parse_mapping_record_split(lbuf_t *, lisp_addr_t *, glist_t *,
                                         locator_t **);
 int lisp_msg_parse_mapping_record(lbuf_t *, mapping_t *, locator_t **);
 
+int lisp_msg_addr_len(uint8_t *, uint8_t *);
+int lisp_msg_pull_rec_view(lbuf_t *, lisp_rec_view_t *);
+int lisp_rec_view_eid(lisp_rec_view_t *, lisp_addr_t *);
+int lisp_rec_view_next_loc(lisp_rec_view_t *, lisp_loc_view_t *);
+int lisp_loc_view_addr(lisp_loc_view_t *, lisp_addr_t *);
+int lisp_rec_view_to_mapping(lisp_rec_view_t *, mapping_t *, locator_t **);
+int lisp_rec_view_cmp_locators(lisp_rec_view_t *, mapping_t *);
+void *lisp_msg_put_rec_view(lbuf_t *, lisp_rec_view_t *);
+
+/* Iterate the locators of a record view */
+#define lisp_rec_view_foreach_loc(_rv, _lv) \
+    for ((_lv)->hdr = NULL; lisp_rec_view_next_loc((_rv), (_lv)); )
+static inline uint16_t lisp_loc_view_afi(lisp_loc_view_t *);
+
 int lisp_msg_ecm_decap(struct lbuf *, uint16_t *);
 
 void *lisp_msg_put_addr(lbuf_t *, lisp_addr_t *);
@@ -65,10 +101,14 @@ static inline void lisp_msg_destroy(lbuf_t *);
 static inline void *lisp_msg_hdr(lbuf_t *b);
 
 lbuf_t *lisp_msg_mreq_create(lisp_addr_t *, glist_t *, lisp_addr_t *);
+lbuf_t *lisp_msg_pubsub_mreq_create(lisp_addr_t *, glist_t *, lisp_addr_t *,
+        lisp_xtr_id *, lisp_site_id);
+int lisp_msg_parse_xtr_id_site_id(lbuf_t *, lisp_xtr_id *, lisp_site_id *);
 lbuf_t *lisp_msg_neg_mrep_create(lisp_addr_t *, int, lisp_action_e,
         lisp_authoritative_e, uint64_t);
 lbuf_t *lisp_msg_inf_req_create(mapping_t *m, lisp_key_type_e keyid);
 lbuf_t *lisp_msg_mreg_create(mapping_t *, lisp_key_type_e);
+int lisp_msg_mreg_put_mapping(lbuf_t *, mapping_t *, int max_len);
 lbuf_t *lisp_msg_nat_mreg_create(mapping_t *, lisp_site_id ,
         lisp_xtr_id *, lisp_key_type_e );
 
@@ -87,6 +127,8 @@ void *lisp_msg_pull_auth_field(lbuf_t *b);
 void *lisp_data_push_hdr(lbuf_t *b, uint32_t iid);
 void *lisp_data_pull_hdr(lbuf_t *b);
 void *lisp_data_encap(lbuf_t *, int, int, lisp_addr_t *, lisp_addr_t *, uint32_t);
+void *lisp_data_encap_hdr(lbuf_t *, int, int, lisp_addr_t *, lisp_addr_t *,
+        lisp_data_hdr_t *);
 
 static inline glist_t *laddr_list_new();
 static inline void laddr_list_init(glist_t *);
@@ -125,6 +167,13 @@ lisp_msg_auth_record(lbuf_t *b)
     return((uint8_t *)lbuf_lisp(b) + sizeof(map_notify_hdr_t));
 }
 
+/* LISP AFI of the address of a locator view */
+static inline uint16_t
+lisp_loc_view_afi(lisp_loc_view_t *lv)
+{
+    return(ntohs(*(uint16_t *)lv->addr));
+}
+
 
 
 static inline glist_t *
@@ -22,6 +22,9 @@
 #include "../lib/oor_log.h"
 
 
+static mem_slab_t lisp_addr_slab = MEM_SLAB_INITIALIZER("lisp_addr",
+        lisp_addr_t);
+
 static inline lm_afi_t get_lafi_(lisp_addr_t *laddr);
 static inline void set_lafi_(lisp_addr_t *laddr, lm_afi_t lafi);
 static inline lisp_addr_t *new_no_addr_();
@@ -128,7 +131,19 @@ lisp_addr_new_lafi(uint8_t lafi)
 inline lisp_addr_t *
 lisp_addr_new()
 {
-    return (xzalloc(sizeof(lisp_addr_t)));
+    return (mem_slab_alloc(&lisp_addr_slab));
+}
+
+/* Address allocated in 'arena'. It must not be freed with lisp_addr_del */
+lisp_addr_t *
+lisp_addr_new_arena(mem_arena_t *arena)
+{
+    lisp_addr_t *laddr;
+
+    laddr = mem_arena_alloc(arena, sizeof(lisp_addr_t));
+    mem_arena_add_cleanup(arena, (mem_arena_cleanup_fct)lisp_addr_dealloc,
+            laddr);
+    return (laddr);
 }
 
 inline void
@@ -142,11 +157,11 @@ lisp_addr_del(lisp_addr_t *laddr)
     case LM_AFI_IP:
     case LM_AFI_IPPREF:
     case LM_AFI_NO_ADDR:
-        free(laddr);
+        mem_slab_free(&lisp_addr_slab, laddr);
         break;
     case LM_AFI_LCAF:
         lcaf_addr_del_addr(get_lcaf_(laddr));
-        free(laddr);
+        mem_slab_free(&lisp_addr_slab, laddr);
         break;
     default:
         OOR_LOG(LWRN, "lisp_addr_delete: unknown lisp addr afi %d",
@@ -22,6 +22,7 @@
 
 #include "lisp_ip.h"
 #include "lisp_lcaf.h"
+#include "../lib/mem_util.h"
 #include "lisp_messages.h"
 
 
@@ -61,6 +62,7 @@ struct _lisp_addr_t {
 
 
 lisp_addr_t *lisp_addr_new();
+lisp_addr_t *lisp_addr_new_arena(mem_arena_t *arena);
 lisp_addr_t *lisp_addr_new_lafi(uint8_t lafi);
 void lisp_addr_del(lisp_addr_t *laddr);
 void lisp_addr_dealloc(lisp_addr_t *addr);
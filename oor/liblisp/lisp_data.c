@@ -49,3 +49,56 @@ lisp_data_hdr_init(lisp_data_hdr_t *lhdr, uint32_t iid)
     lhdr->nonce_present = 0;
     lhdr->rflags = 0;
 }
+
+void
+lisp_data_hdr_set_nonce(lisp_data_hdr_t *lhdr, uint32_t nonce, uint8_t echo_req)
+{
+    lhdr->nonce_present = 1;
+    lhdr->echo_nonce = echo_req ? 1 : 0;
+    pkt_add_uint32_in_3bytes(lhdr->nonce, nonce);
+}
+
+uint32_t
+lisp_data_hdr_get_nonce(lisp_data_hdr_t *lhdr)
+{
+    return (pkt_get_uint32_from_3bytes(lhdr->nonce));
+}
+
+void
+lisp_data_hdr_set_lsb(lisp_data_hdr_t *lhdr, uint32_t lsb)
+{
+    lhdr->lsb = 1;
+    /* Without instance ID, the 24 bits of the IID are the high order bits */
+    if (!lhdr->instance_id){
+        pkt_add_uint32_in_3bytes(lhdr->iid, lsb >> 8);
+    }
+    lhdr->lsb_bits = lsb & 0xff;
+}
+
+uint32_t
+lisp_data_hdr_get_lsb(lisp_data_hdr_t *lhdr)
+{
+    if (lhdr->instance_id){
+        return (lhdr->lsb_bits);
+    }
+    return ((pkt_get_uint32_from_3bytes(lhdr->iid) << 8) | lhdr->lsb_bits);
+}
+
+void
+lisp_data_hdr_set_map_versions(lisp_data_hdr_t *lhdr, uint16_t src_ver,
+        uint16_t dst_ver)
+{
+    lhdr->map_version = 1;
+    pkt_add_uint32_in_3bytes(lhdr->nonce,
+            ((uint32_t)(src_ver & 0xfff) << 12) | (dst_ver & 0xfff));
+}
+
+void
+lisp_data_hdr_get_map_versions(lisp_data_hdr_t *lhdr, uint16_t *src_ver,
+        uint16_t *dst_ver)
+{
+    uint32_t versions = pkt_get_uint32_from_3bytes(lhdr->nonce);
+
+    *src_ver = (versions >> 12) & 0xfff;
+    *dst_ver = versions & 0xfff;
+}
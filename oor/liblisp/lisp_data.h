@@ -46,9 +46,26 @@
      uint8_t lsb_bits;
  } lisp_data_hdr_t;
 
+/* Locator-Status-Bits available: 8 with instance ID and 32 without it */
+#define LDHDR_LSB_COUNT(h_) ((h_)->instance_id ? 8 : 32)
+
 uint32_t lisp_data_hdr_get_iid(lisp_data_hdr_t *hdr);
 
 void lisp_data_hdr_init(lisp_data_hdr_t *lhdr, uint32_t iid);
+/* Set the 24 bits nonce with the N bit. With 'echo_req' the E bit is also
+ * set to request the ETR to echo the nonce */
+void lisp_data_hdr_set_nonce(lisp_data_hdr_t *lhdr, uint32_t nonce,
+        uint8_t echo_req);
+uint32_t lisp_data_hdr_get_nonce(lisp_data_hdr_t *lhdr);
+/* Set the Locator-Status-Bits with the L bit. Bit 0 is the first locator */
+void lisp_data_hdr_set_lsb(lisp_data_hdr_t *lhdr, uint32_t lsb);
+uint32_t lisp_data_hdr_get_lsb(lisp_data_hdr_t *lhdr);
+/* Set the Source and Dest Map-Versions (RFC 6834) with the V bit. They use
+ * the nonce field: the N bit must not be set */
+void lisp_data_hdr_set_map_versions(lisp_data_hdr_t *lhdr, uint16_t src_ver,
+        uint16_t dst_ver);
+void lisp_data_hdr_get_map_versions(lisp_data_hdr_t *lhdr, uint16_t *src_ver,
+        uint16_t *dst_ver);
 
 #define LISPDATA_HDR_CAST(h_) ((lisp_data_hdr_t *)(h_))
 #define LDHDR_LSB_BIT(h_) (LISPDATA_HDR_CAST((h_)))->instance_id
@@ -23,10 +23,12 @@
 #include "../lib/oor_log.h"
 
 
+static mem_slab_t locator_slab = MEM_SLAB_INITIALIZER("locator", locator_t);
+
 locator_t *
 locator_new()
 {
-    return (xzalloc(sizeof(locator_t)));
+    return (mem_slab_alloc(&locator_slab));
 }
 
 locator_t *
@@ -127,7 +129,7 @@ locator_del(locator_t *locator)
     }
 
     lisp_addr_del(locator->addr);
-    free(locator);
+    mem_slab_free(&locator_slab, locator);
     locator = NULL;
 }
 
@@ -137,6 +139,7 @@ locator_clone(locator_t *loc)
 {
     locator_t *locator = locator_new_init(loc->addr, loc->state,loc->L_bit, loc->R_bit,
             loc->priority, loc->weight, loc->mpriority, loc->mweight);
+    locator->rtt = loc->rtt;
 
     return (locator);
 }
@@ -312,3 +315,138 @@ locator_list_cmp_afi(glist_t *loct_list_a,glist_t *loct_list_b)
 
     return (lisp_addr_cmp_afi(addr_a,addr_b));
 }
+
+
+/* Order of the locators in a loct_vec_t: lafi, afi or LCAF type, priority
+ * and, for IP locators, address */
+static int
+loct_vec_elt_order(const void *a, const void *b)
+{
+    lisp_addr_t *addr1 = &((loct_vec_elt_t *)a)->addr;
+    lisp_addr_t *addr2 = &((loct_vec_elt_t *)b)->addr;
+    int prio1 = ((loct_vec_elt_t *)a)->priority;
+    int prio2 = ((loct_vec_elt_t *)b)->priority;
+    int afi1, afi2;
+
+    if (lisp_addr_lafi(addr1) != lisp_addr_lafi(addr2)){
+        return (lisp_addr_lafi(addr1) < lisp_addr_lafi(addr2) ? -1 : 1);
+    }
+    afi1 = lisp_addr_ip_afi_lcaf_type(addr1);
+    afi2 = lisp_addr_ip_afi_lcaf_type(addr2);
+    if (afi1 != afi2){
+        return (afi1 < afi2 ? -1 : 1);
+    }
+    if (prio1 != prio2){
+        return (prio1 < prio2 ? -1 : 1);
+    }
+    if (lisp_addr_lafi(addr1) == LM_AFI_IP){
+        return (memcmp(ip_addr_get_addr(lisp_addr_ip(addr1)),
+                ip_addr_get_addr(lisp_addr_ip(addr2)),
+                ip_addr_get_size(lisp_addr_ip(addr1))));
+    }
+    return (0);
+}
+
+/* Fill the vector with the active locators of the lists of a mapping */
+void
+loct_vec_build(loct_vec_t *vec, glist_t *locators_lists)
+{
+    glist_entry_t *it_list, *it_loct;
+    glist_t *loct_list;
+    locator_t *loct;
+    loct_vec_elt_t *elt;
+    int count = 0;
+
+    loct_vec_reset(vec);
+
+    glist_for_each_entry(it_list, locators_lists){
+        loct_list = (glist_t *)glist_entry_data(it_list);
+        if (glist_size(loct_list) == 0){
+            continue;
+        }
+        loct = (locator_t *)glist_first_data(loct_list);
+        if (lisp_addr_is_no_addr(locator_addr(loct)) == TRUE){
+            vec->inactive += glist_size(loct_list);
+            continue;
+        }
+        count += glist_size(loct_list);
+    }
+
+    if (count > 0){
+        vec->elts = xcalloc(count, sizeof(loct_vec_elt_t));
+        elt = vec->elts;
+        glist_for_each_entry(it_list, locators_lists){
+            loct_list = (glist_t *)glist_entry_data(it_list);
+            if (glist_size(loct_list) == 0){
+                continue;
+            }
+            loct = (locator_t *)glist_first_data(loct_list);
+            if (lisp_addr_is_no_addr(locator_addr(loct)) == TRUE){
+                continue;
+            }
+            glist_for_each_entry(it_loct, loct_list){
+                loct = (locator_t *)glist_entry_data(it_loct);
+                lisp_addr_copy(&elt->addr, locator_addr(loct));
+                elt->loct = loct;
+                elt->priority = loct->priority;
+                elt->weight = loct->weight;
+                elt->mpriority = loct->mpriority;
+                elt->mweight = loct->mweight;
+                elt++;
+            }
+        }
+        qsort(vec->elts, count, sizeof(loct_vec_elt_t), loct_vec_elt_order);
+    }
+    vec->count = count;
+    vec->valid = TRUE;
+}
+
+/* Free the elements of the vector. It has to be built again before using it */
+void
+loct_vec_reset(loct_vec_t *vec)
+{
+    loct_vec_elt_t *elt;
+
+    if (vec->elts != NULL){
+        loct_vec_foreach(vec, elt){
+            lisp_addr_dealloc(&elt->addr);
+        }
+        free(vec->elts);
+    }
+    memset(vec, 0, sizeof(loct_vec_t));
+}
+
+loct_vec_elt_t *
+loct_vec_get_with_addr(loct_vec_t *vec, lisp_addr_t *addr)
+{
+    loct_vec_elt_t *elt;
+    int lafi = lisp_addr_lafi(addr);
+    int afi = lisp_addr_ip_afi_lcaf_type(addr);
+
+    loct_vec_foreach(vec, elt){
+        if (lisp_addr_lafi(&elt->addr) != lafi
+                || lisp_addr_ip_afi_lcaf_type(&elt->addr) != afi){
+            continue;
+        }
+        if (lisp_addr_cmp(&elt->addr, addr) == 0){
+            return (elt);
+        }
+    }
+    return (NULL);
+}
+
+/* Same as locator_cmp: 0 if both elements are equal and 1 otherwise */
+int
+loct_vec_elt_cmp(loct_vec_elt_t *e1, loct_vec_elt_t *e2)
+{
+    if (lisp_addr_cmp(&e1->addr, &e2->addr) != 0) {
+        return (1);
+    }
+    if (e1->priority != e2->priority
+            || e1->weight != e2->weight
+            || e1->mpriority != e2->mpriority
+            || e1->mweight != e2->mweight){
+        return (1);
+    }
+    return (0);
+}
@@ -40,8 +40,36 @@ typedef struct locator {
     uint8_t weight;
     uint8_t mpriority;
     uint8_t mweight;
+    /* Smoothed RTT to the RLOC measured with RLOC probes, in microseconds.
+     * 0 if unknown */
+    uint32_t rtt;
 } locator_t;
 
+/*
+ * Flat copy of the active locators of a mapping, sorted by lafi, afi (or LCAF
+ * type) and priority, with the address stored inline so that the hot paths
+ * walk a single array. The locators stay in their lists: each element points
+ * to its locator, whose state and L and R bits are read through the pointer
+ * as they change in place. The vector is rebuilt from the lists after they
+ * are modified.
+ */
+typedef struct loct_vec_elt {
+    lisp_addr_t addr;
+    locator_t   *loct;
+    uint8_t     priority;
+    uint8_t     weight;
+    uint8_t     mpriority;
+    uint8_t     mweight;
+} loct_vec_elt_t;
+
+typedef struct loct_vec {
+    loct_vec_elt_t  *elts;
+    uint16_t        count;
+    /* Locators without address, not included in the vector */
+    uint16_t        inactive;
+    uint8_t         valid;
+} loct_vec_t;
+
 
 locator_t *locator_new();
 locator_t *
@@ -60,6 +88,14 @@ int locator_cmp_addr (locator_t *loct1,locator_t *loct2);
 glist_t *locator_list_clone(glist_t *llist);
 int locator_list_cmp_afi(glist_t *loct_list_a, glist_t *loct_list_b);
 
+void loct_vec_build(loct_vec_t *vec, glist_t *locators_lists);
+void loct_vec_reset(loct_vec_t *vec);
+loct_vec_elt_t *loct_vec_get_with_addr(loct_vec_t *vec, lisp_addr_t *addr);
+int loct_vec_elt_cmp(loct_vec_elt_t *e1, loct_vec_elt_t *e2);
+
+#define loct_vec_foreach(_vec, _elt) \
+    for ((_elt) = (_vec)->elts; (_elt) < (_vec)->elts + (_vec)->count; (_elt)++)
+
 static inline lisp_addr_t *locator_addr(locator_t *);
 static inline uint8_t locator_state(locator_t *);
 static inline uint8_t locator_L_bit(locator_t *);
@@ -68,11 +104,13 @@ static inline uint8_t locator_priority(locator_t *);
 static inline uint8_t locator_weight(locator_t *);
 static inline uint8_t locator_mpriority(locator_t *);
 static inline uint8_t locator_mweight(locator_t *);
+static inline uint32_t locator_rtt(locator_t *);
 static inline void locator_set_addr(locator_t *, lisp_addr_t *);
 static inline void locator_clone_addr(locator_t *loc, lisp_addr_t *addr);
 static inline void locator_set_state(locator_t *locator, uint8_t state);
 static inline void locator_set_L_bit(locator_t *locator, uint8_t L_bit);
 static inline void locator_set_R_bit(locator_t *locator, uint8_t R_bit);
+static inline void locator_set_rtt(locator_t *locator, uint32_t rtt);
 
 
 
@@ -117,6 +155,11 @@ static inline uint8_t locator_mweight(locator_t *locator)
     return (locator->mweight);
 }
 
+static inline uint32_t locator_rtt(locator_t *locator)
+{
+    return (locator->rtt);
+}
+
 static inline void locator_set_addr(locator_t *loc, lisp_addr_t *addr)
 {
     /* Addr is linked to corresponding interface address */
@@ -146,4 +189,9 @@ static inline void locator_set_R_bit(locator_t *locator, uint8_t R_bit)
     locator->R_bit = R_bit;
 }
 
+static inline void locator_set_rtt(locator_t *locator, uint32_t rtt)
+{
+    locator->rtt = rtt;
+}
+
 #endif /* LISP_LOCATOR_H_ */
@@ -17,14 +17,25 @@
  *
  */
 
+#include "../lib/loct_set.h"
 #include "../lib/oor_log.h"
 #include "lisp_mapping.h"
 
+static mem_slab_t mapping_slab = MEM_SLAB_INITIALIZER("mapping", mapping_t);
+
+/* Version that follows 'version' when the mapping changes. After the
+ * highest one it wraps to 1, skipping the Null Map-Version */
+uint16_t
+map_version_next(uint16_t version)
+{
+    return (version >= MAP_VERSION_MAX ? 1 : version + 1);
+}
+
 inline mapping_t *
 mapping_new()
 {
     mapping_t *mapping;
-    mapping = xzalloc(sizeof(mapping_t));
+    mapping = mem_slab_alloc(&mapping_slab);
     if (mapping == NULL){
 
         return (NULL);
@@ -33,7 +44,7 @@ mapping_new()
             (glist_cmp_fct) locator_list_cmp_afi,
             (glist_del_fct) glist_destroy);
     if (mapping->locators_lists == NULL){
-        free(mapping);
+        mem_slab_free(&mapping_slab, mapping);
         return (NULL);
     }
     return(mapping);
@@ -73,11 +84,16 @@ void mapping_del(mapping_t *m)
     }
 
     /* Free the locators list*/
-    glist_destroy(m->locators_lists);
+    loct_vec_reset(&m->locts);
+    if (m->lset != NULL){
+        loct_set_release(m->lset);
+    }else{
+        glist_destroy(m->locators_lists);
+    }
 
     /*  MUST free lcaf addr */
     lisp_addr_dealloc(mapping_eid(m));
-    free(m);
+    mem_slab_free(&mapping_slab, m);
 }
 
 
@@ -86,14 +102,9 @@ void mapping_del(mapping_t *m)
 int
 mapping_cmp(mapping_t *m1, mapping_t *m2)
 {
-    glist_t *loct_list1 = NULL;
-    glist_t *loct_list2 = NULL;
-    locator_t *loct1 = NULL;
-    locator_t *loct2 = NULL;
-    glist_entry_t *it_list1 = NULL;
-    glist_entry_t *it_list2 = NULL;
-    glist_entry_t *it_loct1 = NULL;
-    glist_entry_t *it_loct2 = NULL;
+    loct_vec_t *vec1 = NULL;
+    loct_vec_t *vec2 = NULL;
+    int i;
 
     if (lisp_addr_cmp(mapping_eid(m1), mapping_eid(m2)) != 0) {
         return (1);
@@ -101,29 +112,19 @@ mapping_cmp(mapping_t *m1, mapping_t *m2)
     if (m1->locator_count != m2->locator_count) {
         return (1);
     }
-    if (glist_size(m1->locators_lists) != glist_size(m2->locators_lists)){
+
+    vec1 = mapping_loct_vec(m1);
+    vec2 = mapping_loct_vec(m2);
+    /* Locators without address are never equal */
+    if (vec1->count != vec2->count || vec1->inactive != 0
+            || vec2->inactive != 0){
         return (1);
     }
 
-    it_list2 = glist_first(m2->locators_lists);
-    glist_for_each_entry(it_list1,m1->locators_lists){
-        loct_list1 = (glist_t *)glist_entry_data(it_list1);
-        loct_list2 = (glist_t *)glist_entry_data(it_list2);
-        if (glist_size(loct_list1) != glist_size(loct_list2)){
+    for (i = 0; i < vec1->count; i++){
+        if (loct_vec_elt_cmp(&vec1->elts[i], &vec2->elts[i]) != 0) {
             return (1);
         }
-        it_loct2 = glist_first(loct_list2);
-        glist_for_each_entry(it_loct1,loct_list1){
-            loct1 = (locator_t *)glist_entry_data(it_loct1);
-            loct2 = (locator_t *)glist_entry_data(it_loct2);
-
-            if (locator_cmp(loct1, loct2) != 0) {
-                return (1);
-            }
-            it_loct2 = glist_next(it_loct2);
-        }
-        it_list2 = glist_next(it_list2);
-
     }
 
     return (0);
@@ -140,6 +141,7 @@ mapping_clone(mapping_t *m) {
     mapping_set_eid(cm, mapping_eid(m));
     cm->action = m->action;
     cm->authoritative = m->authoritative;
+    cm->version = m->version;
     cm->locator_count = m->locator_count;
     cm->ttl = m->ttl;
 
@@ -156,9 +158,10 @@ mapping_to_char(mapping_t *m)
 
     *buf = '\0';
     snprintf(buf,buf_size, "EID: %s, ttl: %d, loc-count: %d, action: %s, "
-            "auth: %d\n", lisp_addr_to_char(mapping_eid(m)), mapping_ttl(m),
-            mapping_locator_count(m),
-            mapping_action_to_char(mapping_action(m)), mapping_auth(m));
+            "auth: %d, version: %d\n", lisp_addr_to_char(mapping_eid(m)),
+            mapping_ttl(m), mapping_locator_count(m),
+            mapping_action_to_char(mapping_action(m)), mapping_auth(m),
+            mapping_version(m));
 
     if (m->locator_count > 0) {
         mapping_foreach_active_locator(m,locator){
@@ -180,6 +183,8 @@ mapping_add_locator(
 
 	int result = GOOD;
 
+	loct_set_unshare(mapping, TRUE);
+	loct_vec_reset(&mapping->locts);
 	addr = locator_addr(loct);
 
 	loct_list = mapping_get_loct_lst_with_addr_type(mapping,addr);
@@ -197,7 +202,7 @@ mapping_add_locator(
 			OOR_LOG(LDBG_2, "mapping_add_locator: The locator %s already exists "
 					"for the EID %s. Discarding the one with less priority", lisp_addr_to_char(locator_addr(loct)),
 					lisp_addr_to_char(mapping_eid(mapping)));
-			aux_loct = mapping_get_loct_with_addr(mapping, locator_addr(loct));
+			aux_loct = locator_list_get_locator_with_addr(loct_list, addr);
 			if (locator_priority(aux_loct) > locator_priority(loct)){
 			    /* Returns good in order the caller of this functione doesn't free the memory of the locator */
 			    glist_remove_obj_with_ptr(aux_loct,loct_list);
@@ -228,7 +233,8 @@ mapping_add_locator(
 	return (result);
 }
 
-/* This function extract the locator from the list of locators of the mapping */
+/* This function extract the locator from the list of locators of the mapping.
+ * It can't be used with the locators of an interned mapping */
 int
 mapping_remove_locator(
         mapping_t *mapping,
@@ -237,6 +243,13 @@ mapping_remove_locator(
     lisp_addr_t *addr = NULL;
     glist_t *loct_list = NULL;
 
+    if (mapping->lset != NULL){
+        OOR_LOG(LERR,"mapping_remove_locator: The locators of the mapping %s "
+                "are shared. It should never happen",
+                lisp_addr_to_char(mapping_eid(mapping)));
+        return (BAD);
+    }
+    loct_vec_reset(&mapping->locts);
     addr = locator_addr(loct);
 
     loct_list = mapping_get_loct_lst_with_addr_type(mapping,addr);
@@ -274,6 +287,11 @@ mapping_remove_locator(
 void
 mapping_remove_locators(mapping_t *mapping)
 {
+    loct_vec_reset(&mapping->locts);
+    if (mapping->lset != NULL){
+        loct_set_unshare(mapping, FALSE);
+        return;
+    }
     glist_remove_all(mapping->locators_lists);
     mapping->locator_count = 0;
 }
@@ -294,7 +312,7 @@ mapping_update_locators(mapping_t *mapping, glist_t *locts_lists)
     }
 
     /* TODO: do a comparison first */
-    glist_remove_all(mapping->locators_lists);
+    mapping_remove_locators(mapping);
 
     glist_for_each_entry(it_list,locts_lists){
         loct_list = (glist_t *)glist_entry_data(it_list);
@@ -317,6 +335,12 @@ mapping_get_loct_with_addr(mapping_t *mapping, lisp_addr_t *address)
 {
     locator_t *locator = NULL;
     glist_t *locator_list = NULL;
+    loct_vec_elt_t *elt = NULL;
+
+    if (lisp_addr_is_no_addr(address) == FALSE){
+        elt = loct_vec_get_with_addr(mapping_loct_vec(mapping), address);
+        return (elt ? elt->loct : NULL);
+    }
 
     locator_list = mapping_get_loct_lst_with_addr_type(mapping,address);
 
@@ -415,6 +439,8 @@ mapping_sort_locators(mapping_t *mapping, lisp_addr_t *changed_loc_addr)
     locator_t      *locator = NULL;
     int            res = 0;
 
+    loct_set_unshare(mapping, TRUE);
+    loct_vec_reset(&mapping->locts);
     loct_list = mapping_get_loct_lst_with_addr_type(mapping,changed_loc_addr);
 
     locator = locator_list_extract_locator_with_addr(loct_list, changed_loc_addr);
@@ -442,6 +468,10 @@ mapping_activate_locator(
     int res = GOOD;
 
     glist_t *loct_list = NULL;
+
+    if (mapping->lset != NULL){
+        return (BAD);
+    }
     loct_list = mapping_get_loct_lst_with_afi(mapping,LM_AFI_NO_ADDR,0);
     if (loct_list == NULL){
         return (BAD);
@@ -464,3 +494,25 @@ mapping_activate_locator(
     }
     return (res);
 }
+
+/* Flat vector with the active locators of the mapping. It is shared by all
+ * the mappings of a locator set */
+loct_vec_t *
+mapping_loct_vec(mapping_t *mapping)
+{
+    loct_vec_t *vec;
+
+    vec = mapping->lset != NULL ? &mapping->lset->locts : &mapping->locts;
+    if (!vec->valid){
+        loct_vec_build(vec, mapping->locators_lists);
+    }
+    return (vec);
+}
+
+/* To be called after modifying in place the address of a locator of the
+ * mapping */
+void
+mapping_locators_changed(mapping_t *mapping)
+{
+    loct_vec_reset(&mapping->locts);
+}
@@ -32,6 +32,8 @@ typedef enum {
 
 typedef void (*extended_info_del_fct)(void *);
 
+struct loct_set;
+
 typedef struct mapping {
     lisp_addr_t                     eid_prefix;
     uint16_t                        locator_count;
@@ -41,10 +43,24 @@ typedef struct mapping {
     uint32_t                        ttl;
     uint8_t                         action;
     uint8_t                         authoritative;
+    /* Map-Version number (RFC 6834). MAP_VERSION_NULL when not versioned */
+    uint16_t                        version;
 
     uint32_t                        iid;                /*to remove in future*/
+
+    /* Interned set the locators belong to. NULL if the mapping owns them */
+    struct loct_set                 *lset;
+    /* Flat copy of the locators, built on demand by mapping_loct_vec */
+    loct_vec_t                      locts;
 } mapping_t;
 
+/* Map-Versions are 12 bits numbers. The Null Map-Version is never used by a
+ * versioned mapping */
+#define MAP_VERSION_NULL    0
+#define MAP_VERSION_MAX     4095
+
+uint16_t map_version_next(uint16_t version);
+
 mapping_t *mapping_new();
 mapping_t *mapping_new_init(lisp_addr_t *);
 void mapping_del(mapping_t *);
@@ -63,18 +79,23 @@ glist_t *mapping_get_loct_lst_with_addr_type(mapping_t * mapping,lisp_addr_t *ad
 uint8_t mapping_has_locator(mapping_t *mapping, locator_t *loct);
 int mapping_sort_locators(mapping_t *, lisp_addr_t *);
 int mapping_activate_locator(mapping_t *map,locator_t *loct, lisp_addr_t *new_addr);
+loct_vec_t *mapping_loct_vec(mapping_t *m);
+void mapping_locators_changed(mapping_t *m);
 
 static inline lisp_addr_t *mapping_eid(mapping_t *m);
 static inline void mapping_set_eid(mapping_t *m, lisp_addr_t *addr);
 static inline void mapping_set_iid(mapping_t *m, uint32_t iid);
 static inline glist_t *mapping_locators_lists(mapping_t *m);
 static inline uint16_t mapping_locator_count(mapping_t *);
+static inline struct loct_set *mapping_loct_set(mapping_t *);
 static inline uint32_t mapping_ttl(mapping_t *);
 static inline void mapping_set_ttl(mapping_t *, uint32_t);
 static inline uint8_t mapping_action(mapping_t *);
 static inline void mapping_set_action(mapping_t *, uint8_t);
 static inline uint8_t mapping_auth(const mapping_t *);
 static inline void mapping_set_auth(mapping_t *, uint8_t);
+static inline uint16_t mapping_version(const mapping_t *);
+static inline void mapping_set_version(mapping_t *, uint16_t);
 
 /*****************************************************************************/
 
@@ -104,6 +125,11 @@ static inline uint16_t mapping_locator_count(mapping_t *m)
     return(m->locator_count);
 }
 
+static inline struct loct_set *mapping_loct_set(mapping_t *m)
+{
+    return(m->lset);
+}
+
 
 static inline uint32_t mapping_ttl(mapping_t *m)
 {
@@ -135,6 +161,16 @@ static inline void mapping_set_auth(mapping_t *m, uint8_t a)
     m->authoritative = a;
 }
 
+static inline uint16_t mapping_version(const mapping_t *m)
+{
+    return(m->version);
+}
+
+static inline void mapping_set_version(mapping_t *m, uint16_t v)
+{
+    m->version = v;
+}
+
 /* For all locators */
 #define mapping_foreach_locator(_map, _loct) \
         do { \
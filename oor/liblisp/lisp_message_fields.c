@@ -120,6 +120,7 @@ void
 eid_rec_hdr_init(eid_record_hdr_t *ptr)
 {
     ptr->eid_prefix_length = 0;
+    ptr->notify = 0;
     ptr->reserved = 0;
 }
 
@@ -463,7 +463,11 @@ char *mapping_record_hdr_to_char(mapping_record_hdr_t *h);
 #define MAP_REC_AUTH(h) ((mapping_record_hdr_t *)(h))->authoritative
 #define MAP_REC_TTL(h) ((mapping_record_hdr_t *)(h))->ttl
 #define MAP_REC_EID(h) (uint8_t *)(h)+sizeof(mapping_record_hdr_t)
-#define MAP_REC_VERSION(h) (h)->version_hi << 8 | (h)->version_low
+#define MAP_REC_VERSION(h) ((h)->version_hi << 8 | (h)->version_low)
+#define MAP_REC_SET_VERSION(h, v_) do { \
+        (h)->version_hi = ((v_) >> 8) & 0xf; \
+        (h)->version_low = (v_) & 0xff; \
+    } while (0)
 
 typedef enum lisp_actions {
     ACT_NO_ACTION = 0,
@@ -483,15 +487,24 @@ typedef enum lisp_authoritative {
 
 /*
  *      +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
- *    / |   Reserved    | EID mask-len  |        EID-prefix-AFI         |
+ *    / |N|  Reserved   | EID mask-len  |        EID-prefix-AFI         |
  *  Rec +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
  *    \ |                       EID-prefix  ...                         |
  *      +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ *
+ * N: Notification-Requested bit of LISP Pub/Sub. The ITR subscribes to the
+ *    changes of the mapping of the EID-prefix
  */
 
 
 typedef struct _eid_prefix_record_hdr {
-    uint8_t reserved;
+#ifdef LITTLE_ENDIANS
+    uint8_t reserved:7;
+    uint8_t notify:1;
+#else
+    uint8_t notify:1;
+    uint8_t reserved:7;
+#endif
     uint8_t eid_prefix_length;
 } __attribute__ ((__packed__)) eid_record_hdr_t;
 
@@ -499,6 +512,7 @@ void eid_rec_hdr_init(eid_record_hdr_t *ptr);
 
 #define EID_REC_CAST(h_) ((eid_record_hdr_t *)(h_))
 #define EID_REC_MLEN(h_) EID_REC_CAST((h_))->eid_prefix_length
+#define EID_REC_NOTIFY(h_) EID_REC_CAST((h_))->notify
 #define EID_REC_ADDR(h) (uint8_t *)(h) + sizeof(eid_record_hdr_t)
 
 
@@ -45,8 +45,10 @@ map_request_hdr_init(void *ptr)
     mrp->record_count = 0;              /* to be filled in later */
     mrp->nonce = 0;                     /* to be filled in later */
     mrp->pitr = 0;                      /* default not sent by PITR */
+    mrp->xtr_id_present = 0;            /* default no Pub/Sub subscription */
     mrp->reserved1 = 0;
     mrp->reserved2 = 0;
+    mrp->reserved3 = 0;
 }
 
 void
@@ -137,7 +139,7 @@ info_nat_hdr_2_init(void *ptr)
 char *
 mreq_flags_to_char(map_request_hdr_t *h)
 {
-    static char buf[25];
+    static char buf[30];
 
     *buf = '\0';
     h->authoritative ? sprintf(buf+strlen(buf), "a=1,") : sprintf(buf+strlen(buf), "a=0,");
@@ -145,7 +147,8 @@ mreq_flags_to_char(map_request_hdr_t *h)
     h->rloc_probe ? sprintf(buf+strlen(buf), "p=1,") : sprintf(buf+strlen(buf), "p=0,");
     h->solicit_map_request ? sprintf(buf+strlen(buf), "s=1,") : sprintf(buf+strlen(buf), "s=0,");
     h->pitr ? sprintf(buf+strlen(buf), "P=1,") : sprintf(buf+strlen(buf), "P=0,");
-    h->smr_invoked ? sprintf(buf+strlen(buf), "S=1") : sprintf(buf+strlen(buf), "S=0");
+    h->smr_invoked ? sprintf(buf+strlen(buf), "S=1,") : sprintf(buf+strlen(buf), "S=0,");
+    h->xtr_id_present ? sprintf(buf+strlen(buf), "I=1") : sprintf(buf+strlen(buf), "I=0");
     return(buf);
 }
 
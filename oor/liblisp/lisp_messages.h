@@ -114,7 +114,7 @@ void ecm_hdr_init(void *ptr);
  *       0                   1                   2                   3
  *       0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
  *      +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
- *      |Type=1 |A|M|P|S|p|s|    Reserved     |   IRC   | Record Count  |
+ *      |Type=1 |A|M|P|S|p|s|R|I|  Reserved   |   IRC   | Record Count  |
  *      +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
  *      |                         Nonce . . .                           |
  *      +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
@@ -136,6 +136,13 @@ void ecm_hdr_init(void *ptr);
  *      +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
  *      |                     Mapping Protocol Data                     |
  *      +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ *      |                            xTR-ID  ...                        |
+ *      +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ *      |                            Site-ID  ...                       |
+ *      +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ *
+ * I: xTR-ID bit of LISP Pub/Sub. The xTR-ID and the Site-ID of the ITR are
+ *    appended at the end of the message
  */
 
 
@@ -159,13 +166,17 @@ typedef struct map_request_hdr {
     uint8_t solicit_map_request:1;
 #endif
 #ifdef LITTLE_ENDIANS
-    uint8_t reserved1:6;
+    uint8_t reserved1:4;
+    uint8_t xtr_id_present:1;
+    uint8_t reserved3:1;
     uint8_t smr_invoked:1;
     uint8_t pitr:1;
 #else
     uint8_t pitr:1;
     uint8_t smr_invoked:1;
-    uint8_t reserved1:6;
+    uint8_t reserved3:1;
+    uint8_t xtr_id_present:1;
+    uint8_t reserved1:4;
 #endif
 #ifdef LITTLE_ENDIANS
     uint8_t additional_itr_rloc_count:5;
@@ -190,6 +201,7 @@ char *map_request_hdr_to_char(map_request_hdr_t *h);
 #define MREQ_NONCE(h_) (MREQ_HDR_CAST(h_))->nonce
 #define MREQ_SMR(h_) (MREQ_HDR_CAST(h_))->solicit_map_request
 #define MREQ_SMR_INVOKED(h_) (MREQ_HDR_CAST(h_))->smr_invoked
+#define MREQ_XTR_ID_PRESENT(h_) (MREQ_HDR_CAST(h_))->xtr_id_present
 
 
 
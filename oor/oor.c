@@ -255,6 +255,8 @@ signal_handler(int sig) {
 void
 exit_cleanup(void) {
     OOR_LOG(LDBG_2,"Exit Cleanup");
+    mem_stats_dump(LDBG_1);
+    lbuf_pool_stats_dump(LDBG_1);
 
 #ifndef ANDROID
     pid_file_remove();
@@ -520,12 +522,14 @@ main(int argc, char **argv)
     for (;;) {
         sockmstr_wait_on_all_read(smaster);
         sockmstr_process_all(smaster);
+        ctrl_pacer_process(&lctrl->pacer);
         oor_api_loop(&oor_api_connection);
     }
 #else
     for (;;) {
         sockmstr_wait_on_all_read(smaster);
         sockmstr_process_all(smaster);
+        ctrl_pacer_process(&lctrl->pacer);
     }
 
     OOR_LOG(LERR,"Checkpoint 12");
@@ -608,6 +612,7 @@ JNIEXPORT void JNICALL Java_org_openoverlayrouter_noroot_OOR_1JNI_oor_1loop(JNIE
     while (oor_running) {
         sockmstr_wait_on_all_read(smaster);
         sockmstr_process_all(smaster);
+        ctrl_pacer_process(&lctrl->pacer);
     }
     /* event_loop returned: bad! */
     exit_cleanup();
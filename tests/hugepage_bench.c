@@ -0,0 +1,101 @@
+/*
+ * Access benchmark of packet buffers carved from a region backed by huge
+ * pages, compared with buffers allocated with malloc on normal pages. The
+ * headers of the buffers are read and written in a random order, as when
+ * many packets are in flight. Run it under perf to see the TLB misses:
+ *
+ *   perf stat -e dTLB-loads,dTLB-load-misses,dTLB-store-misses \
+ *       ./hugepage_bench [n_bufs] [n_accesses]
+ *
+ * hugepage_bench_normal is built with -DMEM_NO_HUGEPAGES, so that the region
+ * uses normal pages too.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../oor/lib/mem_util.h"
+#include "../oor/lib/oor_log.h"
+
+/* Symbols expected by oor_log.c and mem_util.c */
+int debug_level = 0;
+int daemonize = 0;
+void exit_cleanup(void) { exit(EXIT_FAILURE); }
+
+/* Size of each packet buffer */
+#define BUF_SIZE 2048
+
+static double
+now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec + ts.tv_nsec * 1e-9);
+}
+
+static void
+bench_access(const char *name, uint8_t **bufs, int n_bufs, long n)
+{
+    uint32_t *order, sum = 0;
+    double t0;
+    long i;
+    int j;
+
+    /* Random order of the buffers, so that the accesses don't follow the
+     * pages */
+    order = xmalloc(n_bufs * sizeof(uint32_t));
+    for (j = 0; j < n_bufs; j++) {
+        order[j] = j;
+    }
+    for (j = n_bufs - 1; j > 0; j--) {
+        uint32_t k = random() % (j + 1), tmp = order[j];
+        order[j] = order[k];
+        order[k] = tmp;
+    }
+
+    t0 = now();
+    for (i = 0; i < n; i++) {
+        uint8_t *hdr = bufs[order[i % n_bufs]];
+        /* Read the outer header and rewrite its TTL and checksum */
+        sum += *(uint32_t *)(hdr + 12) + *(uint32_t *)(hdr + 16);
+        hdr[8]--;
+        *(uint16_t *)(hdr + 10) += 1;
+    }
+    printf("%-34s %6.2f ns/access (%u)\n", name, (now() - t0) * 1e9 / n,
+            sum & 1);
+    free(order);
+}
+
+int
+main(int argc, char **argv)
+{
+    int n_bufs = argc > 1 ? atoi(argv[1]) : 65536;
+    long n = argc > 2 ? atol(argv[2]) : 30000000;
+    mem_huge_t region;
+    uint8_t **bufs;
+    char name[64];
+    int i;
+
+    bufs = xmalloc(n_bufs * sizeof(uint8_t *));
+
+    for (i = 0; i < n_bufs; i++) {
+        bufs[i] = xzalloc(BUF_SIZE);
+    }
+    bench_access("malloc, normal pages", bufs, n_bufs, n);
+    for (i = 0; i < n_bufs; i++) {
+        free(bufs[i]);
+    }
+
+    mem_huge_init(&region, "bench", (size_t)n_bufs * BUF_SIZE);
+    for (i = 0; i < n_bufs; i++) {
+        bufs[i] = mem_huge_carve(&region, BUF_SIZE);
+    }
+    snprintf(name, sizeof(name), "region, %s", mem_pages_to_char(region.pages));
+    bench_access(name, bufs, n_bufs, n);
+    mem_huge_uninit(&region);
+
+    free(bufs);
+    return (0);
+}
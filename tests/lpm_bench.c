@@ -0,0 +1,176 @@
+/*
+ * Lookup benchmark of the LPM trie used by the mappings database, compared
+ * with the Patricia tree it replaces for lookups.
+ *
+ * Usage: lpm_bench [n_prefixes] [n_lookups]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/socket.h>
+
+#include "../oor/lib/lpm_trie.h"
+#include "../oor/elibs/patricia/patricia.h"
+
+/* Symbols expected by oor_log.c and mem_util.c */
+int debug_level = 0;
+int daemonize = 0;
+void exit_cleanup(void) { exit(EXIT_FAILURE); }
+
+/* Number of /32 blocks holding the IPv6 prefixes */
+#define V6_POOL_SIZE 20000
+
+static double
+now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec + ts.tv_nsec * 1e-9);
+}
+
+static void
+random_addr(uint8_t *addr, int len)
+{
+    int i;
+    for (i = 0; i < len; i++) {
+        addr[i] = random() & 0xff;
+    }
+}
+
+/* Prefix length following roughly the distribution of a routing table */
+static int
+random_plen(int afi)
+{
+    int r = random() % 100;
+
+    if (afi == AF_INET) {
+        if (r < 55) return (24);
+        if (r < 70) return (22 + random() % 2);
+        if (r < 80) return (16 + random() % 6);
+        return (25 + random() % 8);
+    }
+    if (r < 50) return (48);
+    if (r < 70) return (33 + random() % 15);
+    if (r < 90) return (49 + random() % 16);
+    return (65 + random() % 64);
+}
+
+static void
+bench(int afi, int n_pfx, int n_lookups)
+{
+    int alen = (afi == AF_INET) ? 4 : 16;
+    lpm_trie_t *trie;
+    patricia_tree_t *pt;
+    patricia_node_t *node;
+    prefix_t *prefix;
+    uint8_t *pfxs, *keys, *plens;
+    uint8_t pool[V6_POOL_SIZE * 4];
+    long i, inserted = 0, mismatches = 0;
+    void *r1, *r2;
+    double t0, t_lpm, t_pt;
+    volatile uintptr_t sink = 0;
+
+    pfxs = malloc((size_t)n_pfx * alen);
+    plens = malloc(n_pfx);
+    keys = malloc((size_t)n_lookups * alen);
+    for (i = 0; i < V6_POOL_SIZE; i++) {
+        random_addr(&pool[i * 4], 4);
+        pool[i * 4] = 0x20 | (pool[i * 4] & 0x1f);
+    }
+    trie = lpm_trie_new(alen * 8);
+    pt = New_Patricia(alen * 8);
+
+    t0 = now();
+    for (i = 0; i < n_pfx; i++) {
+        uint8_t *a = &pfxs[i * alen];
+        int plen = random_plen(afi);
+        random_addr(a, alen);
+        if (afi == AF_INET6) {
+            /* Allocations of a pool of /32 blocks in 2000::/3 */
+            memcpy(a, &pool[(random() % V6_POOL_SIZE) * 4], 4);
+        }
+        plens[i] = plen;
+        if (lpm_trie_insert(trie, a, plen, (void *)(i + 1)) != GOOD) {
+            continue;
+        }
+        prefix = New_Prefix(afi, a, plen);
+        node = patricia_lookup(pt, prefix);
+        Deref_Prefix(prefix);
+        node->data = (void *)(i + 1);
+        inserted++;
+    }
+    printf("%s: %ld prefixes inserted in %.2f s, trie memory %.1f MB\n",
+            afi == AF_INET ? "IPv4" : "IPv6", inserted, now() - t0,
+            trie->mem / 1048576.0);
+
+    /* Half of the keys fall inside inserted prefixes */
+    for (i = 0; i < n_lookups; i++) {
+        uint8_t *k = &keys[i * alen];
+        random_addr(k, alen);
+        if (i & 1) {
+            memcpy(k, &pfxs[(random() % n_pfx) * alen], alen / 2);
+        }
+    }
+
+    t0 = now();
+    for (i = 0; i < n_lookups; i++) {
+        sink += (uintptr_t)lpm_trie_lookup(trie, &keys[i * alen]);
+    }
+    t_lpm = now() - t0;
+
+    /* Same work as pt_find_ip_node: a prefix is allocated per lookup */
+    t0 = now();
+    for (i = 0; i < n_lookups; i++) {
+        prefix = New_Prefix(afi, &keys[i * alen], alen * 8);
+        node = patricia_search_best(pt, prefix);
+        Deref_Prefix(prefix);
+        sink += node ? (uintptr_t)node->data : 0;
+    }
+    t_pt = now() - t0;
+
+    for (i = 0; i < n_lookups; i++) {
+        r1 = lpm_trie_lookup(trie, &keys[i * alen]);
+        prefix = New_Prefix(afi, &keys[i * alen], alen * 8);
+        node = patricia_search_best(pt, prefix);
+        Deref_Prefix(prefix);
+        r2 = node ? node->data : NULL;
+        if (r1 != r2) {
+            mismatches++;
+        }
+    }
+
+    printf("%s: %d lookups: lpm trie %.1f ns/lookup, patricia %.1f ns/lookup, "
+            "%ld mismatches\n", afi == AF_INET ? "IPv4" : "IPv6", n_lookups,
+            t_lpm * 1e9 / n_lookups, t_pt * 1e9 / n_lookups, mismatches);
+
+    /* Removing all the prefixes must leave an empty root node */
+    t0 = now();
+    for (i = 0; i < n_pfx; i++) {
+        if (lpm_trie_remove(trie, &pfxs[i * alen], plens[i]) == (void *)(i + 1)) {
+            inserted--;
+        }
+    }
+    printf("%s: prefixes removed in %.2f s, %ld left, %d entries, %zu bytes\n",
+            afi == AF_INET ? "IPv4" : "IPv6", now() - t0, inserted,
+            trie->n_entries, trie->mem);
+
+    lpm_trie_del(trie);
+    Destroy_Patricia(pt, NULL);
+    free(pfxs);
+    free(plens);
+    free(keys);
+}
+
+int
+main(int argc, char **argv)
+{
+    int n_pfx = (argc > 1) ? atoi(argv[1]) : 1000000;
+    int n_lookups = (argc > 2) ? atoi(argv[2]) : 10000000;
+
+    srandom(1);
+    bench(AF_INET, n_pfx, n_lookups);
+    bench(AF_INET6, n_pfx, n_lookups);
+    return (0);
+}
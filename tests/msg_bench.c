@@ -0,0 +1,231 @@
+/*
+ * Parsing benchmark of the control messages handled on every Map-Register
+ * and Map-Request, measuring the allocator used for the parsed objects.
+ * Build it also with -DMEM_NO_SLAB to compare with plain malloc.
+ * The Map-Register record is also processed through a record view, as the
+ * Map-Server does with the refreshes of an already registered site.
+ * The creation of Map-Requests measures the pool of message buffers.
+ *
+ * Usage: msg_bench [n_msgs]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../oor/liblisp/liblisp.h"
+#include "../oor/lib/mem_util.h"
+#include "../oor/lib/oor_log.h"
+
+/* Symbols expected by oor_log.c and mem_util.c */
+int debug_level = 0;
+int daemonize = 0;
+void exit_cleanup(void) { exit(EXIT_FAILURE); }
+
+static double
+now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec + ts.tv_nsec * 1e-9);
+}
+
+static void
+report(const char *name, long n, double t)
+{
+    printf("%-28s %8.1f ns/msg %12.0f msgs/s\n", name, t * 1e9 / n, n / t);
+}
+
+static lbuf_t *
+build_map_register()
+{
+    lisp_addr_t eid, rloc;
+    mapping_t *m;
+    locator_t *loc;
+    lbuf_t *b;
+
+    lisp_addr_ippref_from_char("10.1.2.0/24", &eid);
+    m = mapping_new_init(&eid);
+    lisp_addr_ip_from_char("192.0.2.1", &rloc);
+    loc = locator_new_init(&rloc, UP, 1, 1, 1, 50, 255, 0);
+    mapping_add_locator(m, loc);
+    lisp_addr_ip_from_char("198.51.100.7", &rloc);
+    loc = locator_new_init(&rloc, UP, 0, 1, 1, 50, 255, 0);
+    mapping_add_locator(m, loc);
+
+    b = lisp_msg_mreg_create(m, HMAC_SHA_1_96);
+    mapping_del(m);
+    return (b);
+}
+
+static lbuf_t *
+build_map_request()
+{
+    lisp_addr_t seid, deid, rloc1, rloc2;
+    glist_t *rlocs;
+    lbuf_t *b;
+
+    lisp_addr_ip_from_char("10.1.2.3", &seid);
+    lisp_addr_ippref_from_char("10.9.8.0/24", &deid);
+    lisp_addr_ip_from_char("192.0.2.1", &rloc1);
+    lisp_addr_ip_from_char("2001:db8::1", &rloc2);
+    rlocs = glist_new();
+    glist_add(&rloc1, rlocs);
+    glist_add(&rloc2, rlocs);
+
+    b = lisp_msg_mreq_create(&seid, rlocs, &deid);
+    glist_destroy(rlocs);
+    return (b);
+}
+
+static void
+bench_map_register(lbuf_t *msg, long n)
+{
+    lbuf_t b;
+    mapping_t *m;
+    double t0;
+    long i;
+
+    t0 = now();
+    for (i = 0; i < n; i++) {
+        b = *msg;
+        lisp_msg_pull_hdr(&b);
+        lisp_msg_pull_auth_field(&b);
+        m = mapping_new();
+        if (lisp_msg_parse_mapping_record(&b, m, NULL) != GOOD) {
+            printf("Map-Register parsing failed\n");
+            exit(EXIT_FAILURE);
+        }
+        mapping_del(m);
+    }
+    report("Map-Register record", n, now() - t0);
+}
+
+static void
+bench_map_register_view(lbuf_t *msg, long n)
+{
+    lbuf_t b;
+    lisp_rec_view_t rv;
+    lisp_addr_t eid;
+    mapping_t *reg;
+    double t0;
+    long i;
+
+    /* Mapping already registered with the same locators */
+    b = *msg;
+    lisp_msg_pull_hdr(&b);
+    lisp_msg_pull_auth_field(&b);
+    reg = mapping_new();
+    lisp_msg_parse_mapping_record(&b, reg, NULL);
+
+    t0 = now();
+    for (i = 0; i < n; i++) {
+        b = *msg;
+        lisp_msg_pull_hdr(&b);
+        lisp_msg_pull_auth_field(&b);
+        if (lisp_msg_pull_rec_view(&b, &rv) != GOOD
+                || lisp_rec_view_eid(&rv, &eid) != GOOD
+                || lisp_rec_view_cmp_locators(&rv, reg) != 0) {
+            printf("Map-Register view parsing failed\n");
+            exit(EXIT_FAILURE);
+        }
+        lisp_addr_dealloc(&eid);
+    }
+    report("Map-Register record (view)", n, now() - t0);
+    mapping_del(reg);
+}
+
+static void
+bench_map_request(lbuf_t *msg, long n, mem_arena_t *arena)
+{
+    lbuf_t b;
+    lisp_addr_t *seid, *deid;
+    glist_t *itr_rlocs;
+    double t0;
+    long i;
+
+    t0 = now();
+    for (i = 0; i < n; i++) {
+        b = *msg;
+        lisp_msg_pull_hdr(&b);
+        if (arena) {
+            seid = lisp_addr_new_arena(arena);
+            deid = lisp_addr_new_arena(arena);
+            itr_rlocs = glist_new();
+        } else {
+            seid = lisp_addr_new();
+            deid = lisp_addr_new();
+            itr_rlocs = laddr_list_new();
+        }
+        if (lisp_msg_parse_addr(&b, seid) != GOOD
+                || lisp_msg_parse_itr_rlocs(&b, itr_rlocs, arena) != GOOD
+                || lisp_msg_parse_eid_rec(&b, deid) != GOOD) {
+            printf("Map-Request parsing failed\n");
+            exit(EXIT_FAILURE);
+        }
+        glist_destroy(itr_rlocs);
+        if (arena) {
+            mem_arena_reset(arena);
+        } else {
+            lisp_addr_del(seid);
+            lisp_addr_del(deid);
+        }
+    }
+    report(arena ? "Map-Request (arena)" : "Map-Request (heap)", n, now() - t0);
+}
+
+static void
+bench_map_request_create(long n)
+{
+    lisp_addr_t seid, deid, rloc;
+    glist_t *rlocs;
+    lbuf_t *b;
+    double t0;
+    long i;
+
+    lisp_addr_ip_from_char("10.1.2.3", &seid);
+    lisp_addr_ippref_from_char("10.9.8.0/24", &deid);
+    lisp_addr_ip_from_char("192.0.2.1", &rloc);
+    rlocs = glist_new();
+    glist_add(&rloc, rlocs);
+
+    t0 = now();
+    for (i = 0; i < n; i++) {
+        b = lisp_msg_mreq_create(&seid, rlocs, &deid);
+        lisp_msg_encap(b, LISP_CONTROL_PORT, LISP_CONTROL_PORT, &seid, &deid);
+        lisp_msg_destroy(b);
+    }
+    report("Map-Request create + ECM", n, now() - t0);
+    glist_destroy(rlocs);
+}
+
+int
+main(int argc, char **argv)
+{
+    long n = argc > 1 ? atol(argv[1]) : 1000000;
+    mem_arena_t arena;
+    lbuf_t *mreg, *mreq;
+
+    mreg = build_map_register();
+    mreq = build_map_request();
+    mem_arena_init(&arena, "bench", 4096);
+
+#ifdef MEM_NO_SLAB
+    printf("Allocator: malloc\n");
+#else
+    printf("Allocator: slab\n");
+#endif
+    bench_map_register(mreg, n);
+    bench_map_register_view(mreg, n);
+    bench_map_request(mreq, n, NULL);
+    bench_map_request(mreq, n, &arena);
+    bench_map_request_create(n);
+
+    mem_stats_dump(LINF);
+    lbuf_pool_stats_dump(LINF);
+    mem_arena_uninit(&arena);
+    lbuf_del(mreg);
+    lbuf_del(mreq);
+    return (0);
+}